@@ -11,120 +11,152 @@
 #include <d3dx9.h>
 #include <dwmapi.h>
 
+#include <cstddef>
 #include <iostream>
 #include <vector>
 
+#include "Devices/MonitorTable.h"
+#include "Devices/Win32DisplayConfig.h"
+#include "Diagnostics/Instrumentation.h"
+#include "Overlay/CursorChannel.h"
+#include "Overlay/MultiMonitorOverlay.h"
+#include "Overlay/SharedMemoryRegion.h"
+
+using namespace TouchmoteCore;
+
 // Import libraries to link with
 #pragma comment(lib, "d3d9.lib")
 #pragma comment(lib, "d3dx9.lib")
 #pragma comment(lib, "dwmapi.lib")
 
 #define ARGB_TRANS   0x00000000 // 100% alpha
-#define MAX_CURSORS 16
-#define SPRITE_SIZE 128
-
-#define ANIMATION_DURATION 100
+#define SPRITE_SIZE CURSOR_SPRITE_SIZE
 
 #define TEXTURE_PATH L"Resources\\circle.png"
 
+// Dirty rects are copied into the RGNDATA of PresentEx as they are
+static_assert(sizeof(DamageRect) == sizeof(RECT), "DamageRect has the layout of RECT");
+static_assert(offsetof(DamageRect, Left) == offsetof(RECT, left), "DamageRect has the layout of RECT");
+static_assert(offsetof(DamageRect, Top) == offsetof(RECT, top), "DamageRect has the layout of RECT");
+static_assert(offsetof(DamageRect, Right) == offsetof(RECT, right), "DamageRect has the layout of RECT");
+static_assert(offsetof(DamageRect, Bottom) == offsetof(RECT, bottom), "DamageRect has the layout of RECT");
 
-struct D3DCURSOR
-{
-	FLOAT		x,y,rotation,last_rendered_x,last_rendered_y,scaling,snapshot_scaling;
-	BOOL		hidden,enabled,pressed;
-	DWORD		color;
-	clock_t		animationStart;
-};
-
-struct CURSORPTR
+// One layered window and device per monitor, sized to the monitor
+struct MonitorRenderer
 {
-	D3DCURSOR *cursor;
+	HWND                Window;
+	IDirect3DDevice9Ex  *Device;
+	LPD3DXSPRITE        Sprite;
+	LPDIRECT3DTEXTURE9  Circle;
+	// Index into overlay.monitor()
+	int                 Monitor;
+	// Region buffer for PresentEx, grown as needed
+	std::vector<BYTE>   Region;
+	// Rectangles for Clear, reused every frame
+	std::vector<D3DRECT> ClearRects;
 };
 
 // +---------+
 // | Globals |
 // +---------+
 WCHAR                   *g_wcpAppName  = L"D3DCursor";
-INT                     g_iWidth       = 800;
-INT                     g_iHeight      = 600;
 MARGINS                 g_mgDWMMargins = {-1, -1, -1, -1};
 IDirect3D9Ex            *g_pD3D        = NULL;
-IDirect3DDevice9Ex      *g_pD3DDevice  = NULL;
-IDirect3DVertexBuffer9  *g_pVB         = NULL;
-D3DCURSOR				*cursors = new D3DCURSOR[MAX_CURSORS];
-LPD3DXSPRITE g_sprite=NULL;
-LPDIRECT3DTEXTURE9 g_circle=NULL;
-INT enabledCursors = 0;
+MultiMonitorOverlay		overlay;
+std::vector<MonitorRenderer> g_renderers;
+// Cursor state from another process, when a channel is open
+SharedMemoryRegion		*g_channelRegion = NULL;
+CursorChannelReader		*g_channelReader = NULL;
+CursorChannelState		g_channelState;
 
 FLOAT screenRelativeCursorScale = 0.02f;
-FLOAT normalCursorScale = 0.5f;
-FLOAT pressedCursorScale = 0.4f;
-FLOAT hiddenCursorScale = 0.0f;
 
-HWND       hWnd  = NULL;
+HWND       g_hParent = NULL;
+HINSTANCE  g_hInstance = NULL;
+bool       g_topmost = true;
 
 D3DXMATRIX Identity;
 
-CURSORPTR				*clearQueue = new CURSORPTR[MAX_CURSORS];
-INT nToClear=0;
-
 BOOL wait = true;
 
+// SetThreadDpiAwarenessContext of Windows 10, so the windows get the pixels of
+// their own monitor. Left alone on older systems.
+typedef HANDLE (WINAPI *SetThreadDpiAwarenessContextFunction)(HANDLE);
+#define PER_MONITOR_AWARE_V2 ((HANDLE)-4)
+
+HANDLE enterPerMonitorDpiAwareness()
+{
+	static SetThreadDpiAwarenessContextFunction setContext = (SetThreadDpiAwarenessContextFunction)GetProcAddress(GetModuleHandleW(L"user32.dll"), "SetThreadDpiAwarenessContext");
+	return setContext != NULL ? setContext(PER_MONITOR_AWARE_V2) : NULL;
+}
+
+VOID leaveDpiAwareness(HANDLE previous)
+{
+	static SetThreadDpiAwarenessContextFunction setContext = (SetThreadDpiAwarenessContextFunction)GetProcAddress(GetModuleHandleW(L"user32.dll"), "SetThreadDpiAwarenessContext");
+	if (setContext != NULL && previous != NULL)
+		setContext(previous);
+}
+
+// The adapter whose output shows the monitor, so each device renders where it presents
+UINT findAdapter(const DesktopRect &bounds)
+{
+	RECT rect = { bounds.Left, bounds.Top, bounds.Right, bounds.Bottom };
+	HMONITOR monitor = MonitorFromRect(&rect, MONITOR_DEFAULTTONEAREST);
+	for (UINT i = 0; i < g_pD3D->GetAdapterCount(); i++)
+	{
+		if (g_pD3D->GetAdapterMonitor(i) == monitor)
+			return i;
+	}
+	return D3DADAPTER_DEFAULT;
+}
 
 // +--------------+
 // | D3DStartup() |
 // +--------------+----------------------------------+
 // | Initialise Direct3D and perform once only tasks |
 // +-------------------------------------------------+
-HRESULT D3DStartup(HWND hWnd)
+HRESULT D3DStartup(MonitorRenderer &renderer)
 {
-	BOOL                  bCompOk             = FALSE;   // Is composition enabled? 
 	D3DPRESENT_PARAMETERS pp;                            // Presentation prefs
-	DWORD                 msqAAQuality        = 0;       // Non-maskable quality
 
-  
-  
-	D3DXMATRIX Ortho2D;    
+	D3DXMATRIX Ortho2D;
 
-	// Make sure that DWM composition is enabled
-	DwmIsCompositionEnabled(&bCompOk);
-	if(!bCompOk) return E_FAIL;
-
-	// Create a Direct3D object
-	if(FAILED(Direct3DCreate9Ex(D3D_SDK_VERSION, &g_pD3D))) return E_FAIL;
+	const OverlayMonitor &monitor = overlay.monitor(renderer.Monitor);
 
 	// Setup presentation parameters
 	ZeroMemory(&pp, sizeof(pp));
 	pp.Windowed            = TRUE;
-	pp.SwapEffect          = D3DSWAPEFFECT_DISCARD; 
+	pp.SwapEffect          = D3DSWAPEFFECT_DISCARD;
 	pp.BackBufferFormat    = D3DFMT_A8R8G8B8;       // Back buffer format with alpha channel
+	pp.BackBufferWidth     = monitor.getWidth();
+	pp.BackBufferHeight    = monitor.getHeight();
 	pp.PresentationInterval = D3DPRESENT_INTERVAL_IMMEDIATE; //Disables vsync
 
 	pp.MultiSampleType = D3DMULTISAMPLE_NONE;
 
 	// Create a Direct3D device object
-	if(FAILED(g_pD3D->CreateDeviceEx(D3DADAPTER_DEFAULT,
+	if(FAILED(g_pD3D->CreateDeviceEx(findAdapter(monitor.Bounds),
 									D3DDEVTYPE_HAL,
-									hWnd,
+									renderer.Window,
 									D3DCREATE_HARDWARE_VERTEXPROCESSING,
 									&pp,
 									NULL,
-									&g_pD3DDevice
+									&renderer.Device
 									))) return E_FAIL;
 
 	// Configure the device state
-  
-	g_pD3DDevice->SetRenderState(D3DRS_LIGHTING, FALSE);
 
-	D3DXMatrixOrthoLH(&Ortho2D, g_iWidth, g_iHeight, 0.0f, 1.0f);
+	renderer.Device->SetRenderState(D3DRS_LIGHTING, FALSE);
+
+	D3DXMatrixOrthoLH(&Ortho2D, (FLOAT)monitor.getWidth(), (FLOAT)monitor.getHeight(), 0.0f, 1.0f);
 	D3DXMatrixIdentity(&Identity);
 
-	g_pD3DDevice->SetTransform(D3DTS_PROJECTION, &Ortho2D);
-	g_pD3DDevice->SetTransform(D3DTS_WORLD, &Identity);
-	g_pD3DDevice->SetTransform(D3DTS_VIEW, &Identity);
+	renderer.Device->SetTransform(D3DTS_PROJECTION, &Ortho2D);
+	renderer.Device->SetTransform(D3DTS_WORLD, &Identity);
+	renderer.Device->SetTransform(D3DTS_VIEW, &Identity);
 
 
-	g_pD3DDevice->SetRenderState( D3DRS_ALPHABLENDENABLE, TRUE);
+	renderer.Device->SetRenderState( D3DRS_ALPHABLENDENABLE, TRUE);
 
 	return S_OK;
 }
@@ -136,266 +168,163 @@ HRESULT D3DStartup(HWND hWnd)
 // +--------------------------------------+
 VOID D3DShutdown(VOID)
 {
-  if(g_pVB != NULL ) g_pVB->Release();
-  if(g_pD3DDevice != NULL) g_pD3DDevice->Release();
-  if(g_pD3D != NULL) g_pD3D->Release();
+  for (size_t i = 0; i < g_renderers.size(); i++)
+  {
+    MonitorRenderer &renderer = g_renderers[i];
+    if(renderer.Circle != NULL) renderer.Circle->Release();
+    if(renderer.Sprite != NULL) renderer.Sprite->Release();
+    if(renderer.Device != NULL) renderer.Device->Release();
+    if(renderer.Window != NULL) DestroyWindow(renderer.Window);
+  }
+  g_renderers.clear();
 }
 
-// +--------------+
-// | CreateCube() |
-// +--------------+------------------------------+
-// | Populates a vertex buffer with a cube shape |
-// +---------------------------------------------+
-HRESULT InitSprites(VOID)
+// +---------------+
+// | InitSprites() |
+// +---------------+--------------------------------+
+// | Loads the cursor sprite for one monitor device |
+// +------------------------------------------------+
+HRESULT InitSprites(MonitorRenderer &renderer)
 {
-	if (SUCCEEDED(D3DXCreateSprite(g_pD3DDevice,&g_sprite)))
+	if (SUCCEEDED(D3DXCreateSprite(renderer.Device,&renderer.Sprite)))
 	{
 		// created OK
 	}
 
-	D3DXCreateTextureFromFile(g_pD3DDevice,TEXTURE_PATH, &g_circle );
+	D3DXCreateTextureFromFile(renderer.Device,TEXTURE_PATH, &renderer.Circle );
 
 	return S_OK;
 }
-FLOAT easeInOutQuint(FLOAT elapsedTime, FLOAT startValue, FLOAT changeInValue, FLOAT duration) {
-	elapsedTime /= duration/2;
-	if (elapsedTime < 1) return changeInValue/2*elapsedTime*elapsedTime*elapsedTime*elapsedTime*elapsedTime + startValue;
-	elapsedTime -= 2;
-	return changeInValue/2*(elapsedTime*elapsedTime*elapsedTime*elapsedTime*elapsedTime + 2) + startValue;
-};
-// +----------+
-// | Render() |
-// +----------+-------------------------+
-// | Renders a scene to the back buffer |
-// +------------------------------------+
-VOID Render(VOID)
+// Milliseconds on the clock() timeline, which the cursor animations run on
+double nowMs()
 {
-	if (!wait)
+	return (double)clock() * 1000.0 / CLOCKS_PER_SEC;
+}
+// +--------------+
+// | RenderOne() |
+// +--------------+------------------------------------+
+// | Renders the cursors of one monitor and presents it |
+// +----------------------------------------------------+
+VOID RenderOne(MonitorRenderer &renderer)
+{
+	D3DXMATRIX    scaleMatrix;
+	D3DXMATRIX	positionMatrix;
+	// Sanity check
+	if (renderer.Device == NULL) return;
+	if (renderer.Sprite == NULL) return;
+
+	const OverlayMonitor &monitor = overlay.monitor(renderer.Monitor);
+	// Nothing changed on this monitor
+	if (!monitor.Present) return;
+
+	const std::vector<DamageRect> &clearRects = monitor.Clear;
+	std::vector<D3DRECT> &clearRect = renderer.ClearRects;
+	clearRect.resize(clearRects.size());
+	for (size_t i = 0; i < clearRects.size(); i++)
 	{
-		std::vector<RECT> dirtyRects;
-
-		D3DXMATRIX    scaleMatrix;
-		D3DXMATRIX	positionMatrix;
-		// Sanity check
-		if (g_pD3DDevice == NULL) return;
-		if (g_sprite == NULL) return;
-
-		D3DRECT *clearRect = new D3DRECT[enabledCursors + nToClear];
-		int j = -1;
-		int i = 0;
-		for (i = 0; i < enabledCursors; i++)
-		{
-			while (!cursors[++j].enabled)
-			{
-
-			}
-
-			clearRect[i].x1 = cursors[j].last_rendered_x - (SPRITE_SIZE * normalCursorScale);
-			clearRect[i].x2 = cursors[j].last_rendered_x + (SPRITE_SIZE * normalCursorScale);
-			clearRect[i].y1 = cursors[j].last_rendered_y - (SPRITE_SIZE * normalCursorScale);
-			clearRect[i].y2 = cursors[j].last_rendered_y + (SPRITE_SIZE * normalCursorScale);
-
-			RECT dirtyRect;
-			dirtyRect.left = clearRect[i].x1;
-			dirtyRect.right = clearRect[i].x2;
-			dirtyRect.top = clearRect[i].y1;
-			dirtyRect.bottom = clearRect[i].y2;
-
-			dirtyRects.push_back(dirtyRect);
-		}
-		for (j = 0; i < enabledCursors + nToClear; i++)
-		{
-			clearRect[i].x1 = clearQueue[j].cursor->last_rendered_x - (SPRITE_SIZE * normalCursorScale);
-			clearRect[i].x2 = clearQueue[j].cursor->last_rendered_x + (SPRITE_SIZE * normalCursorScale);
-			clearRect[i].y1 = clearQueue[j].cursor->last_rendered_y - (SPRITE_SIZE * normalCursorScale);
-			clearRect[i].y2 = clearQueue[j].cursor->last_rendered_y + (SPRITE_SIZE * normalCursorScale);
-
-			RECT dirtyRect;
-			dirtyRect.left = clearRect[i].x1;
-			dirtyRect.right = clearRect[i].x2;
-			dirtyRect.top = clearRect[i].y1;
-			dirtyRect.bottom = clearRect[i].y2;
-
-			dirtyRects.push_back(dirtyRect);
-
-			j++;
-
-		}
-
+		clearRect[i].x1 = clearRects[i].Left;
+		clearRect[i].x2 = clearRects[i].Right;
+		clearRect[i].y1 = clearRects[i].Top;
+		clearRect[i].y2 = clearRects[i].Bottom;
+	}
 
-		g_pD3DDevice->Clear(enabledCursors + nToClear, clearRect, D3DCLEAR_TARGET, ARGB_TRANS, 1.0f, 0);
+	if (!clearRect.empty())
+		renderer.Device->Clear(clearRect.size(), &clearRect[0], D3DCLEAR_TARGET, ARGB_TRANS, 1.0f, 0);
 
-		nToClear = 0;
-		// Render scene
-		if (SUCCEEDED(g_pD3DDevice->BeginScene()))
+	// Render scene
+	if (SUCCEEDED(renderer.Device->BeginScene()))
+	{
+		D3DXVECTOR2 pos;
+		RECT size;
+		D3DXVECTOR2 spriteCentre = D3DXVECTOR2(64.0f, 64.0f);
+		D3DXMATRIX mat;
+		D3DXVECTOR2 scaling;
+
+		size.top = 0;
+		size.left = 0;
+		size.right = SPRITE_SIZE;
+		size.bottom = SPRITE_SIZE;
+
+		if (SUCCEEDED(renderer.Sprite->Begin(D3DXSPRITE_ALPHABLEND)))
 		{
-			D3DXVECTOR2 pos;
-			RECT size;
-			D3DXVECTOR2 spriteCentre = D3DXVECTOR2(64.0f, 64.0f);
-			D3DXMATRIX mat;
-			D3DXVECTOR2 scaling;
-
-			size.top = 0;
-			size.left = 0;
-			size.right = SPRITE_SIZE;
-			size.bottom = SPRITE_SIZE;
-
-			if (SUCCEEDED(g_sprite->Begin(D3DXSPRITE_ALPHABLEND)))
+			for (int j = 0; j < MAX_OVERLAY_CURSORS; j++)
 			{
-				j = -1;
-				for (int i = 0; i < enabledCursors; i++)
-				{
-					while (!cursors[++j].enabled)
-					{
-
-					}
-					cursors[j].last_rendered_x = cursors[j].x;
-					cursors[j].last_rendered_y = cursors[j].y;
-
-					pos.x = cursors[j].x - (SPRITE_SIZE / 2);
-					pos.y = cursors[j].y - (SPRITE_SIZE / 2);
-
-					RECT dirtyRect;
-					dirtyRect.left = pos.x;
-					dirtyRect.right = pos.x + SPRITE_SIZE;
-					dirtyRect.top = pos.y;
-					dirtyRect.bottom = pos.y + SPRITE_SIZE;
-
-					dirtyRects.push_back(dirtyRect);
-
-					//Animation
-					if (cursors[j].hidden)
-					{
-						if (cursors[j].scaling == hiddenCursorScale)
-						{
-
-						}
-						else if (abs(cursors[j].scaling - hiddenCursorScale) > 0.01)
-						{
-							float diff = (((float)clock() - (float)cursors[j].animationStart) / CLOCKS_PER_SEC) * 1000;
-							cursors[j].scaling = easeInOutQuint(diff, cursors[j].snapshot_scaling, hiddenCursorScale - cursors[j].snapshot_scaling, ANIMATION_DURATION);
-						}
-						else
-						{
-							cursors[j].scaling = hiddenCursorScale;
-						}
-					}
-					else if (cursors[j].pressed)
-					{
-						if (cursors[j].scaling == pressedCursorScale)
-						{
-
-						}
-						else if (abs(cursors[j].scaling - pressedCursorScale) > 0.01)
-						{
-							float diff = (((float)clock() - (float)cursors[j].animationStart) / CLOCKS_PER_SEC) * 1000;
-							cursors[j].scaling = easeInOutQuint(diff, cursors[j].snapshot_scaling, pressedCursorScale - cursors[j].snapshot_scaling, ANIMATION_DURATION);
-						}
-						else
-						{
-							cursors[j].scaling = pressedCursorScale;
-						}
-					}
-					else if (!cursors[j].pressed)
-					{
-						if (cursors[j].scaling == normalCursorScale)
-						{
-
-						}
-						else if (abs(cursors[j].scaling - normalCursorScale) > 0.01)
-						{
-							float diff = (((float)clock() - (float)cursors[j].animationStart) / CLOCKS_PER_SEC) * 1000;
-							cursors[j].scaling = easeInOutQuint(diff, cursors[j].snapshot_scaling, normalCursorScale - cursors[j].snapshot_scaling, ANIMATION_DURATION);
-						}
-						else
-						{
-							cursors[j].scaling = normalCursorScale;
-						}
-					}
-
-					if (cursors[j].scaling < 0)
-					{
-						cursors[j].scaling = hiddenCursorScale;
-					}
-
-					if (cursors[j].scaling > normalCursorScale)
-					{
-						cursors[j].scaling = normalCursorScale;
-					}
-
-					scaling.x = cursors[j].scaling;
-					scaling.y = cursors[j].scaling;
-					D3DXMatrixTransformation2D(&mat, &spriteCentre, 0.0, &scaling, &spriteCentre, 0, &pos);
-					g_sprite->SetTransform(&mat);
-					g_sprite->Draw(g_circle, NULL, NULL, NULL, 0xff000000 | cursors[j].color);
-
-					scaling.x *= 0.9f;
-					scaling.y *= 0.9f;
-					D3DXMatrixTransformation2D(&mat, &spriteCentre, 0.0, &scaling, &spriteCentre, 0, &pos);
-					g_sprite->SetTransform(&mat);
-					g_sprite->Draw(g_circle, NULL, NULL, NULL, 0xff000000);
-
-					scaling.x *= 0.5f;
-					scaling.y *= 0.5f;
-					D3DXMatrixTransformation2D(&mat, &spriteCentre, 0.0, &scaling, &spriteCentre, 0, &pos);
-					g_sprite->SetTransform(&mat);
-					g_sprite->Draw(g_circle, NULL, NULL, NULL, 0xffFFFFFF);
-
-				}
-
-				g_sprite->End();
+				const OverlayCursor &cursor = monitor.Overlay.cursor(j);
+				if (!cursor.Enabled)
+					continue;
+
+				pos.x = cursor.X - (SPRITE_SIZE / 2);
+				pos.y = cursor.Y - (SPRITE_SIZE / 2);
+
+				scaling.x = cursor.Scaling;
+				scaling.y = cursor.Scaling;
+				D3DXMatrixTransformation2D(&mat, &spriteCentre, 0.0, &scaling, &spriteCentre, 0, &pos);
+				renderer.Sprite->SetTransform(&mat);
+				renderer.Sprite->Draw(renderer.Circle, NULL, NULL, NULL, 0xff000000 | cursor.Color);
+
+				scaling.x *= 0.9f;
+				scaling.y *= 0.9f;
+				D3DXMatrixTransformation2D(&mat, &spriteCentre, 0.0, &scaling, &spriteCentre, 0, &pos);
+				renderer.Sprite->SetTransform(&mat);
+				renderer.Sprite->Draw(renderer.Circle, NULL, NULL, NULL, 0xff000000);
+
+				scaling.x *= 0.5f;
+				scaling.y *= 0.5f;
+				D3DXMatrixTransformation2D(&mat, &spriteCentre, 0.0, &scaling, &spriteCentre, 0, &pos);
+				renderer.Sprite->SetTransform(&mat);
+				renderer.Sprite->Draw(renderer.Circle, NULL, NULL, NULL, 0xffFFFFFF);
+
 			}
 
-			g_pD3DDevice->EndScene();
+			renderer.Sprite->End();
 		}
-		RECT dummy;
-		dummy.left = 0;
-		dummy.right = 0;
-		dummy.bottom = 0;
-		dummy.top = 0;
-		dirtyRects.push_back(dummy);
-
-		DWORD size = dirtyRects.size() * sizeof(RECT)+sizeof(RGNDATAHEADER);
-
-		RGNDATA *rgndata = NULL;
 
-		//allocate  the memory
-		rgndata = (RGNDATA *)HeapAlloc(GetProcessHeap(), 0, size);
-
-		if (!rgndata)
-			return;
+		renderer.Device->EndScene();
+	}
+	const std::vector<DamageRect> &dirtyRects = monitor.Dirty;
+
+	DWORD size = dirtyRects.size() * sizeof(RECT)+sizeof(RGNDATAHEADER);
+	if (renderer.Region.size() < size)
+		renderer.Region.resize(size);
+	RGNDATA *rgndata = (RGNDATA *)&renderer.Region[0];
+
+	memcpy(rgndata->Buffer, &dirtyRects[0], dirtyRects.size() * sizeof(RECT));
+	const DamageRect &rectBounding = monitor.DirtyBounds;
+
+	//preparing rgndata header
+	RGNDATAHEADER  header;
+	header.dwSize = sizeof(RGNDATAHEADER);
+	header.iType = RDH_RECTANGLES;
+	header.nCount = dirtyRects.size();
+	header.nRgnSize = dirtyRects.size() * sizeof(RECT);
+	header.rcBound.left = rectBounding.Left;
+	header.rcBound.top = rectBounding.Top;
+	header.rcBound.right = rectBounding.Right;
+	header.rcBound.bottom = rectBounding.Bottom;
+
+	rgndata->rdh = header;
+
+	// Update display, only the damage on this monitor
+	renderer.Device->PresentEx(NULL, NULL, NULL, rgndata, 0);
+}
 
-		RECT* pRectInitial = (RECT*)rgndata->Buffer;
-		RECT rectBounding = dirtyRects[0];
+// +----------+
+// | Render() |
+// +----------+-------------------------+
+// | Renders a scene to the back buffer |
+// +------------------------------------+
+VOID Render(VOID)
+{
+	if (!wait)
+	{
+		// Up to the last PresentEx, over all monitors
+		StageProbe probe(PipelineStage::Render, 0);
 
-		//feeding the rectangles into the buffer of rgndata
-		for (int i = 0; i < dirtyRects.size(); i++)
-		{
-			RECT rectCurrent = dirtyRects[i];
-			rectBounding.left = min(rectBounding.left, rectCurrent.left);
-			rectBounding.right = max(rectBounding.right, rectCurrent.right);
-			rectBounding.top = min(rectBounding.top, rectCurrent.top);
-			rectBounding.bottom = max(rectBounding.bottom, rectCurrent.bottom);
-
-			*pRectInitial = dirtyRects[i];
-			pRectInitial++;
-		}
+		// Routing to the monitors, clear and dirty rects, new positions and animation steps
+		overlay.stepFrame(nowMs());
 
-		//preparing rgndata header
-		RGNDATAHEADER  header;
-		header.dwSize = sizeof(RGNDATAHEADER);
-		header.iType = RDH_RECTANGLES;
-		header.nCount = dirtyRects.size();
-		header.nRgnSize = dirtyRects.size() * sizeof(RECT);
-		header.rcBound.left = rectBounding.left;
-		header.rcBound.top = rectBounding.top;
-		header.rcBound.right = rectBounding.right;
-		header.rcBound.bottom = rectBounding.bottom;
-
-		rgndata->rdh = header;
-
-		// Update display
-		g_pD3DDevice->PresentEx(NULL, NULL, NULL, rgndata, 0);
+		for (size_t i = 0; i < g_renderers.size(); i++)
+			RenderOne(g_renderers[i]);
 	}
 }
 
@@ -409,8 +338,8 @@ LRESULT WINAPI WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
   switch(uMsg)
   {
     case WM_DESTROY:
-      // Signal application to terminate
-      PostQuitMessage(0);
+      // No PostQuitMessage: SetD3DCursorWindowPosition destroys and recreates
+      // the windows on every reposition, and the message loop belongs to the host
       return 0;
 
     case WM_ERASEBKGND:
@@ -427,11 +356,86 @@ LRESULT WINAPI WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
   return DefWindowProc(hWnd, uMsg, wParam, lParam);
 }
 
-VOID recalculateCursorScale(FLOAT scale)
+// +------------------+
+// | CreateRenderers() |
+// +------------------+----------------------------------------------+
+// | One window and device for every monitor the x, y, width, height |
+// | area covers, from the monitor table of enumerateMonitors        |
+// +------------------------------------------------------------------+
+VOID CreateRenderers(int x, int y, int width, int height)
 {
-	normalCursorScale = (scale * g_iWidth) / SPRITE_SIZE;
-	//normalCursorScale = normalCursorScale > 1.0f ? 1.0f : normalCursorScale;
-	pressedCursorScale = 0.8f*normalCursorScale;
+	Win32DisplayConfigProvider provider;
+	std::vector<DisplayPath> paths;
+	std::vector<MonitorEntry> monitors;
+	enumerateMonitors(provider, paths, monitors);
+
+	// Only the monitors the area covers, a single monitor as before or the whole wall
+	std::vector<MonitorEntry> covered;
+	for (size_t i = 0; i < monitors.size(); i++)
+	{
+		const DesktopRect &bounds = monitors[i].Bounds;
+		if (bounds.Left < x + width && bounds.Right > x && bounds.Top < y + height && bounds.Bottom > y)
+			covered.push_back(monitors[i]);
+	}
+	// No monitor table, e.g. over remote desktop: the area is the one monitor
+	if (covered.empty())
+	{
+		MonitorEntry area;
+		area.TargetId = 0;
+		area.Bounds.Left = x;
+		area.Bounds.Top = y;
+		area.Bounds.Right = x + width;
+		area.Bounds.Bottom = y + height;
+		area.Dpi = DEFAULT_MONITOR_DPI;
+		covered.push_back(area);
+	}
+
+	overlay.setLayout(covered, x, y);
+	overlay.setCursorScale(screenRelativeCursorScale);
+
+	HANDLE previousAwareness = enterPerMonitorDpiAwareness();
+	HWND zpos = g_topmost ? HWND_TOPMOST : HWND_NOTOPMOST;
+	for (int m = 0; m < overlay.getMonitorCount(); m++)
+	{
+		const OverlayMonitor &monitor = overlay.monitor(m);
+		MonitorRenderer renderer;
+		renderer.Device = NULL;
+		renderer.Sprite = NULL;
+		renderer.Circle = NULL;
+		renderer.Monitor = m;
+		renderer.Window = CreateWindowEx(WS_EX_COMPOSITED | WS_EX_LAYERED | WS_EX_TRANSPARENT,             // dwExStyle
+                        g_wcpAppName,                 // lpClassName
+                        g_wcpAppName,                 // lpWindowName
+						WS_POPUP,        // dwStyle
+                        monitor.Bounds.Left, monitor.Bounds.Top, // x, y
+                        monitor.getWidth(), monitor.getHeight(),  // nWidth, nHeight
+                        g_hParent,                       // hWndParent
+                        NULL,                         // hMenu
+                        g_hInstance,                  // hInstance
+                        NULL);                        // lpParam
+		if (renderer.Window == NULL)
+			continue;
+
+		// Extend glass to cover whole window
+		DwmExtendFrameIntoClientArea(renderer.Window, &g_mgDWMMargins);
+
+		SetLayeredWindowAttributes(renderer.Window, 0, 180, LWA_ALPHA);
+
+		SetWindowPos(renderer.Window,zpos,0,0,0,0,SWP_NOMOVE|SWP_NOSIZE|SWP_NOACTIVATE);
+
+		// Initialise Direct3D
+		if(SUCCEEDED(D3DStartup(renderer)))
+		{
+			if(SUCCEEDED(InitSprites(renderer)))
+			{
+				// Show the window
+				ShowWindow(renderer.Window, SW_SHOWDEFAULT);
+				UpdateWindow(renderer.Window);
+			}
+		}
+		g_renderers.push_back(renderer);
+	}
+	leaveDpiAwareness(previousAwareness);
 }
 
 // +-----------+
@@ -441,7 +445,6 @@ VOID recalculateCursorScale(FLOAT scale)
 // +---------------------+
 extern "C" __declspec(dllexport)INT WINAPI StartD3DCursorWindow(HINSTANCE hInstance, HWND hParent, int x, int y, int width, int height, bool topmost, float cursorScale)
 {
-  MSG        uMsg;     
   WNDCLASSEX wc    = {sizeof(WNDCLASSEX),              // cbSize
                       NULL,                            // style
                       WindowProc,                      // lpfnWndProc
@@ -457,42 +460,19 @@ extern "C" __declspec(dllexport)INT WINAPI StartD3DCursorWindow(HINSTANCE hInsta
 
   RegisterClassEx(&wc);
 
-  g_iWidth = width;
-  g_iHeight = height;
+  g_hInstance = hInstance;
+  g_hParent = hParent;
+  g_topmost = topmost;
 
   screenRelativeCursorScale = cursorScale;
 
-  recalculateCursorScale(screenRelativeCursorScale);
-
-  hWnd = CreateWindowEx(WS_EX_COMPOSITED | WS_EX_LAYERED | WS_EX_TRANSPARENT,             // dwExStyle
-                        g_wcpAppName,                 // lpClassName
-                        g_wcpAppName,                 // lpWindowName
-						WS_POPUP,        // dwStyle
-                        x, y, // x, y
-                        g_iWidth, g_iHeight,          // nWidth, nHeight
-                        hParent,                         // hWndParent
-                        NULL,                         // hMenu
-                        hInstance,                    // hInstance
-                        NULL);                        // lpParam
-
-  // Extend glass to cover whole window
-  DwmExtendFrameIntoClientArea(hWnd, &g_mgDWMMargins);
-
-  SetLayeredWindowAttributes(hWnd, 0, 180, LWA_ALPHA);
- 
-  HWND zpos = topmost ? HWND_TOPMOST : HWND_NOTOPMOST;
-
-  SetWindowPos(hWnd,zpos,0,0,0,0,SWP_NOMOVE|SWP_NOSIZE|SWP_NOACTIVATE);
-
-  // Initialise Direct3D
-  if(SUCCEEDED(D3DStartup(hWnd)))
+  // Make sure that DWM composition is enabled
+  BOOL bCompOk = FALSE;
+  DwmIsCompositionEnabled(&bCompOk);
+  // Create a Direct3D object, shared by the devices of all monitors
+  if(bCompOk && g_pD3D == NULL && SUCCEEDED(Direct3DCreate9Ex(D3D_SDK_VERSION, &g_pD3D)))
   {
-    if(SUCCEEDED(InitSprites()))
-    {
-      // Show the window
-      ShowWindow(hWnd, SW_SHOWDEFAULT);
-      UpdateWindow(hWnd);
-    }
+    CreateRenderers(x, y, width, height);
   }
 
   wait = false;
@@ -506,37 +486,59 @@ extern "C" __declspec(dllexport)INT WINAPI StartD3DCursorWindow(HINSTANCE hInsta
 extern "C" __declspec(dllexport)VOID WINAPI SetCursorScale(float cursorScale)
 {
 	screenRelativeCursorScale = cursorScale;
-	recalculateCursorScale(screenRelativeCursorScale);
+	overlay.setCursorScale(screenRelativeCursorScale);
 }
 
+// The area is that of StartD3DCursorWindow; the monitors it covers get a renderer
+// each, made again from the current monitor table
 extern "C" __declspec(dllexport)VOID WINAPI SetD3DCursorWindowPosition(int x, int y, int width, int height, bool topmost)
 {
-	g_iWidth = width;
-	g_iHeight = height;
-	HWND zpos = topmost ? HWND_TOPMOST : HWND_NOTOPMOST;
+	if (g_pD3D == NULL)
+		return;
+
 	wait = true;
-	SetWindowPos(hWnd, zpos, x, y, g_iWidth, g_iHeight, SWP_NOACTIVATE);
+	g_topmost = topmost;
 	D3DShutdown();
+	CreateRenderers(x, y, width, height);
+	wait = false;
+}
 
-	recalculateCursorScale(screenRelativeCursorScale);
+// Renders from the cursor channel of the app instead of the calls below, so the
+// overlay can be hosted by a process of its own. name is the file mapping the
+// app created, e.g. Local\TouchmoteCursors.
+extern "C" __declspec(dllexport)BOOL WINAPI OpenD3DCursorChannel(const char *name)
+{
+	SharedMemoryRegion *region = SharedMemoryRegion::open(name, getCursorChannelSize());
+	if (region == NULL)
+		return FALSE;
+
+	delete g_channelReader;
+	delete g_channelRegion;
+	g_channelRegion = region;
+	g_channelReader = new CursorChannelReader(region->data());
+	memset(&g_channelState, 0, sizeof(g_channelState));
+	return TRUE;
+}
 
-	if (SUCCEEDED(D3DStartup(hWnd)))
-	{
-		if (SUCCEEDED(InitSprites()))
-		{
-			// Show the window
-			ShowWindow(hWnd, SW_SHOWDEFAULT);
-			UpdateWindow(hWnd);
-		}
-	}
-	wait = false;
-	//D3DXMATRIX Ortho2D;
-	//D3DXMatrixOrthoLH(&Ortho2D, g_iWidth, g_iHeight, 0.0f, 1.0f);
-	//g_pD3DDevice->SetTransform(D3DTS_PROJECTION, &Ortho2D);
+// Takes the newest cursor state of the channel, never waits for the app
+VOID PollCursorChannel()
+{
+	CursorChannelState state;
+	if (g_channelReader == NULL || !g_channelReader->read(state))
+		return;
+
+	applyCursorState(overlay, g_channelState, state, nowMs());
+	if (state.CursorScale != g_channelState.CursorScale)
+		SetCursorScale(state.CursorScale);
+	if (state.WindowX != g_channelState.WindowX || state.WindowY != g_channelState.WindowY || state.WindowWidth != g_channelState.WindowWidth
+		|| state.WindowHeight != g_channelState.WindowHeight || state.Topmost != g_channelState.Topmost)
+		SetD3DCursorWindowPosition(state.WindowX, state.WindowY, state.WindowWidth, state.WindowHeight, state.Topmost != 0);
+	g_channelState = state;
 }
 
 extern "C" __declspec(dllexport)VOID WINAPI RenderAllD3DCursors()
 {
+	PollCursorChannel();
 	if (!wait)
 	{
 		try {
@@ -548,60 +550,25 @@ extern "C" __declspec(dllexport)VOID WINAPI RenderAllD3DCursors()
 
 extern "C" __declspec(dllexport)VOID WINAPI SetD3DCursorPosition(int id, int x, int y)
 {
-	cursors[id].x = x;
-	cursors[id].y = y;
+	overlay.setPosition(id, x, y);
 }
 
 extern "C" __declspec(dllexport)VOID WINAPI SetD3DCursorPressed(int id, bool pressed)
 {
-	if(cursors[id].pressed != pressed)
-	{
-		cursors[id].pressed = pressed;
-		cursors[id].animationStart = clock();
-		cursors[id].snapshot_scaling = cursors[id].scaling;
-	}
+	overlay.setPressed(id, pressed, nowMs());
 }
 
 extern "C" __declspec(dllexport)VOID WINAPI SetD3DCursorHidden(int id, bool hidden)
 {
-	if(cursors[id].hidden != hidden)
-	{
-		cursors[id].hidden = hidden;
-		cursors[id].animationStart = clock();
-		cursors[id].snapshot_scaling = cursors[id].scaling;
-	}
+	overlay.setHidden(id, hidden, nowMs());
 }
 
 extern "C" __declspec(dllexport)VOID WINAPI AddD3DCursor(int id, DWORD color)
 {
-	if(id >= MAX_CURSORS)
-	{
-
-	}
-	else
-	{
-		D3DCURSOR newcursor;
-
-		newcursor.x = 0;
-		newcursor.y = 0;
-		newcursor.rotation = 0;
-		newcursor.last_rendered_x = 0;
-		newcursor.last_rendered_y = 0;
-		newcursor.scaling = normalCursorScale;
-		newcursor.hidden = false;
-		newcursor.enabled = true;
-		newcursor.color = color;
-
-		cursors[id] = newcursor;
-
-		enabledCursors++;
-	}
+	overlay.addCursor(id, color);
 }
 
 extern "C" __declspec(dllexport)VOID WINAPI RemoveD3DCursor(int id)
 {
-	cursors[id].enabled = false;
-	enabledCursors--;
-	clearQueue[nToClear].cursor = &cursors[id];
-	nToClear++;
-}
\ No newline at end of file
+	overlay.removeCursor(id);
+}
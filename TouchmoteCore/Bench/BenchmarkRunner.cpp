@@ -0,0 +1,135 @@
+// BenchmarkRunner.cpp
+
+#include "BenchmarkRunner.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#include "../Diagnostics/Instrumentation.h"
+
+namespace TouchmoteCore {
+
+	static const int BENCHMARK_JSON_FORMAT = 1;
+
+	void BenchmarkState::resetTimer()
+	{
+		start = Instrumentation::now();
+	}
+
+	void BenchmarkRunner::add(const std::string &name, const BenchmarkFunction &function)
+	{
+		Entry entry;
+		entry.Name = name;
+		entry.Function = function;
+		benchmarks.push_back(entry);
+	}
+
+	double BenchmarkRunner::measure(const BenchmarkFunction &function, uint64_t iterations)
+	{
+		BenchmarkState state;
+		state.Iterations = iterations;
+		state.start = Instrumentation::now();
+		function(state);
+		return (double)(Instrumentation::now() - state.start);
+	}
+
+	static bool compareName(const BenchmarkResult &a, const BenchmarkResult &b)
+	{
+		return a.Name < b.Name;
+	}
+
+	void BenchmarkRunner::run(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results, FILE *progress)
+	{
+		double minTimeNs = options.MinTimeMs * 1000000.0;
+		int repetitions = options.Repetitions > 0 ? options.Repetitions : 1;
+
+		for (size_t b = 0; b < benchmarks.size(); b++)
+		{
+			const Entry &entry = benchmarks[b];
+			if (!options.Filter.empty() && entry.Name.find(options.Filter) == std::string::npos)
+				continue;
+
+			//Grow the iteration count until a run is long enough to extrapolate from.
+			uint64_t iterations = 1;
+			double elapsed = measure(entry.Function, iterations);
+			while (elapsed < minTimeNs / 10 && iterations < ((uint64_t)1 << 40))
+			{
+				iterations *= 10;
+				elapsed = measure(entry.Function, iterations);
+			}
+			if (elapsed < minTimeNs)
+			{
+				double scale = elapsed > 0 ? minTimeNs / elapsed : 10;
+				iterations = (uint64_t)(iterations * scale) + 1;
+			}
+
+			std::vector<double> perOp;
+			for (int r = 0; r < repetitions; r++)
+				perOp.push_back(measure(entry.Function, iterations) / iterations);
+			std::sort(perOp.begin(), perOp.end());
+
+			BenchmarkResult result;
+			result.Name = entry.Name;
+			result.Iterations = iterations;
+			result.NsPerOp = perOp[perOp.size() / 2];
+			result.MinNsPerOp = perOp.front();
+			result.MaxNsPerOp = perOp.back();
+			results.push_back(result);
+
+			if (progress != NULL)
+			{
+				fprintf(progress, "%-40s %12.2f ns/op %12llu iterations\n", result.Name.c_str(), result.NsPerOp, (unsigned long long)result.Iterations);
+				fflush(progress);
+			}
+		}
+
+		std::sort(results.begin(), results.end(), compareName);
+	}
+
+	void BenchmarkRunner::writeJson(FILE *out, const std::vector<BenchmarkResult> &results)
+	{
+		fprintf(out, "{\n");
+		fprintf(out, "  \"format\": %d,\n", BENCHMARK_JSON_FORMAT);
+		fprintf(out, "  \"benchmarks\": [\n");
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			const BenchmarkResult &result = results[i];
+			//Names are ours and never need escaping.
+			fprintf(out, "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f, \"min_ns_per_op\": %.3f, \"max_ns_per_op\": %.3f}%s\n",
+				result.Name.c_str(),
+				(unsigned long long)result.Iterations,
+				result.NsPerOp,
+				result.MinNsPerOp,
+				result.MaxNsPerOp,
+				i + 1 < results.size() ? "," : "");
+		}
+		fprintf(out, "  ]\n");
+		fprintf(out, "}\n");
+	}
+
+	bool BenchmarkRunner::readJson(const char *path, std::vector<BenchmarkResult> &results)
+	{
+		FILE *in = fopen(path, "r");
+		if (in == NULL)
+			return false;
+
+		char line[512];
+		char name[256];
+		while (fgets(line, sizeof(line), in) != NULL)
+		{
+			unsigned long long iterations;
+			BenchmarkResult result;
+			if (sscanf(line, " {\"name\": \"%255[^\"]\", \"iterations\": %llu, \"ns_per_op\": %lf, \"min_ns_per_op\": %lf, \"max_ns_per_op\": %lf",
+				name, &iterations, &result.NsPerOp, &result.MinNsPerOp, &result.MaxNsPerOp) == 5)
+			{
+				result.Name = name;
+				result.Iterations = iterations;
+				results.push_back(result);
+			}
+		}
+		fclose(in);
+		return true;
+	}
+
+}
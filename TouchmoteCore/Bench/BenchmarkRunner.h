@@ -0,0 +1,91 @@
+// BenchmarkRunner.h
+//
+// Minimal microbenchmark harness for TouchmoteBench. Each benchmark runs its
+// operation state.Iterations times; the runner picks the iteration count so a
+// run takes about MinTimeMs, repeats the run and reports the median, min and
+// max time per operation. The JSON output has a fixed layout with one
+// benchmark per line, sorted by name, so results of two commits can be diffed
+// or compared with --compare.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace TouchmoteCore {
+
+	class BenchmarkState
+	{
+	public:
+		uint64_t Iterations;
+
+		//Call after per-run setup that should not be measured.
+		void resetTimer();
+
+		uint64_t getStart() const { return start; }
+
+	private:
+		friend class BenchmarkRunner;
+		uint64_t start;
+	};
+
+	typedef std::function<void(BenchmarkState &)> BenchmarkFunction;
+
+	struct BenchmarkResult
+	{
+		std::string Name;
+		uint64_t Iterations;
+		double NsPerOp;
+		double MinNsPerOp;
+		double MaxNsPerOp;
+	};
+
+	struct BenchmarkOptions
+	{
+		//Only run benchmarks whose name contains this.
+		std::string Filter;
+		double MinTimeMs;
+		int Repetitions;
+
+		BenchmarkOptions() : MinTimeMs(50), Repetitions(5) {}
+	};
+
+	//Keeps the compiler from optimizing away a value.
+	template <class T>
+	inline void doNotOptimize(const T &value)
+	{
+#if defined(__GNUC__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		const volatile char *p = (const volatile char *)&value;
+		(void)*p;
+#endif
+	}
+
+	class BenchmarkRunner
+	{
+	public:
+		void add(const std::string &name, const BenchmarkFunction &function);
+
+		void run(const BenchmarkOptions &options, std::vector<BenchmarkResult> &results, FILE *progress);
+
+		static void writeJson(FILE *out, const std::vector<BenchmarkResult> &results);
+		//Reads results written by writeJson. Returns false if the file could not be read.
+		static bool readJson(const char *path, std::vector<BenchmarkResult> &results);
+
+	private:
+		double measure(const BenchmarkFunction &function, uint64_t iterations);
+
+		struct Entry
+		{
+			std::string Name;
+			BenchmarkFunction Function;
+		};
+
+		std::vector<Entry> benchmarks;
+	};
+
+}
@@ -0,0 +1,18 @@
+// Benchmarks.h
+//
+// Registration of the TouchmoteBench benchmarks, one function per area. Names
+// are "area/operation[/size]" and must stay stable, they are the keys when
+// comparing results between commits.
+
+#pragma once
+
+#include "BenchmarkRunner.h"
+
+namespace TouchmoteCore {
+
+	void registerOverlayBenchmarks(BenchmarkRunner &runner);
+	void registerDeviceBenchmarks(BenchmarkRunner &runner);
+	void registerOutputBenchmarks(BenchmarkRunner &runner);
+	void registerPipelineBenchmarks(BenchmarkRunner &runner);
+
+}
@@ -0,0 +1,279 @@
+// CalibrationEval.cpp
+//
+// Accuracy of the calibration solver on synthetic data. Every trial places the
+// camera's view of the screen at a slightly different angle, takes noisy
+// samples of the IR dot at every target, some of them outliers far off, and
+// compares the mapping found with the true one over a grid of screen points.
+//
+// Calibrated are the four corners the way Calibrate.stepCalibration does it,
+// one sample each at a margin of 0.1, and the solver on 3x3 and 5x5 grids.
+// The oracle is a least squares fit to the same samples that knows which are
+// outliers, the best the solver can do. Reported are the screen error, the
+// solve time, outliers kept and good samples rejected. Exits with 1 if the
+// solver fails, keeps an outlier far from its target or has a mean error more
+// than 1.5 times the oracle's.
+//
+//   CalibrationEval [--trials N] [--samples N] [--noise PX] [--outliers F] [--seed N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "../Input/CalibrationSolver.h"
+#include "../Replay/SyntheticTrace.h"
+
+using namespace TouchmoteCore;
+
+static const double SCREEN_WIDTH = 1920;
+static const double SCREEN_HEIGHT = 1080;
+static const double CAMERA_WIDTH = 1024;
+static const double CAMERA_HEIGHT = 768;
+static const double MARGIN = 0.1;
+
+struct EvalConfig
+{
+	int Trials;
+	int SamplesPerTarget;
+	//Standard deviation of the IR position, in camera pixels.
+	double Noise;
+	//Fraction of samples anywhere in the camera's view.
+	double Outliers;
+	uint32_t Seed;
+
+	EvalConfig() : Trials(200), SamplesPerTarget(20), Noise(1.5), Outliers(0.1), Seed(1) {}
+};
+
+struct MethodResult
+{
+	const char *Name;
+	std::vector<double> Errors;
+	double SolveTime;
+	int Solves;
+	int Failures;
+	int KeptOutliers;
+	int RejectedInliers;
+	int Samples;
+
+	explicit MethodResult(const char *name) : Name(name), SolveTime(0), Solves(0), Failures(0), KeptOutliers(0), RejectedInliers(0), Samples(0) {}
+};
+
+static double nextUniform(XorShift32 &random)
+{
+	return (random.next() + 0.5) / 4294967296.0;
+}
+
+static double nextGaussian(XorShift32 &random)
+{
+	return std::sqrt(-2 * std::log(nextUniform(random))) * std::cos(2 * 3.14159265358979 * nextUniform(random));
+}
+
+//Where the camera sees the screen corners, top left, top right, bottom left,
+//bottom right, as from a Wiimote somewhat off center.
+static void makeCameraView(XorShift32 &random, Vector quad[4])
+{
+	Vector base[4] = { Vector(210, 140), Vector(810, 175), Vector(190, 620), Vector(840, 590) };
+	for (int i = 0; i < 4; i++)
+		quad[i] = base[i] + Vector(nextGaussian(random) * 30, nextGaussian(random) * 30);
+}
+
+//A sample of the dot at target, true says it is an outlier.
+static bool makeSample(XorShift32 &random, const EvalConfig &config, const Homography &toCamera, Vector target, Vector &camera)
+{
+	if (nextUniform(random) < config.Outliers)
+	{
+		camera = Vector(nextUniform(random) * CAMERA_WIDTH, nextUniform(random) * CAMERA_HEIGHT);
+		return true;
+	}
+	camera = toCamera.apply(target) + Vector(nextGaussian(random) * config.Noise, nextGaussian(random) * config.Noise);
+	return false;
+}
+
+//Screen error of mapping against the truth on a 20x20 grid.
+static void measure(const Homography &mapping, const Homography &toCamera, std::vector<double> &errors)
+{
+	for (int y = 0; y < 20; y++)
+	{
+		for (int x = 0; x < 20; x++)
+		{
+			Vector screen(SCREEN_WIDTH * (x + 0.5) / 20, SCREEN_HEIGHT * (y + 0.5) / 20);
+			errors.push_back((mapping.apply(toCamera.apply(screen)) - screen).Length());
+		}
+	}
+}
+
+static void runCorners(XorShift32 &random, const EvalConfig &config, const Homography &toCamera, MethodResult &result)
+{
+	std::vector<Vector> targets;
+	makeCalibrationGrid(2, 2, MARGIN, SCREEN_WIDTH, SCREEN_HEIGHT, targets);
+	Vector camera[4];
+	Vector screen[4];
+	for (int i = 0; i < 4; i++)
+	{
+		makeSample(random, config, toCamera, targets[i], camera[i]);
+		screen[i] = targets[i];
+	}
+
+	Homography mapping;
+	result.Solves++;
+	if (!Homography::quadToQuad(camera, screen, mapping))
+	{
+		result.Failures++;
+		return;
+	}
+	measure(mapping, toCamera, result.Errors);
+}
+
+static void runSolver(XorShift32 &random, const EvalConfig &config, const Homography &toCamera, int grid, MethodResult &result, MethodResult &oracle)
+{
+	std::vector<Vector> targets;
+	makeCalibrationGrid(grid, grid, MARGIN, SCREEN_WIDTH, SCREEN_HEIGHT, targets);
+	std::vector<CalibrationSample> samples;
+	std::vector<bool> outliers;
+	for (size_t t = 0; t < targets.size(); t++)
+	{
+		for (int s = 0; s < config.SamplesPerTarget; s++)
+		{
+			CalibrationSample sample;
+			outliers.push_back(makeSample(random, config, toCamera, targets[t], sample.Camera));
+			sample.Screen = targets[t];
+			sample.Target = (int)t;
+			samples.push_back(sample);
+		}
+	}
+
+	std::vector<CalibrationSample> good;
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		if (!outliers[i])
+			good.push_back(samples[i]);
+	}
+	Homography best;
+	oracle.Solves++;
+	if (good.size() >= 4 && fitHomography(&good[0], (int)good.size(), best))
+		measure(best, toCamera, oracle.Errors);
+	else
+		oracle.Failures++;
+
+	CalibrationOptions options;
+	options.Seed = random.next();
+	CalibrationResult solved;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	bool ok = solveCalibration(samples, options, solved);
+	result.SolveTime += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	result.Solves++;
+	if (!ok)
+	{
+		result.Failures++;
+		return;
+	}
+	measure(solved.Mapping, toCamera, result.Errors);
+
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		Vector expected = toCamera.apply(samples[i].Screen);
+		//Outliers that happened to land on their target are not wrong to keep.
+		bool far = (samples[i].Camera - expected).Length() > 3 * options.InlierThreshold;
+		if (outliers[i] && far && solved.Inliers[i])
+			result.KeptOutliers++;
+		if (!outliers[i] && !solved.Inliers[i])
+			result.RejectedInliers++;
+		result.Samples++;
+	}
+}
+
+static double getPercentile(std::vector<double> &values, double percentile)
+{
+	if (values.empty())
+		return 0;
+	size_t index = std::min(values.size() - 1, (size_t)(percentile / 100 * values.size()));
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	return values[index];
+}
+
+static double getMean(const std::vector<double> &values)
+{
+	double sum = 0;
+	for (size_t i = 0; i < values.size(); i++)
+		sum += values[i];
+	return values.empty() ? 0 : sum / values.size();
+}
+
+static void printResult(MethodResult &result)
+{
+	double mean = getMean(result.Errors);
+	double p95 = getPercentile(result.Errors, 95);
+	double max = result.Errors.empty() ? 0 : *std::max_element(result.Errors.begin(), result.Errors.end());
+	printf("%-10s %10.2f %10.2f %10.1f %9d", result.Name, mean, p95, max, result.Failures);
+	if (result.Samples > 0)
+		printf(" %10.1f %10d %10d", result.SolveTime / result.Solves, result.KeptOutliers, result.RejectedInliers);
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	EvalConfig config;
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--trials") && hasValue) config.Trials = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--samples") && hasValue) config.SamplesPerTarget = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--noise") && hasValue) config.Noise = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--outliers") && hasValue) config.Outliers = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--seed") && hasValue) config.Seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else
+		{
+			fprintf(stderr, "usage: CalibrationEval [--trials N] [--samples N] [--noise PX] [--outliers F] [--seed N]\n");
+			return 2;
+		}
+	}
+	config.Trials = std::max(config.Trials, 1);
+	config.SamplesPerTarget = std::max(config.SamplesPerTarget, 1);
+
+	XorShift32 random(config.Seed);
+	MethodResult corners("corners");
+	MethodResult grid3("solver 3x3");
+	MethodResult grid5("solver 5x5");
+	MethodResult oracle3("oracle 3x3");
+	MethodResult oracle5("oracle 5x5");
+	for (int t = 0; t < config.Trials; t++)
+	{
+		Vector view[4];
+		makeCameraView(random, view);
+		Vector screen[4] = { Vector(0, 0), Vector(SCREEN_WIDTH, 0), Vector(0, SCREEN_HEIGHT), Vector(SCREEN_WIDTH, SCREEN_HEIGHT) };
+		Homography toCamera;
+		if (!Homography::quadToQuad(screen, view, toCamera))
+			continue;
+
+		runCorners(random, config, toCamera, corners);
+		runSolver(random, config, toCamera, 3, grid3, oracle3);
+		runSolver(random, config, toCamera, 5, grid5, oracle5);
+	}
+
+	printf("%d trials, %d samples per target, %.1fpx noise, %.0f%% outliers\n\n", config.Trials, config.SamplesPerTarget,
+		config.Noise, config.Outliers * 100);
+	printf("%-10s %10s %10s %10s %9s %10s %10s %10s\n", "", "mean px", "p95 px", "max px", "failures", "solve us", "kept out", "lost in");
+	printResult(corners);
+	printResult(oracle3);
+	printResult(grid3);
+	printResult(oracle5);
+	printResult(grid5);
+
+	int failures = 0;
+	MethodResult *solvers[] = { &grid3, &grid5 };
+	MethodResult *oracles[] = { &oracle3, &oracle5 };
+	for (int s = 0; s < 2; s++)
+	{
+		const MethodResult &result = *solvers[s];
+		if (getMean(result.Errors) > 1.5 * getMean(oracles[s]->Errors) || result.Failures != 0 || result.KeptOutliers != 0)
+		{
+			printf("FAIL: %s\n", result.Name);
+			failures++;
+		}
+	}
+	return failures == 0 ? 0 : 1;
+}
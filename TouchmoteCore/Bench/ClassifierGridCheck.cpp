@@ -0,0 +1,260 @@
+// ClassifierGridCheck.cpp
+//
+// Checks the spatial grid of SpatioTemporalClassifier against its pairwise
+// loops. Two classifiers get the same frames, one always on the grid and one
+// never, and after every frame their tracker events and trackers must match,
+// positions bit for bit. The frames are moving IR sources in random order, with
+// sources dropping out, close pairs that make duplicate trackers, points on top
+// of each other that tie, and now and then an empty frame, for 4 up to 256
+// points in screen pixels and in normalized coordinates. Reported is the time
+// per frame and per point of both. Exits with 1 on a mismatch.
+//
+//   ClassifierGridCheck [--frames N] [--seed N]
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "../Input/SpatioTemporalClassifier.h"
+#include "../Replay/SyntheticTrace.h"
+
+using namespace TouchmoteCore;
+
+struct TrackerEvent
+{
+	int Type;
+	uint64_t ID;
+	Vector Position;
+
+	bool operator==(const TrackerEvent &other) const { return Type == other.Type && ID == other.ID && Position == other.Position; }
+};
+
+class RecordingListener : public TrackerListener
+{
+public:
+	std::vector<TrackerEvent> Events;
+
+	void onTrackerStart(const SpatioTemporalTracker &tracker) { record(0, tracker); }
+	void onTrackerUpdate(const SpatioTemporalTracker &tracker) { record(1, tracker); }
+	void onTrackerEnd(const SpatioTemporalTracker &tracker) { record(2, tracker); }
+
+private:
+	void record(int type, const SpatioTemporalTracker &tracker)
+	{
+		TrackerEvent event = { type, tracker.ID, tracker.Position };
+		Events.push_back(event);
+	}
+};
+
+struct Scenario
+{
+	const char *Name;
+	//Width of the screen; the height is 9/16 of it.
+	double Scale;
+	double DuplicateDistance;
+	double PredictionScale;
+};
+
+static const Scenario SCENARIOS[] = {
+	{ "pixels", 1920, 10, 1920 },
+	{ "normalized", 1, 0.005, 1 },
+};
+
+static const int POINT_COUNTS[] = { 4, 16, 64, 128, 256 };
+
+//Sources bouncing around the screen. A few have a twin a few pixels away,
+//which the classifier sees as duplicates, or a twin right on top of them.
+class SourceField
+{
+public:
+	SourceField(int count, double scale, XorShift32 &random)
+		: scale(scale)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			Source source;
+			source.X = (random.next() % 10000) / 10000.0 * scale;
+			source.Y = (random.next() % 10000) / 10000.0 * scale * 9 / 16;
+			source.VX = random.nextInt(100) / 1000.0 * scale / 100;
+			source.VY = random.nextInt(100) / 1000.0 * scale / 100;
+			source.Twin = random.next() % 8 == 0 ? 1 + (int)(random.next() % 2) : 0;
+			sources.push_back(source);
+		}
+	}
+
+	void step(XorShift32 &random, std::vector<Vector> &points)
+	{
+		points.clear();
+		//Now and then the camera sees nothing.
+		if (random.next() % 97 == 0)
+			return;
+
+		double height = scale * 9 / 16;
+		for (size_t i = 0; i < sources.size(); i++)
+		{
+			Source &source = sources[i];
+			source.X += source.VX;
+			source.Y += source.VY;
+			if (source.X < 0 || source.X > scale)
+				source.VX = -source.VX;
+			if (source.Y < 0 || source.Y > height)
+				source.VY = -source.VY;
+			if (random.next() % 20 == 0)
+				continue;
+
+			//Some on whole pixels, where points tie exactly.
+			Vector point(source.X, source.Y);
+			if (i % 5 == 0)
+				point = Vector((double)(int)(source.X * 64 / scale) * scale / 64, (double)(int)(source.Y * 64 / scale) * scale / 64);
+			points.push_back(point);
+			if (source.Twin == 1)
+				points.push_back(Vector(point.X + scale * 0.002, point.Y));
+			else if (source.Twin == 2)
+				points.push_back(point);
+		}
+
+		//The Wiimote reports its points in no particular order.
+		for (size_t i = points.size(); i > 1; i--)
+			std::swap(points[i - 1], points[random.next() % i]);
+	}
+
+private:
+	struct Source
+	{
+		double X;
+		double Y;
+		double VX;
+		double VY;
+		int Twin;
+	};
+
+	double scale;
+	std::vector<Source> sources;
+};
+
+static bool compare(const char *name, int points, int frame, const RecordingListener &gridEvents, const RecordingListener &pairEvents,
+	const SpatioTemporalClassifier &grid, const SpatioTemporalClassifier &pairwise)
+{
+	if (!(gridEvents.Events == pairEvents.Events))
+	{
+		printf("FAIL: %s/%d frame %d: %d events on the grid, %d pairwise\n", name, points, frame, (int)gridEvents.Events.size(), (int)pairEvents.Events.size());
+		for (size_t i = 0; i < std::min(gridEvents.Events.size(), pairEvents.Events.size()); i++)
+		{
+			const TrackerEvent &a = gridEvents.Events[i];
+			const TrackerEvent &b = pairEvents.Events[i];
+			if (!(a == b))
+			{
+				printf("  event %d: grid %d id %llu at %.17g,%.17g, pairwise %d id %llu at %.17g,%.17g\n", (int)i, a.Type, (unsigned long long)a.ID,
+					a.Position.X, a.Position.Y, b.Type, (unsigned long long)b.ID, b.Position.X, b.Position.Y);
+				break;
+			}
+		}
+		return false;
+	}
+
+	const std::vector<std::unique_ptr<SpatioTemporalTracker> > &a = grid.trackers();
+	const std::vector<std::unique_ptr<SpatioTemporalTracker> > &b = pairwise.trackers();
+	if (a.size() != b.size())
+	{
+		printf("FAIL: %s/%d frame %d: %d trackers on the grid, %d pairwise\n", name, points, frame, (int)a.size(), (int)b.size());
+		return false;
+	}
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (a[i]->ID != b[i]->ID || a[i]->Position != b[i]->Position || a[i]->eTrackerState != b[i]->eTrackerState || a[i]->StrongLock() != b[i]->StrongLock())
+		{
+			printf("FAIL: %s/%d frame %d: tracker %d is id %llu on the grid, id %llu pairwise\n", name, points, frame, (int)i,
+				(unsigned long long)a[i]->ID, (unsigned long long)b[i]->ID);
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	int frames = 200;
+	uint32_t seed = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else
+		{
+			fprintf(stderr, "usage: %s [--frames N] [--seed N]\n", argv[0]);
+			return 2;
+		}
+	}
+	frames = std::max(frames, 1);
+
+	//Trackers lock after a few frames and survive a few empty ones.
+	SpatioTemporalTracker::StrongLockThreshold = 2;
+	SpatioTemporalTracker::StrongLockLostThreshold = 2;
+
+	int failures = 0;
+	printf("%-12s %6s %14s %14s %12s %12s\n", "space", "points", "grid ns/frame", "pairs ns/frame", "grid ns/pt", "pairs ns/pt");
+	for (size_t s = 0; s < sizeof(SCENARIOS) / sizeof(SCENARIOS[0]); s++)
+	{
+		const Scenario &scenario = SCENARIOS[s];
+		for (size_t c = 0; c < sizeof(POINT_COUNTS) / sizeof(POINT_COUNTS[0]); c++)
+		{
+			int count = POINT_COUNTS[c];
+			XorShift32 random(seed + (uint32_t)(s * 100 + c));
+			SourceField field(count, scenario.Scale, random);
+
+			SpatioTemporalClassifier grid;
+			SpatioTemporalClassifier pairwise;
+			RecordingListener gridEvents;
+			RecordingListener pairEvents;
+			SpatioTemporalClassifier *classifiers[2] = { &grid, &pairwise };
+			for (int k = 0; k < 2; k++)
+			{
+				classifiers[k]->DuplicateDistance = scenario.DuplicateDistance;
+				classifiers[k]->PredictionScale = scenario.PredictionScale;
+			}
+			grid.GridMinimumPoints = 0;
+			pairwise.GridMinimumPoints = INT_MAX;
+			grid.setListener(&gridEvents);
+			pairwise.setListener(&pairEvents);
+
+			std::vector<Vector> points;
+			double gridTime = 0;
+			double pairTime = 0;
+			uint64_t pointCount = 0;
+			bool ok = true;
+			for (int f = 0; f < frames && ok; f++)
+			{
+				field.step(random, points);
+				pointCount += points.size();
+				gridEvents.Events.clear();
+				pairEvents.Events.clear();
+
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				grid.processFrame(points);
+				std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+				pairwise.processFrame(points);
+				std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+				gridTime += std::chrono::duration<double, std::nano>(middle - start).count();
+				pairTime += std::chrono::duration<double, std::nano>(end - middle).count();
+
+				ok = compare(scenario.Name, count, f, gridEvents, pairEvents, grid, pairwise);
+			}
+			if (!ok)
+				failures++;
+
+			double perPoint = pointCount > 0 ? (double)pointCount : 1;
+			printf("%-12s %6d %14.0f %14.0f %12.1f %12.1f\n", scenario.Name, count, gridTime / frames, pairTime / frames, gridTime / perPoint, pairTime / perPoint);
+		}
+	}
+
+	if (failures != 0)
+		printf("FAIL: %d mismatches\n", failures);
+	return failures == 0 ? 0 : 1;
+}
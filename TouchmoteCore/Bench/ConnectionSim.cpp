@@ -0,0 +1,552 @@
+// ConnectionSim.cpp
+//
+// Discovery churn with fake Wiimotes, on a virtual clock. Every device comes
+// and goes a number of times (batteries, range, the user switching it off),
+// takes a random time to connect, sometimes fails to and sometimes is slow.
+// All devices are there at the start, so the first pass has to connect 16.
+// While present and connected it reports every 10ms and is used by phases,
+// so it also goes to power save and wakes up again.
+//
+// The same devices, with the same connect times per attempt, are run through
+// ConnectionManager and through a model of wiimoteConnectorTimer_Elapsed: one
+// pass every 2s that connects new devices one after the other with a blocking
+// Connect and sleeps 100ms per device in power save when it blinks. Reported
+// is the time from a device appearing to it getting a slot, and the CPU time
+// of ConnectionManager::advance. Exits with 1 if the manager breaks a slot
+// invariant or misses a device the model connects. With --log the manager's
+// log is written to FILE as a binary log, for TouchmoteLogDecode.
+//
+//   ConnectionSim [--devices N] [--minutes N] [--seed N] [--log FILE]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../Devices/ConnectionManager.h"
+#include "../Diagnostics/BinaryLog.h"
+#include "../Diagnostics/Instrumentation.h"
+
+using namespace TouchmoteCore;
+
+//Simulation step and report interval, in ms.
+static const uint64_t STEP = 5;
+static const uint64_t REPORT_INTERVAL = 10;
+//Short enough that power save happens a few times per session.
+static const uint64_t SIGNIFICANT_TIMEOUT = 60000;
+
+struct Session
+{
+	uint64_t Appear;
+	uint64_t Vanish;
+};
+
+struct FakeWiimote
+{
+	std::string Path;
+	std::vector<Session> Sessions;
+	//Offset of the use phases, see isInUse.
+	uint64_t Phase;
+	uint32_t Seed;
+};
+
+static uint32_t hashInt(uint32_t x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352d;
+	x ^= x >> 15;
+	x *= 0x846ca68b;
+	x ^= x >> 16;
+	return x;
+}
+
+static uint64_t randomRange(uint32_t &state, uint64_t low, uint64_t high)
+{
+	state = hashInt(state + 0x9e3779b9u);
+	return low + state % (high - low + 1);
+}
+
+//Connect attempt number attempt of a device: how long it takes and whether it works.
+static void getAttempt(const FakeWiimote &fake, int attempt, uint64_t &latency, bool &succeeds)
+{
+	uint32_t state = fake.Seed ^ hashInt((uint32_t)attempt * 7919u);
+	uint64_t kind = randomRange(state, 0, 99);
+	if (kind < 10)
+		latency = randomRange(state, 1500, 4000);
+	else
+		latency = randomRange(state, 30, 400);
+	succeeds = randomRange(state, 0, 99) >= 15;
+}
+
+//Used for 3 minutes, then left alone for 90s.
+static bool isInUse(const FakeWiimote &fake, uint64_t now)
+{
+	return (now + fake.Phase) % 270000 < 180000;
+}
+
+static int findSession(const FakeWiimote &fake, uint64_t now)
+{
+	for (size_t s = 0; s < fake.Sessions.size(); s++)
+	{
+		if (fake.Sessions[s].Appear <= now && now < fake.Sessions[s].Vanish)
+			return (int)s;
+	}
+	return -1;
+}
+
+static std::vector<FakeWiimote> createDevices(int count, uint64_t duration, uint32_t seed)
+{
+	std::vector<FakeWiimote> fakes(count);
+	for (int d = 0; d < count; d++)
+	{
+		FakeWiimote &fake = fakes[d];
+		char path[128];
+		sprintf(path, "\\\\?\\hid#{00001124-0000-1000-8000-00805f9b34fb}_vid&0002057e_pid&0306#%d", d);
+		fake.Path = path;
+		fake.Seed = hashInt(seed * 131u + (uint32_t)d);
+		uint32_t state = fake.Seed;
+		fake.Phase = randomRange(state, 0, 270000);
+
+		//All of them are on when Touchmote starts.
+		uint64_t t = randomRange(state, 0, 1000);
+		while (t < duration)
+		{
+			Session session;
+			session.Appear = t;
+			session.Vanish = t + randomRange(state, 60000, 600000);
+			fake.Sessions.push_back(session);
+			t = session.Vanish + randomRange(state, 5000, 60000);
+		}
+	}
+	return fakes;
+}
+
+//When every session got its slot, UINT64_MAX if never.
+struct SessionResults
+{
+	std::vector<std::vector<uint64_t> > ConnectedAt;
+
+	explicit SessionResults(const std::vector<FakeWiimote> &fakes)
+	{
+		for (size_t d = 0; d < fakes.size(); d++)
+			ConnectedAt.push_back(std::vector<uint64_t>(fakes[d].Sessions.size(), UINT64_MAX));
+	}
+
+	void connected(const FakeWiimote &fake, int device, uint64_t now)
+	{
+		int session = findSession(fake, now);
+		if (session != -1 && ConnectedAt[device][session] == UINT64_MAX)
+			ConnectedAt[device][session] = now;
+	}
+};
+
+class FakeDeviceIO : public DeviceIO
+{
+public:
+	FakeDeviceIO(const std::vector<FakeWiimote> &fakes) : manager(NULL), fakes(fakes), now(0), writes(0), attempts(fakes.size(), 0) {}
+
+	ConnectionManager *manager;
+
+	void setTime(uint64_t time) { now = time; }
+
+	//Posts the results of connects that finished by now.
+	void deliver()
+	{
+		for (size_t p = 0; p < pending.size();)
+		{
+			if (pending[p].At <= now)
+			{
+				manager->postConnectResult(pending[p].Device, pending[p].Succeeds);
+				pending[p] = pending.back();
+				pending.pop_back();
+			}
+			else
+			{
+				p++;
+			}
+		}
+	}
+
+	virtual void enumerate(std::vector<std::string> &paths)
+	{
+		paths.clear();
+		for (size_t d = 0; d < fakes.size(); d++)
+		{
+			if (findSession(fakes[d], now) != -1)
+				paths.push_back(fakes[d].Path);
+		}
+	}
+
+	virtual void beginConnect(int device, const std::string &path)
+	{
+		int fake = getFake(path);
+		PendingConnect connect;
+		connect.Device = device;
+		getAttempt(fakes[fake], attempts[fake]++, connect.At, connect.Succeeds);
+		connect.At += now;
+		//A device that vanishes while connecting fails when it does.
+		int session = findSession(fakes[fake], now);
+		if (session == -1 || fakes[fake].Sessions[session].Vanish <= connect.At)
+		{
+			connect.Succeeds = false;
+			if (session != -1)
+				connect.At = fakes[fake].Sessions[session].Vanish;
+		}
+		pending.push_back(connect);
+	}
+
+	virtual void disconnect(int device)
+	{
+		for (size_t p = 0; p < pending.size(); p++)
+		{
+			if (pending[p].Device == device)
+			{
+				pending[p] = pending.back();
+				pending.pop_back();
+				break;
+			}
+		}
+	}
+
+	virtual void setReportMode(int, DeviceReportMode) { writes++; }
+	virtual void setLEDs(int, int) { writes++; }
+	virtual void setRumble(int, bool) { writes++; }
+	virtual void requestStatus(int) { writes++; }
+
+	int getFake(const std::string &path) const
+	{
+		for (size_t d = 0; d < fakes.size(); d++)
+		{
+			if (fakes[d].Path == path)
+				return (int)d;
+		}
+		return -1;
+	}
+
+	uint64_t getWrites() const { return writes; }
+
+private:
+	struct PendingConnect
+	{
+		int Device;
+		uint64_t At;
+		bool Succeeds;
+	};
+
+	const std::vector<FakeWiimote> &fakes;
+	uint64_t now;
+	uint64_t writes;
+	std::vector<int> attempts;
+	std::vector<PendingConnect> pending;
+};
+
+class SlotChecker : public ConnectionListener
+{
+public:
+	SlotChecker() : errors(0), count(0) { memset(used, 0, sizeof(used)); }
+
+	virtual void onConnect(int slot, int newCount)
+	{
+		if (slot < 1 || slot > MAX_CONTROLLER_SLOTS || used[slot - 1] || newCount != count + 1)
+			errors++;
+		else
+			used[slot - 1] = true;
+		count = newCount;
+		connects.push_back(slot);
+	}
+
+	virtual void onDisconnect(int slot, int newCount)
+	{
+		if (slot == 0 && newCount == 0 && count == 0)
+			return;
+		if (slot < 1 || slot > MAX_CONTROLLER_SLOTS || !used[slot - 1] || newCount != count - 1)
+			errors++;
+		else
+			used[slot - 1] = false;
+		count = newCount;
+	}
+
+	//Slots connected since the last call.
+	std::vector<int> connects;
+	int errors;
+
+private:
+	bool used[MAX_CONTROLLER_SLOTS];
+	int count;
+};
+
+struct ManagerRun
+{
+	SessionResults Results;
+	ConnectionStats Stats;
+	uint64_t Writes;
+	int Errors;
+	uint64_t AdvanceCalls;
+	uint64_t AdvanceTime;
+	uint64_t MaxAdvanceTime;
+
+	explicit ManagerRun(const std::vector<FakeWiimote> &fakes) : Results(fakes), Stats(), Writes(0), Errors(0), AdvanceCalls(0), AdvanceTime(0), MaxAdvanceTime(0) {}
+};
+
+static void runManager(const std::vector<FakeWiimote> &fakes, uint64_t duration, ManagerRun &run)
+{
+	ConnectionSettings settings;
+	settings.SignificantTimeout = SIGNIFICANT_TIMEOUT;
+
+	FakeDeviceIO io(fakes);
+	SlotChecker checker;
+	ConnectionManager manager(io, checker, settings);
+	io.manager = &manager;
+
+	//Fake per slot, -1 if none, and the session it was connected in. A device
+	//that vanished and came back has a new connection, the old one stays silent.
+	std::vector<int> slotFakes(MAX_CONTROLLER_SLOTS + 1, -1);
+	std::vector<int> slotSessions(MAX_CONTROLLER_SLOTS + 1, -1);
+
+	manager.start(0);
+	for (uint64_t now = 0; now < duration; now += STEP)
+	{
+		io.setTime(now);
+		io.deliver();
+
+		if (now % REPORT_INTERVAL == 0)
+		{
+			for (int slot = 1; slot <= MAX_CONTROLLER_SLOTS; slot++)
+			{
+				int fake = slotFakes[slot];
+				if (fake != -1 && findSession(fakes[fake], now) == slotSessions[slot])
+					manager.noteActivity(slot, now, isInUse(fakes[fake], now));
+			}
+		}
+
+		uint64_t start = Instrumentation::now();
+		manager.advance(now);
+		uint64_t elapsed = Instrumentation::now() - start;
+		run.AdvanceCalls++;
+		run.AdvanceTime += elapsed;
+		run.MaxAdvanceTime = std::max(run.MaxAdvanceTime, elapsed);
+
+		for (size_t c = 0; c < checker.connects.size(); c++)
+		{
+			int slot = checker.connects[c];
+			slotFakes[slot] = -1;
+			for (int device = 0; device < manager.getDeviceCount(); device++)
+			{
+				if (manager.getSlot(device) == slot)
+					slotFakes[slot] = io.getFake(manager.getPath(device));
+			}
+			if (slotFakes[slot] != -1)
+			{
+				slotSessions[slot] = findSession(fakes[slotFakes[slot]], now);
+				run.Results.connected(fakes[slotFakes[slot]], slotFakes[slot], now);
+			}
+			else
+				checker.errors++;
+		}
+		checker.connects.clear();
+	}
+	manager.stop(duration);
+
+	if (manager.getConnectedCount() != 0)
+		checker.errors++;
+
+	run.Stats = manager.getStats();
+	run.Writes = io.getWrites();
+	run.Errors = checker.errors;
+}
+
+//wiimoteConnectorTimer_Elapsed: teardown and power save checks, then a
+//blocking Connect per new device, then the next pass 2s after this one ended.
+static void runSerial(const std::vector<FakeWiimote> &fakes, uint64_t duration, SessionResults &results)
+{
+	ConnectionSettings settings;
+	int count = (int)fakes.size();
+	std::vector<bool> connected(count, false);
+	std::vector<int> sessions(count, -1);
+	std::vector<int> attempts(count, 0);
+	int blinkWait = 0;
+
+	uint64_t now = 0;
+	while (now < duration)
+	{
+		bool blink = settings.EnumerateInterval * blinkWait >= settings.BlinkInterval;
+		blinkWait = blink ? 0 : blinkWait + 1;
+
+		for (int d = 0; d < count; d++)
+		{
+			if (!connected[d])
+				continue;
+
+			//Not used for longer than the significant timeout.
+			const FakeWiimote &fake = fakes[d];
+			bool powerSave = !isInUse(fake, now) && (now + fake.Phase) % 270000 >= 180000 + SIGNIFICANT_TIMEOUT;
+			if (findSession(fake, now) != sessions[d])
+			{
+				//The connection went silent when the device vanished.
+				uint64_t timeout = powerSave ? settings.PowerSaveDisconnectTimeout : settings.DisconnectTimeout;
+				if (fake.Sessions[sessions[d]].Vanish + timeout <= now)
+					connected[d] = false;
+				continue;
+			}
+
+			if (powerSave && blink)
+				now += settings.BlinkTime;
+		}
+
+		for (int d = 0; d < count; d++)
+		{
+			if (connected[d] || findSession(fakes[d], now) == -1)
+				continue;
+
+			uint64_t latency;
+			bool succeeds;
+			getAttempt(fakes[d], attempts[d]++, latency, succeeds);
+			int session = findSession(fakes[d], now);
+			now += latency;
+			if (succeeds && now < fakes[d].Sessions[session].Vanish)
+			{
+				connected[d] = true;
+				sessions[d] = session;
+				results.connected(fakes[d], d, now);
+			}
+		}
+
+		now += settings.EnumerateInterval;
+	}
+}
+
+struct LatencySummary
+{
+	std::vector<uint64_t> Latencies;
+	int Missed;
+};
+
+static LatencySummary summarize(const std::vector<FakeWiimote> &fakes, const SessionResults &results, uint64_t duration)
+{
+	LatencySummary summary;
+	summary.Missed = 0;
+	for (size_t d = 0; d < fakes.size(); d++)
+	{
+		for (size_t s = 0; s < fakes[d].Sessions.size(); s++)
+		{
+			const Session &session = fakes[d].Sessions[s];
+			//Sessions too close to the end are not counted.
+			if (session.Appear + 20000 > duration)
+				continue;
+
+			uint64_t at = results.ConnectedAt[d][s];
+			if (at == UINT64_MAX)
+				summary.Missed++;
+			else
+				summary.Latencies.push_back(at - session.Appear);
+		}
+	}
+	std::sort(summary.Latencies.begin(), summary.Latencies.end());
+	return summary;
+}
+
+static uint64_t getPercentile(const std::vector<uint64_t> &sorted, double percentile)
+{
+	if (sorted.empty())
+		return 0;
+	size_t index = (size_t)(percentile / 100.0 * (double)(sorted.size() - 1) + 0.5);
+	return sorted[index];
+}
+
+static void printSummary(const char *name, const LatencySummary &summary)
+{
+	printf("%-10s %9d %9llu %9llu %9llu %9llu %7d\n", name, (int)summary.Latencies.size(),
+		(unsigned long long)getPercentile(summary.Latencies, 50),
+		(unsigned long long)getPercentile(summary.Latencies, 90),
+		(unsigned long long)getPercentile(summary.Latencies, 99),
+		(unsigned long long)(summary.Latencies.empty() ? 0 : summary.Latencies.back()),
+		summary.Missed);
+}
+
+int main(int argc, char **argv)
+{
+	int devices = MAX_CONTROLLER_SLOTS;
+	int minutes = 60;
+	uint32_t seed = 1;
+	const char *logPath = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--devices") == 0 && i + 1 < argc)
+			devices = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--minutes") == 0 && i + 1 < argc)
+			minutes = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			seed = (uint32_t)atoi(argv[++i]);
+		else if (strcmp(argv[i], "--log") == 0 && i + 1 < argc)
+			logPath = argv[++i];
+		else
+		{
+			fprintf(stderr, "usage: ConnectionSim [--devices N] [--minutes N] [--seed N] [--log FILE]\n");
+			return 2;
+		}
+	}
+	devices = std::max(1, std::min(devices, MAX_CONTROLLER_SLOTS));
+	minutes = std::max(1, minutes);
+
+	uint64_t duration = (uint64_t)minutes * 60000;
+	std::vector<FakeWiimote> fakes = createDevices(devices, duration, seed);
+
+	FILE *logFile = NULL;
+	std::unique_ptr<BinaryLogSink> logSink;
+	if (logPath != NULL)
+	{
+		logFile = fopen(logPath, "wb");
+		if (logFile == NULL)
+		{
+			fprintf(stderr, "Could not create %s\n", logPath);
+			return 2;
+		}
+		logSink.reset(new BinaryLogSink(logFile));
+		Logger::start(*logSink, LogLevel::Info);
+	}
+
+	ManagerRun run(fakes);
+	runManager(fakes, duration, run);
+
+	if (logFile != NULL)
+	{
+		Logger::stop();
+		fclose(logFile);
+		if (Logger::getDropped() != 0)
+			printf("log: %llu records dropped\n\n", (unsigned long long)Logger::getDropped());
+	}
+	SessionResults serial(fakes);
+	runSerial(fakes, duration, serial);
+
+	LatencySummary managerSummary = summarize(fakes, run.Results, duration);
+	LatencySummary serialSummary = summarize(fakes, serial, duration);
+
+	printf("%d devices, %d virtual minutes\n\n", devices, minutes);
+	printf("appear to slot (ms)\n");
+	printf("%-10s %9s %9s %9s %9s %9s %7s\n", "", "sessions", "p50", "p90", "p99", "max", "missed");
+	printSummary("manager", managerSummary);
+	printSummary("serial", serialSummary);
+
+	const ConnectionStats &stats = run.Stats;
+	printf("\nmanager: %llu enumerations, %llu attempts, %llu failures, %llu timeouts, %llu connects, %llu teardowns, %llu power saves, %llu wakes, %llu writes\n",
+		(unsigned long long)stats.Enumerations, (unsigned long long)stats.ConnectAttempts, (unsigned long long)stats.ConnectFailures,
+		(unsigned long long)stats.ConnectTimeouts, (unsigned long long)stats.Connects, (unsigned long long)stats.Teardowns,
+		(unsigned long long)stats.PowerSaves, (unsigned long long)stats.Wakes, (unsigned long long)run.Writes);
+	printf("advance: %llu calls, %.1f ns mean, %.1f us max\n", (unsigned long long)run.AdvanceCalls,
+		(double)run.AdvanceTime / (double)run.AdvanceCalls, (double)run.MaxAdvanceTime / 1000.0);
+
+	int failures = run.Errors;
+	if (run.Errors != 0)
+		printf("FAIL: %d slot errors\n", run.Errors);
+	if (managerSummary.Missed > serialSummary.Missed)
+	{
+		printf("FAIL: manager missed %d sessions, serial %d\n", managerSummary.Missed, serialSummary.Missed);
+		failures++;
+	}
+	return failures == 0 ? 0 : 1;
+}
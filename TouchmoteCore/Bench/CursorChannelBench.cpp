@@ -0,0 +1,223 @@
+// CursorChannelBench.cpp
+//
+// Update-to-read latency of CursorChannel between two processes. The parent
+// maps the channel in a file under /dev/shm, forks a renderer stand-in that
+// maps it again by name, and publishes the 16 cursors at the given rate. The
+// reader records the time from publish to its copy of the frame, and checks
+// that every copy is whole: all cursors of a frame carry the same position, so
+// a torn read shows up as a mismatch and the run exits with 1.
+//
+// The reader spins by default, which measures the channel itself; --poll-us
+// makes it sleep between reads like a renderer waiting for vsync, and
+// --stall-ms stops it that long once a second, like a GPU stall. The writer's
+// publish time is reported too, and must not change with either.
+//
+// Linux only.
+//
+//   CursorChannelBench [--seconds N] [--rate HZ] [--poll-us N] [--stall-ms N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <memory>
+#include <thread>
+
+#include "../Diagnostics/Instrumentation.h"
+#include "../Overlay/CursorChannel.h"
+#include "../Overlay/SharedMemoryRegion.h"
+
+using namespace TouchmoteCore;
+
+struct BenchOptions
+{
+	double Seconds;
+	int Rate;
+	int PollMicroseconds;
+	int StallMilliseconds;
+};
+
+static void printHistogram(const char *label, const LatencyHistogram &histogram, double scale, const char *unit)
+{
+	HistogramSnapshot snapshot;
+	snapshot.add(histogram);
+	printf("%s p50 %8.1f%s  p99 %8.1f%s  p99.9 %8.1f%s  max %8.1f%s\n", label,
+		snapshot.getPercentile(50) / scale, unit,
+		snapshot.getPercentile(99) / scale, unit,
+		snapshot.getPercentile(99.9) / scale, unit,
+		snapshot.Max / scale, unit);
+}
+
+//The run is over when the writer publishes a window of width -1.
+static int runReader(const char *name, const BenchOptions &options)
+{
+	std::unique_ptr<SharedMemoryRegion> region(SharedMemoryRegion::open(name, getCursorChannelSize()));
+	if (!region)
+	{
+		fprintf(stderr, "reader: could not open %s\n", name);
+		return 1;
+	}
+
+	CursorChannelReader reader(region->data());
+	CursorChannelState state;
+	LatencyHistogram latency;
+	uint64_t reads = 0;
+	uint64_t torn = 0;
+	uint64_t start = Instrumentation::now();
+	uint64_t nextStall = start + 1000000000ull;
+	uint64_t giveUp = start + (uint64_t)((options.Seconds + 5) * 1e9);
+	while (true)
+	{
+		uint64_t now = Instrumentation::now();
+		if (now > giveUp)
+		{
+			fprintf(stderr, "reader: writer stopped publishing\n");
+			return 1;
+		}
+		if (options.StallMilliseconds > 0 && now >= nextStall)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(options.StallMilliseconds));
+			nextStall += 1000000000ull;
+		}
+
+		if (reader.read(state))
+		{
+			latency.record(Instrumentation::now() - state.Timestamp);
+			reads++;
+			if (state.WindowWidth == -1)
+				break;
+			for (int i = 1; i < MAX_OVERLAY_CURSORS; i++)
+			{
+				if (state.Cursors[i].X != state.Cursors[0].X || state.Cursors[i].Y != state.Cursors[0].Y)
+				{
+					torn++;
+					break;
+				}
+			}
+		}
+		if (options.PollMicroseconds > 0)
+			std::this_thread::sleep_for(std::chrono::microseconds(options.PollMicroseconds));
+	}
+
+	printf("reader: %llu reads, %llu skipped, %llu retries, %llu torn\n", (unsigned long long)reads,
+		(unsigned long long)reader.getSkipped(), (unsigned long long)reader.getRetries(), (unsigned long long)torn);
+	printHistogram("update to read:", latency, 1000.0, "us");
+	return torn == 0 ? 0 : 1;
+}
+
+static int runWriter(SharedMemoryRegion &region, pid_t child, const BenchOptions &options)
+{
+	CursorChannelWriter writer(region.data());
+	writer.setWindow(0, 0, 1920, 1080, true);
+	writer.setCursorScale(0.02f);
+	for (int i = 0; i < MAX_OVERLAY_CURSORS; i++)
+		writer.addCursor(i, 0x00ff0000u >> i);
+
+	LatencyHistogram publish;
+	uint64_t period = 1000000000ull / (uint64_t)options.Rate;
+	uint64_t start = Instrumentation::now();
+	uint64_t end = start + (uint64_t)(options.Seconds * 1e9);
+	uint64_t next = start;
+	uint64_t frames = 0;
+	while (next < end)
+	{
+		//Sleep most of the way, spin the rest so the rate holds.
+		uint64_t now = Instrumentation::now();
+		if (next > now + 200000)
+			std::this_thread::sleep_for(std::chrono::nanoseconds(next - now - 100000));
+		while (Instrumentation::now() < next)
+		{
+		}
+
+		frames++;
+		for (int i = 0; i < MAX_OVERLAY_CURSORS; i++)
+		{
+			writer.setPosition(i, (int)(frames & 0xffff), (int)(frames >> 16));
+			writer.setPressed(i, (frames / 30 + i) % 2 == 0);
+		}
+		uint64_t before = Instrumentation::now();
+		writer.publish(before);
+		publish.record(Instrumentation::now() - before);
+		next += period;
+	}
+
+	writer.setWindow(0, 0, -1, -1, true);
+	writer.publish(Instrumentation::now());
+
+	int status = 0;
+	if (waitpid(child, &status, 0) != child)
+		return 1;
+
+	printf("writer: %llu frames at %d Hz\n", (unsigned long long)frames, options.Rate);
+	printHistogram("publish:       ", publish, 1.0, "ns");
+	return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+int main(int argc, char **argv)
+{
+	BenchOptions options;
+	options.Seconds = 5;
+	options.Rate = 1000;
+	options.PollMicroseconds = 0;
+	options.StallMilliseconds = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+			options.Seconds = atof(argv[++i]);
+		else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+			options.Rate = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--poll-us") == 0 && i + 1 < argc)
+			options.PollMicroseconds = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--stall-ms") == 0 && i + 1 < argc)
+			options.StallMilliseconds = atoi(argv[++i]);
+		else
+		{
+			fprintf(stderr, "usage: CursorChannelBench [--seconds N] [--rate HZ] [--poll-us N] [--stall-ms N]\n");
+			return 2;
+		}
+	}
+	if (options.Rate < 1)
+		options.Rate = 1;
+
+	char name[64];
+	snprintf(name, sizeof(name), "%s/touchmote-cursors-%d", access("/dev/shm", W_OK) == 0 ? "/dev/shm" : "/tmp", (int)getpid());
+	std::unique_ptr<SharedMemoryRegion> region(SharedMemoryRegion::create(name, getCursorChannelSize()));
+	if (!region)
+	{
+		fprintf(stderr, "Could not create %s\n", name);
+		return 1;
+	}
+
+	fflush(stdout);
+	pid_t child = fork();
+	if (child == -1)
+	{
+		unlink(name);
+		return 1;
+	}
+	if (child == 0)
+	{
+		int result = runReader(name, options);
+		fflush(stdout);
+		_exit(result);
+	}
+
+	int result = runWriter(*region, child, options);
+	unlink(name);
+	return result;
+}
+
+#else
+
+int main()
+{
+	fprintf(stderr, "CursorChannelBench runs on Linux only\n");
+	return 0;
+}
+
+#endif
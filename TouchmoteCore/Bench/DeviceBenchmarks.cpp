@@ -0,0 +1,344 @@
+// DeviceBenchmarks.cpp
+//
+// Monitor table construction against a fake display layout, Bluetooth
+// address formatting, and HID device lookup against a fake sysfs tree.
+
+#include "Benchmarks.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+
+#if defined(__linux__)
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#include "../Devices/BluetoothAddress.h"
+#include "../Devices/HidRegistry.h"
+#include "../Devices/MonitorTable.h"
+#include "../Devices/SysfsHidBackend.h"
+
+namespace TouchmoteCore {
+
+	//A layout of monitors with a couple of inactive paths per monitor, and one
+	//cloned desktop so two active paths lead to the same target, which is what
+	//QDC_ALL_PATHS returns on a typical multi-head machine.
+	class FakeDisplayConfigProvider : public DisplayConfigProvider
+	{
+	public:
+		explicit FakeDisplayConfigProvider(int monitorCount)
+		{
+			DisplayAdapterId adapter = { 0x1234, 0 };
+			for (int m = 0; m < monitorCount; m++)
+			{
+				for (int source = 0; source < 3; source++)
+				{
+					DisplayPath path;
+					path.SourceAdapter = adapter;
+					path.SourceId = (uint32_t)source;
+					path.TargetAdapter = adapter;
+					path.TargetId = (uint32_t)(monitorCount - m) * 256 + 0x100;
+					path.Active = source == m % 3 || (m == 0 && source == 1);
+					DesktopRect bounds = { m * 1920, 0, (m + 1) * 1920, 1080 };
+					path.SourceBounds = bounds;
+					layout.push_back(path);
+				}
+			}
+		}
+
+		virtual bool queryPaths(std::vector<DisplayPath> &paths)
+		{
+			paths.insert(paths.end(), layout.begin(), layout.end());
+			return true;
+		}
+
+		virtual std::wstring getGDIDeviceName(const DisplayAdapterId &, uint32_t sourceId)
+		{
+			wchar_t name[32];
+			swprintf(name, 32, L"\\\\.\\DISPLAY%u", sourceId + 1);
+			return name;
+		}
+
+		virtual std::wstring getMonitorDevicePath(const DisplayAdapterId &, uint32_t targetId)
+		{
+			wchar_t path[128];
+			swprintf(path, 128, L"\\\\?\\DISPLAY#SAM0304#5&9a89472&0&UID%u#{e6f07b5f-ee97-4a90-b076-33f57bf4eaa7}", targetId);
+			return path;
+		}
+
+		virtual std::wstring getFriendlyName(const DisplayAdapterId &, uint32_t)
+		{
+			return L"SyncMaster";
+		}
+
+	private:
+		std::vector<DisplayPath> layout;
+	};
+
+	static void benchmarkEnumerateMonitors(BenchmarkState &state, int monitorCount)
+	{
+		FakeDisplayConfigProvider provider(monitorCount);
+		std::vector<DisplayPath> paths;
+		std::vector<MonitorEntry> monitors;
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			enumerateMonitors(provider, paths, monitors);
+			doNotOptimize(monitors.size());
+		}
+	}
+
+	static void benchmarkFormatBTAddress(BenchmarkState &state)
+	{
+		uint8_t address[BT_ADDRESS_BYTES] = { 0x1b, 0x3f, 0x7a, 0x19, 0x1e, 0x00 };
+		char text[BT_ADDRESS_STRING_LENGTH];
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			address[0] = (uint8_t)n;
+			formatBTAddress(address, text);
+			doNotOptimize(text);
+		}
+	}
+
+#if defined(__linux__)
+	static const uint16_t NINTENDO_VENDOR_ID = 0x057e;
+	//RVL-CNT-01 and RVL-CNT-01-TR.
+	static const uint16_t WIIMOTE_PRODUCT_IDS[] = { 0x0306, 0x0330 };
+	static const int FAKE_WIIMOTES = 8;
+
+	//A sysfs tree in a temporary directory with hidraw nodes for keyboards, mice,
+	//headsets and the like, and a few Wiimotes, like on a desk with a docking station.
+	class FakeUdevTree
+	{
+	public:
+		explicit FakeUdevTree(int deviceCount)
+		{
+			char root[] = "/tmp/touchmote-sysfs-XXXXXX";
+			if (mkdtemp(root) == NULL)
+				return;
+
+			this->root = root;
+			mkdir((this->root + "/class").c_str(), 0700);
+			mkdir((this->root + "/class/hidraw").c_str(), 0700);
+			//Spread over the node numbers, hidraw0 is a Wiimote.
+			int stride = std::max(deviceCount / FAKE_WIIMOTES, 1);
+			for (int d = 0; d < deviceCount; d++)
+			{
+				if (d % stride == 0)
+					addDevice(d, NINTENDO_VENDOR_ID, WIIMOTE_PRODUCT_IDS[(d / stride) % 2], "Nintendo RVL-CNT-01");
+				else
+					addDevice(d, (uint16_t)(0x0400 + d % 37), (uint16_t)(0x1000 + d), "Generic USB HID");
+			}
+		}
+
+		~FakeUdevTree()
+		{
+			for (size_t n = 0; n < nodes.size(); n++)
+			{
+				std::string directory = getNodeDirectory(nodes[n]);
+				unlink((directory + "/device/uevent").c_str());
+				rmdir((directory + "/device").c_str());
+				rmdir(directory.c_str());
+			}
+			rmdir((root + "/class/hidraw").c_str());
+			rmdir((root + "/class").c_str());
+			rmdir(root.c_str());
+		}
+
+		const std::string &getRoot() const { return root; }
+
+	private:
+		std::string getNodeDirectory(int node) const
+		{
+			char name[32];
+			snprintf(name, sizeof(name), "/class/hidraw/hidraw%d", node);
+			return root + name;
+		}
+
+		void addDevice(int node, uint16_t vendorId, uint16_t productId, const char *name)
+		{
+			std::string directory = getNodeDirectory(node);
+			mkdir(directory.c_str(), 0700);
+			mkdir((directory + "/device").c_str(), 0700);
+
+			FILE *file = fopen((directory + "/device/uevent").c_str(), "w");
+			if (file == NULL)
+				return;
+			fprintf(file, "DRIVER=hid-generic\nHID_ID=0005:%08X:%08X\nHID_NAME=%s\nHID_PHYS=00:1a:7d:da:71:13\nHID_UNIQ=00:1f:32:b2:%02x:%02x\nMODALIAS=hid:b0005g0000v%08Xp%08X\n",
+				vendorId, productId, name, node / 256, node % 256, vendorId, productId);
+			fclose(file);
+			nodes.push_back(node);
+		}
+
+		std::string root;
+		std::vector<int> nodes;
+	};
+
+	//Built once per size and removed at exit, so the timed runs do not pay for it.
+	static const FakeUdevTree &getFakeUdevTree(int deviceCount)
+	{
+		static std::map<int, std::unique_ptr<FakeUdevTree> > trees;
+		std::unique_ptr<FakeUdevTree> &tree = trees[deviceCount];
+		if (!tree)
+			tree.reset(new FakeUdevTree(deviceCount));
+		return *tree;
+	}
+
+	//Reads the fake tree, with notifications queued by the benchmark instead of
+	//coming from the netlink socket.
+	class FakeHotplugBackend : public HidBackend
+	{
+	public:
+		FakeHotplugBackend(const std::string &root, bool hotplug) : sysfs(root, false), hotplug(hotplug) {}
+
+		std::vector<HidChange> Queued;
+
+		virtual bool enumerate(std::vector<std::string> &paths) { return sysfs.enumerate(paths); }
+		virtual bool readInfo(const std::string &path, HidDeviceInfo &info) { return sysfs.readInfo(path, info); }
+
+		virtual bool pollChanges(std::vector<HidChange> &changes)
+		{
+			changes.insert(changes.end(), Queued.begin(), Queued.end());
+			Queued.clear();
+			return hotplug;
+		}
+
+	private:
+		SysfsHidBackend sysfs;
+		bool hotplug;
+	};
+
+	//What HidDevices.Enumerate(vendorId, productIds) does on every connector tick:
+	//list everything, read the attributes of every device, filter.
+	static void scanHidDevices(HidBackend &backend, uint16_t vendorId, const uint16_t *productIds, int productCount,
+		std::vector<std::string> &paths, std::vector<HidDeviceInfo> &devices)
+	{
+		paths.clear();
+		devices.clear();
+		backend.enumerate(paths);
+		for (size_t p = 0; p < paths.size(); p++)
+		{
+			HidDeviceInfo info = HidDeviceInfo();
+			if (!backend.readInfo(paths[p], info) || info.VendorId != vendorId)
+				continue;
+
+			for (int i = 0; i < productCount; i++)
+			{
+				if (info.ProductId == productIds[i])
+				{
+					info.Path = paths[p];
+					devices.push_back(info);
+					break;
+				}
+			}
+		}
+	}
+
+	static void benchmarkHidScan(BenchmarkState &state, int deviceCount)
+	{
+		const FakeUdevTree &tree = getFakeUdevTree(deviceCount);
+		FakeHotplugBackend backend(tree.getRoot(), false);
+		std::vector<std::string> paths;
+		std::vector<HidDeviceInfo> devices;
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			scanHidDevices(backend, NINTENDO_VENDOR_ID, WIIMOTE_PRODUCT_IDS, 2, paths, devices);
+			doNotOptimize(devices.size());
+		}
+	}
+
+	//Without notifications: only the listing, attributes are cached.
+	static void benchmarkHidRegistryRescan(BenchmarkState &state, int deviceCount)
+	{
+		const FakeUdevTree &tree = getFakeUdevTree(deviceCount);
+		FakeHotplugBackend backend(tree.getRoot(), false);
+		HidRegistry registry(backend);
+		registry.update();
+		std::vector<const HidDeviceInfo *> devices;
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			registry.update();
+			devices.clear();
+			registry.find(NINTENDO_VENDOR_ID, WIIMOTE_PRODUCT_IDS, 2, devices);
+			doNotOptimize(devices.size());
+		}
+	}
+
+	//With notifications and nothing plugged: what a connector tick costs.
+	static void benchmarkHidRegistryUpdate(BenchmarkState &state, int deviceCount)
+	{
+		const FakeUdevTree &tree = getFakeUdevTree(deviceCount);
+		FakeHotplugBackend backend(tree.getRoot(), true);
+		HidRegistry registry(backend);
+		registry.update();
+		std::vector<const HidDeviceInfo *> devices;
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			registry.update();
+			devices.clear();
+			registry.find(NINTENDO_VENDOR_ID, WIIMOTE_PRODUCT_IDS, 2, devices);
+			doNotOptimize(devices.size());
+		}
+	}
+
+	//A Wiimote dropping off and coming back, one attributes read.
+	static void benchmarkHidRegistryHotplug(BenchmarkState &state, int deviceCount)
+	{
+		const FakeUdevTree &tree = getFakeUdevTree(deviceCount);
+		FakeHotplugBackend backend(tree.getRoot(), true);
+		HidRegistry registry(backend);
+		registry.update();
+		HidChange removed = { false, "/dev/hidraw0" };
+		HidChange added = { true, "/dev/hidraw0" };
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			backend.Queued.push_back(removed);
+			backend.Queued.push_back(added);
+			doNotOptimize(registry.update());
+		}
+	}
+
+	static void benchmarkHidRegistryFind(BenchmarkState &state, int deviceCount)
+	{
+		const FakeUdevTree &tree = getFakeUdevTree(deviceCount);
+		FakeHotplugBackend backend(tree.getRoot(), true);
+		HidRegistry registry(backend);
+		registry.update();
+		std::vector<const HidDeviceInfo *> devices;
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			devices.clear();
+			registry.find(NINTENDO_VENDOR_ID, WIIMOTE_PRODUCT_IDS, 2, devices);
+			doNotOptimize(devices.size());
+		}
+	}
+#endif
+
+	void registerDeviceBenchmarks(BenchmarkRunner &runner)
+	{
+		runner.add("devices/enumerate_monitors/1", [](BenchmarkState &state) { benchmarkEnumerateMonitors(state, 1); });
+		runner.add("devices/enumerate_monitors/4", [](BenchmarkState &state) { benchmarkEnumerateMonitors(state, 4); });
+		runner.add("devices/enumerate_monitors/16", [](BenchmarkState &state) { benchmarkEnumerateMonitors(state, 16); });
+		runner.add("devices/format_bt_address", benchmarkFormatBTAddress);
+#if defined(__linux__)
+		runner.add("devices/hid_scan/64", [](BenchmarkState &state) { benchmarkHidScan(state, 64); });
+		runner.add("devices/hid_scan/512", [](BenchmarkState &state) { benchmarkHidScan(state, 512); });
+		runner.add("devices/hid_registry_rescan/64", [](BenchmarkState &state) { benchmarkHidRegistryRescan(state, 64); });
+		runner.add("devices/hid_registry_rescan/512", [](BenchmarkState &state) { benchmarkHidRegistryRescan(state, 512); });
+		runner.add("devices/hid_registry_update/64", [](BenchmarkState &state) { benchmarkHidRegistryUpdate(state, 64); });
+		runner.add("devices/hid_registry_update/512", [](BenchmarkState &state) { benchmarkHidRegistryUpdate(state, 512); });
+		runner.add("devices/hid_registry_hotplug/512", [](BenchmarkState &state) { benchmarkHidRegistryHotplug(state, 512); });
+		runner.add("devices/hid_registry_find/512", [](BenchmarkState &state) { benchmarkHidRegistryFind(state, 512); });
+#endif
+	}
+
+}
@@ -0,0 +1,509 @@
+// DuoTouchCheck.cpp
+//
+// Checks the native DuoTouch against the managed one. First scripted gestures,
+// a tap, an edge swipe, a pinch with the slave lifted first and one with the
+// master lifted first, and a tap with hover disabled, against the frames
+// DuoTouch.getFrame gives for them. Then random input, driven the way
+// TouchHandler.setPosition drives it, for several controllers appending to one
+// frame, against a transcription of DuoTouch.getFrame that keeps its flags and
+// returns a new vector per frame like the Queue. Contacts must match exactly,
+// positions bit for bit. Reported is the time per frame of both. Exits with 1
+// on a mismatch.
+//
+//   DuoTouchCheck [--frames N] [--controllers N] [--seed N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "../Output/DuoTouch.h"
+#include "../Replay/SyntheticTrace.h"
+
+using namespace TouchmoteCore;
+
+//DuoTouch.getFrame as it is, flags and all.
+class ManagedDuoTouch
+{
+public:
+	ManagedDuoTouch(uint64_t startId, const PipelineSettings &settings)
+		: masterPriority((int)startId), slavePriority((int)startId + 1), stepIDs(false), masterID(startId), slaveID(startId + 1),
+		startID(startId), usingMidpoint(false), masterHovering(true), slaveHovering(true), slaveEnded(true), masterReleased(true),
+		slaveReleased(true), hoverDisabled(false), isFirstMasterContact(true), masterHoldPosition(true)
+	{
+		width = settings.screenWidth;
+		height = settings.screenHeight;
+		edgeHelperMargins = settings.touch_edgeGestureHelperMargins;
+		edgeHelperRelease = settings.touch_edgeGestureHelperRelease;
+		masterPosition = slavePosition = firstMasterContact = midpoint = Point();
+		lastMasterContact = lastSlaveContact = TouchContact();
+	}
+
+	void setMasterPosition(double x, double y) { masterPosition.X = x; masterPosition.Y = y; }
+	void setSlavePosition(double x, double y)
+	{
+		if (slaveReleased)
+		{
+			slavePosition.X = x;
+			slavePosition.Y = y;
+		}
+	}
+	void setContactMaster() { masterReleased = false; }
+	void setContactSlave() { slaveReleased = false; }
+	void releaseContactMaster() { masterReleased = true; }
+	void releaseContactSlave() { slaveReleased = true; }
+	void setHoverEnabled(bool enabled) { hoverDisabled = !enabled; }
+
+	std::vector<TouchContact> getFrame()
+	{
+		std::vector<TouchContact> newFrame;
+		ContactType contactType;
+		if (!masterReleased)
+		{
+			if (masterHovering)
+			{
+				contactType = ContactType::Start;
+				masterHovering = false;
+			}
+			else
+			{
+				contactType = ContactType::Move;
+			}
+			if (isFirstMasterContact)
+			{
+				firstMasterContact = masterPosition;
+			}
+			else
+			{
+				if (masterHoldPosition)
+					masterHoldPosition = false;
+				if (firstMasterContact.X < edgeHelperMargins && masterPosition.X < edgeHelperRelease)
+					masterPosition.Y = (firstMasterContact.Y + firstMasterContact.Y + masterPosition.Y) / 3;
+				if (firstMasterContact.X > (width - edgeHelperMargins) && masterPosition.X > (width - edgeHelperRelease))
+					masterPosition.Y = (firstMasterContact.Y + firstMasterContact.Y + masterPosition.Y) / 3;
+				if (firstMasterContact.Y < edgeHelperMargins && masterPosition.Y < edgeHelperRelease)
+					masterPosition.X = (firstMasterContact.X + firstMasterContact.X + masterPosition.X) / 3;
+				if (firstMasterContact.Y > (height - edgeHelperMargins) && masterPosition.Y > (height - edgeHelperRelease))
+					masterPosition.X = (firstMasterContact.X + firstMasterContact.X + masterPosition.X) / 3;
+			}
+			isFirstMasterContact = false;
+		}
+		else
+		{
+			if (!masterHovering)
+			{
+				contactType = hoverDisabled ? ContactType::End : ContactType::EndToHover;
+				masterPosition.X = lastMasterContact.X;
+				masterPosition.Y = lastMasterContact.Y;
+				masterHovering = true;
+			}
+			else
+			{
+				contactType = ContactType::Hover;
+			}
+			isFirstMasterContact = true;
+			masterHoldPosition = true;
+		}
+
+		if (!(contactType == ContactType::Hover && hoverDisabled))
+		{
+			if (stepIDs && contactType == ContactType::EndToHover)
+			{
+				lastMasterContact = makeContact(masterID, ContactType::End, masterPosition, masterPriority);
+				masterID = (masterID - startID + 2) % 4 + startID;
+				slaveID = (slaveID - startID + 2) % 4 + startID;
+				stepIDs = false;
+			}
+			else
+			{
+				lastMasterContact = makeContact(masterID, contactType, masterPosition, masterPriority);
+			}
+			newFrame.push_back(lastMasterContact);
+		}
+
+		if (!slaveReleased)
+		{
+			if (slaveHovering)
+			{
+				contactType = ContactType::Start;
+				slaveHovering = false;
+			}
+			else
+			{
+				contactType = ContactType::Move;
+			}
+			if (!masterReleased)
+			{
+				if (!usingMidpoint)
+				{
+					midpoint.X = (masterPosition.X + slavePosition.X) / 2;
+					midpoint.Y = (masterPosition.Y + slavePosition.Y) / 2;
+					usingMidpoint = true;
+				}
+				slavePosition.X = midpoint.X - (masterPosition.X - midpoint.X);
+				slavePosition.Y = midpoint.Y - (masterPosition.Y - midpoint.Y);
+				if (slavePosition.X < 0)
+					slavePosition.X = 0;
+				if (slavePosition.Y < 0)
+					slavePosition.Y = 0;
+				if (slavePosition.X > width)
+					slavePosition.X = width - 1;
+				if (slavePosition.Y > height)
+					slavePosition.Y = height - 1;
+			}
+			else
+			{
+				usingMidpoint = false;
+			}
+			slaveEnded = false;
+			stepIDs = false;
+		}
+		else
+		{
+			if (!slaveHovering)
+			{
+				contactType = ContactType::EndToHover;
+				slavePosition.X = lastSlaveContact.X;
+				slavePosition.Y = lastSlaveContact.Y;
+				slaveHovering = true;
+			}
+			else
+			{
+				contactType = ContactType::EndFromHover;
+			}
+		}
+
+		if (!slaveEnded)
+		{
+			lastSlaveContact = makeContact(slaveID, contactType, slavePosition, slavePriority);
+			newFrame.push_back(lastSlaveContact);
+			if (contactType == ContactType::EndFromHover)
+			{
+				slaveEnded = true;
+				if (!masterReleased)
+				{
+					stepIDs = true;
+				}
+				else
+				{
+					masterID = (masterID - startID + 2) % 4 + startID;
+					slaveID = (slaveID - startID + 2) % 4 + startID;
+					stepIDs = false;
+				}
+			}
+		}
+		return newFrame;
+	}
+
+private:
+	struct Point
+	{
+		double X;
+		double Y;
+
+		Point() : X(0), Y(0) {}
+	};
+
+	static TouchContact makeContact(uint64_t id, ContactType type, Point position, int priority)
+	{
+		TouchContact contact = { id, type, position.X, position.Y, priority };
+		return contact;
+	}
+
+	int masterPriority;
+	int slavePriority;
+	bool stepIDs;
+	uint64_t masterID;
+	uint64_t slaveID;
+	uint64_t startID;
+	TouchContact lastMasterContact;
+	TouchContact lastSlaveContact;
+	Point masterPosition;
+	Point slavePosition;
+	Point midpoint;
+	bool usingMidpoint;
+	bool masterHovering;
+	bool slaveHovering;
+	bool slaveEnded;
+	bool masterReleased;
+	bool slaveReleased;
+	bool hoverDisabled;
+	bool isFirstMasterContact;
+	Point firstMasterContact;
+	bool masterHoldPosition;
+	double width;
+	double height;
+	double edgeHelperMargins;
+	double edgeHelperRelease;
+};
+
+//What TouchHandler.setPosition does with a cursor position and the buttons.
+struct ControllerInput
+{
+	bool MasterDown;
+	bool SlaveDown;
+	bool HoverEnabled;
+	double X;
+	double Y;
+};
+
+template<typename T> static void applyInput(T &duoTouch, const ControllerInput &input)
+{
+	duoTouch.setHoverEnabled(input.HoverEnabled);
+	if (input.MasterDown)
+		duoTouch.setContactMaster();
+	else
+		duoTouch.releaseContactMaster();
+	duoTouch.setMasterPosition(input.X, input.Y);
+	if (input.SlaveDown)
+	{
+		duoTouch.setSlavePosition(input.X, input.Y);
+		duoTouch.setContactSlave();
+	}
+	else
+	{
+		duoTouch.releaseContactSlave();
+	}
+}
+
+static bool sameContact(const TouchContact &a, const TouchContact &b)
+{
+	return a.ID == b.ID && a.Type == b.Type && a.Priority == b.Priority && memcmp(&a.X, &b.X, sizeof(double)) == 0
+		&& memcmp(&a.Y, &b.Y, sizeof(double)) == 0;
+}
+
+static void printContact(const char *label, const TouchContact &contact)
+{
+	printf("  %s: id %llu %s (%.17g, %.17g) priority %d\n", label, (unsigned long long)contact.ID, getContactTypeName(contact.Type),
+		contact.X, contact.Y, contact.Priority);
+}
+
+static bool compareFrame(const char *name, int frameIndex, const ContactFrame &frame, const TouchContact *expected, int expectedCount)
+{
+	bool same = frame.getCount() == expectedCount;
+	for (int i = 0; same && i < expectedCount; i++)
+		same = sameContact(frame[i], expected[i]);
+	if (same)
+		return true;
+	printf("FAIL: %s, frame %d\n", name, frameIndex);
+	for (int i = 0; i < expectedCount; i++)
+		printContact("expected", expected[i]);
+	for (int i = 0; i < frame.getCount(); i++)
+		printContact("got", frame[i]);
+	return false;
+}
+
+struct ScriptStep
+{
+	ControllerInput Input;
+	int Count;
+	TouchContact Contacts[DUO_TOUCH_CONTACTS];
+};
+
+#define C(id, type, x, y, priority) { id, ContactType::type, x, y, priority }
+
+//Frames of DuoTouch with start id 1 on a 1920x1080 screen, margins 30 and
+//release 60.
+static const ScriptStep TAP[] = {
+	{ { false, false, true, 500, 400 }, 1, { C(1, Hover, 500, 400, 1) } },
+	{ { true, false, true, 500, 400 }, 1, { C(1, Start, 500, 400, 1) } },
+	{ { true, false, true, 510, 405 }, 1, { C(1, Move, 510, 405, 1) } },
+	{ { false, false, true, 520, 410 }, 1, { C(1, EndToHover, 510, 405, 1) } },
+	{ { false, false, true, 530, 420 }, 1, { C(1, Hover, 530, 420, 1) } }
+};
+
+static const ScriptStep EDGE_SWIPE[] = {
+	{ { true, false, true, 10, 500 }, 1, { C(1, Start, 10, 500, 1) } },
+	{ { true, false, true, 40, 560 }, 1, { C(1, Move, 40, 520, 1) } },
+	{ { true, false, true, 80, 600 }, 1, { C(1, Move, 80, 600, 1) } },
+	{ { true, false, true, 1900, 20 }, 1, { C(1, Move, 1900, 20, 1) } },
+	{ { false, false, true, 1900, 20 }, 1, { C(1, EndToHover, 1900, 20, 1) } }
+};
+
+static const ScriptStep PINCH_SLAVE_FIRST[] = {
+	{ { true, false, true, 800, 500 }, 1, { C(1, Start, 800, 500, 1) } },
+	{ { true, true, true, 800, 500 }, 2, { C(1, Move, 800, 500, 1), C(2, Start, 800, 500, 2) } },
+	{ { true, true, true, 850, 520 }, 2, { C(1, Move, 850, 520, 1), C(2, Move, 750, 480, 2) } },
+	{ { true, false, true, 860, 530 }, 2, { C(1, Move, 860, 530, 1), C(2, EndToHover, 750, 480, 2) } },
+	{ { true, false, true, 870, 530 }, 2, { C(1, Move, 870, 530, 1), C(2, EndFromHover, 750, 480, 2) } },
+	{ { false, false, true, 880, 530 }, 1, { C(1, End, 870, 530, 1) } },
+	{ { false, false, true, 890, 530 }, 1, { C(3, Hover, 890, 530, 1) } }
+};
+
+static const ScriptStep PINCH_MASTER_FIRST[] = {
+	{ { true, true, true, 100, 200 }, 2, { C(1, Start, 100, 200, 1), C(2, Start, 100, 200, 2) } },
+	{ { true, true, true, 90, 190 }, 2, { C(1, Move, 90, 190, 1), C(2, Move, 110, 210, 2) } },
+	{ { false, true, true, 80, 180 }, 2, { C(1, EndToHover, 90, 190, 1), C(2, Move, 110, 210, 2) } },
+	{ { false, false, true, 70, 170 }, 2, { C(1, Hover, 70, 170, 1), C(2, EndToHover, 110, 210, 2) } },
+	{ { false, false, true, 60, 160 }, 2, { C(1, Hover, 60, 160, 1), C(2, EndFromHover, 110, 210, 2) } },
+	{ { false, false, true, 50, 150 }, 1, { C(3, Hover, 50, 150, 1) } }
+};
+
+static const ScriptStep TAP_NO_HOVER[] = {
+	{ { false, false, false, 300, 300 }, 0, {} },
+	{ { true, false, false, 300, 300 }, 1, { C(1, Start, 300, 300, 1) } },
+	{ { false, false, false, 310, 300 }, 1, { C(1, End, 300, 300, 1) } },
+	{ { false, false, false, 320, 300 }, 0, {} },
+	{ { true, false, false, 330, 300 }, 1, { C(1, Start, 330, 300, 1) } }
+};
+
+#undef C
+
+static PipelineSettings makeSettings()
+{
+	PipelineSettings settings;
+	settings.screenWidth = 1920;
+	settings.screenHeight = 1080;
+	settings.touch_edgeGestureHelperMargins = 30;
+	settings.touch_edgeGestureHelperRelease = 60;
+	return settings;
+}
+
+static int runScript(const char *name, const ScriptStep *steps, int count)
+{
+	PipelineSettings settings = makeSettings();
+	DuoTouch duoTouch(1, settings);
+	TouchContact contacts[DUO_TOUCH_CONTACTS];
+	for (int s = 0; s < count; s++)
+	{
+		ContactFrame frame(contacts, DUO_TOUCH_CONTACTS);
+		applyInput(duoTouch, steps[s].Input);
+		duoTouch.getFrame(frame);
+		if (!compareFrame(name, s, frame, steps[s].Contacts, steps[s].Count))
+			return 1;
+	}
+	return 0;
+}
+
+//A cursor that wanders, jumps to the screen edges now and then and leaves
+//the screen a little, with buttons that stay down for a while.
+struct RandomController
+{
+	ControllerInput Input;
+
+	RandomController() { Input.MasterDown = Input.SlaveDown = false; Input.HoverEnabled = true; Input.X = 960; Input.Y = 540; }
+
+	void step(XorShift32 &random)
+	{
+		uint32_t roll = random.next() % 100;
+		if (roll < 4)
+		{
+			//Next to an edge or a corner.
+			Input.X = (random.next() & 1) ? random.next() % 50 : 1920 - random.next() % 50;
+			if (random.next() & 1)
+				Input.Y = (random.next() & 1) ? random.next() % 50 : 1080 - random.next() % 50;
+		}
+		else
+		{
+			Input.X = std::min(1950.0, std::max(-30.0, Input.X + random.nextInt(40) + (random.next() % 8) / 8.0));
+			Input.Y = std::min(1110.0, std::max(-30.0, Input.Y + random.nextInt(40) + (random.next() % 8) / 8.0));
+		}
+		if (random.next() % 100 < 8)
+			Input.MasterDown = !Input.MasterDown;
+		if (random.next() % 100 < 6)
+			Input.SlaveDown = !Input.SlaveDown;
+		if (random.next() % 1000 < 5)
+			Input.HoverEnabled = !Input.HoverEnabled;
+	}
+};
+
+int main(int argc, char **argv)
+{
+	int frames = 200000;
+	int controllers = 4;
+	uint32_t seed = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--frames") && hasValue) frames = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--controllers") && hasValue) controllers = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--seed") && hasValue) seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else
+		{
+			fprintf(stderr, "usage: DuoTouchCheck [--frames N] [--controllers N] [--seed N]\n");
+			return 2;
+		}
+	}
+	frames = std::max(frames, 1);
+	controllers = std::min(std::max(controllers, 1), 16);
+
+	int failures = 0;
+	failures += runScript("tap", TAP, sizeof(TAP) / sizeof(TAP[0]));
+	failures += runScript("edge swipe", EDGE_SWIPE, sizeof(EDGE_SWIPE) / sizeof(EDGE_SWIPE[0]));
+	failures += runScript("pinch, slave lifted first", PINCH_SLAVE_FIRST, sizeof(PINCH_SLAVE_FIRST) / sizeof(PINCH_SLAVE_FIRST[0]));
+	failures += runScript("pinch, master lifted first", PINCH_MASTER_FIRST, sizeof(PINCH_MASTER_FIRST) / sizeof(PINCH_MASTER_FIRST[0]));
+	failures += runScript("tap without hover", TAP_NO_HOVER, sizeof(TAP_NO_HOVER) / sizeof(TAP_NO_HOVER[0]));
+
+	//A frame without room is refused and changes nothing.
+	{
+		PipelineSettings settings = makeSettings();
+		DuoTouch duoTouch(1, settings);
+		TouchContact contacts[DUO_TOUCH_CONTACTS];
+		ContactFrame small(contacts, 1);
+		applyInput(duoTouch, TAP[1].Input);
+		ContactFrame frame(contacts, DUO_TOUCH_CONTACTS);
+		if (duoTouch.getFrame(small) || small.getCount() != 0 || !duoTouch.getFrame(frame) || !compareFrame("full frame", 0, frame, TAP[1].Contacts, 1))
+		{
+			printf("FAIL: full frame\n");
+			failures++;
+		}
+	}
+
+	PipelineSettings settings = makeSettings();
+	std::vector<std::unique_ptr<DuoTouch> > native;
+	std::vector<std::unique_ptr<ManagedDuoTouch> > managed;
+	std::vector<RandomController> inputs(controllers);
+	for (int c = 0; c < controllers; c++)
+	{
+		native.push_back(std::unique_ptr<DuoTouch>(new DuoTouch((uint64_t)c * DUO_TOUCH_ID_SPAN + 1, settings)));
+		managed.push_back(std::unique_ptr<ManagedDuoTouch>(new ManagedDuoTouch((uint64_t)c * DUO_TOUCH_ID_SPAN + 1, settings)));
+	}
+
+	std::vector<TouchContact> contacts(controllers * DUO_TOUCH_CONTACTS);
+	XorShift32 random(seed);
+	double nativeTime = 0;
+	double managedTime = 0;
+	uint64_t contactCount = 0;
+	int mismatches = 0;
+	for (int f = 0; f < frames && mismatches < 5; f++)
+	{
+		for (int c = 0; c < controllers; c++)
+		{
+			inputs[c].step(random);
+			applyInput(*native[c], inputs[c].Input);
+			applyInput(*managed[c], inputs[c].Input);
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		ContactFrame frame(&contacts[0], (int)contacts.size());
+		for (int c = 0; c < controllers; c++)
+			native[c]->getFrame(frame);
+		std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+		//The merge of MultiWiiPointerProvider.
+		std::vector<TouchContact> allContacts;
+		for (int c = 0; c < controllers; c++)
+		{
+			std::vector<TouchContact> queue = managed[c]->getFrame();
+			allContacts.insert(allContacts.end(), queue.begin(), queue.end());
+		}
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		nativeTime += std::chrono::duration<double, std::nano>(middle - start).count();
+		managedTime += std::chrono::duration<double, std::nano>(end - middle).count();
+
+		contactCount += frame.getCount();
+		if (!compareFrame("random input", f, frame, allContacts.empty() ? NULL : &allContacts[0], (int)allContacts.size()))
+			mismatches++;
+	}
+	failures += mismatches;
+
+	printf("%d frames of %d controllers, %llu contacts\n", frames, controllers, (unsigned long long)contactCount);
+	printf("native  %8.1f ns per frame\n", nativeTime / frames);
+	printf("managed %8.1f ns per frame, as transcribed\n", managedTime / frames);
+	if (failures != 0)
+		printf("FAIL: %d mismatches\n", failures);
+	return failures == 0 ? 0 : 1;
+}
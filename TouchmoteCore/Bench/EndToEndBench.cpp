@@ -0,0 +1,476 @@
+// EndToEndBench.cpp
+//
+// Latency from a Wiimote report arriving to the output of the frame that used
+// it, headless, through the native components one after the other on the real
+// clock. The synthetic reports of every controller arrive at the report rate,
+// with a tenth of the period of jitter like Bluetooth adds. They arrive as
+// capture records, so decoding is CaptureReader. Each goes into the
+// InputPipeline as soon as it is due. Frames run at the pipeline's frame period
+// and each one goes through:
+//
+//   the pipeline, which covers the pointer filter and the classifier
+//   a fixed button map, standing in for WiiKeyMapper, into the vmulti reports
+//   the contacts through TouchOutputStage into a sink that drops them
+//   a TUIO bundle of the contacts
+//   the cursor overlay, drawn by SoftwareCursorRenderer
+//
+// The latency of a report runs from when it was due to the end of the first
+// frame that used it, so it includes the wait for that frame. A report that a
+// newer one of the same controller replaced before any frame ran is counted as
+// superseded, the same as the mailbox drops it. Reported per rate and
+// controller count are the throughput, the latency percentiles, the work per
+// frame and the heap allocations per frame, counted by replacing operator new.
+// Exits with 1 if a record does not decode or a report never reaches an output.
+//
+//   EndToEndBench [--rate HZ] [--controllers N] [--fps N] [--seconds N] [--seed N]
+//
+// Without --rate and --controllers every combination of 100, 250, 500 and
+// 1000Hz with 1, 4 and 16 controllers is run.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "../Diagnostics/LatencyHistogram.h"
+#include "../Output/TouchOutputStage.h"
+#include "../Output/TuioEncoder.h"
+#include "../Output/VmultiReports.h"
+#include "../Overlay/CursorOverlay.h"
+#include "../Overlay/SoftwareCursorRenderer.h"
+#include "../Pipeline/InputPipeline.h"
+#include "../Replay/CaptureReader.h"
+#include "../Replay/CaptureWriter.h"
+#include "../Replay/SyntheticTrace.h"
+
+using namespace TouchmoteCore;
+
+static std::atomic<uint64_t> allocations(0);
+
+void *operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void *memory = malloc(size > 0 ? size : 1);
+	if (memory == NULL)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void *operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+	free(memory);
+}
+
+static uint64_t nowNs()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class DroppingTouchSink : public TouchSink
+{
+public:
+	uint64_t Pointers;
+
+	DroppingTouchSink() : Pointers(0) {}
+
+	virtual bool inject(const TouchPointer *, int count, uint64_t) { Pointers += count; return true; }
+	virtual bool reset() { return true; }
+};
+
+class DroppingVmultiSink : public VmultiSink
+{
+public:
+	uint64_t Reports;
+
+	DroppingVmultiSink() : Reports(0) {}
+
+	virtual bool send(VmultiReportType, const uint8_t *, size_t) { Reports++; return true; }
+};
+
+//A button and what it does, the way a keymap binds buttons to keys and mouse buttons.
+struct ButtonBinding
+{
+	uint32_t Button;
+	//HID keyboard usage, 0 for a mouse button.
+	uint8_t Key;
+	uint8_t MouseButton;
+};
+
+static const ButtonBinding BUTTON_MAP[] = {
+	{ Button_A, 0, 1 },
+	{ Button_B, 0, 2 },
+	{ Button_Up, 0x52, 0 },
+	{ Button_Down, 0x51, 0 },
+	{ Button_Left, 0x50, 0 },
+	{ Button_Right, 0x4f, 0 },
+	{ Button_Plus, 0x2e, 0 },
+	{ Button_Minus, 0x2d, 0 },
+	{ Button_Home, 0x4a, 0 },
+};
+
+//The output handlers of a frame, fed by the pipeline's events.
+class FrameOutputs : public EventSink
+{
+public:
+	FrameOutputs(const PipelineSettings &settings)
+		: touch(touchSink), vmulti(vmultiSink), renderer(settings.screenWidth, settings.screenHeight),
+		width(settings.screenWidth), height(settings.screenHeight), tuioCount(0), tuioFrame(0), tuioBytes(0), pixels(0), now(0)
+	{
+		overlay.setCursorScale(0.02f, settings.screenWidth);
+		memset(buttons, 0, sizeof(buttons));
+	}
+
+	void setTime(double milliseconds) { now = milliseconds; }
+
+	virtual void onEvent(const OutputEvent &event)
+	{
+		switch (event.EventType)
+		{
+		case OutputEvent::Type::Connect:
+			overlay.addCursor(event.Slot - 1, 0x00ff0000u >> (event.Slot - 1));
+			break;
+		case OutputEvent::Type::Cursor:
+			overlay.setPosition(event.Slot - 1, (int)event.X, (int)event.Y);
+			dispatchButtons(event.Slot, event.Buttons);
+			break;
+		case OutputEvent::Type::ContactStart:
+		case OutputEvent::Type::ContactUpdate:
+			touch.onEvent(event);
+			setTuioCursor((uint32_t)event.ID, (float)(event.X / width), (float)(event.Y / height));
+			break;
+		case OutputEvent::Type::ContactEnd:
+			touch.onEvent(event);
+			removeTuioCursor((uint32_t)event.ID);
+			break;
+		default:
+			break;
+		}
+	}
+
+	//After the pipeline's frame, every output in turn.
+	void endFrame(uint64_t timestamp)
+	{
+		touch.submitFrame(timestamp);
+		vmulti.endUpdate();
+		tuioBytes += encodeTuioFrame(tuioCursors, tuioCount, ++tuioFrame, tuioPacket, sizeof(tuioPacket));
+		overlay.stepFrame(now);
+		pixels += renderer.render(overlay);
+	}
+
+	uint64_t getTouchPointers() const { return touchSink.Pointers; }
+	uint64_t getVmultiReports() const { return vmultiSink.Reports; }
+	uint64_t getTuioBytes() const { return tuioBytes; }
+	uint64_t getPixels() const { return pixels; }
+
+private:
+	void dispatchButtons(int slot, uint32_t current)
+	{
+		uint32_t changed = current ^ buttons[slot - 1];
+		buttons[slot - 1] = current;
+		if (changed == 0)
+			return;
+
+		for (size_t i = 0; i < sizeof(BUTTON_MAP) / sizeof(BUTTON_MAP[0]); i++)
+		{
+			const ButtonBinding &binding = BUTTON_MAP[i];
+			if ((changed & binding.Button) == 0)
+				continue;
+			bool down = (current & binding.Button) != 0;
+			if (binding.Key != 0)
+			{
+				if (down)
+					vmulti.keyDown(binding.Key);
+				else
+					vmulti.keyUp(binding.Key);
+			}
+			else if (down)
+				vmulti.mouseButtonDown(binding.MouseButton);
+			else
+				vmulti.mouseButtonUp(binding.MouseButton);
+		}
+		if (changed & Button_A)
+			overlay.setPressed(slot - 1, (current & Button_A) != 0, now);
+	}
+
+	void setTuioCursor(uint32_t id, float x, float y)
+	{
+		for (int i = 0; i < tuioCount; i++)
+		{
+			if (tuioCursors[i].ID == id)
+			{
+				tuioCursors[i].X = x;
+				tuioCursors[i].Y = y;
+				return;
+			}
+		}
+		if (tuioCount == MAX_TUIO_CURSORS)
+			return;
+		TuioCursor cursor = { id, x, y, 0.01f, 0.01f };
+		tuioCursors[tuioCount++] = cursor;
+	}
+
+	void removeTuioCursor(uint32_t id)
+	{
+		for (int i = 0; i < tuioCount; i++)
+		{
+			if (tuioCursors[i].ID == id)
+			{
+				tuioCursors[i] = tuioCursors[--tuioCount];
+				return;
+			}
+		}
+	}
+
+	DroppingTouchSink touchSink;
+	TouchOutputStage touch;
+	DroppingVmultiSink vmultiSink;
+	VmultiReportAccumulator vmulti;
+	CursorOverlay overlay;
+	SoftwareCursorRenderer renderer;
+	double width;
+	double height;
+	uint32_t buttons[MAX_CONTROLLER_SLOTS];
+	TuioCursor tuioCursors[MAX_TUIO_CURSORS];
+	int tuioCount;
+	int32_t tuioFrame;
+	uint8_t tuioPacket[TUIO_MAX_PACKET];
+	uint64_t tuioBytes;
+	uint64_t pixels;
+	double now;
+};
+
+struct Arrival
+{
+	//Nanoseconds after the start.
+	uint64_t Time;
+	int Slot;
+
+	bool operator<(const Arrival &other) const { return Time < other.Time || (Time == other.Time && Slot < other.Slot); }
+};
+
+struct RunResult
+{
+	bool Ok;
+	uint64_t Reports;
+	uint64_t Superseded;
+	uint64_t Frames;
+	uint64_t Overruns;
+	uint64_t Allocations;
+	uint64_t Elapsed;
+	//Due to output, per report.
+	LatencyHistogram Latency;
+	//Start to end of a frame.
+	LatencyHistogram Work;
+	uint64_t TouchPointers;
+	uint64_t VmultiReports;
+	uint64_t TuioBytes;
+	uint64_t Pixels;
+};
+
+static void run(int rate, int controllers, int fps, double seconds, uint32_t seed, RunResult &result)
+{
+	PipelineSettings settings;
+	if (fps > 0)
+		settings.pointer_FPS = fps;
+	uint64_t duration = (uint64_t)(seconds * 1e9);
+
+	//Every controller at the rate, offset from each other and jittered.
+	XorShift32 random(seed);
+	std::vector<Arrival> arrivals;
+	uint64_t period = 1000000000ull / (uint64_t)rate;
+	for (int c = 0; c < controllers; c++)
+	{
+		for (uint64_t t = period + period * c / controllers; t < duration; t += period)
+		{
+			Arrival arrival = { t + (uint64_t)(random.nextInt((int)(period / 20)) + (int)(period / 20)), c + 1 };
+			arrivals.push_back(arrival);
+		}
+	}
+	std::sort(arrivals.begin(), arrivals.end());
+
+	std::ostringstream out(std::ios::binary);
+	{
+		CaptureWriter writer(out);
+		for (size_t i = 0; i < arrivals.size(); i++)
+		{
+			WiimoteReport report;
+			makeSyntheticReport(random, arrivals[i].Time / 1000, arrivals[i].Slot, report);
+			writer.writeReport(report);
+		}
+	}
+	std::istringstream in(out.str(), std::ios::binary);
+	CaptureReader reader(in);
+	CaptureRecord record;
+
+	FrameOutputs outputs(settings);
+	InputPipeline pipeline(settings, outputs);
+	for (int c = 1; c <= controllers; c++)
+		pipeline.connect(c, 0);
+	uint64_t framePeriod = pipeline.getFramePeriod() * 1000;
+
+	result.Ok = reader.isValid();
+	result.Reports = result.Superseded = result.Frames = result.Overruns = result.Allocations = 0;
+	uint64_t due[MAX_CONTROLLER_SLOTS];
+	bool pending[MAX_CONTROLLER_SLOTS];
+	memset(pending, 0, sizeof(pending));
+
+	uint64_t start = nowNs();
+	uint64_t nextFrame = framePeriod;
+	size_t next = 0;
+	while (result.Ok)
+	{
+		uint64_t now = nowNs() - start;
+		while (next < arrivals.size() && arrivals[next].Time <= now)
+		{
+			if (!reader.next(record) || record.Type != CaptureRecordType::Report)
+			{
+				printf("FAIL: record %d did not decode: %s\n", (int)next, reader.error().c_str());
+				result.Ok = false;
+				break;
+			}
+			pipeline.pushReport(record.Report);
+			int slot = arrivals[next].Slot - 1;
+			if (pending[slot])
+				result.Superseded++;
+			due[slot] = arrivals[next].Time;
+			pending[slot] = true;
+			result.Reports++;
+			next++;
+		}
+
+		if (now >= nextFrame)
+		{
+			uint64_t frameStart = nowNs();
+			uint64_t allocated = allocations.load(std::memory_order_relaxed);
+			outputs.setTime(nextFrame / 1e6);
+			pipeline.processFrame(nextFrame / 1000);
+			outputs.endFrame(nextFrame / 1000);
+			uint64_t frameEnd = nowNs();
+			result.Allocations += allocations.load(std::memory_order_relaxed) - allocated;
+			result.Work.record(frameEnd - frameStart);
+			result.Frames++;
+			for (int c = 0; c < controllers; c++)
+			{
+				if (pending[c])
+				{
+					result.Latency.record(frameEnd - start - due[c]);
+					pending[c] = false;
+				}
+			}
+
+			//Deadlines missed while this frame ran are skipped.
+			nextFrame += framePeriod;
+			while (nextFrame <= frameEnd - start)
+			{
+				nextFrame += framePeriod;
+				result.Overruns++;
+			}
+			continue;
+		}
+
+		if (next >= arrivals.size() && now >= duration)
+			break;
+
+		//Sleeping is too coarse for the last stretch, so that is spun.
+		uint64_t wake = nextFrame;
+		if (next < arrivals.size())
+			wake = std::min(wake, arrivals[next].Time);
+		if (wake > now + 200000)
+			std::this_thread::sleep_for(std::chrono::nanoseconds(wake - now - 100000));
+	}
+	result.Elapsed = nowNs() - start;
+	result.TouchPointers = outputs.getTouchPointers();
+	result.VmultiReports = outputs.getVmultiReports();
+	result.TuioBytes = outputs.getTuioBytes();
+	result.Pixels = outputs.getPixels();
+
+	//All but the reports of the last frame period reached an output.
+	if (result.Ok && result.Latency.getCount() + result.Superseded + controllers < result.Reports)
+	{
+		printf("FAIL: %llu of %llu reports reached an output\n", (unsigned long long)result.Latency.getCount(), (unsigned long long)result.Reports);
+		result.Ok = false;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int rate = 0;
+	int controllers = 0;
+	int fps = 0;
+	double seconds = 1;
+	uint32_t seed = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) rate = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--controllers") == 0 && i + 1 < argc) controllers = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) fps = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = atof(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else
+		{
+			fprintf(stderr, "usage: EndToEndBench [--rate HZ] [--controllers N] [--fps N] [--seconds N] [--seed N]\n");
+			return 2;
+		}
+	}
+	if (rate < 0 || rate > 1000 || controllers < 0 || controllers > MAX_CONTROLLER_SLOTS || seconds <= 0)
+	{
+		fprintf(stderr, "--rate must be 1..1000, --controllers 1..%d and --seconds positive\n", MAX_CONTROLLER_SLOTS);
+		return 2;
+	}
+
+	std::vector<int> rates;
+	std::vector<int> counts;
+	if (rate > 0)
+		rates.push_back(rate);
+	else
+		rates = { 100, 250, 500, 1000 };
+	if (controllers > 0)
+		counts.push_back(controllers);
+	else
+		counts = { 1, 4, 16 };
+
+	printf("%6s %5s %10s %8s %10s %10s %10s %10s %10s %8s %7s\n", "rate", "ctrls", "reports/s", "frames/s", "lat p50", "lat p99", "lat p99.9",
+		"work p50", "work p99", "allocs/f", "overrun");
+	int status = 0;
+	for (size_t r = 0; r < rates.size(); r++)
+	{
+		for (size_t c = 0; c < counts.size(); c++)
+		{
+			RunResult result;
+			run(rates[r], counts[c], fps, seconds, seed, result);
+			if (!result.Ok)
+				status = 1;
+
+			HistogramSnapshot latency;
+			latency.add(result.Latency);
+			HistogramSnapshot work;
+			work.add(result.Work);
+			double elapsed = result.Elapsed / 1e9;
+			printf("%6d %5d %10.0f %8.1f %8.0fus %8.0fus %8.0fus %8.1fus %8.1fus %8.2f %7llu\n", rates[r], counts[c], result.Reports / elapsed,
+				result.Frames / elapsed, latency.getPercentile(50) / 1000.0, latency.getPercentile(99) / 1000.0, latency.getPercentile(99.9) / 1000.0,
+				work.getPercentile(50) / 1000.0, work.getPercentile(99) / 1000.0, result.Frames > 0 ? (double)result.Allocations / result.Frames : 0,
+				(unsigned long long)result.Overruns);
+			printf("%12s %llu superseded, %llu touch pointers, %llu vmulti reports, %llu TUIO bytes, %llu overlay pixels\n", "",
+				(unsigned long long)result.Superseded, (unsigned long long)result.TouchPointers, (unsigned long long)result.VmultiReports,
+				(unsigned long long)result.TuioBytes, (unsigned long long)result.Pixels);
+		}
+	}
+	return status;
+}
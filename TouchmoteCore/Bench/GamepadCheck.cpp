@@ -0,0 +1,454 @@
+// GamepadCheck.cpp
+//
+// Checks the native Xbox 360 controller output. First the conversions against a
+// transcription of XinputReport: toThumbValue and toTriggerValue must give what
+// ToBytes puts on the wire for 0, 0.5, 1, values just inside and outside the
+// range, infinities, NaN and a sweep over 0..1.
+//
+// Then random frames of tilt, stick, trigger and button changes through
+// GamepadReportBuilder into a memory sink, against a model of the report: one
+// report for a frame that ends on a change, with the dirty bits of exactly the
+// fields that changed, and none for a frame that ends where the last report
+// did. The sink fails now and then, and the report has to go again the next
+// frame; invalidate() and reset() are mixed in. On Linux the same reports go
+// through UinputGamepadSink into a pipe, and the input_events read back are
+// decoded into the state of the controller, which has to match the report
+// after every SYN_REPORT. Exits with 1 on a mismatch.
+//
+//   GamepadCheck [--frames N] [--seed N]
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "../Output/GamepadReport.h"
+#include "../Output/UinputGamepadSink.h"
+#include "../Replay/SyntheticTrace.h"
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace TouchmoteCore;
+
+//(Int32) of a double in .NET: truncated, and 0x80000000 for NaN and anything
+//out of range, what cvttsd2si gives.
+static int32_t toDotNetInt32(double value)
+{
+	if (!(value > -2147483649.0 && value < 2147483648.0))
+		return INT_MIN;
+	return (int32_t)value;
+}
+
+//XinputReport.getStickLXRaw and the others, and the two bytes ToBytes keeps of it.
+static int16_t managedThumb(double stick)
+{
+	int32_t raw;
+	if (stick > 1.0)
+		raw = 32767;
+	else if (stick < 0.0)
+		raw = -32767;
+	else
+		raw = toDotNetInt32((stick - 0.5) * 2 * 32767);
+	return (int16_t)(uint16_t)(raw & 0xffff);
+}
+
+//XinputReport.getTriggerRRaw. getTriggerLRaw tests TriggerR for the lower end,
+//a slip, so the right one stands for both.
+static uint8_t managedTrigger(double trigger)
+{
+	if (trigger > 1.0)
+		return 255;
+	if (trigger < 0.0)
+		return 0;
+	return (uint8_t)toDotNetInt32(trigger * 255);
+}
+
+static int checkConversions()
+{
+	const double infinity = std::numeric_limits<double>::infinity();
+	std::vector<double> values;
+	const double edges[] = { 0, 0.5, 1, 0.25, 0.75, 1e-12, 0.5 - 1e-12, 0.5 + 1e-12, 1 - 1e-12, -1e-12, 1 + 1e-12, -0.5, 1.5, -1e300, 1e300,
+		infinity, -infinity, std::numeric_limits<double>::quiet_NaN() };
+	values.insert(values.end(), edges, edges + sizeof(edges) / sizeof(edges[0]));
+	for (int i = 0; i <= 100000; i++)
+		values.push_back(i / 100000.0);
+
+	int failures = 0;
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		double value = values[i];
+		if (toThumbValue(value) != managedThumb(value))
+		{
+			if (failures < 5)
+				printf("FAIL: stick %.17g is %d, XinputReport %d\n", value, toThumbValue(value), managedThumb(value));
+			failures++;
+		}
+		if (toTriggerValue(value) != managedTrigger(value))
+		{
+			if (failures < 5)
+				printf("FAIL: trigger %.17g is %d, XinputReport %d\n", value, toTriggerValue(value), managedTrigger(value));
+			failures++;
+		}
+	}
+	printf("%d values converted like XinputReport\n", (int)values.size() - failures);
+	return failures;
+}
+
+static const uint16_t BUTTONS[] = {
+	XINPUT_BUTTON_DPAD_UP, XINPUT_BUTTON_DPAD_DOWN, XINPUT_BUTTON_DPAD_LEFT, XINPUT_BUTTON_DPAD_RIGHT, XINPUT_BUTTON_START, XINPUT_BUTTON_BACK,
+	XINPUT_BUTTON_LEFT_THUMB, XINPUT_BUTTON_RIGHT_THUMB, XINPUT_BUTTON_LEFT_SHOULDER, XINPUT_BUTTON_RIGHT_SHOULDER, XINPUT_BUTTON_GUIDE,
+	XINPUT_BUTTON_A, XINPUT_BUTTON_B, XINPUT_BUTTON_X, XINPUT_BUTTON_Y,
+};
+
+static uint32_t getChanged(const XinputGamepadReport &a, const XinputGamepadReport &b)
+{
+	uint32_t changed = 0;
+	if (a.Buttons != b.Buttons)
+		changed |= GAMEPAD_CHANGED_BUTTONS;
+	if (a.LeftTrigger != b.LeftTrigger)
+		changed |= GAMEPAD_CHANGED_LEFT_TRIGGER;
+	if (a.RightTrigger != b.RightTrigger)
+		changed |= GAMEPAD_CHANGED_RIGHT_TRIGGER;
+	if (a.ThumbLX != b.ThumbLX)
+		changed |= GAMEPAD_CHANGED_THUMB_LX;
+	if (a.ThumbLY != b.ThumbLY)
+		changed |= GAMEPAD_CHANGED_THUMB_LY;
+	if (a.ThumbRX != b.ThumbRX)
+		changed |= GAMEPAD_CHANGED_THUMB_RX;
+	if (a.ThumbRY != b.ThumbRY)
+		changed |= GAMEPAD_CHANGED_THUMB_RY;
+	return changed;
+}
+
+static XinputGamepadReport getNeutral()
+{
+	XinputGamepadReport report;
+	memset(&report, 0, sizeof(report));
+	report.Length = (uint8_t)sizeof(report);
+	return report;
+}
+
+//Keeps what it is sent, or fails while Failing, and passes it on to next.
+class MemoryGamepadSink : public GamepadSink
+{
+public:
+	struct Sent
+	{
+		XinputGamepadReport Report;
+		uint32_t Changed;
+	};
+
+	std::vector<Sent> Reports;
+	bool Failing;
+	GamepadSink *Next;
+
+	MemoryGamepadSink() : Failing(false), Next(NULL) {}
+
+	virtual bool send(const XinputGamepadReport &report, uint32_t changed, uint64_t timestamp)
+	{
+		if (Failing || (Next != NULL && !Next->send(report, changed, timestamp)))
+			return false;
+		Sent sent = { report, changed };
+		Reports.push_back(sent);
+		return true;
+	}
+};
+
+#if defined(__linux__)
+
+struct EvdevButton
+{
+	uint16_t Button;
+	uint16_t Code;
+};
+
+//The buttons of xpad, written down apart from the sink's table.
+static const EvdevButton EVDEV_BUTTONS[] = {
+	{ XINPUT_BUTTON_A, BTN_A }, { XINPUT_BUTTON_B, BTN_B }, { XINPUT_BUTTON_X, BTN_X }, { XINPUT_BUTTON_Y, BTN_Y },
+	{ XINPUT_BUTTON_LEFT_SHOULDER, BTN_TL }, { XINPUT_BUTTON_RIGHT_SHOULDER, BTN_TR }, { XINPUT_BUTTON_BACK, BTN_SELECT },
+	{ XINPUT_BUTTON_START, BTN_START }, { XINPUT_BUTTON_GUIDE, BTN_MODE }, { XINPUT_BUTTON_LEFT_THUMB, BTN_THUMBL },
+	{ XINPUT_BUTTON_RIGHT_THUMB, BTN_THUMBR },
+};
+
+//The state of the controller as a reader of its event device sees it.
+class EvdevDecoder
+{
+public:
+	explicit EvdevDecoder(int fd) : fd(fd), events(0)
+	{
+		memset(keys, 0, sizeof(keys));
+		memset(axes, 0, sizeof(axes));
+	}
+
+	//Reads the events of one report. Returns false and says why if they do not
+	//end in one SYN_REPORT, or an event other than a hat repeats a value.
+	bool readReport(bool forced)
+	{
+		struct input_event event;
+		for (;;)
+		{
+			ssize_t got = read(fd, &event, sizeof(event));
+			if (got != (ssize_t)sizeof(event))
+			{
+				printf("FAIL: report without SYN_REPORT\n");
+				return false;
+			}
+			events++;
+			if (event.type == EV_SYN && event.code == SYN_REPORT)
+				break;
+
+			int32_t *target = NULL;
+			if (event.type == EV_KEY && event.code <= KEY_MAX)
+				target = &keys[event.code];
+			else if (event.type == EV_ABS && event.code <= ABS_MAX)
+				target = &axes[event.code];
+			if (target == NULL)
+			{
+				printf("FAIL: event type %d code %d\n", event.type, event.code);
+				return false;
+			}
+			//Both hat axes are written when the d-pad changes, and a new
+			//device gets every field.
+			if (*target == event.value && !forced && !(event.type == EV_ABS && (event.code == ABS_HAT0X || event.code == ABS_HAT0Y)))
+			{
+				printf("FAIL: event type %d code %d repeats %d\n", event.type, event.code, event.value);
+				return false;
+			}
+			*target = event.value;
+		}
+
+		char extra;
+		if (read(fd, &extra, 1) != -1 || errno != EAGAIN)
+		{
+			printf("FAIL: events after SYN_REPORT\n");
+			return false;
+		}
+		return true;
+	}
+
+	bool matches(const XinputGamepadReport &report) const
+	{
+		bool ok = true;
+		for (size_t b = 0; b < sizeof(EVDEV_BUTTONS) / sizeof(EVDEV_BUTTONS[0]); b++)
+			ok = ok && keys[EVDEV_BUTTONS[b].Code] == ((report.Buttons & EVDEV_BUTTONS[b].Button) != 0 ? 1 : 0);
+		int hatX = ((report.Buttons & XINPUT_BUTTON_DPAD_RIGHT) != 0 ? 1 : 0) - ((report.Buttons & XINPUT_BUTTON_DPAD_LEFT) != 0 ? 1 : 0);
+		int hatY = ((report.Buttons & XINPUT_BUTTON_DPAD_DOWN) != 0 ? 1 : 0) - ((report.Buttons & XINPUT_BUTTON_DPAD_UP) != 0 ? 1 : 0);
+		//Evdev y grows downwards, xpad sends -1 - y.
+		return ok && axes[ABS_HAT0X] == hatX && axes[ABS_HAT0Y] == hatY && axes[ABS_X] == report.ThumbLX && axes[ABS_Y] == -1 - report.ThumbLY
+			&& axes[ABS_RX] == report.ThumbRX && axes[ABS_RY] == -1 - report.ThumbRY && axes[ABS_Z] == report.LeftTrigger
+			&& axes[ABS_RZ] == report.RightTrigger;
+	}
+
+	uint64_t getEvents() const { return events; }
+
+private:
+	int fd;
+	int32_t keys[KEY_MAX + 1];
+	int32_t axes[ABS_MAX + 1];
+	uint64_t events;
+};
+
+#endif
+
+struct Model
+{
+	uint16_t Buttons;
+	double Sticks[4];
+	double Triggers[2];
+
+	void reset()
+	{
+		Buttons = 0;
+		std::fill(Sticks, Sticks + 4, 0.5);
+		std::fill(Triggers, Triggers + 2, 0.0);
+	}
+
+	XinputGamepadReport getReport() const
+	{
+		XinputGamepadReport report = getNeutral();
+		report.Buttons = Buttons;
+		report.ThumbLX = managedThumb(Sticks[0]);
+		report.ThumbLY = managedThumb(Sticks[1]);
+		report.ThumbRX = managedThumb(Sticks[2]);
+		report.ThumbRY = managedThumb(Sticks[3]);
+		report.LeftTrigger = managedTrigger(Triggers[0]);
+		report.RightTrigger = managedTrigger(Triggers[1]);
+		return report;
+	}
+};
+
+static double pickValue(XorShift32 &random, double current)
+{
+	switch (random.next() % 10)
+	{
+	case 0:
+		return 0.5;
+	case 1:
+		return (random.next() % 2) == 0 ? -0.25 : 1.25;
+	case 2:
+		//Within one step of the conversion, often the same raw value.
+		return current + (random.nextInt(2) * 1e-6);
+	case 3:
+		return current;
+	default:
+		return (random.next() % 10001) / 10000.0;
+	}
+}
+
+static void fail(int &failures, int frame, const char *what)
+{
+	if (failures < 5)
+		printf("FAIL: frame %d: %s\n", frame, what);
+	failures++;
+}
+
+static int checkFrames(int frames, uint32_t seed)
+{
+	MemoryGamepadSink sink;
+#if defined(__linux__)
+	int pipes[2];
+	if (pipe(pipes) != 0 || fcntl(pipes[0], F_SETFL, O_NONBLOCK) != 0)
+	{
+		printf("FAIL: no pipe\n");
+		return 1;
+	}
+	UinputGamepadSink uinput(pipes[1], false);
+	EvdevDecoder decoder(pipes[0]);
+	sink.Next = &uinput;
+#endif
+
+	GamepadReportBuilder builder(sink);
+	XorShift32 random(seed);
+	Model model;
+	model.reset();
+	XinputGamepadReport sent = getNeutral();
+	//Like a newly connected device.
+	bool forced = true;
+	builder.invalidate();
+
+	int failures = 0;
+	int unchanged = 0;
+	int failed = 0;
+	for (int f = 0; f < frames && failures < 5; f++)
+	{
+		int actions = (int)(random.next() % 7);
+		for (int a = 0; a < actions; a++)
+		{
+			uint32_t kind = random.next() % 3;
+			if (kind == 0)
+			{
+				uint16_t button = BUTTONS[random.next() % (sizeof(BUTTONS) / sizeof(BUTTONS[0]))];
+				bool down = random.next() % 2 == 0;
+				builder.setButton(button, down);
+				model.Buttons = down ? (uint16_t)(model.Buttons | button) : (uint16_t)(model.Buttons & ~button);
+			}
+			else if (kind == 1)
+			{
+				int axis = (int)(random.next() % 4);
+				model.Sticks[axis] = pickValue(random, model.Sticks[axis]);
+				builder.setStick((GamepadAxis)axis, model.Sticks[axis]);
+			}
+			else
+			{
+				int trigger = (int)(random.next() % 2);
+				model.Triggers[trigger] = pickValue(random, model.Triggers[trigger]);
+				builder.setTrigger((GamepadTrigger)trigger, model.Triggers[trigger]);
+			}
+		}
+		if (random.next() % 50 == 0)
+		{
+			builder.reset();
+			model.reset();
+		}
+		if (random.next() % 100 == 0)
+		{
+			builder.invalidate();
+			forced = true;
+		}
+		sink.Failing = random.next() % 20 == 0;
+
+		XinputGamepadReport expected = model.getReport();
+		uint32_t changed = getChanged(expected, sent);
+		size_t before = sink.Reports.size();
+		bool result = builder.endUpdate((uint64_t)f * 10000);
+		size_t reports = sink.Reports.size() - before;
+
+		if (memcmp(&builder.getReport(), &expected, sizeof(expected)) != 0)
+			fail(failures, f, "report differs from the model");
+		if (sink.Failing)
+		{
+			failed++;
+			if (result || reports != 0)
+				fail(failures, f, "a failed send counted as sent");
+			if (builder.getDirty() != changed)
+				fail(failures, f, "dirty bits lost after a failed send");
+			continue;
+		}
+		if (changed == 0 && !forced)
+		{
+			unchanged++;
+			if (result || reports != 0)
+				fail(failures, f, "report for an unchanged frame");
+			continue;
+		}
+		if (!result || reports != 1)
+		{
+			fail(failures, f, "not one report for a changed frame");
+			continue;
+		}
+		const MemoryGamepadSink::Sent &last = sink.Reports.back();
+		if (memcmp(&last.Report, &expected, sizeof(expected)) != 0)
+			fail(failures, f, "sent report differs from the model");
+		if (last.Changed != (forced ? GAMEPAD_CHANGED_ALL : changed))
+			fail(failures, f, "dirty bits are not the fields that changed");
+		if (builder.getDirty() != 0)
+			fail(failures, f, "dirty bits left after sending");
+#if defined(__linux__)
+		if (!decoder.readReport(forced) || !decoder.matches(expected))
+			fail(failures, f, "input events do not decode to the report");
+#endif
+		sent = expected;
+		forced = false;
+	}
+
+	printf("%d frames, %d reports, %d unchanged, %d failed sends", frames, (int)sink.Reports.size(), unchanged, failed);
+#if defined(__linux__)
+	printf(", %llu input events decoded", (unsigned long long)decoder.getEvents());
+	close(pipes[0]);
+#endif
+	printf("\n");
+	return failures;
+}
+
+int main(int argc, char **argv)
+{
+	int frames = 100000;
+	uint32_t seed = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else
+		{
+			fprintf(stderr, "usage: %s [--frames N] [--seed N]\n", argv[0]);
+			return 2;
+		}
+	}
+	frames = std::max(frames, 1);
+
+	int failures = checkConversions();
+	failures += checkFrames(frames, seed);
+	if (failures != 0)
+		printf("FAIL: %d mismatches\n", failures);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+// InstrumentationBench.cpp
+//
+// Measures what a probe costs on the pipeline thread: a bare record(), a
+// StageProbe including both clock reads, a disabled probe, and recording from
+// several threads while another thread keeps taking snapshots.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../Diagnostics/Instrumentation.h"
+
+using namespace TouchmoteCore;
+
+static const int ITERATIONS = 10000000;
+
+static double measure(void (*body)(int), int iterations)
+{
+	uint64_t start = Instrumentation::now();
+	body(iterations);
+	return (double)(Instrumentation::now() - start) / iterations;
+}
+
+static void recordLoop(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+		Instrumentation::record(PipelineStage::Filter, (i & 3) + 1, (uint64_t)(i & 0xffff));
+}
+
+static void probeLoop(int iterations)
+{
+	for (int i = 0; i < iterations; i++)
+		StageProbe probe(PipelineStage::Filter, (i & 3) + 1);
+}
+
+static void clockLoop(int iterations)
+{
+	volatile uint64_t sink = 0;
+	for (int i = 0; i < iterations; i++)
+		sink = sink + Instrumentation::now();
+}
+
+int main(int argc, char **argv)
+{
+	//Defaults to one writer per core, more than that only measures the scheduler.
+	int threads = argc > 1 ? atoi(argv[1]) : (int)std::max(1u, std::thread::hardware_concurrency());
+
+	recordLoop(1000);
+	printf("%-28s %8.2f ns\n", "steady_clock::now", measure(clockLoop, ITERATIONS));
+	printf("%-28s %8.2f ns\n", "record", measure(recordLoop, ITERATIONS));
+	printf("%-28s %8.2f ns\n", "StageProbe", measure(probeLoop, ITERATIONS));
+	Instrumentation::setEnabled(false);
+	printf("%-28s %8.2f ns\n", "StageProbe (disabled)", measure(probeLoop, ITERATIONS));
+	Instrumentation::setEnabled(true);
+
+	InstrumentationSnapshot snapshot;
+	Instrumentation::snapshot(snapshot);
+	const int snapshotIterations = 1000;
+	uint64_t start = Instrumentation::now();
+	for (int i = 0; i < snapshotIterations; i++)
+		Instrumentation::snapshot(snapshot);
+	printf("%-28s %8.2f us\n", "snapshot", (double)(Instrumentation::now() - start) / snapshotIterations / 1000.0);
+
+	//Writers on every thread while the main thread polls like a UI would.
+	Instrumentation::reset();
+	std::atomic<int> finished(0);
+	std::vector<double> costs(threads);
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; t++)
+	{
+		workers.push_back(std::thread([t, &costs, &finished]() {
+			costs[t] = measure(probeLoop, ITERATIONS / 4);
+			finished++;
+		}));
+	}
+	uint64_t snapshots = 0;
+	while (finished.load() < threads)
+	{
+		Instrumentation::snapshot(snapshot);
+		snapshots++;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+		workers[t].join();
+
+	double worst = 0;
+	for (int t = 0; t < threads; t++)
+		worst = costs[t] > worst ? costs[t] : worst;
+	Instrumentation::snapshot(snapshot);
+	const StageSummary *filter = snapshot.findStage(PipelineStage::Filter, -1);
+	printf("%-28s %8.2f ns (%d threads, %llu snapshots taken, %llu samples)\n", "StageProbe under snapshot", worst, threads,
+		(unsigned long long)snapshots, (unsigned long long)(filter != NULL ? filter->Count : 0));
+	return 0;
+}
@@ -0,0 +1,267 @@
+// MailboxStress.cpp
+//
+// Stress test and latency benchmark of ReportMailbox.
+//
+// The stress phase runs one producer thread per slot, publishing reports whose
+// every field is derived from a sequence number, against a consumer polling all
+// slots. Every report the consumer sees must be consistent (no torn copy) and
+// newer than the previous one of its slot. Exits with 1 otherwise.
+//
+// The latency phase measures the time from publish to the consumer picking the
+// report up, for the mailboxes and for the managed scheme: a dictionary keyed
+// by device path under one mutex, which the connector also holds for 100ms
+// every second while it blinks LEDs.
+//
+//   MailboxStress [--seconds N] [--slots N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Diagnostics/Instrumentation.h"
+#include "../Pipeline/ReportMailbox.h"
+
+using namespace TouchmoteCore;
+
+static void fillReport(WiimoteReport &report, int slot, uint64_t sequence)
+{
+	memset(&report, 0, sizeof(report));
+	report.Timestamp = sequence;
+	report.Slot = slot;
+	report.Buttons = (uint32_t)(sequence * 2654435761u);
+	for (int i = 0; i < 3; i++)
+		report.AccelRaw[i] = (uint8_t)(sequence >> (i * 8));
+	report.BatteryRaw = (uint8_t)(sequence >> 24);
+	for (int s = 0; s < IR_SENSOR_COUNT; s++)
+	{
+		report.IR[s].Found = ((sequence >> s) & 1) != 0;
+		report.IR[s].setRawPosition((int)((sequence + s) % 1024), (int)((sequence * 3 + s) % 768));
+		report.IR[s].Size = (int)(sequence % 16);
+	}
+	report.Extension = (ExtensionType)(sequence % 3);
+	for (int i = 0; i < MAX_EXTENSION_BYTES; i++)
+		report.ExtensionData[i] = (uint8_t)(sequence * (i + 1));
+}
+
+static bool isConsistent(const WiimoteReport &report, int slot)
+{
+	//Field by field, assignment does not have to copy padding.
+	WiimoteReport expected;
+	fillReport(expected, slot, report.Timestamp);
+	if (report.Slot != expected.Slot || report.Buttons != expected.Buttons || report.BatteryRaw != expected.BatteryRaw
+		|| report.Extension != expected.Extension
+		|| memcmp(report.AccelRaw, expected.AccelRaw, sizeof(report.AccelRaw)) != 0
+		|| memcmp(report.ExtensionData, expected.ExtensionData, sizeof(report.ExtensionData)) != 0)
+		return false;
+
+	for (int s = 0; s < IR_SENSOR_COUNT; s++)
+	{
+		const IRSensor &a = report.IR[s];
+		const IRSensor &b = expected.IR[s];
+		if (a.Found != b.Found || a.RawX != b.RawX || a.RawY != b.RawY || a.Size != b.Size || a.X != b.X || a.Y != b.Y)
+			return false;
+	}
+	return true;
+}
+
+static int runStress(int slots, double seconds)
+{
+	ReportMailbox mailboxes[MAX_CONTROLLER_SLOTS];
+	std::atomic<bool> running(true);
+	std::vector<uint64_t> published(slots, 0);
+	std::vector<uint64_t> overwritten(slots, 0);
+	std::vector<std::thread> producers;
+	for (int s = 0; s < slots; s++)
+	{
+		mailboxes[s].open();
+		producers.push_back(std::thread([s, &mailboxes, &running, &published, &overwritten]() {
+			WiimoteReport report;
+			uint64_t sequence = 1;
+			while (running.load(std::memory_order_relaxed))
+			{
+				fillReport(report, s + 1, sequence++);
+				if (mailboxes[s].publish(report))
+					overwritten[s]++;
+			}
+			published[s] = sequence - 1;
+		}));
+	}
+
+	uint64_t reads = 0;
+	uint64_t received = 0;
+	uint64_t failures = 0;
+	std::vector<uint64_t> last(slots, 0);
+	uint64_t end = Instrumentation::now() + (uint64_t)(seconds * 1e9);
+	while (Instrumentation::now() < end)
+	{
+		for (int s = 0; s < slots; s++)
+		{
+			reads++;
+			if (!mailboxes[s].update())
+				continue;
+
+			const WiimoteReport &report = mailboxes[s].latest();
+			received++;
+			if (!isConsistent(report, s + 1) || report.Timestamp <= last[s])
+			{
+				if (failures++ < 10)
+					printf("  slot %d: bad report, sequence %llu after %llu\n", s + 1, (unsigned long long)report.Timestamp, (unsigned long long)last[s]);
+			}
+			last[s] = report.Timestamp;
+		}
+	}
+	running.store(false);
+	for (size_t t = 0; t < producers.size(); t++)
+		producers[t].join();
+
+	uint64_t totalPublished = 0, totalOverwritten = 0;
+	for (int s = 0; s < slots; s++)
+	{
+		totalPublished += published[s];
+		totalOverwritten += overwritten[s];
+	}
+	printf("stress: %d slots, %llu published, %llu overwritten, %llu polls, %llu received, %llu bad\n", slots,
+		(unsigned long long)totalPublished, (unsigned long long)totalOverwritten, (unsigned long long)reads,
+		(unsigned long long)received, (unsigned long long)failures);
+	return failures == 0 ? 0 : 1;
+}
+
+//The managed scheme: eventBuffer[HIDDevicePath] under pDeviceMutex.
+class LockedBuffer
+{
+public:
+	void publish(const std::string &path, const WiimoteReport &report)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		reports[path] = report;
+		fresh[path] = true;
+	}
+
+	bool take(const std::string &path, WiimoteReport &report)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::map<std::string, bool>::iterator it = fresh.find(path);
+		if (it == fresh.end() || !it->second)
+			return false;
+		it->second = false;
+		report = reports[path];
+		return true;
+	}
+
+	std::mutex mutex;
+
+private:
+	std::map<std::string, WiimoteReport> reports;
+	std::map<std::string, bool> fresh;
+};
+
+static std::string getDevicePath(int slot)
+{
+	char path[96];
+	snprintf(path, sizeof(path), "\\\\?\\hid#{00001124-0000-1000-8000-00805f9b34fb}_vid&0002057e_pid&0306#%d", slot);
+	return path;
+}
+
+//Producers publish about every 10ms, like a Wiimote in IR mode; Timestamp carries the publish time.
+static void runLatency(int slots, double seconds, bool locked)
+{
+	ReportMailbox mailboxes[MAX_CONTROLLER_SLOTS];
+	LockedBuffer buffer;
+	std::vector<std::string> paths;
+	for (int s = 0; s < slots; s++)
+	{
+		mailboxes[s].open();
+		paths.push_back(getDevicePath(s + 1));
+	}
+
+	std::atomic<bool> running(true);
+	std::vector<std::thread> threads;
+	for (int s = 0; s < slots; s++)
+	{
+		threads.push_back(std::thread([s, locked, &mailboxes, &buffer, &paths, &running]() {
+			WiimoteReport report;
+			memset(&report, 0, sizeof(report));
+			report.Slot = s + 1;
+			while (running.load(std::memory_order_relaxed))
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+				report.Timestamp = Instrumentation::now();
+				if (locked)
+					buffer.publish(paths[s], report);
+				else
+					mailboxes[s].publish(report);
+			}
+		}));
+	}
+	if (locked)
+	{
+		threads.push_back(std::thread([&buffer, &running]() {
+			while (running.load(std::memory_order_relaxed))
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(900));
+				std::lock_guard<std::mutex> lock(buffer.mutex);
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			}
+		}));
+	}
+
+	LatencyHistogram latency;
+	WiimoteReport report;
+	uint64_t end = Instrumentation::now() + (uint64_t)(seconds * 1e9);
+	while (Instrumentation::now() < end)
+	{
+		for (int s = 0; s < slots; s++)
+		{
+			if (locked)
+			{
+				if (buffer.take(paths[s], report))
+					latency.record(Instrumentation::now() - report.Timestamp);
+			}
+			else if (mailboxes[s].update())
+			{
+				latency.record(Instrumentation::now() - mailboxes[s].latest().Timestamp);
+			}
+		}
+		std::this_thread::yield();
+	}
+	running.store(false);
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+
+	HistogramSnapshot snapshot;
+	snapshot.add(latency);
+	printf("latency %-22s %8llu reports  p50 %8.1fus  p99 %8.1fus  p99.9 %8.1fus  max %8.1fus\n", locked ? "(mutex + dictionary):" : "(mailbox):",
+		(unsigned long long)snapshot.Count, snapshot.getPercentile(50) / 1000.0, snapshot.getPercentile(99) / 1000.0,
+		snapshot.getPercentile(99.9) / 1000.0, snapshot.Max / 1000.0);
+}
+
+int main(int argc, char **argv)
+{
+	double seconds = 3;
+	int slots = 4;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = atof(argv[++i]);
+		else if (strcmp(argv[i], "--slots") == 0 && i + 1 < argc) slots = atoi(argv[++i]);
+		else
+		{
+			fprintf(stderr, "usage: MailboxStress [--seconds N] [--slots N]\n");
+			return 2;
+		}
+	}
+	slots = std::min(std::max(slots, 1), MAX_CONTROLLER_SLOTS);
+
+	int status = runStress(slots, seconds);
+	runLatency(slots, seconds, false);
+	runLatency(slots, seconds, true);
+	return status;
+}
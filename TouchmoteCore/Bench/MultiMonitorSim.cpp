@@ -0,0 +1,377 @@
+// MultiMonitorSim.cpp
+//
+// Cursors moving over a fake wall of three monitors through
+// MultiMonitorOverlay: a 1920x1080 monitor at 100% at the origin, a 3840x2160
+// one at 200% to its right and a little higher, and a 1280x800 one at 100%
+// to its left and lower, so the desktop has corners no monitor covers. The
+// layout goes through enumerateMonitors from a fake DisplayConfigProvider.
+// Cursors cross the borders, get pressed and hidden, and are added and
+// removed.
+//
+// After every frame the routing is checked: a visible cursor is on exactly the
+// monitors its sprite touches, at its position in that monitor's pixels. A
+// cursor that left a monitor gets cleared there. Every rectangle a monitor
+// presents lies on it. A monitor that had no cursor now or the frame before
+// presents nothing. The cursor scale of each monitor follows its DPI.
+// Reported are the pixels presented per frame and the cursor sizes, against
+// one overlay spanning the bounding box of the wall the way
+// StartD3DCursorWindow would be given it. Exits with 1 on a mismatch.
+//
+//   MultiMonitorSim [--frames N] [--cursors N] [--seed N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "../Devices/MonitorTable.h"
+#include "../Overlay/MultiMonitorOverlay.h"
+#include "../Replay/SyntheticTrace.h"
+
+using namespace TouchmoteCore;
+
+static const float CURSOR_SCALE = 0.02f;
+
+struct FakeMonitor
+{
+	DesktopRect Bounds;
+	uint32_t Dpi;
+	const wchar_t *Name;
+};
+
+static const FakeMonitor WALL[] = {
+	{ { 0, 0, 1920, 1080 }, 96, L"Center" },
+	{ { 1920, -540, 5760, 1620 }, 192, L"Right" },
+	{ { -1280, 280, 0, 1080 }, 96, L"Left" }
+};
+static const int WALL_MONITORS = sizeof(WALL) / sizeof(WALL[0]);
+
+class FakeWallProvider : public DisplayConfigProvider
+{
+public:
+	virtual bool queryPaths(std::vector<DisplayPath> &paths)
+	{
+		DisplayAdapterId adapter = { 0x1234, 0 };
+		for (int m = 0; m < WALL_MONITORS; m++)
+		{
+			DisplayPath path = { adapter, (uint32_t)m, adapter, (uint32_t)(m + 1) * 256, true, WALL[m].Bounds };
+			paths.push_back(path);
+			//An inactive path to the same monitor, like QDC_ALL_PATHS has.
+			path.Active = false;
+			path.SourceId = (uint32_t)(m + WALL_MONITORS);
+			paths.push_back(path);
+		}
+		return true;
+	}
+
+	virtual std::wstring getGDIDeviceName(const DisplayAdapterId &, uint32_t sourceId)
+	{
+		wchar_t name[32];
+		swprintf(name, 32, L"\\\\.\\DISPLAY%u", sourceId + 1);
+		return name;
+	}
+
+	virtual std::wstring getMonitorDevicePath(const DisplayAdapterId &, uint32_t targetId)
+	{
+		wchar_t path[64];
+		swprintf(path, 64, L"\\\\?\\DISPLAY#FAKE#%u", targetId);
+		return path;
+	}
+
+	virtual std::wstring getFriendlyName(const DisplayAdapterId &, uint32_t targetId)
+	{
+		return WALL[targetId / 256 - 1].Name;
+	}
+
+	virtual uint32_t getDpi(const DesktopRect &bounds)
+	{
+		for (int m = 0; m < WALL_MONITORS; m++)
+		{
+			if (WALL[m].Bounds.Left == bounds.Left && WALL[m].Bounds.Top == bounds.Top)
+				return WALL[m].Dpi;
+		}
+		return DEFAULT_MONITOR_DPI;
+	}
+};
+
+struct SimCursor
+{
+	bool Enabled;
+	bool Pressed;
+	bool Hidden;
+	int X;
+	int Y;
+	int VelocityX;
+	int VelocityY;
+};
+
+static bool touchesMonitor(const OverlayMonitor &monitor, int x, int y)
+{
+	float half = CURSOR_SPRITE_SIZE * monitor.Overlay.scales().Normal;
+	return x + half > monitor.Bounds.Left && x - half < monitor.Bounds.Right && y + half > monitor.Bounds.Top && y - half < monitor.Bounds.Bottom;
+}
+
+static bool contains(const std::vector<DamageRect> &rects, const DamageRect &rect)
+{
+	for (size_t i = 0; i < rects.size(); i++)
+	{
+		if (rects[i].Left <= rect.Left && rects[i].Top <= rect.Top && rects[i].Right >= rect.Right && rects[i].Bottom >= rect.Bottom)
+			return true;
+	}
+	return false;
+}
+
+static DamageRect clipToMonitor(DamageRect rect, const OverlayMonitor &monitor)
+{
+	rect.Left = std::max(rect.Left, 0);
+	rect.Top = std::max(rect.Top, 0);
+	rect.Right = std::min(rect.Right, monitor.getWidth());
+	rect.Bottom = std::min(rect.Bottom, monitor.getHeight());
+	return rect;
+}
+
+//Zero for empty rectangles, also the ones clipping turned inside out.
+static int64_t getArea(const DamageRect &rect)
+{
+	if (rect.Right <= rect.Left || rect.Bottom <= rect.Top)
+		return 0;
+	return (int64_t)(rect.Right - rect.Left) * (rect.Bottom - rect.Top);
+}
+
+static int64_t getArea(const DesktopRect &rect)
+{
+	return (int64_t)(rect.Right - rect.Left) * (rect.Bottom - rect.Top);
+}
+
+int main(int argc, char **argv)
+{
+	int frames = 20000;
+	int cursorCount = 8;
+	uint32_t seed = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--frames") && hasValue) frames = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--cursors") && hasValue) cursorCount = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--seed") && hasValue) seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else
+		{
+			fprintf(stderr, "usage: MultiMonitorSim [--frames N] [--cursors N] [--seed N]\n");
+			return 2;
+		}
+	}
+	frames = std::max(frames, 1);
+	cursorCount = std::min(std::max(cursorCount, 1), MAX_OVERLAY_CURSORS);
+
+	FakeWallProvider provider;
+	std::vector<DisplayPath> paths;
+	std::vector<MonitorEntry> entries;
+	enumerateMonitors(provider, paths, entries);
+
+	int errors = 0;
+	if ((int)entries.size() != WALL_MONITORS)
+	{
+		printf("FAIL: %d monitors enumerated\n", (int)entries.size());
+		return 1;
+	}
+
+	//Cursor positions are relative to the monitor at the origin, as they were
+	//to the overlay window on it.
+	MultiMonitorOverlay overlay;
+	overlay.setLayout(entries, 0, 0);
+	overlay.setCursorScale(CURSOR_SCALE);
+
+	DesktopRect wall = WALL[0].Bounds;
+	for (int m = 1; m < WALL_MONITORS; m++)
+	{
+		wall.Left = std::min(wall.Left, WALL[m].Bounds.Left);
+		wall.Top = std::min(wall.Top, WALL[m].Bounds.Top);
+		wall.Right = std::max(wall.Right, WALL[m].Bounds.Right);
+		wall.Bottom = std::max(wall.Bottom, WALL[m].Bounds.Bottom);
+	}
+	CursorOverlay spanning;
+	spanning.setCursorScale(CURSOR_SCALE, wall.Right - wall.Left);
+
+	//Same size on the wall: the monitor at 200% gives it twice the pixels.
+	for (int m = 0; m < overlay.getMonitorCount(); m++)
+	{
+		const OverlayMonitor &monitor = overlay.monitor(m);
+		float expected = CURSOR_SCALE * 1920 * monitor.Dpi / DEFAULT_MONITOR_DPI / CURSOR_SPRITE_SIZE;
+		if (std::abs(monitor.Overlay.scales().Normal - expected) > 1e-4f)
+		{
+			printf("FAIL: monitor %d cursor scale %.4f, expected %.4f\n", m, monitor.Overlay.scales().Normal, expected);
+			errors++;
+		}
+	}
+
+	XorShift32 random(seed);
+	std::vector<SimCursor> cursors(cursorCount);
+	for (int c = 0; c < cursorCount; c++)
+	{
+		SimCursor cursor = { false, false, false, 960, 540, 0, 0 };
+		cursors[c] = cursor;
+	}
+
+	std::vector<uint32_t> lastCursors(overlay.getMonitorCount(), 0);
+	int64_t presentedPixels = 0;
+	int64_t spanningPixels = 0;
+	int64_t idleFrames = 0;
+	double now = 0;
+	for (int f = 0; f < frames && errors < 10; f++)
+	{
+		now += 8;
+		for (int c = 0; c < cursorCount; c++)
+		{
+			SimCursor &cursor = cursors[c];
+			uint32_t roll = random.next() % 1000;
+			if (!cursor.Enabled)
+			{
+				if (roll < 20)
+				{
+					cursor.Enabled = true;
+					cursor.Pressed = cursor.Hidden = false;
+					overlay.addCursor(c, 0xff0000u >> c);
+					spanning.addCursor(c, 0xff0000u >> c);
+					overlay.setPosition(c, cursor.X, cursor.Y);
+					spanning.setPosition(c, cursor.X - wall.Left, cursor.Y - wall.Top);
+				}
+				continue;
+			}
+			if (roll < 2)
+			{
+				cursor.Enabled = false;
+				overlay.removeCursor(c);
+				spanning.removeCursor(c);
+				continue;
+			}
+			if (roll < 40)
+			{
+				cursor.Pressed = !cursor.Pressed;
+				overlay.setPressed(c, cursor.Pressed, now);
+				spanning.setPressed(c, cursor.Pressed, now);
+			}
+			else if (roll < 50)
+			{
+				cursor.Hidden = !cursor.Hidden;
+				overlay.setHidden(c, cursor.Hidden, now);
+				spanning.setHidden(c, cursor.Hidden, now);
+			}
+			if (roll % 50 == 0)
+			{
+				cursor.VelocityX = random.nextInt(60);
+				cursor.VelocityY = random.nextInt(40);
+			}
+			cursor.X = std::min(std::max(cursor.X + cursor.VelocityX, (int)wall.Left - 100), (int)wall.Right + 100);
+			cursor.Y = std::min(std::max(cursor.Y + cursor.VelocityY, (int)wall.Top - 100), (int)wall.Bottom + 100);
+			overlay.setPosition(c, cursor.X, cursor.Y);
+			spanning.setPosition(c, cursor.X - wall.Left, cursor.Y - wall.Top);
+		}
+
+		overlay.stepFrame(now);
+		spanning.stepFrame(now);
+		DamageRect spanned = spanning.dirtyBounds();
+		spanned.Left = std::max(spanned.Left, 0);
+		spanned.Top = std::max(spanned.Top, 0);
+		spanned.Right = std::min(spanned.Right, wall.Right - wall.Left);
+		spanned.Bottom = std::min(spanned.Bottom, wall.Bottom - wall.Top);
+		spanningPixels += getArea(spanned);
+
+		for (int m = 0; m < overlay.getMonitorCount(); m++)
+		{
+			const OverlayMonitor &monitor = overlay.monitor(m);
+			if (monitor.Present)
+				presentedPixels += getArea(monitor.DirtyBounds);
+			else
+				idleFrames++;
+
+			for (int c = 0; c < cursorCount; c++)
+			{
+				const SimCursor &cursor = cursors[c];
+				bool routed = (monitor.Cursors & (1u << c)) != 0;
+				bool touches = cursor.Enabled && touchesMonitor(monitor, cursor.X, cursor.Y);
+				//A hidden cursor stays where it was, it is not added anywhere.
+				bool wasRouted = (lastCursors[m] & (1u << c)) != 0;
+				bool expected = cursor.Hidden ? wasRouted && touches : touches;
+				if (routed != expected)
+				{
+					printf("FAIL: frame %d, cursor %d at %d,%d %s monitor %d\n", f, c, cursor.X, cursor.Y, routed ? "routed to" : "not routed to", m);
+					errors++;
+					continue;
+				}
+				if (!routed)
+				{
+					//Left the monitor, its sprite there is cleared.
+					const OverlayCursor &old = monitor.Overlay.cursor(c);
+					float half = CURSOR_SPRITE_SIZE * monitor.Overlay.scales().Normal;
+					DamageRect rect = { (int32_t)(old.LastRenderedX - half), (int32_t)(old.LastRenderedY - half),
+						(int32_t)(old.LastRenderedX + half), (int32_t)(old.LastRenderedY + half) };
+					rect = clipToMonitor(rect, monitor);
+					if ((lastCursors[m] & (1u << c)) && getArea(rect) > 0 && !contains(monitor.Clear, rect))
+					{
+						printf("FAIL: frame %d, cursor %d left monitor %d without being cleared\n", f, c, m);
+						errors++;
+					}
+					continue;
+				}
+
+				const OverlayCursor &drawn = monitor.Overlay.cursor(c);
+				if (drawn.X != cursor.X - monitor.Bounds.Left || drawn.Y != cursor.Y - monitor.Bounds.Top)
+				{
+					printf("FAIL: frame %d, cursor %d at %.0f,%.0f on monitor %d\n", f, c, drawn.X, drawn.Y, m);
+					errors++;
+				}
+				float half = CURSOR_SPRITE_SIZE / 2 * drawn.Scaling;
+				DamageRect sprite = { (int32_t)(drawn.X - half), (int32_t)(drawn.Y - half), (int32_t)(drawn.X + half), (int32_t)(drawn.Y + half) };
+				sprite = clipToMonitor(sprite, monitor);
+				if (getArea(sprite) > 0 && !contains(monitor.Dirty, sprite))
+				{
+					printf("FAIL: frame %d, cursor %d drawn outside the damage of monitor %d\n", f, c, m);
+					errors++;
+				}
+			}
+
+			for (int pass = 0; pass < 2; pass++)
+			{
+				const std::vector<DamageRect> &rects = pass == 0 ? monitor.Clear : monitor.Dirty;
+				for (size_t r = 0; r < rects.size(); r++)
+				{
+					const DamageRect &rect = rects[r];
+					if (rect.Left < 0 || rect.Top < 0 || rect.Right > monitor.getWidth() || rect.Bottom > monitor.getHeight()
+						|| rect.Right <= rect.Left || rect.Bottom <= rect.Top)
+					{
+						printf("FAIL: frame %d, rectangle %d,%d-%d,%d off monitor %d\n", f, rect.Left, rect.Top, rect.Right, rect.Bottom, m);
+						errors++;
+					}
+				}
+			}
+			if (monitor.Cursors == 0 && lastCursors[m] == 0 && monitor.Present)
+			{
+				printf("FAIL: frame %d, monitor %d presents without cursors\n", f, m);
+				errors++;
+			}
+			lastCursors[m] = monitor.Cursors;
+		}
+	}
+
+	int64_t wallPixels = getArea(wall);
+	int64_t monitorPixels = 0;
+	for (int m = 0; m < WALL_MONITORS; m++)
+		monitorPixels += getArea(WALL[m].Bounds);
+	printf("%d frames, %d cursors, %d monitors\n", frames, cursorCount, overlay.getMonitorCount());
+	printf("%-10s %14s %18s %12s\n", "", "surface px", "presented px/frame", "idle frames");
+	printf("%-10s %14lld %18.0f %12s\n", "spanning", (long long)wallPixels, (double)spanningPixels / frames, "-");
+	printf("%-10s %14lld %18.0f %12lld\n", "monitors", (long long)monitorPixels, (double)presentedPixels / frames, (long long)idleFrames);
+	printf("\ncursor size in pixels, spanning %.0f\n", CURSOR_SPRITE_SIZE * spanning.scales().Normal);
+	for (int m = 0; m < overlay.getMonitorCount(); m++)
+	{
+		const OverlayMonitor &monitor = overlay.monitor(m);
+		printf("  monitor %d, %dx%d at %u dpi: %.0f\n", m, monitor.getWidth(), monitor.getHeight(), monitor.Dpi,
+			CURSOR_SPRITE_SIZE * monitor.Overlay.scales().Normal);
+	}
+	if (errors != 0)
+		printf("FAIL: %d errors\n", errors);
+	return errors == 0 ? 0 : 1;
+}
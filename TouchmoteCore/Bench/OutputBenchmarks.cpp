@@ -0,0 +1,396 @@
+// OutputBenchmarks.cpp
+//
+// Touch injection frames: TouchOutputStage against the way
+// TouchInjectProviderHandler.processEventFrame builds its arrays, and the
+// stage with the uinput sink writing to /dev/null. Vmulti frames with a burst
+// of key changes through VmultiReportAccumulator. Gamepad frames with tilt,
+// nunchuk stick and buttons through GamepadReportBuilder against the way
+// XinputHandler builds its report. DuoTouch frames of several controllers
+// into one contact frame, against a queue per controller merged into another.
+
+#include "Benchmarks.h"
+
+#include <deque>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#endif
+
+#include "../Output/DuoTouch.h"
+#include "../Output/GamepadReport.h"
+#include "../Output/TouchOutputStage.h"
+#include "../Output/UinputGamepadSink.h"
+#include "../Output/UinputTouchSink.h"
+#include "../Output/VmultiReports.h"
+#include "../Replay/SyntheticTrace.h"
+
+namespace TouchmoteCore {
+
+	class CountingTouchSink : public TouchSink
+	{
+	public:
+		CountingTouchSink() : Pointers(0) {}
+
+		uint64_t Pointers;
+
+		virtual bool inject(const TouchPointer *pointers, int count, uint64_t)
+		{
+			Pointers += count;
+			doNotOptimize(pointers[count - 1]);
+			return true;
+		}
+
+		virtual bool reset() { return true; }
+	};
+
+	//Contact n moves every frame and is lifted and put down again every 64 frames.
+	static void moveContacts(TouchOutputStage &stage, XorShift32 &random, uint64_t frame, int contactCount)
+	{
+		for (int i = 0; i < contactCount; i++)
+		{
+			uint32_t id = (uint32_t)(i + contactCount * ((frame + i * 7) / 64));
+			if ((frame + i * 7) % 64 == 0)
+				stage.removeContact(id - contactCount);
+			stage.setContact(id, 960 + random.nextInt(900), 540 + random.nextInt(500), true);
+		}
+	}
+
+	static void benchmarkTouchFrame(BenchmarkState &state, int contactCount)
+	{
+		CountingTouchSink sink;
+		TouchOutputStage stage(sink);
+		XorShift32 random(1);
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			moveContacts(stage, random, n, contactCount);
+			stage.submitFrame(n * 8000);
+		}
+		doNotOptimize(sink.Pointers);
+	}
+
+	//processEventFrame: contact events queued during the frame, a new List of
+	//them, and ToArray for the call.
+	static void benchmarkTouchFrameList(BenchmarkState &state, int contactCount)
+	{
+		CountingTouchSink sink;
+		std::deque<TouchPointer> contactQueue;
+		XorShift32 random(1);
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			for (int i = 0; i < contactCount; i++)
+			{
+				uint32_t id = (uint32_t)(i + contactCount * ((n + i * 7) / 64));
+				TouchPointer contact = { id, 960 + random.nextInt(900), 540 + random.nextInt(500), TOUCH_FLAG_UPDATE | TOUCH_FLAG_INRANGE | TOUCH_FLAG_INCONTACT };
+				if ((n + i * 7) % 64 == 0)
+				{
+					TouchPointer end = { id - contactCount, contact.X, contact.Y, TOUCH_FLAG_UP };
+					contactQueue.push_back(end);
+					contact.Flags = TOUCH_FLAG_DOWN | TOUCH_FLAG_INRANGE | TOUCH_FLAG_INCONTACT;
+				}
+				contactQueue.push_back(contact);
+			}
+
+			std::vector<TouchPointer> toFire;
+			while (!contactQueue.empty())
+			{
+				toFire.push_back(contactQueue.front());
+				contactQueue.pop_front();
+			}
+			if (!toFire.empty())
+			{
+				TouchPointer *array = new TouchPointer[toFire.size()];
+				std::copy(toFire.begin(), toFire.end(), array);
+				sink.inject(array, (int)toFire.size(), n * 8000);
+				delete[] array;
+			}
+		}
+		doNotOptimize(sink.Pointers);
+	}
+
+#if defined(__linux__)
+	static void benchmarkTouchFrameUinput(BenchmarkState &state, int contactCount)
+	{
+		UinputTouchSink sink(open("/dev/null", O_WRONLY | O_CLOEXEC), false);
+		TouchOutputStage stage(sink);
+		XorShift32 random(1);
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			moveContacts(stage, random, n, contactCount);
+			stage.submitFrame(n * 8000);
+		}
+		doNotOptimize(stage.getStats().Failures);
+	}
+#endif
+
+	//Every 128 frames a controller taps and pinches: the master is down from
+	//frame 16 to 96, the slave from 40 to 80. Controllers are out of step.
+	static void driveDuoTouch(DuoTouch &duoTouch, XorShift32 &random, uint64_t frame, int controller)
+	{
+		uint64_t phase = (frame + controller * 37) % 128;
+		double x = 960 + random.nextInt(600);
+		double y = 540 + random.nextInt(400);
+		if (phase >= 16 && phase < 96)
+			duoTouch.setContactMaster();
+		else
+			duoTouch.releaseContactMaster();
+		duoTouch.setMasterPosition(x, y);
+		if (phase >= 40 && phase < 80)
+		{
+			duoTouch.setSlavePosition(x, y);
+			duoTouch.setContactSlave();
+		}
+		else
+		{
+			duoTouch.releaseContactSlave();
+		}
+	}
+
+	static void benchmarkDuoTouchFrame(BenchmarkState &state, int controllers)
+	{
+		PipelineSettings settings;
+		std::vector<DuoTouch> generators;
+		for (int c = 0; c < controllers; c++)
+			generators.push_back(DuoTouch((uint64_t)c * DUO_TOUCH_ID_SPAN + 1, settings));
+		std::vector<TouchContact> contacts(controllers * DUO_TOUCH_CONTACTS);
+		XorShift32 random(1);
+		uint64_t count = 0;
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			ContactFrame frame(&contacts[0], (int)contacts.size());
+			for (int c = 0; c < controllers; c++)
+			{
+				driveDuoTouch(generators[c], random, n, c);
+				generators[c].getFrame(frame);
+			}
+			count += frame.getCount();
+			doNotOptimize(contacts[0]);
+		}
+		doNotOptimize(count);
+	}
+
+	//getFrame returning a new Queue per controller, and MultiWiiPointerProvider
+	//queueing them all in another one.
+	static void benchmarkDuoTouchFrameQueue(BenchmarkState &state, int controllers)
+	{
+		PipelineSettings settings;
+		std::vector<DuoTouch> generators;
+		for (int c = 0; c < controllers; c++)
+			generators.push_back(DuoTouch((uint64_t)c * DUO_TOUCH_ID_SPAN + 1, settings));
+		XorShift32 random(1);
+		uint64_t count = 0;
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			std::deque<TouchContact> allContacts;
+			for (int c = 0; c < controllers; c++)
+			{
+				driveDuoTouch(generators[c], random, n, c);
+				TouchContact contacts[DUO_TOUCH_CONTACTS];
+				ContactFrame frame(contacts, DUO_TOUCH_CONTACTS);
+				generators[c].getFrame(frame);
+				std::deque<TouchContact> newFrame;
+				for (int i = 0; i < frame.getCount(); i++)
+					newFrame.push_back(frame[i]);
+				while (!newFrame.empty())
+				{
+					allContacts.push_back(newFrame.front());
+					newFrame.pop_front();
+				}
+			}
+			count += allContacts.size();
+			doNotOptimize(allContacts);
+		}
+		doNotOptimize(count);
+	}
+
+	//Contacts of the generators injected through the touch output stage.
+	static void benchmarkDuoTouchInject(BenchmarkState &state, int controllers)
+	{
+		PipelineSettings settings;
+		CountingTouchSink sink;
+		TouchOutputStage stage(sink);
+		std::vector<DuoTouch> generators;
+		for (int c = 0; c < controllers; c++)
+			generators.push_back(DuoTouch((uint64_t)c * DUO_TOUCH_ID_SPAN + 1, settings));
+		std::vector<TouchContact> contacts(controllers * DUO_TOUCH_CONTACTS);
+		XorShift32 random(1);
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			ContactFrame frame(&contacts[0], (int)contacts.size());
+			for (int c = 0; c < controllers; c++)
+			{
+				driveDuoTouch(generators[c], random, n, c);
+				generators[c].getFrame(frame);
+			}
+			queueContacts(frame, stage);
+			stage.submitFrame(n * 8000);
+		}
+		doNotOptimize(sink.Pointers);
+	}
+
+	class CountingVmultiSink : public VmultiSink
+	{
+	public:
+		CountingVmultiSink() : Bytes(0) {}
+
+		uint64_t Bytes;
+
+		virtual bool send(VmultiReportType, const uint8_t *report, size_t length)
+		{
+			Bytes += length;
+			doNotOptimize(report[length - 1]);
+			return true;
+		}
+	};
+
+	//Every frame presses keyCount keys and lets go of the ones of the frame
+	//before, and moves the mouse.
+	static void benchmarkVmultiFrame(BenchmarkState &state, int keyCount)
+	{
+		CountingVmultiSink sink;
+		VmultiReportAccumulator accumulator(sink);
+		XorShift32 random(1);
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			uint8_t first = (uint8_t)(4 + (n % 2) * VMULTI_KEYBOARD_KEYS);
+			uint8_t previous = (uint8_t)(4 + ((n + 1) % 2) * VMULTI_KEYBOARD_KEYS);
+			for (int k = 0; k < keyCount; k++)
+			{
+				accumulator.keyUp((uint8_t)(previous + k));
+				accumulator.keyDown((uint8_t)(first + k));
+			}
+			accumulator.moveMouse(random.nextInt(20), random.nextInt(20));
+			accumulator.endUpdate();
+		}
+		doNotOptimize(sink.Bytes);
+	}
+
+	class CountingGamepadSink : public GamepadSink
+	{
+	public:
+		CountingGamepadSink() : Reports(0) {}
+
+		uint64_t Reports;
+
+		virtual bool send(const XinputGamepadReport &report, uint32_t, uint64_t)
+		{
+			Reports++;
+			doNotOptimize(report.ThumbLX);
+			return true;
+		}
+	};
+
+	//A Wiimote report of a keymap with tilt on the right stick, the nunchuk
+	//stick on the left one and a button that changes every 16 frames. Values
+	//jitter by a few counts, the nunchuk stick rests every other 64 frames.
+	struct GamepadFrame
+	{
+		double TiltX;
+		double TiltY;
+		double StickX;
+		double StickY;
+		bool A;
+	};
+
+	static GamepadFrame nextGamepadFrame(XorShift32 &random, uint64_t frame)
+	{
+		GamepadFrame values;
+		values.TiltX = 0.5 + random.nextInt(100) / 1000.0;
+		values.TiltY = 0.5 + random.nextInt(100) / 1000.0;
+		bool resting = (frame / 64) % 2 == 0;
+		values.StickX = resting ? 0.5 : 0.5 + random.nextInt(400) / 1000.0;
+		values.StickY = resting ? 0.5 : 0.5 + random.nextInt(400) / 1000.0;
+		values.A = (frame / 16) % 2 == 0;
+		return values;
+	}
+
+	static void benchmarkGamepadFrame(BenchmarkState &state, GamepadSink &sink)
+	{
+		GamepadReportBuilder builder(sink);
+		XorShift32 random(1);
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			GamepadFrame values = nextGamepadFrame(random, n);
+			builder.setStick(GamepadAxis::RightX, values.TiltX);
+			builder.setStick(GamepadAxis::RightY, values.TiltY);
+			builder.setStick(GamepadAxis::LeftX, values.StickX);
+			builder.setStick(GamepadAxis::LeftY, values.StickY);
+			builder.setButton(XINPUT_BUTTON_A, values.A);
+			builder.endUpdate(n * 10000);
+		}
+		doNotOptimize(builder.getStats().Sent);
+	}
+
+	static void benchmarkGamepadFrameCounting(BenchmarkState &state)
+	{
+		CountingGamepadSink sink;
+		benchmarkGamepadFrame(state, sink);
+	}
+
+#if defined(__linux__)
+	static void benchmarkGamepadFrameUinput(BenchmarkState &state)
+	{
+		UinputGamepadSink sink(open("/dev/null", O_WRONLY | O_CLOEXEC), false);
+		benchmarkGamepadFrame(state, sink);
+	}
+#endif
+
+	//XinputReport: fields set as doubles and bools, and ToBytes making a new
+	//28 byte array for the bus on every endUpdate.
+	static void benchmarkGamepadFrameManaged(BenchmarkState &state)
+	{
+		XorShift32 random(1);
+		uint64_t reports = 0;
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			GamepadFrame values = nextGamepadFrame(random, n);
+			std::vector<uint8_t> input(28);
+			input[11] |= (uint8_t)(values.A ? 1 << 6 : 0);
+			int32_t thumbs[4] = {
+				(int32_t)((values.StickX - 0.5) * 2 * 32767), (int32_t)((values.StickY - 0.5) * 2 * 32767),
+				(int32_t)((values.TiltX - 0.5) * 2 * 32767), (int32_t)((values.TiltY - 0.5) * 2 * 32767) };
+			for (int t = 0; t < 4; t++)
+			{
+				input[14 + 2 * t] = (uint8_t)(thumbs[t] & 0xff);
+				input[15 + 2 * t] = (uint8_t)((thumbs[t] >> 8) & 0xff);
+			}
+			doNotOptimize(input[14]);
+			reports++;
+		}
+		doNotOptimize(reports);
+	}
+
+	void registerOutputBenchmarks(BenchmarkRunner &runner)
+	{
+		runner.add("output/touch_frame/1", [](BenchmarkState &state) { benchmarkTouchFrame(state, 1); });
+		runner.add("output/touch_frame/4", [](BenchmarkState &state) { benchmarkTouchFrame(state, 4); });
+		runner.add("output/touch_frame/16", [](BenchmarkState &state) { benchmarkTouchFrame(state, 16); });
+		runner.add("output/touch_frame_list/1", [](BenchmarkState &state) { benchmarkTouchFrameList(state, 1); });
+		runner.add("output/touch_frame_list/4", [](BenchmarkState &state) { benchmarkTouchFrameList(state, 4); });
+		runner.add("output/touch_frame_list/16", [](BenchmarkState &state) { benchmarkTouchFrameList(state, 16); });
+		runner.add("output/duotouch_frame/1", [](BenchmarkState &state) { benchmarkDuoTouchFrame(state, 1); });
+		runner.add("output/duotouch_frame/4", [](BenchmarkState &state) { benchmarkDuoTouchFrame(state, 4); });
+		runner.add("output/duotouch_frame_queue/1", [](BenchmarkState &state) { benchmarkDuoTouchFrameQueue(state, 1); });
+		runner.add("output/duotouch_frame_queue/4", [](BenchmarkState &state) { benchmarkDuoTouchFrameQueue(state, 4); });
+		runner.add("output/duotouch_inject/4", [](BenchmarkState &state) { benchmarkDuoTouchInject(state, 4); });
+		runner.add("output/vmulti_frame/1", [](BenchmarkState &state) { benchmarkVmultiFrame(state, 1); });
+		runner.add("output/vmulti_frame/6", [](BenchmarkState &state) { benchmarkVmultiFrame(state, 6); });
+		runner.add("output/gamepad_frame", benchmarkGamepadFrameCounting);
+		runner.add("output/gamepad_frame_managed", benchmarkGamepadFrameManaged);
+#if defined(__linux__)
+		runner.add("output/gamepad_frame_uinput", benchmarkGamepadFrameUinput);
+		runner.add("output/touch_frame_uinput/4", [](BenchmarkState &state) { benchmarkTouchFrameUinput(state, 4); });
+		runner.add("output/touch_frame_uinput/16", [](BenchmarkState &state) { benchmarkTouchFrameUinput(state, 16); });
+#endif
+	}
+
+}
@@ -0,0 +1,193 @@
+// OverlayBenchmarks.cpp
+//
+// The per-frame work of the D3DCursor overlay without the Direct3D calls, and
+// the cursor channel that feeds it from another process. The same frame split
+// over three monitors by MultiMonitorOverlay, and drawn by the software renderer.
+
+#include "Benchmarks.h"
+
+#include <vector>
+
+#include "../Overlay/CursorChannel.h"
+#include "../Overlay/CursorOverlay.h"
+#include "../Overlay/MultiMonitorOverlay.h"
+#include "../Overlay/SoftwareCursorRenderer.h"
+#include "../Replay/SyntheticTrace.h"
+
+namespace TouchmoteCore {
+
+	//Cursors moving every frame and pressed and released every 30 frames, so
+	//there is always an animation running somewhere.
+	static void benchmarkOverlayFrame(BenchmarkState &state, int cursorCount)
+	{
+		CursorOverlay overlay;
+		overlay.setCursorScale(0.02f, 1920);
+		for (int i = 0; i < cursorCount; i++)
+			overlay.addCursor(i, 0x00ff0000u >> i);
+
+		XorShift32 random(1);
+		double now = 0;
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			now += 8;
+			for (int i = 0; i < cursorCount; i++)
+			{
+				overlay.setPosition(i, 960 + random.nextInt(900), 540 + random.nextInt(500));
+				if ((n + i) % 30 == 0)
+					overlay.setPressed(i, !overlay.cursor(i).Pressed, now);
+			}
+			overlay.stepFrame(now);
+			doNotOptimize(overlay.dirtyBounds());
+		}
+	}
+
+	//The same frames, cleared and drawn into a 1920x1080 buffer.
+	static void benchmarkSoftwareRender(BenchmarkState &state, int cursorCount)
+	{
+		CursorOverlay overlay;
+		overlay.setCursorScale(0.02f, 1920);
+		for (int i = 0; i < cursorCount; i++)
+			overlay.addCursor(i, 0x00ff0000u >> i);
+		SoftwareCursorRenderer renderer(1920, 1080);
+
+		XorShift32 random(1);
+		double now = 0;
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			now += 8;
+			for (int i = 0; i < cursorCount; i++)
+			{
+				overlay.setPosition(i, 960 + random.nextInt(900), 540 + random.nextInt(500));
+				if ((n + i) % 30 == 0)
+					overlay.setPressed(i, !overlay.cursor(i).Pressed, now);
+			}
+			overlay.stepFrame(now);
+			doNotOptimize(renderer.render(overlay));
+		}
+	}
+
+	//Add and remove churn, which goes through the clear queue.
+	static void benchmarkOverlayChurn(BenchmarkState &state)
+	{
+		CursorOverlay overlay;
+		overlay.setCursorScale(0.02f, 1920);
+		double now = 0;
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			int id = (int)(n % MAX_OVERLAY_CURSORS);
+			now += 8;
+			overlay.addCursor(id, 0xffffff);
+			overlay.setPosition(id, (int)(n % 1920), (int)(n % 1080));
+			overlay.stepFrame(now);
+			overlay.removeCursor(id);
+			doNotOptimize(overlay.dirtyBounds());
+		}
+	}
+
+	//Cursors wandering over three monitors side by side, the middle one at
+	//200%, so some of them are on a border in every frame.
+	static void benchmarkMultiMonitorFrame(BenchmarkState &state, int cursorCount)
+	{
+		std::vector<MonitorEntry> monitors(3);
+		for (int m = 0; m < 3; m++)
+		{
+			DesktopRect bounds = { m * 1920, 0, (m + 1) * 1920, 1080 };
+			monitors[m].TargetId = (uint32_t)m;
+			monitors[m].Bounds = bounds;
+			monitors[m].Dpi = m == 1 ? 192 : 96;
+		}
+		MultiMonitorOverlay overlay;
+		overlay.setLayout(monitors, 0, 0);
+		overlay.setCursorScale(0.02f);
+		for (int i = 0; i < cursorCount; i++)
+			overlay.addCursor(i, 0x00ff0000u >> i);
+
+		XorShift32 random(1);
+		double now = 0;
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			now += 8;
+			for (int i = 0; i < cursorCount; i++)
+			{
+				int x = (int)((n * 4 + i * 360) % 5760);
+				overlay.setPosition(i, x + random.nextInt(8), 540 + random.nextInt(500));
+				if ((n + i) % 30 == 0)
+					overlay.setPressed(i, (n / 30) % 2 == 0, now);
+			}
+			overlay.stepFrame(now);
+			doNotOptimize(overlay.monitor(1).DirtyBounds);
+		}
+	}
+
+	static void benchmarkCursorAnimation(BenchmarkState &state)
+	{
+		CursorScales scales;
+		scales.recalculate(0.02f, 1920);
+		OverlayCursor cursor;
+		cursor.Enabled = true;
+		cursor.Scaling = scales.Normal;
+		double now = 0;
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			now += 1;
+			if (n % 64 == 0)
+			{
+				cursor.Pressed = !cursor.Pressed;
+				cursor.AnimationStart = now;
+				cursor.SnapshotScaling = cursor.Scaling;
+			}
+			stepCursorAnimation(cursor, scales, now);
+			doNotOptimize(cursor.Scaling);
+		}
+	}
+
+	//Both sides in one process and on one thread, so this is the cost of the
+	//copies without any cache line moving between cores. CursorChannelBench
+	//measures the latency between processes.
+	static void benchmarkChannel(BenchmarkState &state, bool read)
+	{
+		std::vector<unsigned char> memory(getCursorChannelSize());
+		CursorChannelWriter writer(&memory[0]);
+		CursorChannelReader reader(&memory[0]);
+		CursorOverlay overlay;
+		CursorChannelState previous = CursorChannelState();
+		CursorChannelState current;
+		for (int i = 0; i < MAX_OVERLAY_CURSORS; i++)
+			writer.addCursor(i, 0x00ff0000u >> i);
+
+		XorShift32 random(1);
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			for (int i = 0; i < MAX_OVERLAY_CURSORS; i++)
+				writer.setPosition(i, 960 + random.nextInt(900), 540 + random.nextInt(500));
+			writer.publish(n);
+			if (read && reader.read(current))
+			{
+				applyCursorState(overlay, previous, current, (double)n);
+				previous = current;
+			}
+		}
+		doNotOptimize(overlay.cursor(0).X);
+	}
+
+	void registerOverlayBenchmarks(BenchmarkRunner &runner)
+	{
+		runner.add("overlay/animation_step", benchmarkCursorAnimation);
+		runner.add("overlay/frame/1", [](BenchmarkState &state) { benchmarkOverlayFrame(state, 1); });
+		runner.add("overlay/frame/4", [](BenchmarkState &state) { benchmarkOverlayFrame(state, 4); });
+		runner.add("overlay/frame/16", [](BenchmarkState &state) { benchmarkOverlayFrame(state, MAX_OVERLAY_CURSORS); });
+		runner.add("overlay/software_render/1", [](BenchmarkState &state) { benchmarkSoftwareRender(state, 1); });
+		runner.add("overlay/software_render/16", [](BenchmarkState &state) { benchmarkSoftwareRender(state, MAX_OVERLAY_CURSORS); });
+		runner.add("overlay/add_remove", benchmarkOverlayChurn);
+		runner.add("overlay/multi_monitor_frame/4", [](BenchmarkState &state) { benchmarkMultiMonitorFrame(state, 4); });
+		runner.add("overlay/multi_monitor_frame/16", [](BenchmarkState &state) { benchmarkMultiMonitorFrame(state, MAX_OVERLAY_CURSORS); });
+		runner.add("overlay/channel_publish/16", [](BenchmarkState &state) { benchmarkChannel(state, false); });
+		runner.add("overlay/channel_read_apply/16", [](BenchmarkState &state) { benchmarkChannel(state, true); });
+	}
+
+}
@@ -0,0 +1,618 @@
+// PipelineBenchmarks.cpp
+//
+// The native pipeline core: filters, cursor position, settings snapshots,
+// sensor fusion, classifier, a whole frame, the timer wheel, the capture encoder and decoder and the
+// instrumentation probes and the logger.
+
+#include "Benchmarks.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <string.h>
+#include <thread>
+
+#include "../Diagnostics/Instrumentation.h"
+#include "../Diagnostics/Logger.h"
+#include "../Filters/CoordFilter.h"
+#include "../Filters/OneEuroFilter.h"
+#include "../Filters/PredictiveFilter.h"
+#include "../Filters/RadiusBuffer.h"
+#include "../Filters/SmoothingBuffer.h"
+#include "../Input/CalibrationSolver.h"
+#include "../Input/ScreenPositionCalculator.h"
+#include "../Input/SensorFusion.h"
+#include "../Input/SpatioTemporalClassifier.h"
+#include "../Pipeline/InputPipeline.h"
+#include "../Pipeline/JobSystem.h"
+#include "../Pipeline/ReportMailbox.h"
+#include "../Pipeline/SettingsStore.h"
+#include "../Pipeline/TimerWheel.h"
+#include "../Replay/CaptureReader.h"
+#include "../Replay/CaptureWriter.h"
+#include "../Replay/SyntheticTrace.h"
+
+namespace TouchmoteCore {
+
+	//Pre-generated reports so the generator is not part of the measurement.
+	static const int REPORT_TABLE_SIZE = 4096;
+
+	static void makeReportTable(std::vector<WiimoteReport> &reports, int controllers)
+	{
+		XorShift32 random(1);
+		reports.resize(REPORT_TABLE_SIZE);
+		for (int i = 0; i < REPORT_TABLE_SIZE; i++)
+			makeSyntheticReport(random, (uint64_t)(i / controllers + 1) * 10000, i % controllers + 1, reports[i]);
+	}
+
+	class NullSink : public EventSink
+	{
+	public:
+		uint64_t Events;
+
+		NullSink() : Events(0) {}
+
+		virtual void onEvent(const OutputEvent &)
+		{
+			Events++;
+		}
+	};
+
+	class NullStreamBuffer : public std::streambuf
+	{
+	protected:
+		virtual int_type overflow(int_type c) { return traits_type::not_eof(c); }
+		virtual std::streamsize xsputn(const char *, std::streamsize count) { return count; }
+	};
+
+	static void benchmarkCoordFilter(BenchmarkState &state)
+	{
+		CoordFilter filter;
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			Vector point((double)(n % 1920), (double)(n % 1080));
+			doNotOptimize(filter.AddGetFilteredCoord(point, 1920, 1080));
+		}
+	}
+
+	static void benchmarkOneEuroFilter(BenchmarkState &state)
+	{
+		OneEuroFilter filter(0.02, 0.007, 2.0);
+		for (uint64_t n = 0; n < state.Iterations; n++)
+			doNotOptimize(filter.Filter((double)(n % 1024), 120));
+	}
+
+	//One measurement and one prediction per report, like a 100Hz controller on a 125Hz frame loop.
+	static void benchmarkPredictiveFilter(BenchmarkState &state)
+	{
+		PredictiveFilter filter;
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			uint64_t timestamp = (n + 1) * 10000;
+			filter.update(Vector((n % 1000) / 1000.0, (n % 700) / 700.0), timestamp);
+			doNotOptimize(filter.predict(timestamp + 16000));
+		}
+	}
+
+	static void benchmarkSmoothingBuffer(BenchmarkState &state)
+	{
+		SmoothingBuffer buffer(3);
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			buffer.addValue((double)(n % 1920), (double)(n % 1080));
+			doNotOptimize(buffer.getSmoothedValue());
+		}
+	}
+
+	static void benchmarkRadiusBuffer(BenchmarkState &state)
+	{
+		RadiusBuffer buffer(0.002);
+		for (uint64_t n = 0; n < state.Iterations; n++)
+			doNotOptimize(buffer.AddAndGet(Vector((n % 1000) / 1000.0, (n % 700) / 700.0)));
+	}
+
+	static void benchmarkScreenPosition(BenchmarkState &state)
+	{
+		std::vector<WiimoteReport> reports;
+		makeReportTable(reports, 1);
+		PipelineSettings settings;
+		ScreenPositionCalculator calculator(settings);
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+			doNotOptimize(calculator.CalculateCursorPos(reports[n % REPORT_TABLE_SIZE]));
+	}
+
+	//The settings a frame reads: pointer_considerRotation and pointer_sensorBarPos
+	//per controller, pointer_customCursor and the DuoTouch thresholds.
+	static int readFrameSettings(const PipelineSettings &settings)
+	{
+		return (settings.pointer_considerRotation ? 1 : 0) + (int)settings.pointer_sensorBarPos + (settings.pointer_customCursor ? 2 : 0)
+			+ settings.touch_touchTapThreshold + settings.touch_edgeGestureHelperMargins + settings.touch_edgeGestureHelperRelease;
+	}
+
+	static void benchmarkSettingsSnapshot(BenchmarkState &state)
+	{
+		SettingsStore store;
+		SettingsReader reader(store);
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+			doNotOptimize(readFrameSettings(reader.acquire().Values));
+	}
+
+	//A change every 64 frames, so the reader moves its pin now and then.
+	static void benchmarkSettingsSnapshotChanging(BenchmarkState &state)
+	{
+		SettingsStore store;
+		SettingsReader reader(store);
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			if ((n & 63) == 0)
+				store.set("touch_touchTapThreshold", SettingValue::fromInt((int)(n & 0xff)));
+			doNotOptimize(readFrameSettings(reader.acquire().Values));
+		}
+	}
+
+	//What Settings.Default does: a lookup by name per read and a string compare
+	//for the sensor bar position.
+	static void benchmarkSettingsLookup(BenchmarkState &state)
+	{
+		std::map<std::string, SettingValue> values;
+		std::vector<SettingEntry> entries = PipelineSettings().toEntries();
+		for (size_t i = 0; i < entries.size(); i++)
+			values[entries[i].key] = entries[i].value;
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			int sum = (values["pointer_considerRotation"].asBool() ? 1 : 0) + (values["pointer_sensorBarPos"].s == "top" ? 1 : 0)
+				+ (values["pointer_customCursor"].asBool() ? 2 : 0) + values["touch_touchTapThreshold"].asInt()
+				+ values["touch_edgeGestureHelperMargins"].asInt() + values["touch_edgeGestureHelperRelease"].asInt();
+			doNotOptimize(sum);
+		}
+	}
+
+	//20 samples per target of a grid seen by a tilted camera, with 1 in 10 an outlier.
+	static void benchmarkCalibration(BenchmarkState &state, int grid)
+	{
+		Vector screen[4] = { Vector(0, 0), Vector(1920, 0), Vector(0, 1080), Vector(1920, 1080) };
+		Vector camera[4] = { Vector(210, 140), Vector(810, 175), Vector(190, 620), Vector(840, 590) };
+		Homography toCamera;
+		Homography::quadToQuad(screen, camera, toCamera);
+
+		std::vector<Vector> targets;
+		makeCalibrationGrid(grid, grid, 0.1, 1920, 1080, targets);
+		std::vector<CalibrationSample> samples;
+		XorShift32 random(1);
+		for (size_t t = 0; t < targets.size(); t++)
+		{
+			for (int s = 0; s < 20; s++)
+			{
+				CalibrationSample sample;
+				if (random.next() % 10 == 0)
+					sample.Camera = Vector(random.next() % 1024, random.next() % 768);
+				else
+					sample.Camera = toCamera.apply(targets[t]) + Vector(random.nextInt(2), random.nextInt(2));
+				sample.Screen = targets[t];
+				sample.Target = (int)t;
+				samples.push_back(sample);
+			}
+		}
+
+		CalibrationOptions options;
+		CalibrationResult result;
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			options.Seed = (uint32_t)n + 1;
+			solveCalibration(samples, options, result);
+		}
+		doNotOptimize(result.RmsError);
+	}
+
+	//Points drifting slowly, with one point dropping out every 50 frames.
+	static void benchmarkClassifier(BenchmarkState &state, int pointCount)
+	{
+		SpatioTemporalClassifier classifier;
+		classifier.PredictionScale = 1920;
+		std::vector<Vector> points;
+		XorShift32 random(1);
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			points.clear();
+			for (int i = 0; i < pointCount; i++)
+			{
+				if ((n + i * 7) % 50 == 0)
+					continue;
+				points.push_back(Vector(100.0 + i * 110 + (n % 200) + random.nextInt(1), 300.0 + (i % 4) * 150 + random.nextInt(1)));
+			}
+			classifier.processFrame(points);
+		}
+		doNotOptimize(classifier.trackers().size());
+	}
+
+	//Every camera looks at the whole screen from a slightly different angle and
+	//sees the same four moving sources, with a pixel of sensor noise.
+	struct MultiCameraTrace
+	{
+		std::vector<Homography> Mappings;
+		//Frames of reports, one report per camera.
+		std::vector<WiimoteReport> Reports;
+		int Cameras;
+		int Frames;
+	};
+
+	static void makeMultiCameraTrace(MultiCameraTrace &trace, int cameras, int frames)
+	{
+		XorShift32 random(1);
+		trace.Cameras = cameras;
+		trace.Frames = frames;
+		trace.Mappings.resize(cameras);
+		std::vector<Homography> inverse(cameras);
+		for (int c = 0; c < cameras; c++)
+		{
+			Vector camera[4] = { Vector(0, 0), Vector(1, 0), Vector(0, 1), Vector(1, 1) };
+			Vector screen[4] = { Vector(-100, -80), Vector(2020, -80), Vector(-100, 1160), Vector(2020, 1160) };
+			for (int i = 0; i < 4; i++)
+				screen[i] += Vector(random.nextInt(60), random.nextInt(60));
+			Homography::quadToQuad(camera, screen, trace.Mappings[c]);
+			trace.Mappings[c].invert(inverse[c]);
+		}
+
+		trace.Reports.resize((size_t)cameras * frames);
+		for (int f = 0; f < frames; f++)
+		{
+			for (int c = 0; c < cameras; c++)
+			{
+				WiimoteReport &report = trace.Reports[(size_t)f * cameras + c];
+				memset(&report, 0, sizeof(report));
+				report.Timestamp = (uint64_t)(f + 1) * 8000;
+				report.Slot = c + 1;
+				for (int s = 0; s < IR_SENSOR_COUNT; s++)
+				{
+					Vector source(300.0 + s * 400 + (f % 300), 250.0 + (s % 2) * 500 + (f % 200));
+					Vector point = inverse[c].apply(source);
+					int rawX = (int)(point.X * 1023.5) + random.nextInt(1);
+					int rawY = (int)(point.Y * 767.5) + random.nextInt(1);
+					IRSensor &sensor = report.IR[s];
+					sensor.Found = rawX >= 0 && rawX <= 1023 && rawY >= 0 && rawY <= 767;
+					sensor.Size = 3;
+					sensor.setRawPosition(rawX, rawY);
+				}
+			}
+		}
+	}
+
+	static void benchmarkFusion(BenchmarkState &state, int cameras)
+	{
+		MultiCameraTrace trace;
+		makeMultiCameraTrace(trace, cameras, 256);
+		SensorFusion fusion;
+		for (int c = 0; c < cameras; c++)
+			fusion.setCalibration(c + 1, trace.Mappings[c], 1.0);
+		std::vector<Vector> points;
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			int f = (int)(n % trace.Frames);
+			fusion.beginFrame((uint64_t)(f + 1) * 8000);
+			for (int c = 0; c < cameras; c++)
+				fusion.addReport(trace.Reports[(size_t)f * cameras + c]);
+			fusion.fuse();
+			fusion.getPositions(points);
+		}
+		doNotOptimize(points.size());
+	}
+
+	//With parallel set, the per controller part runs on a job system with a worker per extra core.
+	static void benchmarkPipelineFrame(BenchmarkState &state, int controllers, bool parallel)
+	{
+		std::vector<WiimoteReport> reports;
+		makeReportTable(reports, controllers);
+		NullSink sink;
+		PipelineSettings settings;
+		InputPipeline pipeline(settings, sink);
+		std::unique_ptr<JobSystem> jobs;
+		if (parallel)
+		{
+			jobs.reset(new JobSystem(std::max(1, (int)std::thread::hardware_concurrency() - 1)));
+			pipeline.setJobSystem(jobs.get());
+		}
+		for (int c = 1; c <= controllers; c++)
+			pipeline.connect(c, 0);
+
+		bool enabled = Instrumentation::isEnabled();
+		Instrumentation::setEnabled(false);
+		size_t next = 0;
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			for (int c = 0; c < controllers; c++)
+			{
+				pipeline.pushReport(reports[next]);
+				next = (next + 1) % REPORT_TABLE_SIZE;
+			}
+			pipeline.processFrame((n + 1) * 8000);
+		}
+		Instrumentation::setEnabled(enabled);
+		doNotOptimize(sink.Events);
+	}
+
+	//Both sides on one thread, so this is the uncontended cost of a handover.
+	static void benchmarkMailbox(BenchmarkState &state)
+	{
+		std::vector<WiimoteReport> reports;
+		makeReportTable(reports, 1);
+		std::unique_ptr<ReportMailbox> mailbox(new ReportMailbox());
+		mailbox->open();
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			mailbox->publish(reports[n % REPORT_TABLE_SIZE]);
+			mailbox->update();
+			doNotOptimize(mailbox->latest().Timestamp);
+		}
+	}
+
+	//Cursor timeouts as the pipeline uses them: microseconds, millisecond ticks,
+	//deadlines up to the 3s of pointer_cursorStillHideTimeout ahead.
+	static const uint32_t TIMER_SPAN = 3000000;
+
+	static void countTimer(void *context, uint64_t)
+	{
+		(*(uint64_t *)context)++;
+	}
+
+	//Moving the deadline of a random timer out of count, the clock advancing 1ms
+	//every 64 moves. A timer that fired is scheduled again.
+	static void benchmarkTimerReschedule(BenchmarkState &state, int count)
+	{
+		XorShift32 random(1);
+		uint64_t fired = 0;
+		uint64_t now = 0;
+		TimerWheel wheel(1000, 64, now);
+		std::vector<TimerWheel::Handle> handles(count);
+		for (int i = 0; i < count; i++)
+			handles[i] = wheel.schedule(random.next() % TIMER_SPAN, countTimer, &fired, i);
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			int i = (int)(random.next() % (uint32_t)count);
+			uint64_t deadline = now + random.next() % TIMER_SPAN;
+			if (!wheel.reschedule(handles[i], deadline))
+				handles[i] = wheel.schedule(deadline, countTimer, &fired, i);
+			if ((n & 63) == 63)
+			{
+				now += 1000;
+				wheel.advance(now);
+			}
+		}
+		doNotOptimize(fired);
+	}
+
+	//The same with a sorted timer queue, a multimap keyed by deadline.
+	static void benchmarkTimerQueueReschedule(BenchmarkState &state, int count)
+	{
+		typedef std::multimap<uint64_t, int> TimerQueue;
+		XorShift32 random(1);
+		uint64_t fired = 0;
+		uint64_t now = 0;
+		TimerQueue queue;
+		std::vector<TimerQueue::iterator> handles(count);
+		for (int i = 0; i < count; i++)
+			handles[i] = queue.insert(std::make_pair((uint64_t)(random.next() % TIMER_SPAN), i));
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			int i = (int)(random.next() % (uint32_t)count);
+			uint64_t deadline = now + random.next() % TIMER_SPAN;
+			queue.erase(handles[i]);
+			handles[i] = queue.insert(std::make_pair(deadline, i));
+			if ((n & 63) == 63)
+			{
+				now += 1000;
+				while (!queue.empty() && queue.begin()->first <= now)
+				{
+					//Scheduled again right away, the wheel does the same through the
+					//failed reschedule.
+					int fire = queue.begin()->second;
+					queue.erase(queue.begin());
+					fired++;
+					handles[fire] = queue.insert(std::make_pair(now + random.next() % TIMER_SPAN, fire));
+				}
+			}
+		}
+		doNotOptimize(fired);
+	}
+
+	struct TimerLoad
+	{
+		TimerWheel *Wheel;
+		XorShift32 *Random;
+		uint64_t Now;
+		uint64_t Fired;
+	};
+
+	static void rescheduleTimer(void *context, uint64_t data)
+	{
+		TimerLoad &load = *(TimerLoad *)context;
+		load.Fired++;
+		load.Wheel->schedule(load.Now + 1 + load.Random->next() % TIMER_SPAN, rescheduleTimer, context, data);
+	}
+
+	//One frame tick of 1ms with count timers spread over the next 3s, the ones
+	//that fire scheduled again.
+	static void benchmarkTimerAdvance(BenchmarkState &state, int count)
+	{
+		XorShift32 random(1);
+		TimerWheel wheel(1000, 64, 0);
+		TimerLoad load = { &wheel, &random, 0, 0 };
+		for (int i = 0; i < count; i++)
+			wheel.schedule(random.next() % TIMER_SPAN, rescheduleTimer, &load, i);
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			load.Now += 1000;
+			wheel.advance(load.Now);
+		}
+		doNotOptimize(load.Fired);
+	}
+
+	static void benchmarkEncodeReport(BenchmarkState &state)
+	{
+		std::vector<WiimoteReport> reports;
+		makeReportTable(reports, 1);
+		NullStreamBuffer buffer;
+		std::ostream out(&buffer);
+		CaptureWriter writer(out);
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+			writer.writeReport(reports[n % REPORT_TABLE_SIZE]);
+	}
+
+	static void benchmarkDecodeReport(BenchmarkState &state)
+	{
+		std::vector<WiimoteReport> reports;
+		makeReportTable(reports, 1);
+		std::ostringstream out(std::ios::binary);
+		CaptureWriter writer(out);
+		for (int i = 0; i < REPORT_TABLE_SIZE; i++)
+			writer.writeReport(reports[i]);
+		std::string encoded = out.str();
+
+		std::istringstream in(encoded, std::ios::binary);
+		std::unique_ptr<CaptureReader> reader(new CaptureReader(in));
+		CaptureRecord record;
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			if (!reader->next(record))
+			{
+				//Start over, this happens once every REPORT_TABLE_SIZE reports.
+				in.clear();
+				in.seekg(0);
+				reader.reset(new CaptureReader(in));
+				reader->next(record);
+			}
+			doNotOptimize(record.Report);
+		}
+	}
+
+	static void benchmarkHistogramRecord(BenchmarkState &state)
+	{
+		LatencyHistogram histogram;
+		for (uint64_t n = 0; n < state.Iterations; n++)
+			histogram.record(n & 0xfffff);
+		doNotOptimize(histogram.getCount());
+	}
+
+	static void benchmarkInstrumentationRecord(BenchmarkState &state)
+	{
+		for (uint64_t n = 0; n < state.Iterations; n++)
+			Instrumentation::record(PipelineStage::Filter, (int)(n & 3) + 1, n & 0xffff);
+	}
+
+	static void benchmarkStageProbe(BenchmarkState &state)
+	{
+		for (uint64_t n = 0; n < state.Iterations; n++)
+			StageProbe probe(PipelineStage::Filter, (int)(n & 3) + 1);
+	}
+
+	class CountingLogSink : public LogSink
+	{
+	public:
+		uint64_t Records;
+
+		CountingLogSink() : Records(0) {}
+
+		virtual void write(const LogRecord *, int count)
+		{
+			Records += count;
+		}
+	};
+
+	static void benchmarkLogDisabled(BenchmarkState &state)
+	{
+		for (uint64_t n = 0; n < state.Iterations; n++)
+			TOUCHMOTE_LOG(LogLevel::Debug, "report {} of slot {} after {}us", n, (int)(n & 3) + 1, 0.5);
+	}
+
+	//Drains the ring from the benchmark thread every half ring, so the time
+	//includes the logger thread's copy of the record but no record is dropped.
+	static void benchmarkLogEnabled(BenchmarkState &state)
+	{
+		CountingLogSink sink;
+		Logger::start(sink, LogLevel::Debug, 1000);
+		state.resetTimer();
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			TOUCHMOTE_LOG(LogLevel::Debug, "report {} of slot {} after {}us", n, (int)(n & 3) + 1, 0.5);
+			if ((n & (LOG_RING_RECORDS / 2 - 1)) == 0)
+				Logger::flush();
+		}
+		Logger::stop();
+		doNotOptimize(sink.Records);
+	}
+
+	//What the managed handlers do now, formatting on the calling thread.
+	static void benchmarkLogSnprintf(BenchmarkState &state)
+	{
+		char line[128];
+		for (uint64_t n = 0; n < state.Iterations; n++)
+		{
+			snprintf(line, sizeof(line), "report %llu of slot %d after %gus", (unsigned long long)n, (int)(n & 3) + 1, 0.5);
+			doNotOptimize(line);
+		}
+	}
+
+	void registerPipelineBenchmarks(BenchmarkRunner &runner)
+	{
+		runner.add("filters/coord_filter", benchmarkCoordFilter);
+		runner.add("filters/one_euro", benchmarkOneEuroFilter);
+		runner.add("filters/predictive", benchmarkPredictiveFilter);
+		runner.add("filters/smoothing_buffer", benchmarkSmoothingBuffer);
+		runner.add("filters/radius_buffer", benchmarkRadiusBuffer);
+		runner.add("input/screen_position", benchmarkScreenPosition);
+		runner.add("settings/frame_snapshot", benchmarkSettingsSnapshot);
+		runner.add("settings/frame_snapshot_changing", benchmarkSettingsSnapshotChanging);
+		runner.add("settings/frame_lookup", benchmarkSettingsLookup);
+		runner.add("input/calibration/3x3", [](BenchmarkState &state) { benchmarkCalibration(state, 3); });
+		runner.add("input/calibration/5x5", [](BenchmarkState &state) { benchmarkCalibration(state, 5); });
+		runner.add("input/fusion/1", [](BenchmarkState &state) { benchmarkFusion(state, 1); });
+		runner.add("input/fusion/4", [](BenchmarkState &state) { benchmarkFusion(state, 4); });
+		runner.add("input/fusion/16", [](BenchmarkState &state) { benchmarkFusion(state, 16); });
+		runner.add("input/classifier/2", [](BenchmarkState &state) { benchmarkClassifier(state, 2); });
+		runner.add("input/classifier/8", [](BenchmarkState &state) { benchmarkClassifier(state, 8); });
+		runner.add("input/classifier/16", [](BenchmarkState &state) { benchmarkClassifier(state, 16); });
+		runner.add("input/classifier/64", [](BenchmarkState &state) { benchmarkClassifier(state, 64); });
+		runner.add("input/classifier/256", [](BenchmarkState &state) { benchmarkClassifier(state, 256); });
+		runner.add("pipeline/frame/1", [](BenchmarkState &state) { benchmarkPipelineFrame(state, 1, false); });
+		runner.add("pipeline/frame/2", [](BenchmarkState &state) { benchmarkPipelineFrame(state, 2, false); });
+		runner.add("pipeline/frame/4", [](BenchmarkState &state) { benchmarkPipelineFrame(state, 4, false); });
+		runner.add("pipeline/frame/8", [](BenchmarkState &state) { benchmarkPipelineFrame(state, 8, false); });
+		runner.add("pipeline/frame/16", [](BenchmarkState &state) { benchmarkPipelineFrame(state, 16, false); });
+		runner.add("pipeline/frame_jobs/1", [](BenchmarkState &state) { benchmarkPipelineFrame(state, 1, true); });
+		runner.add("pipeline/frame_jobs/2", [](BenchmarkState &state) { benchmarkPipelineFrame(state, 2, true); });
+		runner.add("pipeline/frame_jobs/4", [](BenchmarkState &state) { benchmarkPipelineFrame(state, 4, true); });
+		runner.add("pipeline/frame_jobs/8", [](BenchmarkState &state) { benchmarkPipelineFrame(state, 8, true); });
+		runner.add("pipeline/frame_jobs/16", [](BenchmarkState &state) { benchmarkPipelineFrame(state, 16, true); });
+		runner.add("pipeline/mailbox", benchmarkMailbox);
+		runner.add("pipeline/timer_reschedule/1000", [](BenchmarkState &state) { benchmarkTimerReschedule(state, 1000); });
+		runner.add("pipeline/timer_reschedule/10000", [](BenchmarkState &state) { benchmarkTimerReschedule(state, 10000); });
+		runner.add("pipeline/timer_queue_reschedule/1000", [](BenchmarkState &state) { benchmarkTimerQueueReschedule(state, 1000); });
+		runner.add("pipeline/timer_queue_reschedule/10000", [](BenchmarkState &state) { benchmarkTimerQueueReschedule(state, 10000); });
+		runner.add("pipeline/timer_advance/1000", [](BenchmarkState &state) { benchmarkTimerAdvance(state, 1000); });
+		runner.add("pipeline/timer_advance/10000", [](BenchmarkState &state) { benchmarkTimerAdvance(state, 10000); });
+		runner.add("replay/encode_report", benchmarkEncodeReport);
+		runner.add("replay/decode_report", benchmarkDecodeReport);
+		runner.add("diagnostics/histogram_record", benchmarkHistogramRecord);
+		runner.add("diagnostics/instrumentation_record", benchmarkInstrumentationRecord);
+		runner.add("diagnostics/stage_probe", benchmarkStageProbe);
+		runner.add("diagnostics/log_disabled", benchmarkLogDisabled);
+		runner.add("diagnostics/log_enabled/3", benchmarkLogEnabled);
+		runner.add("diagnostics/log_snprintf/3", benchmarkLogSnprintf);
+	}
+
+}
@@ -0,0 +1,249 @@
+// SchedulerBench.cpp
+//
+// Frame pacing of FrameScheduler against the loop of
+// MultiWiiPointerProvider.WiimoteHandlerWorker, which sleeps (int)(1000 / fps -
+// elapsed) milliseconds. First both run for an hour of frames on a
+// VirtualFrameClock with a 1ms sleep granularity, which must come out drift
+// free for the scheduler. Then both run on the real clock with a pipeline frame
+// as work, optionally next to busy threads, and report the achieved rate and
+// how far frame intervals stray from the period.
+//
+//   SchedulerBench [--fps N] [--seconds N] [--load THREADS] [--controllers N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../Pipeline/FrameScheduler.h"
+#include "../Pipeline/InputPipeline.h"
+#include "../Replay/SyntheticTrace.h"
+
+using namespace TouchmoteCore;
+
+struct PacingResult
+{
+	uint64_t Frames;
+	uint64_t Elapsed;
+	//Deviation of every frame interval from the period, in ns.
+	LatencyHistogram Jitter;
+
+	PacingResult() : Frames(0), Elapsed(0) {}
+};
+
+class FrameIntervals
+{
+public:
+	FrameIntervals(PacingResult &result, uint64_t period) : result(result), period(period), last(0) {}
+
+	void frame(uint64_t now)
+	{
+		if (last != 0)
+		{
+			uint64_t interval = now - last;
+			result.Jitter.record(interval > period ? interval - period : period - interval);
+		}
+		last = now;
+		result.Frames++;
+	}
+
+private:
+	PacingResult &result;
+	uint64_t period;
+	uint64_t last;
+};
+
+typedef void (*WorkFunction)(FrameClock &clock, uint64_t deadline, void *context);
+
+//The managed loop, with DateTime.Now replaced by the clock.
+static void runSleepLoop(FrameClock &clock, int fps, uint64_t duration, WorkFunction work, void *context, PacingResult &result)
+{
+	uint64_t period = FrameScheduler::getPeriodForFPS(fps);
+	FrameIntervals intervals(result, period);
+	double millisecondsForEachFrame = 1000 / fps;
+	uint64_t start = clock.now();
+	uint64_t lastFrame = start;
+	while (clock.now() - start < duration)
+	{
+		double delay = (double)(clock.now() - lastFrame) / 1000000.0;
+		double wait = millisecondsForEachFrame - delay;
+		if (wait > 0)
+			clock.sleepFor((uint64_t)(int)wait * 1000000);
+
+		lastFrame = clock.now();
+		intervals.frame(lastFrame);
+		work(clock, lastFrame, context);
+	}
+	result.Elapsed = clock.now() - start;
+}
+
+static void runScheduler(FrameClock &clock, int fps, uint64_t duration, WorkFunction work, void *context, PacingResult &result, FrameSchedulerStats &stats)
+{
+	uint64_t period = FrameScheduler::getPeriodForFPS(fps);
+	FrameIntervals intervals(result, period);
+	FrameScheduler scheduler(clock, period);
+	uint64_t start = clock.now();
+	scheduler.start();
+	while (clock.now() - start < duration)
+	{
+		uint64_t deadline = scheduler.waitForFrame();
+		intervals.frame(clock.now());
+		work(clock, deadline, context);
+		scheduler.endFrame();
+	}
+	result.Elapsed = clock.now() - start;
+	scheduler.getStats(stats);
+}
+
+static void printResult(const char *name, int fps, const PacingResult &result)
+{
+	HistogramSnapshot jitter;
+	jitter.add(result.Jitter);
+	double seconds = (double)result.Elapsed / 1e9;
+	printf("%-22s %9.2f fps (target %d)  interval error p50 %7.1fus  p99 %7.1fus  p99.9 %7.1fus  max %7.1fus\n",
+		name, result.Frames / seconds, fps, jitter.getPercentile(50) / 1000.0, jitter.getPercentile(99) / 1000.0,
+		jitter.getPercentile(99.9) / 1000.0, (double)jitter.Max / 1000.0);
+}
+
+static void printStats(const FrameSchedulerStats &stats)
+{
+	printf("%-22s %llu frames, %llu overruns, %llu skipped, lateness p50 %.1fus p99 %.1fus max %.1fus, work p50 %.1fus max %.1fus\n", "",
+		(unsigned long long)stats.Frames, (unsigned long long)stats.Overruns, (unsigned long long)stats.SkippedFrames,
+		stats.Lateness.getPercentile(50) / 1000.0, stats.Lateness.getPercentile(99) / 1000.0, (double)stats.Lateness.Max / 1000.0,
+		stats.Work.getPercentile(50) / 1000.0, (double)stats.Work.Max / 1000.0);
+}
+
+static void virtualWork(FrameClock &clock, uint64_t, void *)
+{
+	static_cast<VirtualFrameClock &>(clock).advance(300000);
+}
+
+class NullSink : public EventSink
+{
+public:
+	virtual void onEvent(const OutputEvent &) {}
+};
+
+struct PipelineWork
+{
+	InputPipeline *Pipeline;
+	std::vector<WiimoteReport> Reports;
+	int Controllers;
+	size_t Next;
+};
+
+static void pipelineWork(FrameClock &, uint64_t deadline, void *context)
+{
+	PipelineWork &work = *static_cast<PipelineWork *>(context);
+	for (int c = 0; c < work.Controllers; c++)
+	{
+		work.Pipeline->pushReport(work.Reports[work.Next]);
+		work.Next = (work.Next + 1) % work.Reports.size();
+	}
+	work.Pipeline->processFrame(deadline / 1000);
+}
+
+int main(int argc, char **argv)
+{
+	int fps = 120;
+	double seconds = 5;
+	int load = 0;
+	int controllers = 4;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) fps = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = atof(argv[++i]);
+		else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) load = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--controllers") == 0 && i + 1 < argc) controllers = atoi(argv[++i]);
+		else
+		{
+			fprintf(stderr, "usage: SchedulerBench [--fps N] [--seconds N] [--load THREADS] [--controllers N]\n");
+			return 2;
+		}
+	}
+	if (fps <= 0 || controllers <= 0)
+	{
+		fprintf(stderr, "--fps and --controllers must be positive\n");
+		return 2;
+	}
+
+	//An hour of virtual time, 1ms sleep granularity plus 50us wakeup latency and 300us of work per frame.
+	const uint64_t hour = 3600ull * 1000000000ull;
+	printf("virtual clock, 1 hour:\n");
+	{
+		VirtualFrameClock clock(1);
+		clock.SleepGranularity = 1000000;
+		clock.SleepLatency = 50000;
+		PacingResult result;
+		runSleepLoop(clock, fps, hour, virtualWork, NULL, result);
+		printResult("  sleep loop", fps, result);
+	}
+	int status = 0;
+	{
+		VirtualFrameClock clock(1);
+		clock.SleepGranularity = 1000000;
+		clock.SleepLatency = 50000;
+		PacingResult result;
+		FrameSchedulerStats stats;
+		runScheduler(clock, fps, hour, virtualWork, NULL, result, stats);
+		printResult("  scheduler", fps, result);
+		printStats(stats);
+
+		//Every deadline in the hour is hit, so nothing drifted.
+		uint64_t expected = result.Elapsed / FrameScheduler::getPeriodForFPS(fps);
+		if (stats.SkippedFrames != 0 || result.Frames + 1 < expected || result.Frames > expected + 1)
+		{
+			printf("  scheduler drifted: %llu frames, expected %llu\n", (unsigned long long)result.Frames, (unsigned long long)expected);
+			status = 1;
+		}
+	}
+
+	std::atomic<bool> loaded(true);
+	std::vector<std::thread> loadThreads;
+	for (int t = 0; t < load; t++)
+	{
+		loadThreads.push_back(std::thread([&loaded]() {
+			volatile uint64_t sink = 0;
+			while (loaded.load(std::memory_order_relaxed))
+				sink = sink + 1;
+		}));
+	}
+
+	printf("steady clock, %.1f s, %d controllers, %d load threads:\n", seconds, controllers, load);
+	NullSink sink;
+	PipelineSettings settings;
+	InputPipeline pipeline(settings, sink);
+	PipelineWork work;
+	work.Pipeline = &pipeline;
+	work.Controllers = controllers;
+	work.Next = 0;
+	XorShift32 random(1);
+	work.Reports.resize(4096);
+	for (size_t i = 0; i < work.Reports.size(); i++)
+		makeSyntheticReport(random, (uint64_t)(i / controllers + 1) * 10000, (int)(i % controllers) + 1, work.Reports[i]);
+	for (int c = 1; c <= controllers; c++)
+		pipeline.connect(c, 0);
+
+	uint64_t duration = (uint64_t)(seconds * 1e9);
+	SteadyFrameClock clock;
+	{
+		PacingResult result;
+		runSleepLoop(clock, fps, duration, pipelineWork, &work, result);
+		printResult("  sleep loop", fps, result);
+	}
+	{
+		PacingResult result;
+		FrameSchedulerStats stats;
+		runScheduler(clock, fps, duration, pipelineWork, &work, result, stats);
+		printResult("  scheduler", fps, result);
+		printStats(stats);
+	}
+
+	loaded.store(false);
+	for (size_t t = 0; t < loadThreads.size(); t++)
+		loadThreads[t].join();
+	return status;
+}
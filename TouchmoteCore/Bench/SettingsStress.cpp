@@ -0,0 +1,185 @@
+// SettingsStress.cpp
+//
+// Stress test of SettingsStore: reader threads acquire snapshots in a loop
+// while a writer publishes changes as fast as it can. Every change sets a few
+// settings to the same number, so a snapshot is consistent if they are all
+// equal, and a reader must never see the version go back. One reader holds
+// each snapshot for a millisecond, while the writer replaces it many times.
+// A listener checks it hears about every change and only of its keys. At the
+// end all snapshots but the current one must have been freed. Exits with 1 on
+// any error; run a build with -fsanitize=address to also catch a snapshot
+// read after it was freed.
+//
+//   SettingsStress [--seconds N] [--readers N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../Pipeline/SettingsStore.h"
+
+using namespace TouchmoteCore;
+
+static bool isConsistent(const PipelineSettings &values)
+{
+	int n = values.screenWidth;
+	return values.screenHeight == n && values.pointer_FPS == n && values.pointer_fusionMaxAge == n
+		&& values.touch_touchTapThreshold == n && values.pointer_marginsLeftRight == n;
+}
+
+static std::vector<SettingEntry> makeChange(int n)
+{
+	const char *keys[] = { "screenWidth", "screenHeight", "pointer_FPS", "pointer_fusionMaxAge", "touch_touchTapThreshold", "pointer_marginsLeftRight" };
+	std::vector<SettingEntry> entries;
+	for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++)
+	{
+		SettingEntry entry = { keys[k], k == 5 ? SettingValue::fromDouble(n) : SettingValue::fromInt(n) };
+		entries.push_back(entry);
+	}
+	return entries;
+}
+
+class CheckingListener : public SettingsListener
+{
+public:
+	uint64_t Changes;
+	uint64_t LastVersion;
+	int Errors;
+
+	CheckingListener() : Changes(0), LastVersion(1), Errors(0) {}
+
+	virtual void onSettingsChanged(const SettingsSnapshot &snapshot, const std::vector<std::string> &keys)
+	{
+		Changes++;
+		if (snapshot.Version != LastVersion + 1 || keys.size() != 1 || keys[0] != "pointer_FPS" || !isConsistent(snapshot.Values))
+			Errors++;
+		LastVersion = snapshot.Version;
+	}
+};
+
+struct ReaderResult
+{
+	uint64_t Reads;
+	uint64_t Versions;
+	int Errors;
+
+	ReaderResult() : Reads(0), Versions(0), Errors(0) {}
+};
+
+static void runReader(SettingsStore &store, const std::atomic<bool> &stop, bool slow, ReaderResult &result)
+{
+	SettingsReader reader(store);
+	uint64_t last = 0;
+	while (!stop.load(std::memory_order_relaxed))
+	{
+		const SettingsSnapshot &snapshot = reader.acquire();
+		if (snapshot.Version < last || !isConsistent(snapshot.Values))
+			result.Errors++;
+		if (snapshot.Version != last)
+			result.Versions++;
+		last = snapshot.Version;
+		result.Reads++;
+		if (slow)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			//Still readable after writers replaced it in the meantime.
+			if (snapshot.Version != last || !isConsistent(snapshot.Values))
+				result.Errors++;
+		}
+		else if ((result.Reads & 1023) == 0)
+		{
+			reader.release();
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	double seconds = 3;
+	int readers = 3;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = atof(argv[++i]);
+		else if (strcmp(argv[i], "--readers") == 0 && i + 1 < argc) readers = atoi(argv[++i]);
+		else
+		{
+			fprintf(stderr, "usage: SettingsStress [--seconds N] [--readers N]\n");
+			return 2;
+		}
+	}
+	readers = std::max(readers, 1);
+
+	PipelineSettings initial;
+	std::vector<SettingEntry> first = makeChange(0);
+	for (size_t e = 0; e < first.size(); e++)
+		initial.setValue(first[e].key, first[e].value);
+
+	int errors = 0;
+	size_t maxRetired = 0;
+	uint64_t writes = 0;
+	CheckingListener listener;
+	std::vector<ReaderResult> results(readers + 1);
+	{
+		SettingsStore store(initial);
+		store.subscribe(listener, std::vector<std::string>(1, "pointer_FPS"));
+
+		std::atomic<bool> stop(false);
+		std::vector<std::thread> threads;
+		for (int r = 0; r <= readers; r++)
+			threads.push_back(std::thread(runReader, std::ref(store), std::cref(stop), r == readers, std::ref(results[r])));
+
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now()
+			+ std::chrono::microseconds((int64_t)(seconds * 1e6));
+		while (std::chrono::steady_clock::now() < end)
+		{
+			writes++;
+			if (!store.update(makeChange((int)writes)))
+				errors++;
+			if ((writes & 255) == 0)
+				maxRetired = std::max(maxRetired, store.getRetiredCount());
+			if ((writes & 1023) == 0)
+				std::this_thread::yield();
+		}
+		stop.store(true);
+		for (size_t t = 0; t < threads.size(); t++)
+			threads[t].join();
+
+		if (store.getVersion() != writes + 1)
+		{
+			printf("FAIL: version %llu after %llu changes\n", (unsigned long long)store.getVersion(), (unsigned long long)writes);
+			errors++;
+		}
+		//Every reader is gone, so nothing is pinned any more.
+		if (store.getRetiredCount() != 0)
+		{
+			printf("FAIL: %llu snapshots not freed\n", (unsigned long long)store.getRetiredCount());
+			errors++;
+		}
+		store.unsubscribe(listener);
+	}
+
+	printf("%llu changes, %.0f per second, up to %llu snapshots waiting to be freed\n", (unsigned long long)writes,
+		writes / seconds, (unsigned long long)maxRetired);
+	for (int r = 0; r <= readers; r++)
+	{
+		printf("reader %d%s: %llu reads, %llu versions seen, %d errors\n", r, r == readers ? " (slow)" : "",
+			(unsigned long long)results[r].Reads, (unsigned long long)results[r].Versions, results[r].Errors);
+		errors += results[r].Errors;
+	}
+	if (listener.Changes != writes || listener.Errors != 0)
+	{
+		printf("FAIL: listener heard %llu of %llu changes, %d errors\n", (unsigned long long)listener.Changes,
+			(unsigned long long)writes, listener.Errors);
+		errors++;
+	}
+	if (errors != 0)
+		printf("FAIL: %d errors\n", errors);
+	return errors == 0 ? 0 : 1;
+}
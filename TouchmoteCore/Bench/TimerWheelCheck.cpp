@@ -0,0 +1,375 @@
+// TimerWheelCheck.cpp
+//
+// Checks TimerWheel against a reference kept in a std::multimap. Random runs
+// schedule, reschedule and cancel timers and advance the clock by small steps,
+// to just before a deadline, within one tick and by jumps of several turns of
+// the top level, for wheels of 4 to 64 slots. Deadlines reach up to eight times
+// slots^4 ticks ahead, and some have already passed. The callbacks schedule,
+// reschedule and cancel timers in turn, some of them due in the same advance().
+//
+// A timer must never fire before its deadline, and must fire in the first
+// advance() that reaches the tick its deadline rounds up to, or the first tick
+// not processed yet if that one is gone: late by less than one tick. The timers
+// of one advance() must fire in deadline order, the same deadline in the order
+// they were scheduled. Exits with 1 on a mismatch.
+//
+//   TimerWheelCheck [--steps N] [--seed N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "../Pipeline/TimerWheel.h"
+#include "../Replay/SyntheticTrace.h"
+
+using namespace TouchmoteCore;
+
+struct Config
+{
+	int Slots;
+	uint64_t Resolution;
+};
+
+static const Config CONFIGS[] = {
+	{ 4, 1 },
+	{ 4, 1000 },
+	{ 16, 7 },
+	{ 64, 1000 },
+};
+
+//Not on a tick, so the first tick is cut.
+static const uint64_t START = 123456789;
+
+class Checker
+{
+public:
+	Checker(const Config &config, uint32_t seed)
+		: config(config), random(seed), wheel(config.Resolution, config.Slots, START), now(START), nextTick(START / config.Resolution),
+		nextSequence(0), batchPosition(0), failures(0), scheduled(0), fired(0), rescheduled(0), cancelled(0), maxPending(0)
+	{
+		horizon = config.Resolution;
+		for (int level = 0; level < TIMER_WHEEL_LEVELS; level++)
+			horizon *= config.Slots;
+		handles.push_back(0);
+	}
+
+	void step()
+	{
+		int schedules = (int)(random.next() % 4);
+		for (int i = 0; i < schedules; i++)
+			schedule(pickDeadline());
+		if (random.next() % 2 == 0)
+			reschedule(pickId(), pickDeadline());
+		if (random.next() % 4 == 0)
+			cancel(pickId());
+		advance(pickTime());
+		maxPending = std::max(maxPending, pending.size());
+	}
+
+	int getFailures() const { return failures; }
+
+	void report() const
+	{
+		printf("slots %2d resolution %4llu: %7llu scheduled, %7llu fired, %6llu rescheduled, %6llu cancelled, %5d pending at most\n", config.Slots,
+			(unsigned long long)config.Resolution, (unsigned long long)scheduled, (unsigned long long)fired, (unsigned long long)rescheduled,
+			(unsigned long long)cancelled, (int)maxPending);
+	}
+
+private:
+	struct RefTimer
+	{
+		uint64_t Deadline;
+		uint64_t Sequence;
+		//Tick it has to fire in.
+		uint64_t Tick;
+		//Taken out by advance() and waiting for its callback.
+		bool Due;
+		bool Cancelled;
+		std::multimap<uint64_t, uint64_t>::iterator Entry;
+	};
+
+	static void onTimer(void *context, uint64_t data)
+	{
+		((Checker *)context)->fire(data);
+	}
+
+	uint64_t next64()
+	{
+		return ((uint64_t)random.next() << 32) | random.next();
+	}
+
+	uint64_t pickDeadline()
+	{
+		uint64_t resolution = config.Resolution;
+		switch (random.next() % 8)
+		{
+		case 0:
+			return now - std::min(now, next64() % (3 * resolution));
+		case 1:
+			return (now / resolution + 1 + random.next() % 4) * resolution;
+		case 2:
+			return now + horizon + next64() % (7 * horizon);
+		case 3:
+			return now + next64() % horizon;
+		default:
+			return now + next64() % ((uint64_t)config.Slots * config.Slots * resolution);
+		}
+	}
+
+	uint64_t pickTime()
+	{
+		uint64_t resolution = config.Resolution;
+		switch (random.next() % 10)
+		{
+		case 0:
+			return now + next64() % resolution;
+		case 1:
+			return now + horizon * (1 + random.next() % 3) + next64() % horizon;
+		case 2:
+			if (!byTick.empty())
+			{
+				uint64_t deadline = pending[byTick.begin()->second].Deadline;
+				if (deadline > now)
+					return deadline - 1;
+			}
+			return now;
+		case 3:
+			if (!byTick.empty())
+				return std::max(now, pending[byTick.begin()->second].Deadline);
+			return now;
+		default:
+			return now + next64() % (2 * (uint64_t)config.Slots * resolution);
+		}
+	}
+
+	//Mostly a recent timer, which is likely still pending, else any.
+	uint64_t pickId()
+	{
+		uint64_t count = handles.size() - 1;
+		if (count == 0)
+			return 0;
+		if (random.next() % 2 == 0)
+			return count - std::min(count - 1, (uint64_t)(random.next() % 64));
+		return 1 + random.next() % count;
+	}
+
+	uint64_t getTick(uint64_t deadline) const
+	{
+		uint64_t tick = deadline / config.Resolution + (deadline % config.Resolution != 0 ? 1 : 0);
+		return std::max(tick, nextTick);
+	}
+
+	void fail(const char *what, uint64_t id)
+	{
+		if (failures < 5)
+			printf("FAIL: slots %d resolution %llu at %llu: %s, timer %llu\n", config.Slots, (unsigned long long)config.Resolution,
+				(unsigned long long)now, what, (unsigned long long)id);
+		failures++;
+	}
+
+	void schedule(uint64_t deadline)
+	{
+		uint64_t id = handles.size();
+		handles.push_back(wheel.schedule(deadline, onTimer, this, id));
+		RefTimer &timer = pending[id];
+		timer.Deadline = deadline;
+		timer.Sequence = nextSequence++;
+		timer.Tick = getTick(deadline);
+		timer.Due = false;
+		timer.Cancelled = false;
+		timer.Entry = byTick.insert(std::make_pair(timer.Tick, id));
+		scheduled++;
+	}
+
+	void reschedule(uint64_t id, uint64_t deadline)
+	{
+		if (id == 0)
+			return;
+		std::map<uint64_t, RefTimer>::iterator found = pending.find(id);
+		bool expected = found != pending.end() && !found->second.Due;
+		if (wheel.reschedule(handles[id], deadline) != expected)
+		{
+			fail(expected ? "reschedule refused" : "reschedule of a timer that fired or is due", id);
+			return;
+		}
+		if (!expected)
+			return;
+
+		RefTimer &timer = found->second;
+		byTick.erase(timer.Entry);
+		timer.Deadline = deadline;
+		timer.Sequence = nextSequence++;
+		timer.Tick = getTick(deadline);
+		timer.Entry = byTick.insert(std::make_pair(timer.Tick, id));
+		rescheduled++;
+	}
+
+	void cancel(uint64_t id)
+	{
+		if (id == 0)
+			return;
+		std::map<uint64_t, RefTimer>::iterator found = pending.find(id);
+		bool expected = found != pending.end() && !found->second.Cancelled;
+		if (wheel.cancel(handles[id]) != expected)
+		{
+			fail(expected ? "cancel refused" : "cancel of a timer that fired", id);
+			return;
+		}
+		if (!expected)
+			return;
+
+		if (found->second.Due)
+			found->second.Cancelled = true;
+		else
+		{
+			byTick.erase(found->second.Entry);
+			pending.erase(found);
+		}
+		cancelled++;
+	}
+
+	void advance(uint64_t time)
+	{
+		now = time;
+		uint64_t tick = time / config.Resolution;
+		batch.clear();
+		batchPosition = 0;
+		if (tick >= nextTick)
+		{
+			std::multimap<uint64_t, uint64_t>::iterator end = byTick.upper_bound(tick);
+			for (std::multimap<uint64_t, uint64_t>::iterator i = byTick.begin(); i != end; ++i)
+			{
+				pending[i->second].Due = true;
+				batch.push_back(i->second);
+			}
+			byTick.erase(byTick.begin(), end);
+			std::sort(batch.begin(), batch.end(), [this](uint64_t a, uint64_t b) {
+				const RefTimer &x = pending[a];
+				const RefTimer &y = pending[b];
+				return x.Deadline != y.Deadline ? x.Deadline < y.Deadline : x.Sequence < y.Sequence;
+			});
+			nextTick = tick + 1;
+		}
+
+		wheel.advance(time);
+
+		skipCancelled();
+		if (batchPosition < batch.size())
+			fail("did not fire", batch[batchPosition]);
+		for (size_t i = 0; i < batch.size(); i++)
+			pending.erase(batch[i]);
+		batch.clear();
+		if (wheel.size() != pending.size())
+		{
+			printf("FAIL: slots %d resolution %llu at %llu: %d timers, %d in the reference\n", config.Slots, (unsigned long long)config.Resolution,
+				(unsigned long long)now, (int)wheel.size(), (int)pending.size());
+			failures++;
+		}
+	}
+
+	void skipCancelled()
+	{
+		while (batchPosition < batch.size() && pending[batch[batchPosition]].Cancelled)
+			batchPosition++;
+	}
+
+	void fire(uint64_t id)
+	{
+		skipCancelled();
+		std::map<uint64_t, RefTimer>::iterator found = pending.find(id);
+		if (found == pending.end() || !found->second.Due)
+			fail(found == pending.end() ? "fired twice or after it was cancelled" : "fired early", id);
+		else if (found->second.Cancelled)
+			fail("fired after it was cancelled", id);
+		else if (found->second.Deadline > now)
+			fail("fired before its deadline", id);
+		else if (batchPosition >= batch.size() || batch[batchPosition] != id)
+			fail("fired out of deadline order", id);
+		else
+		{
+			//Gone for cancel and reschedule, like its handle.
+			pending.erase(found);
+			batchPosition++;
+		}
+		fired++;
+
+		//Like a pipeline callback arming its next timeout or moving another.
+		switch (random.next() % 6)
+		{
+		case 0:
+			schedule(pickDeadline());
+			break;
+		case 1:
+			reschedule(pickId(), pickDeadline());
+			break;
+		case 2:
+			cancel(pickId());
+			break;
+		case 3:
+			//Due already, it fires in the next advance().
+			schedule(now - std::min(now, (uint64_t)(random.next() % 3)));
+			break;
+		default:
+			break;
+		}
+	}
+
+	Config config;
+	XorShift32 random;
+	TimerWheel wheel;
+	uint64_t horizon;
+	uint64_t now;
+	//First tick advance() has not processed yet.
+	uint64_t nextTick;
+	uint64_t nextSequence;
+	//By id, which is the index here and the data of the timer.
+	std::vector<TimerWheel::Handle> handles;
+	std::map<uint64_t, RefTimer> pending;
+	std::multimap<uint64_t, uint64_t> byTick;
+	//The timers of the running advance() in the order they have to fire.
+	std::vector<uint64_t> batch;
+	size_t batchPosition;
+	int failures;
+	uint64_t scheduled;
+	uint64_t fired;
+	uint64_t rescheduled;
+	uint64_t cancelled;
+	size_t maxPending;
+};
+
+int main(int argc, char **argv)
+{
+	int steps = 20000;
+	uint32_t seed = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc)
+			steps = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else
+		{
+			fprintf(stderr, "usage: %s [--steps N] [--seed N]\n", argv[0]);
+			return 2;
+		}
+	}
+	steps = std::max(steps, 1);
+
+	int failures = 0;
+	for (size_t c = 0; c < sizeof(CONFIGS) / sizeof(CONFIGS[0]); c++)
+	{
+		Checker checker(CONFIGS[c], seed + (uint32_t)c);
+		for (int s = 0; s < steps && checker.getFailures() < 5; s++)
+			checker.step();
+		checker.report();
+		failures += checker.getFailures();
+	}
+
+	if (failures != 0)
+		printf("FAIL: %d mismatches\n", failures);
+	return failures == 0 ? 0 : 1;
+}
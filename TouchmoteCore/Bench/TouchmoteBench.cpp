@@ -0,0 +1,94 @@
+// TouchmoteBench.cpp
+//
+// Microbenchmarks of the per-frame native code paths.
+//
+//   TouchmoteBench [--filter TEXT] [--min-time MS] [--repetitions N] [--json FILE] [--compare FILE]
+//
+// --json writes the results for later comparison, --compare prints the change
+// against such a file.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BenchmarkRunner.h"
+#include "Benchmarks.h"
+
+using namespace TouchmoteCore;
+
+static int usage()
+{
+	fprintf(stderr, "usage: TouchmoteBench [--filter TEXT] [--min-time MS] [--repetitions N] [--json FILE] [--compare FILE]\n");
+	return 2;
+}
+
+static void printComparison(const std::vector<BenchmarkResult> &baseline, const std::vector<BenchmarkResult> &results)
+{
+	printf("%-40s %12s %12s %9s\n", "benchmark", "base ns/op", "ns/op", "change");
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult *base = NULL;
+		for (size_t j = 0; j < baseline.size(); j++)
+		{
+			if (baseline[j].Name == results[i].Name)
+				base = &baseline[j];
+		}
+
+		if (base == NULL || base->NsPerOp <= 0)
+			printf("%-40s %12s %12.2f %9s\n", results[i].Name.c_str(), "-", results[i].NsPerOp, "new");
+		else
+			printf("%-40s %12.2f %12.2f %+8.1f%%\n", results[i].Name.c_str(), base->NsPerOp, results[i].NsPerOp,
+				(results[i].NsPerOp / base->NsPerOp - 1) * 100);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	BenchmarkOptions options;
+	const char *jsonPath = NULL;
+	const char *comparePath = NULL;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--filter") && hasValue) options.Filter = argv[++i];
+		else if (!strcmp(argv[i], "--min-time") && hasValue) options.MinTimeMs = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--repetitions") && hasValue) options.Repetitions = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--json") && hasValue) jsonPath = argv[++i];
+		else if (!strcmp(argv[i], "--compare") && hasValue) comparePath = argv[++i];
+		else return usage();
+	}
+
+	std::vector<BenchmarkResult> baseline;
+	if (comparePath != NULL && !BenchmarkRunner::readJson(comparePath, baseline))
+	{
+		fprintf(stderr, "Could not read %s\n", comparePath);
+		return 1;
+	}
+
+	BenchmarkRunner runner;
+	registerOverlayBenchmarks(runner);
+	registerDeviceBenchmarks(runner);
+	registerOutputBenchmarks(runner);
+	registerPipelineBenchmarks(runner);
+
+	std::vector<BenchmarkResult> results;
+	runner.run(options, results, comparePath != NULL ? NULL : stdout);
+
+	if (comparePath != NULL)
+		printComparison(baseline, results);
+
+	if (jsonPath != NULL)
+	{
+		FILE *out = !strcmp(jsonPath, "-") ? stdout : fopen(jsonPath, "w");
+		if (out == NULL)
+		{
+			fprintf(stderr, "Could not open %s for writing\n", jsonPath);
+			return 1;
+		}
+		BenchmarkRunner::writeJson(out, results);
+		if (out != stdout)
+			fclose(out);
+	}
+	return 0;
+}
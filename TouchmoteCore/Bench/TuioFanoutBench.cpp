@@ -0,0 +1,277 @@
+// TuioFanoutBench.cpp
+//
+// TuioServer on loopback with 1, 2, 4, 8, 16 and 32 clients. Every client is
+// a UDP socket of this process, read by one receiver thread; the pipeline
+// stand-in publishes frames of moving cursors at the given rate. Reported
+// per run are the frames per second published and received by each client,
+// what the queues dropped, the time publish() took and the time from
+// publish() to a client having the datagram.
+//
+// With --rate 0 frames are published as fast as publish() returns, which
+// shows how many frames a second the sender keeps up with before the queues
+// start dropping. Exits with 1 if a client gets a malformed bundle or none.
+//
+// Linux only.
+//
+//   TuioFanoutBench [--seconds N] [--rate HZ] [--clients N] [--cursors N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../Diagnostics/Instrumentation.h"
+#include "../Output/TuioServer.h"
+
+using namespace TouchmoteCore;
+
+//Publish times by fseq, for the receiver to look up.
+static const int PUBLISH_TIMES = 1 << 16;
+
+struct BenchOptions
+{
+	double Seconds;
+	int Rate;
+	int Cursors;
+};
+
+struct RunResult
+{
+	uint64_t Published;
+	uint64_t Received;
+	uint64_t MinReceived;
+	uint64_t Malformed;
+	TuioServerStats Server;
+	HistogramSnapshot Publish;
+	HistogramSnapshot Delivery;
+	HistogramSnapshot Send;
+};
+
+static int openReceiver(uint16_t &port)
+{
+	int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if (fd == -1)
+		return -1;
+
+	int bufferSize = 1 << 20;
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t length = sizeof(address);
+	if (bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || getsockname(fd, (struct sockaddr *)&address, &length) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	port = ntohs(address.sin_port);
+	return fd;
+}
+
+static bool runClients(int clientCount, const BenchOptions &options, RunResult &result)
+{
+	std::unique_ptr<TuioServer> server(TuioServer::create(16));
+	if (!server)
+		return false;
+
+	std::vector<int> receivers;
+	for (int c = 0; c < clientCount; c++)
+	{
+		uint16_t port = 0;
+		int fd = openReceiver(port);
+		if (fd == -1 || server->addClient("127.0.0.1", port) == -1)
+		{
+			fprintf(stderr, "could not set up client %d\n", c);
+			return false;
+		}
+		receivers.push_back(fd);
+	}
+
+	std::unique_ptr<std::atomic<uint64_t>[]> publishTimes(new std::atomic<uint64_t>[PUBLISH_TIMES]);
+	for (int i = 0; i < PUBLISH_TIMES; i++)
+		publishTimes[i].store(0, std::memory_order_relaxed);
+
+	std::atomic<bool> receiving(true);
+	std::vector<uint64_t> received(clientCount, 0);
+	uint64_t malformed = 0;
+	LatencyHistogram delivery;
+	std::thread receiver([&]() {
+		std::vector<struct pollfd> polls(clientCount);
+		for (int c = 0; c < clientCount; c++)
+		{
+			polls[c].fd = receivers[c];
+			polls[c].events = POLLIN;
+		}
+		uint8_t packet[TUIO_MAX_PACKET];
+		while (receiving.load(std::memory_order_relaxed))
+		{
+			if (poll(&polls[0], polls.size(), 10) <= 0)
+				continue;
+
+			for (int c = 0; c < clientCount; c++)
+			{
+				if ((polls[c].revents & POLLIN) == 0)
+					continue;
+
+				ssize_t size;
+				while ((size = recv(receivers[c], packet, sizeof(packet), 0)) > 0)
+				{
+					uint64_t now = Instrumentation::now();
+					int32_t frame = getTuioFrame(packet, (size_t)size);
+					if (frame < 0)
+					{
+						malformed++;
+						continue;
+					}
+					received[c]++;
+					uint64_t published = publishTimes[frame % PUBLISH_TIMES].load(std::memory_order_acquire);
+					if (published != 0 && now > published)
+						delivery.record(now - published);
+				}
+			}
+		}
+	});
+
+	TuioCursor cursors[MAX_TUIO_CURSORS];
+	int cursorCount = std::min(options.Cursors, MAX_TUIO_CURSORS);
+	LatencyHistogram publish;
+	uint64_t period = options.Rate > 0 ? 1000000000ull / (uint64_t)options.Rate : 0;
+	uint64_t start = Instrumentation::now();
+	uint64_t end = start + (uint64_t)(options.Seconds * 1e9);
+	uint64_t next = start;
+	uint64_t frames = 0;
+	while (true)
+	{
+		uint64_t now = Instrumentation::now();
+		if (now >= end)
+			break;
+		if (period > 0)
+		{
+			if (next > now + 200000)
+				std::this_thread::sleep_for(std::chrono::nanoseconds(next - now - 100000));
+			while (Instrumentation::now() < next)
+			{
+			}
+			next += period;
+		}
+
+		frames++;
+		for (int i = 0; i < cursorCount; i++)
+		{
+			cursors[i].ID = (uint32_t)i;
+			cursors[i].X = (float)((frames + i * 50) % 1000) / 1000.0f;
+			cursors[i].Y = 0.5f;
+			cursors[i].Width = 0.01f;
+			cursors[i].Height = 0.01f;
+		}
+		//The publish time is stored under the frame number publish() is going to use.
+		uint64_t before = Instrumentation::now();
+		publishTimes[frames % PUBLISH_TIMES].store(before, std::memory_order_release);
+		server->publish(cursors, cursorCount);
+		publish.record(Instrumentation::now() - before);
+	}
+	double elapsed = (Instrumentation::now() - start) / 1e9;
+
+	//Let the sender and the receiver catch up.
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+	receiving.store(false, std::memory_order_relaxed);
+	receiver.join();
+	for (int c = 0; c < clientCount; c++)
+		close(receivers[c]);
+
+	result.Published = (uint64_t)(frames / elapsed);
+	result.Received = 0;
+	result.MinReceived = received.empty() ? 0 : received[0];
+	for (int c = 0; c < clientCount; c++)
+	{
+		result.Received += received[c];
+		result.MinReceived = std::min(result.MinReceived, received[c]);
+	}
+	result.Received = (uint64_t)(result.Received / elapsed / clientCount);
+	result.Malformed = malformed;
+	result.Server = server->getStats();
+	result.Publish = HistogramSnapshot();
+	result.Publish.add(publish);
+	result.Delivery = HistogramSnapshot();
+	result.Delivery.add(delivery);
+	result.Send = HistogramSnapshot();
+	result.Send.add(server->getSendLatency());
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	BenchOptions options;
+	options.Seconds = 2;
+	options.Rate = 1000;
+	options.Cursors = 4;
+	int onlyClients = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+			options.Seconds = atof(argv[++i]);
+		else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+			options.Rate = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--clients") == 0 && i + 1 < argc)
+			onlyClients = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--cursors") == 0 && i + 1 < argc)
+			options.Cursors = atoi(argv[++i]);
+		else
+		{
+			fprintf(stderr, "usage: TuioFanoutBench [--seconds N] [--rate HZ] [--clients N] [--cursors N]\n");
+			return 2;
+		}
+	}
+	if (onlyClients > MAX_TUIO_CLIENTS)
+		onlyClients = MAX_TUIO_CLIENTS;
+
+	printf("%d cursors, %s\n", options.Cursors, options.Rate > 0 ? "rate limited" : "unthrottled");
+	printf("clients  published/s  received/s  dropped   publish p50/p99      send p50/p99/p99.9          delivery p50/p99/p99.9\n");
+	bool failed = false;
+	for (int clients = 1; clients <= MAX_TUIO_CLIENTS; clients *= 2)
+	{
+		if (onlyClients > 0 && clients != onlyClients)
+			continue;
+
+		RunResult result;
+		if (!runClients(clients, options, result))
+			return 1;
+
+		printf("%7d  %11llu  %10llu  %7llu  %7.2f/%7.2fus  %7.1f/%7.1f/%7.1fus  %7.1f/%7.1f/%7.1fus\n", clients,
+			(unsigned long long)result.Published, (unsigned long long)result.Received, (unsigned long long)result.Server.Dropped,
+			result.Publish.getPercentile(50) / 1000.0, result.Publish.getPercentile(99) / 1000.0,
+			result.Send.getPercentile(50) / 1000.0, result.Send.getPercentile(99) / 1000.0, result.Send.getPercentile(99.9) / 1000.0,
+			result.Delivery.getPercentile(50) / 1000.0, result.Delivery.getPercentile(99) / 1000.0, result.Delivery.getPercentile(99.9) / 1000.0);
+		if (result.Malformed > 0 || result.MinReceived == 0)
+		{
+			printf("  %llu malformed bundles, fewest received by a client %llu\n",
+				(unsigned long long)result.Malformed, (unsigned long long)result.MinReceived);
+			failed = true;
+		}
+	}
+	return failed ? 1 : 0;
+}
+
+#else
+
+int main()
+{
+	fprintf(stderr, "TuioFanoutBench runs on Linux only\n");
+	return 0;
+}
+
+#endif
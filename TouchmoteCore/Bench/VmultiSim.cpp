@@ -0,0 +1,360 @@
+// VmultiSim.cpp
+//
+// Keymap output through VmultiReportAccumulator and a MemoryVmultiSink, frame
+// by frame at 100Hz. Most frames do nothing, some fire a burst of key, mouse
+// button and joystick changes, like a button mapped to a key combination, and
+// the pointer moves the mouse now and then. Every so often the sink fails for
+// a few frames, like a driver that went away.
+//
+// After every frame the reports are checked against a model of the devices:
+// at most one report per device and frame, no keyboard or joystick report the
+// same as the one before it, and the last report of each device is what the
+// model says once the sink works. Mouse motion adds up to what was moved.
+// Reported is the number of reports against VmultiKeyboardHandler, which sends
+// the whole keyboard report on every endUpdate. Exits with 1 on a mismatch.
+//
+//   VmultiSim [--frames N] [--seed N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "../Output/VmultiReports.h"
+
+using namespace TouchmoteCore;
+
+static uint32_t nextRandom(uint32_t &state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+struct DeviceModel
+{
+	std::vector<uint8_t> Keys;
+	uint8_t Modifiers;
+	uint8_t MouseButtons;
+	uint16_t JoystickButtons;
+	uint8_t Hat;
+	uint8_t Axes[4];
+	long long MovedX;
+	long long MovedY;
+	long long Scrolled;
+};
+
+static VmultiKeyboardReport keyboardOf(const DeviceModel &model)
+{
+	VmultiKeyboardReport report;
+	memset(&report, 0, sizeof(report));
+	report.ReportID = VMULTI_REPORTID_KEYBOARD;
+	report.Modifiers = model.Modifiers;
+	for (size_t k = 0; k < model.Keys.size(); k++)
+		report.Keys[k] = model.Keys[k];
+	return report;
+}
+
+static VmultiJoystickReport joystickOf(const DeviceModel &model)
+{
+	VmultiJoystickReport report;
+	memset(&report, 0, sizeof(report));
+	report.ReportID = VMULTI_REPORTID_JOYSTICK;
+	report.Buttons[0] = (uint8_t)(model.JoystickButtons & 0xff);
+	report.Buttons[1] = (uint8_t)(model.JoystickButtons >> 8);
+	report.Hat = model.Hat;
+	report.X = model.Axes[0];
+	report.Y = model.Axes[1];
+	report.RX = model.Axes[2];
+	report.RY = model.Axes[3];
+	return report;
+}
+
+static void resetModel(DeviceModel &model)
+{
+	model.Keys.clear();
+	model.Modifiers = 0;
+	model.MouseButtons = 0;
+	model.JoystickButtons = 0;
+	model.Hat = VMULTI_HAT_CENTER;
+	for (int a = 0; a < 4; a++)
+		model.Axes[a] = 128;
+}
+
+//One keymap action on both the accumulator and the model. Returns false if
+//the accumulator did not take a key the model did, or the other way round.
+static bool randomAction(VmultiReportAccumulator &accumulator, DeviceModel &model, uint32_t &random)
+{
+	uint32_t r = nextRandom(random);
+	switch (r % 8)
+	{
+	case 0:
+	case 1:
+	{
+		//Usages a..z, 4..29.
+		uint8_t usage = (uint8_t)(4 + (r >> 8) % 26);
+		bool down = std::find(model.Keys.begin(), model.Keys.end(), usage) != model.Keys.end();
+		bool accepted = accumulator.keyDown(usage);
+		if (accepted != (down || model.Keys.size() < (size_t)VMULTI_KEYBOARD_KEYS))
+			return false;
+		if (!down && accepted)
+			model.Keys.push_back(usage);
+		break;
+	}
+	case 2:
+	case 3:
+	{
+		if (model.Keys.empty())
+			break;
+		uint8_t usage = model.Keys[(r >> 8) % model.Keys.size()];
+		accumulator.keyUp(usage);
+		model.Keys.erase(std::find(model.Keys.begin(), model.Keys.end(), usage));
+		break;
+	}
+	case 4:
+	{
+		uint8_t mask = (uint8_t)(1 << ((r >> 8) % 8));
+		if ((r >> 16) & 1)
+		{
+			accumulator.modifierDown(mask);
+			model.Modifiers |= mask;
+		}
+		else
+		{
+			accumulator.modifierUp(mask);
+			model.Modifiers &= (uint8_t)~mask;
+		}
+		break;
+	}
+	case 5:
+	{
+		uint8_t mask = (uint8_t)(1 << ((r >> 8) % 3));
+		if ((r >> 16) & 1)
+		{
+			accumulator.mouseButtonDown(mask);
+			model.MouseButtons |= mask;
+		}
+		else
+		{
+			accumulator.mouseButtonUp(mask);
+			model.MouseButtons &= (uint8_t)~mask;
+		}
+		break;
+	}
+	case 6:
+	{
+		int button = (int)((r >> 8) % 16);
+		bool down = ((r >> 16) & 1) != 0;
+		accumulator.setJoystickButton(button, down);
+		if (down)
+			model.JoystickButtons |= (uint16_t)(1 << button);
+		else
+			model.JoystickButtons &= (uint16_t)~(1 << button);
+		break;
+	}
+	default:
+	{
+		if ((r >> 8) % 5 == 0)
+		{
+			uint8_t hat = (uint8_t)((r >> 16) % 9);
+			accumulator.setHat(hat);
+			model.Hat = hat;
+		}
+		else
+		{
+			int axis = (int)((r >> 8) % 4);
+			//Mostly full deflection or centered, like a mapped d-pad.
+			uint8_t values[3] = { 0, 128, 255 };
+			uint8_t value = values[(r >> 16) % 3];
+			accumulator.setAxis((JoystickAxis)axis, value);
+			model.Axes[axis] = value;
+		}
+		break;
+	}
+	}
+	return true;
+}
+
+struct SimResult
+{
+	uint64_t Frames;
+	uint64_t Reports;
+	uint64_t ManagedReports;
+	uint64_t Suppressed;
+	uint64_t Failures;
+	uint64_t Errors;
+};
+
+static void countError(uint64_t &errors, uint64_t frame, const char *what)
+{
+	if (errors < 10)
+		printf("frame %llu: %s\n", (unsigned long long)frame, what);
+	errors++;
+}
+
+static SimResult simulate(uint64_t frames, uint32_t seed)
+{
+	MemoryVmultiSink sink;
+	VmultiReportAccumulator accumulator(sink);
+	DeviceModel model;
+	resetModel(model);
+	model.MovedX = model.MovedY = model.Scrolled = 0;
+	uint32_t random = seed;
+
+	SimResult result = SimResult();
+	std::vector<MemoryVmultiSink::Record> lastSent(VMULTI_REPORT_TYPES);
+	{
+		//What the driver starts out with.
+		VmultiKeyboardReport keyboard = keyboardOf(model);
+		VmultiJoystickReport joystick = joystickOf(model);
+		memcpy(lastSent[(int)VmultiReportType::Keyboard].Data, &keyboard, sizeof(keyboard));
+		memcpy(lastSent[(int)VmultiReportType::Joystick].Data, &joystick, sizeof(joystick));
+	}
+	int failingFrames = 0;
+	long long sentX = 0;
+	long long sentY = 0;
+	long long sentWheel = 0;
+	for (uint64_t frame = 0; frame < frames; frame++)
+	{
+		uint32_t kind = nextRandom(random) % 100;
+		if (failingFrames > 0)
+			failingFrames--;
+		else if (kind == 0)
+			failingFrames = 1 + (int)(nextRandom(random) % 4);
+		sink.Failing = failingFrames > 0;
+
+		bool disconnect = kind == 1;
+		if (disconnect)
+		{
+			//Motion not sent yet is dropped.
+			resetModel(model);
+			model.MovedX = sentX;
+			model.MovedY = sentY;
+			model.Scrolled = sentWheel;
+			accumulator.releaseAll();
+		}
+		else
+		{
+			//A quarter of the frames fire a burst of up to 6 actions.
+			if (kind < 25)
+			{
+				int actions = 1 + (int)(nextRandom(random) % 6);
+				for (int a = 0; a < actions; a++)
+				{
+					if (!randomAction(accumulator, model, random))
+						countError(result.Errors, frame, "keyDown does not match");
+				}
+			}
+			if (kind >= 90)
+			{
+				int x = (int)(nextRandom(random) % 401) - 200;
+				int y = (int)(nextRandom(random) % 401) - 200;
+				accumulator.moveMouse(x, y);
+				model.MovedX += x;
+				model.MovedY += y;
+				if (kind == 99)
+				{
+					accumulator.scroll(120);
+					model.Scrolled += 120;
+				}
+			}
+			accumulator.endUpdate();
+		}
+		result.ManagedReports++;
+
+		size_t first = (size_t)result.Reports;
+		int perType[VMULTI_REPORT_TYPES] = { 0, 0, 0 };
+		for (size_t i = first; i < sink.Records.size(); i++)
+		{
+			const MemoryVmultiSink::Record &record = sink.Records[i];
+			int type = (int)record.Type;
+			if (++perType[type] > 1)
+				countError(result.Errors, frame, "more than one report of a device");
+			if (record.Type != VmultiReportType::Mouse && !disconnect && memcmp(record.Data, lastSent[type].Data, sizeof(record.Data)) == 0)
+				countError(result.Errors, frame, "report the same as the last one");
+			lastSent[type] = record;
+			if (record.Type == VmultiReportType::Mouse)
+			{
+				sentX += (int8_t)record.Data[2];
+				sentY += (int8_t)record.Data[3];
+				sentWheel += (int8_t)record.Data[4];
+			}
+		}
+		result.Reports = sink.Records.size();
+		if (sink.Failing)
+		{
+			if (result.Reports != first)
+				countError(result.Errors, frame, "report recorded by a failing sink");
+			continue;
+		}
+
+		VmultiKeyboardReport keyboard = keyboardOf(model);
+		VmultiJoystickReport joystick = joystickOf(model);
+		if (memcmp(lastSent[(int)VmultiReportType::Keyboard].Data, &keyboard, sizeof(keyboard)) != 0)
+			countError(result.Errors, frame, "keyboard report does not match");
+		if (memcmp(lastSent[(int)VmultiReportType::Joystick].Data, &joystick, sizeof(joystick)) != 0)
+			countError(result.Errors, frame, "joystick report does not match");
+		if (memcmp(&accumulator.keyboardReport(), &keyboard, sizeof(keyboard)) != 0)
+			countError(result.Errors, frame, "keyboard state does not match");
+		if (lastSent[(int)VmultiReportType::Mouse].Data[1] != model.MouseButtons)
+			countError(result.Errors, frame, "mouse buttons do not match");
+	}
+
+	//Idle frames until the motion left over is out.
+	sink.Failing = false;
+	for (int i = 0; i < 64; i++)
+		accumulator.endUpdate();
+	for (size_t i = (size_t)result.Reports; i < sink.Records.size(); i++)
+	{
+		const MemoryVmultiSink::Record &record = sink.Records[i];
+		if (record.Type == VmultiReportType::Mouse)
+		{
+			sentX += (int8_t)record.Data[2];
+			sentY += (int8_t)record.Data[3];
+			sentWheel += (int8_t)record.Data[4];
+		}
+	}
+	result.Reports = sink.Records.size();
+	result.Frames = frames;
+	const VmultiReportStats &stats = accumulator.getStats();
+	result.Suppressed = stats.Suppressed[0] + stats.Suppressed[1] + stats.Suppressed[2];
+	result.Failures = stats.Failures;
+	if (sentX != model.MovedX || sentY != model.MovedY || sentWheel != model.Scrolled)
+		countError(result.Errors, frames, "mouse motion does not add up");
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t frames = 1000000;
+	uint32_t seed = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frames = strtoull(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else
+		{
+			fprintf(stderr, "usage: VmultiSim [--frames N] [--seed N]\n");
+			return 2;
+		}
+	}
+	if (seed == 0)
+		seed = 1;
+
+	SimResult result = simulate(frames, seed);
+	printf("%llu frames: %llu reports, VmultiKeyboardHandler %llu keyboard reports (%.1f%%)\n",
+		(unsigned long long)result.Frames, (unsigned long long)result.Reports, (unsigned long long)result.ManagedReports,
+		result.ManagedReports > 0 ? 100.0 * result.Reports / result.ManagedReports : 0.0);
+	printf("%llu unchanged reports not sent, %llu failed sends\n", (unsigned long long)result.Suppressed, (unsigned long long)result.Failures);
+	if (result.Errors > 0)
+	{
+		printf("%llu mismatches\n", (unsigned long long)result.Errors);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,20 @@
+// BluetoothAddress.cpp
+
+#include "BluetoothAddress.h"
+
+namespace TouchmoteCore {
+
+	void formatBTAddress(const uint8_t bytes[BT_ADDRESS_BYTES], char out[BT_ADDRESS_STRING_LENGTH])
+	{
+		static const char digits[] = "0123456789abcdef";
+
+		char *pos = out;
+		for (int i = BT_ADDRESS_BYTES - 1; i >= 0; i--)
+		{
+			*pos++ = digits[bytes[i] >> 4];
+			*pos++ = digits[bytes[i] & 0x0f];
+			*pos++ = i > 0 ? ':' : '\0';
+		}
+	}
+
+}
@@ -0,0 +1,20 @@
+// BluetoothAddress.h
+//
+// Formatting of BLUETOOTH_ADDRESS values, split out of WiiPair so it can be
+// built and measured without the Windows Bluetooth APIs.
+
+#pragma once
+
+#include <stdint.h>
+
+namespace TouchmoteCore {
+
+	static const int BT_ADDRESS_BYTES = 6;
+	//"xx:xx:xx:xx:xx:xx" and the terminator.
+	static const int BT_ADDRESS_STRING_LENGTH = 18;
+
+	//Same output as printf("%02x:%02x:%02x:%02x:%02x:%02x") over rgBytes[5] down
+	//to rgBytes[0], which is most significant byte first.
+	void formatBTAddress(const uint8_t bytes[BT_ADDRESS_BYTES], char out[BT_ADDRESS_STRING_LENGTH]);
+
+}
@@ -0,0 +1,472 @@
+// ConnectionManager.cpp
+
+#include "ConnectionManager.h"
+
+#include <algorithm>
+
+#include "../Diagnostics/Logger.h"
+
+namespace TouchmoteCore {
+
+	//10ms ticks, the first level of the wheel covers 640ms and the second 41s.
+	static const uint64_t TIMER_RESOLUTION = 10;
+	static const int TIMER_SLOTS = 64;
+
+	static const int ALL_LEDS = 0xf;
+
+	const char *getConnectionStateName(ConnectionState state)
+	{
+		switch (state)
+		{
+		case ConnectionState::Discovered: return "discovered";
+		case ConnectionState::Connecting: return "connecting";
+		case ConnectionState::Active: return "active";
+		case ConnectionState::PowerSave: return "powersave";
+		case ConnectionState::Teardown: return "teardown";
+		default: return "unknown";
+		}
+	}
+
+	ConnectionSettings::ConnectionSettings()
+		: EnumerateInterval(2000),
+		DisconnectTimeout(2000),
+		SignificantTimeout(300000),
+		PowerSaveDisconnectTimeout(15000),
+		StatusInterval(6000),
+		BlinkInterval(10000),
+		BlinkTime(100),
+		RumbleTime(100),
+		ConnectTimeout(5000),
+		RetryDelay(500),
+		MaxRetryDelay(8000),
+		ReconnectDelay(2000)
+	{
+	}
+
+	ConnectionManager::ConnectionManager(DeviceIO &io, ConnectionListener &listener, const ConnectionSettings &settings)
+		: io(io), listener(listener), settings(settings), wheel(TIMER_RESOLUTION, TIMER_SLOTS, 0),
+		running(false), time(0), enumerateTimer(0), connected(0), wakeRequests(0), resultsPending(false), stats()
+	{
+		for (int s = 0; s < MAX_CONTROLLER_SLOTS; s++)
+		{
+			slots[s] = -1;
+			activities[s].LastEvent.store(0, std::memory_order_relaxed);
+			activities[s].LastSignificant.store(0, std::memory_order_relaxed);
+			activities[s].InPowerSave.store(false, std::memory_order_relaxed);
+		}
+	}
+
+	void ConnectionManager::start(uint64_t now)
+	{
+		time = now;
+		if (running)
+			return;
+
+		running = true;
+		enumerate();
+	}
+
+	void ConnectionManager::stop(uint64_t now)
+	{
+		time = now;
+		if (!running)
+			return;
+
+		running = false;
+		wheel.cancel(enumerateTimer);
+		enumerateTimer = 0;
+
+		if (connected == 0)
+			listener.onDisconnect(0, 0);
+
+		for (int i = 0; i < (int)devices.size(); i++)
+		{
+			if (!devices[i].Used)
+				continue;
+
+			if (devices[i].State == ConnectionState::Active || devices[i].State == ConnectionState::PowerSave)
+			{
+				teardown(i);
+			}
+			else if (devices[i].State == ConnectionState::Connecting)
+			{
+				io.disconnect(i);
+			}
+			forget(i);
+		}
+	}
+
+	void ConnectionManager::postConnectResult(int device, bool succeeded)
+	{
+		ConnectResult result = { device, succeeded };
+		std::lock_guard<std::mutex> lock(resultMutex);
+		results.push_back(result);
+		resultsPending.store(true, std::memory_order_release);
+	}
+
+	void ConnectionManager::advance(uint64_t now)
+	{
+		time = now;
+
+		if (resultsPending.load(std::memory_order_acquire))
+		{
+			{
+				std::lock_guard<std::mutex> lock(resultMutex);
+				takenResults.swap(results);
+				resultsPending.store(false, std::memory_order_relaxed);
+			}
+			for (size_t r = 0; r < takenResults.size(); r++)
+				onConnectResult(takenResults[r].Device, takenResults[r].Succeeded);
+			takenResults.clear();
+		}
+
+		uint32_t wakes = wakeRequests.exchange(0, std::memory_order_acquire);
+		for (int s = 0; wakes != 0; s++, wakes >>= 1)
+		{
+			if ((wakes & 1) != 0 && slots[s] != -1)
+				wakeFromPowerSave(slots[s]);
+		}
+
+		wheel.advance(now);
+	}
+
+	int ConnectionManager::findDevice(const std::string &path) const
+	{
+		std::unordered_map<std::string, int>::const_iterator found = byPath.find(path);
+		return found != byPath.end() ? found->second : -1;
+	}
+
+	TimerWheel::Handle ConnectionManager::schedule(uint64_t deadline, TimerKind kind, int device)
+	{
+		return wheel.schedule(deadline, &ConnectionManager::onTimer, this, ((uint64_t)kind << 32) | (uint32_t)(device + 1));
+	}
+
+	void ConnectionManager::onTimer(void *context, uint64_t data)
+	{
+		ConnectionManager &manager = *(ConnectionManager *)context;
+		int index = (int)(data & 0xffffffffu) - 1;
+		switch ((TimerKind)(data >> 32))
+		{
+		case TimerKind::Enumerate:
+			manager.enumerateTimer = 0;
+			manager.enumerate();
+			break;
+		case TimerKind::State:
+		{
+			Device &device = manager.devices[index];
+			device.StateTimer = 0;
+			switch (device.State)
+			{
+			case ConnectionState::Discovered:
+				//Retry delay passed, devices that vanished meanwhile are left to the next enumeration.
+				if (device.Present)
+					manager.beginConnect(index);
+				break;
+			case ConnectionState::Connecting:
+				manager.stats.ConnectTimeouts++;
+				manager.retryLater(index);
+				break;
+			case ConnectionState::Active:
+			case ConnectionState::PowerSave:
+				manager.checkActivity(index);
+				break;
+			case ConnectionState::Teardown:
+				manager.forget(index);
+				break;
+			}
+			break;
+		}
+		case TimerKind::Status:
+			manager.devices[index].StatusTimer = manager.schedule(manager.time + manager.settings.StatusInterval, TimerKind::Status, index);
+			manager.io.requestStatus(index);
+			break;
+		case TimerKind::Blink:
+			manager.onBlinkTimer(index);
+			break;
+		case TimerKind::Rumble:
+			manager.onRumbleTimer(index);
+			break;
+		}
+	}
+
+	void ConnectionManager::cancelTimers(Device &device)
+	{
+		TimerWheel::Handle *handles[] = { &device.StateTimer, &device.StatusTimer, &device.BlinkTimer, &device.RumbleTimer };
+		for (int h = 0; h < 4; h++)
+		{
+			if (*handles[h] != 0)
+				wheel.cancel(*handles[h]);
+			*handles[h] = 0;
+		}
+	}
+
+	int ConnectionManager::allocateDevice(const std::string &path)
+	{
+		int index;
+		if (!freeDevices.empty())
+		{
+			index = freeDevices.back();
+			freeDevices.pop_back();
+		}
+		else
+		{
+			index = (int)devices.size();
+			devices.push_back(Device());
+		}
+
+		Device &device = devices[index];
+		device = Device();
+		device.Path = path;
+		device.State = ConnectionState::Discovered;
+		device.Used = true;
+		byPath[path] = index;
+		return index;
+	}
+
+	void ConnectionManager::forget(int index)
+	{
+		Device &device = devices[index];
+		cancelTimers(device);
+		byPath.erase(device.Path);
+		device.Path.clear();
+		device.Used = false;
+		freeDevices.push_back(index);
+	}
+
+	void ConnectionManager::enumerate()
+	{
+		stats.Enumerations++;
+		enumerateTimer = schedule(time + settings.EnumerateInterval, TimerKind::Enumerate, -1);
+
+		for (size_t i = 0; i < devices.size(); i++)
+			devices[i].Present = false;
+
+		io.enumerate(paths);
+		for (size_t p = 0; p < paths.size(); p++)
+		{
+			int index = findDevice(paths[p]);
+			if (index == -1)
+				index = allocateDevice(paths[p]);
+			devices[index].Present = true;
+		}
+
+		for (int i = 0; i < (int)devices.size(); i++)
+		{
+			Device &device = devices[i];
+			if (!device.Used || device.State != ConnectionState::Discovered)
+				continue;
+
+			if (!device.Present)
+				forget(i);
+			else if (device.StateTimer == 0)
+				beginConnect(i);
+		}
+	}
+
+	void ConnectionManager::beginConnect(int index)
+	{
+		Device &device = devices[index];
+		stats.ConnectAttempts++;
+		device.State = ConnectionState::Connecting;
+		device.StateTimer = schedule(time + settings.ConnectTimeout, TimerKind::State, index);
+		io.beginConnect(index, device.Path);
+	}
+
+	void ConnectionManager::onConnectResult(int index, bool succeeded)
+	{
+		if (index < 0 || index >= (int)devices.size() || !devices[index].Used || devices[index].State != ConnectionState::Connecting)
+			return;
+
+		wheel.cancel(devices[index].StateTimer);
+		devices[index].StateTimer = 0;
+		if (succeeded)
+		{
+			activate(index);
+		}
+		else
+		{
+			stats.ConnectFailures++;
+			TOUCHMOTE_LOG(LogLevel::Warning, "connect to device {} failed, failure {}", index, devices[index].Failures + 1);
+			retryLater(index);
+		}
+	}
+
+	void ConnectionManager::retryLater(int index)
+	{
+		Device &device = devices[index];
+		io.disconnect(index);
+		device.State = ConnectionState::Discovered;
+
+		uint64_t delay = settings.RetryDelay;
+		for (int f = 0; f < device.Failures && delay < settings.MaxRetryDelay; f++)
+			delay *= 2;
+		device.Failures++;
+		device.StateTimer = schedule(time + std::min(delay, settings.MaxRetryDelay), TimerKind::State, index);
+	}
+
+	int ConnectionManager::getFirstFreeSlot() const
+	{
+		for (int s = 0; s < MAX_CONTROLLER_SLOTS; s++)
+		{
+			if (slots[s] == -1)
+				return s + 1;
+		}
+		return 0;
+	}
+
+	void ConnectionManager::setSlotLEDs(int index)
+	{
+		//Like SetLEDs(id == 1, id == 2, id == 3, id == 4).
+		int slot = devices[index].Slot;
+		io.setLEDs(index, slot >= 1 && slot <= 4 ? 1 << (slot - 1) : 0);
+		devices[index].LEDsLit = false;
+	}
+
+	void ConnectionManager::activate(int index)
+	{
+		Device &device = devices[index];
+		int slot = getFirstFreeSlot();
+		if (slot == 0)
+		{
+			//Every slot taken, wait for the next enumeration.
+			io.disconnect(index);
+			device.State = ConnectionState::Discovered;
+			return;
+		}
+
+		slots[slot - 1] = index;
+		device.Slot = slot;
+		device.Failures = 0;
+		device.State = ConnectionState::Active;
+
+		SlotActivity &activity = activities[slot - 1];
+		activity.LastEvent.store(time, std::memory_order_relaxed);
+		activity.LastSignificant.store(time, std::memory_order_relaxed);
+		activity.InPowerSave.store(false, std::memory_order_relaxed);
+		wakeRequests.fetch_and(~(1u << (slot - 1)), std::memory_order_relaxed);
+
+		io.setReportMode(index, DeviceReportMode::IRExtensionAccel);
+		setSlotLEDs(index);
+		//connectRumble: wait, rumble, stop.
+		device.Rumbling = false;
+		device.RumbleTimer = schedule(time + settings.RumbleTime, TimerKind::Rumble, index);
+
+		checkActivity(index);
+
+		connected++;
+		stats.Connects++;
+		TOUCHMOTE_LOG(LogLevel::Info, "device {} connected on slot {}, {} connected", index, slot, connected);
+		listener.onConnect(slot, connected);
+	}
+
+	void ConnectionManager::checkActivity(int index)
+	{
+		Device &device = devices[index];
+		const SlotActivity &activity = activities[device.Slot - 1];
+		uint64_t lastEvent = activity.LastEvent.load(std::memory_order_relaxed);
+
+		//Reports keep coming in, so instead of moving the timer on each of them it
+		//fires at the old deadline and is moved to the new one from here.
+		if (device.State == ConnectionState::PowerSave)
+		{
+			uint64_t disconnectAt = lastEvent + settings.PowerSaveDisconnectTimeout;
+			if (disconnectAt <= time)
+				teardown(index);
+			else
+				device.StateTimer = schedule(disconnectAt, TimerKind::State, index);
+			return;
+		}
+
+		uint64_t disconnectAt = lastEvent + settings.DisconnectTimeout;
+		uint64_t powerSaveAt = activity.LastSignificant.load(std::memory_order_relaxed) + settings.SignificantTimeout;
+		if (disconnectAt <= time)
+			teardown(index);
+		else if (powerSaveAt <= time)
+			putToPowerSave(index);
+		else
+			device.StateTimer = schedule(std::min(disconnectAt, powerSaveAt), TimerKind::State, index);
+	}
+
+	void ConnectionManager::putToPowerSave(int index)
+	{
+		Device &device = devices[index];
+		stats.PowerSaves++;
+		TOUCHMOTE_LOG(LogLevel::Info, "slot {} to power save", device.Slot);
+		cancelTimers(device);
+		device.State = ConnectionState::PowerSave;
+		activities[device.Slot - 1].InPowerSave.store(true, std::memory_order_relaxed);
+
+		io.setReportMode(index, DeviceReportMode::Buttons);
+		io.setLEDs(index, 0);
+		io.setRumble(index, false);
+		device.LEDsLit = false;
+		device.Rumbling = false;
+
+		device.StatusTimer = schedule(time + settings.StatusInterval, TimerKind::Status, index);
+		device.BlinkTimer = schedule(time + settings.BlinkInterval, TimerKind::Blink, index);
+		checkActivity(index);
+	}
+
+	void ConnectionManager::wakeFromPowerSave(int index)
+	{
+		Device &device = devices[index];
+		if (device.State != ConnectionState::PowerSave)
+			return;
+
+		stats.Wakes++;
+		TOUCHMOTE_LOG(LogLevel::Info, "slot {} woken from power save", device.Slot);
+		cancelTimers(device);
+		device.State = ConnectionState::Active;
+		activities[device.Slot - 1].InPowerSave.store(false, std::memory_order_relaxed);
+
+		io.setReportMode(index, DeviceReportMode::IRExtensionAccel);
+		setSlotLEDs(index);
+		//SetRumble(true) followed by connectRumble, so it rumbles twice as long.
+		io.setRumble(index, true);
+		device.Rumbling = true;
+		device.RumbleTimer = schedule(time + 2 * settings.RumbleTime, TimerKind::Rumble, index);
+
+		checkActivity(index);
+	}
+
+	void ConnectionManager::teardown(int index)
+	{
+		Device &device = devices[index];
+		int slot = device.Slot;
+		stats.Teardowns++;
+		cancelTimers(device);
+
+		slots[slot - 1] = -1;
+		activities[slot - 1].InPowerSave.store(false, std::memory_order_relaxed);
+		device.Slot = 0;
+		device.State = ConnectionState::Teardown;
+		connected--;
+		TOUCHMOTE_LOG(LogLevel::Info, "slot {} disconnected, {} connected", slot, connected);
+
+		io.setReportMode(index, DeviceReportMode::Status);
+		io.setRumble(index, false);
+		io.setLEDs(index, ALL_LEDS);
+		io.disconnect(index);
+
+		device.StateTimer = schedule(time + settings.ReconnectDelay, TimerKind::State, index);
+		listener.onDisconnect(slot, connected);
+	}
+
+	void ConnectionManager::onRumbleTimer(int index)
+	{
+		Device &device = devices[index];
+		device.Rumbling = !device.Rumbling;
+		io.setRumble(index, device.Rumbling);
+		device.RumbleTimer = device.Rumbling ? schedule(time + settings.RumbleTime, TimerKind::Rumble, index) : 0;
+	}
+
+	void ConnectionManager::onBlinkTimer(int index)
+	{
+		Device &device = devices[index];
+		device.LEDsLit = !device.LEDsLit;
+		io.setLEDs(index, device.LEDsLit ? ALL_LEDS : 0);
+		uint64_t delay = device.LEDsLit ? settings.BlinkTime : settings.BlinkInterval - std::min(settings.BlinkTime, settings.BlinkInterval);
+		device.BlinkTimer = schedule(time + delay, TimerKind::Blink, index);
+	}
+
+}
@@ -0,0 +1,272 @@
+// ConnectionManager.h
+//
+// Event driven replacement for wiimoteConnectorTimer_Elapsed of
+// MultiWiiPointerProvider. Every device has its own state machine
+//
+//   Discovered -> Connecting -> Active <-> PowerSave
+//        ^            |           |           |
+//        +------------+-----> Teardown <------+
+//
+// and every delay, from the connect rumble to the power save timeouts, is a
+// timer on one TimerWheel. Nothing blocks: connecting is started through
+// DeviceIO and finishes when the result is posted, so a slow device no longer
+// holds up the others, and the Thread.Sleep calls of connectRumble and the
+// power save blink became timers.
+//
+// Device I/O is behind DeviceIO, so discovery and teardown can be driven by
+// fake devices. Times are in milliseconds on any monotonic clock.
+//
+// advance(), start() and stop() are called from one thread, the one the
+// listener and DeviceIO run on. noteActivity() and postConnectResult() may be
+// called from any thread.
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../Input/WiimoteReport.h"
+#include "../Pipeline/TimerWheel.h"
+
+namespace TouchmoteCore {
+
+	enum class ConnectionState
+	{
+		//Found by enumeration, waiting for a connect attempt.
+		Discovered,
+		//beginConnect was called, waiting for postConnectResult.
+		Connecting,
+		//Has a slot and reports IR.
+		Active,
+		//Has a slot, reports buttons only, LEDs off.
+		PowerSave,
+		//Disconnected, not reconnected until ReconnectDelay passed.
+		Teardown
+	};
+
+	const char *getConnectionStateName(ConnectionState state);
+
+	//Same data as WiimoteLib's InputReport values the provider uses.
+	enum class DeviceReportMode
+	{
+		Status,
+		Buttons,
+		IRExtensionAccel
+	};
+
+	//The Wiimote operations the connector does. Every call but enumerate must
+	//return without waiting for the device; writes are queued.
+	class DeviceIO
+	{
+	public:
+		virtual ~DeviceIO() {}
+
+		//HID paths of all Wiimotes present, like WiimoteCollection.FindAllWiimotes.
+		virtual void enumerate(std::vector<std::string> &paths) = 0;
+
+		//Starts opening the device. The outcome is passed to
+		//ConnectionManager::postConnectResult with the same device id, which may
+		//happen before this returns. After disconnect nothing may be posted for the
+		//attempt any more; the id is reused for other devices later.
+		virtual void beginConnect(int device, const std::string &path) = 0;
+		virtual void disconnect(int device) = 0;
+
+		virtual void setReportMode(int device, DeviceReportMode mode) = 0;
+		//Bit 0 is LED 1.
+		virtual void setLEDs(int device, int leds) = 0;
+		virtual void setRumble(int device, bool on) = 0;
+		virtual void requestStatus(int device) = 0;
+	};
+
+	class ConnectionListener
+	{
+	public:
+		virtual ~ConnectionListener() {}
+
+		//Same arguments as the OnConnect and OnDisconnect events of the provider,
+		//count is the number of connected devices after the change.
+		virtual void onConnect(int slot, int count) = 0;
+		virtual void onDisconnect(int slot, int count) = 0;
+	};
+
+	//Defaults are the constants of MultiWiiPointerProvider.
+	struct ConnectionSettings
+	{
+		//CONNECTION_THREAD_SLEEP
+		uint64_t EnumerateInterval;
+		//WIIMOTE_DISCONNECT_TIMEOUT, without any report.
+		uint64_t DisconnectTimeout;
+		//Settings.autoDisconnectTimeout, without significant input until power save.
+		uint64_t SignificantTimeout;
+		//WIIMOTE_POWER_SAVE_DISCONNECT_TIMEOUT, without any report in power save.
+		uint64_t PowerSaveDisconnectTimeout;
+		//POWER_SAVE_STATUS_INTERVAL
+		uint64_t StatusInterval;
+		//POWER_SAVE_BLINK_DELAY, the LEDs are lit for BlinkTime.
+		uint64_t BlinkInterval;
+		uint64_t BlinkTime;
+		//CONNECT_RUMBLE_TIME, the rumble starts after it and lasts as long.
+		uint64_t RumbleTime;
+		//New: a connect that takes longer is given up.
+		uint64_t ConnectTimeout;
+		//New: delay before retrying a failed connect, doubled per failure up to MaxRetryDelay.
+		uint64_t RetryDelay;
+		uint64_t MaxRetryDelay;
+		//New: a torn down device is not reconnected before this passed.
+		uint64_t ReconnectDelay;
+
+		ConnectionSettings();
+	};
+
+	struct ConnectionStats
+	{
+		uint64_t Enumerations;
+		uint64_t ConnectAttempts;
+		uint64_t ConnectFailures;
+		uint64_t ConnectTimeouts;
+		uint64_t Connects;
+		uint64_t Teardowns;
+		uint64_t PowerSaves;
+		uint64_t Wakes;
+	};
+
+	class ConnectionManager
+	{
+	public:
+		ConnectionManager(DeviceIO &io, ConnectionListener &listener, const ConnectionSettings &settings);
+
+		//Enumerates at once and then every EnumerateInterval.
+		void start(uint64_t now);
+		//Tears every connected device down, like teardownWiimoteConnections.
+		void stop(uint64_t now);
+
+		//Handles posted results and activity and fires due timers. Call it at
+		//least every few tens of milliseconds, timers are rounded up to 10ms.
+		void advance(uint64_t now);
+
+		//From the HID reader of a slot, for every report. significant is what
+		//WiimoteControl.handleWiimoteChanged returns; it wakes a device in power save.
+		void noteActivity(int slot, uint64_t now, bool significant)
+		{
+			if (slot < 1 || slot > MAX_CONTROLLER_SLOTS)
+				return;
+
+			SlotActivity &activity = activities[slot - 1];
+			activity.LastEvent.store(now, std::memory_order_relaxed);
+			if (significant)
+			{
+				activity.LastSignificant.store(now, std::memory_order_relaxed);
+				if (activity.InPowerSave.load(std::memory_order_relaxed))
+					wakeRequests.fetch_or(1u << (slot - 1), std::memory_order_release);
+			}
+		}
+
+		//From the device I/O, once per beginConnect. Ignored unless the device is
+		//still Connecting when advance() gets to it.
+		void postConnectResult(int device, bool succeeded);
+
+		//-1 if the path is not known.
+		int findDevice(const std::string &path) const;
+		const std::string &getPath(int device) const { return devices[device].Path; }
+		ConnectionState getState(int device) const { return devices[device].State; }
+		//0 if the device has no slot.
+		int getSlot(int device) const { return devices[device].Slot; }
+		int getDeviceCount() const { return (int)devices.size(); }
+		int getConnectedCount() const { return connected; }
+		const ConnectionStats &getStats() const { return stats; }
+
+	private:
+		enum class TimerKind
+		{
+			Enumerate,
+			//Connect timeout, activity check, retry or reconnect delay, depending on the state.
+			State,
+			Status,
+			Blink,
+			Rumble
+		};
+
+		struct Device
+		{
+			std::string Path;
+			ConnectionState State;
+			int Slot;
+			bool Present;
+			int Failures;
+			//False once the device was forgotten and its id is free.
+			bool Used;
+			bool LEDsLit;
+			bool Rumbling;
+			TimerWheel::Handle StateTimer;
+			TimerWheel::Handle StatusTimer;
+			TimerWheel::Handle BlinkTimer;
+			TimerWheel::Handle RumbleTimer;
+		};
+
+		//Written by the reader threads, read by the manager.
+		struct SlotActivity
+		{
+			std::atomic<uint64_t> LastEvent;
+			std::atomic<uint64_t> LastSignificant;
+			std::atomic<bool> InPowerSave;
+		};
+
+		struct ConnectResult
+		{
+			int Device;
+			bool Succeeded;
+		};
+
+		static void onTimer(void *context, uint64_t data);
+		TimerWheel::Handle schedule(uint64_t deadline, TimerKind kind, int device);
+		void cancelTimers(Device &device);
+
+		void enumerate();
+		void beginConnect(int index);
+		void onConnectResult(int index, bool succeeded);
+		void retryLater(int index);
+		void activate(int index);
+		void checkActivity(int index);
+		void putToPowerSave(int index);
+		void wakeFromPowerSave(int index);
+		void teardown(int index);
+		void forget(int index);
+		void onRumbleTimer(int index);
+		void onBlinkTimer(int index);
+		void setSlotLEDs(int index);
+		int getFirstFreeSlot() const;
+		int allocateDevice(const std::string &path);
+
+		DeviceIO &io;
+		ConnectionListener &listener;
+		ConnectionSettings settings;
+		TimerWheel wheel;
+		bool running;
+		//Time of the current advance(), start() or stop().
+		uint64_t time;
+		TimerWheel::Handle enumerateTimer;
+
+		std::vector<Device> devices;
+		std::vector<int> freeDevices;
+		std::unordered_map<std::string, int> byPath;
+		//Device index per slot, -1 if free.
+		int slots[MAX_CONTROLLER_SLOTS];
+		int connected;
+		std::vector<std::string> paths;
+
+		SlotActivity activities[MAX_CONTROLLER_SLOTS];
+		std::atomic<uint32_t> wakeRequests;
+
+		std::mutex resultMutex;
+		std::vector<ConnectResult> results;
+		std::vector<ConnectResult> takenResults;
+		std::atomic<bool> resultsPending;
+
+		ConnectionStats stats;
+	};
+
+}
@@ -0,0 +1,178 @@
+// HidRegistry.cpp
+
+#include "HidRegistry.h"
+
+#include <algorithm>
+
+namespace TouchmoteCore {
+
+	static uint32_t getIdKey(uint16_t vendorId, uint16_t productId)
+	{
+		return ((uint32_t)vendorId << 16) | productId;
+	}
+
+	HidRegistry::HidRegistry(HidBackend &backend)
+		: backend(backend), listener(NULL), scanned(false), generation(0)
+	{
+	}
+
+	int HidRegistry::update()
+	{
+		if (!scanned)
+			return rescan();
+
+		changes.clear();
+		if (!backend.pollChanges(changes))
+			return rescan();
+
+		int count = 0;
+		for (size_t c = 0; c < changes.size(); c++)
+		{
+			const HidChange &change = changes[c];
+			if (change.Added)
+			{
+				//Device nodes get reused, a path that is added again may be another device.
+				if (remove(change.Path))
+					count++;
+				if (add(change.Path))
+					count++;
+			}
+			else if (remove(change.Path))
+			{
+				count++;
+			}
+		}
+		return count;
+	}
+
+	int HidRegistry::rescan()
+	{
+		scanned = true;
+		//The scan covers everything that happened so far.
+		changes.clear();
+		backend.pollChanges(changes);
+
+		paths.clear();
+		if (!backend.enumerate(paths))
+			return 0;
+
+		present.assign(devices.size(), 0);
+		for (size_t p = 0; p < paths.size(); p++)
+		{
+			std::unordered_map<std::string, int>::const_iterator found = byPath.find(paths[p]);
+			if (found != byPath.end())
+				present[found->second] = 1;
+		}
+
+		int count = 0;
+		for (size_t d = 0; d < present.size(); d++)
+		{
+			if (!present[d] && !devices[d].Path.empty())
+			{
+				std::string path = devices[d].Path;
+				if (remove(path))
+					count++;
+			}
+		}
+		for (size_t p = 0; p < paths.size(); p++)
+		{
+			if (byPath.find(paths[p]) == byPath.end() && add(paths[p]))
+				count++;
+		}
+		return count;
+	}
+
+	bool HidRegistry::add(const std::string &path)
+	{
+		HidDeviceInfo info = HidDeviceInfo();
+		if (!backend.readInfo(path, info))
+			return false;
+		info.Path = path;
+
+		int index;
+		if (!freeDevices.empty())
+		{
+			index = freeDevices.back();
+			freeDevices.pop_back();
+			devices[index] = info;
+		}
+		else
+		{
+			index = (int)devices.size();
+			devices.push_back(info);
+		}
+
+		byPath[path] = index;
+		byId[getIdKey(info.VendorId, info.ProductId)].push_back(index);
+		byVendor[info.VendorId].push_back(index);
+		generation++;
+
+		if (listener != NULL)
+			listener->onAdded(devices[index]);
+		return true;
+	}
+
+	bool HidRegistry::remove(const std::string &path)
+	{
+		std::unordered_map<std::string, int>::iterator found = byPath.find(path);
+		if (found == byPath.end())
+			return false;
+
+		int index = found->second;
+		HidDeviceInfo &info = devices[index];
+		if (listener != NULL)
+			listener->onRemoved(info);
+
+		eraseFromBucket(byId, getIdKey(info.VendorId, info.ProductId), index);
+		eraseFromBucket(byVendor, info.VendorId, index);
+		byPath.erase(found);
+		info = HidDeviceInfo();
+		freeDevices.push_back(index);
+		generation++;
+		return true;
+	}
+
+	void HidRegistry::eraseFromBucket(std::unordered_map<uint32_t, std::vector<int> > &index, uint32_t key, int device)
+	{
+		std::unordered_map<uint32_t, std::vector<int> >::iterator bucket = index.find(key);
+		if (bucket == index.end())
+			return;
+
+		std::vector<int> &list = bucket->second;
+		list.erase(std::remove(list.begin(), list.end(), device), list.end());
+		if (list.empty())
+			index.erase(bucket);
+	}
+
+	void HidRegistry::appendBucket(const std::unordered_map<uint32_t, std::vector<int> > &index, uint32_t key, std::vector<const HidDeviceInfo *> &found) const
+	{
+		std::unordered_map<uint32_t, std::vector<int> >::const_iterator bucket = index.find(key);
+		if (bucket == index.end())
+			return;
+
+		for (size_t i = 0; i < bucket->second.size(); i++)
+			found.push_back(&devices[bucket->second[i]]);
+	}
+
+	const HidDeviceInfo *HidRegistry::find(const std::string &path) const
+	{
+		std::unordered_map<std::string, int>::const_iterator found = byPath.find(path);
+		return found != byPath.end() ? &devices[found->second] : NULL;
+	}
+
+	void HidRegistry::find(uint16_t vendorId, const uint16_t *productIds, int productCount, std::vector<const HidDeviceInfo *> &found) const
+	{
+		for (int p = 0; p < productCount; p++)
+		{
+			//Enumerate matches a device once even if its product id is listed twice.
+			if (std::find(productIds, productIds + p, productIds[p]) == productIds + p)
+				appendBucket(byId, getIdKey(vendorId, productIds[p]), found);
+		}
+	}
+
+	void HidRegistry::findVendor(uint16_t vendorId, std::vector<const HidDeviceInfo *> &found) const
+	{
+		appendBucket(byVendor, vendorId, found);
+	}
+
+}
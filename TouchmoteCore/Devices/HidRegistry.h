@@ -0,0 +1,112 @@
+// HidRegistry.h
+//
+// Cache of the HID devices on the system, instead of HidLibrary's
+// HidDevices.Enumerate(vendorId, productIds), which walks the whole SetupDi list
+// and opens every HID device to read its attributes, on every connector tick.
+//
+// The registry scans once and then only follows the changes the HidBackend
+// reports from its hotplug notifications; attributes are read once per device
+// when it appears. Lookups by path and by vendor and product id are hash table
+// lookups. If the backend has no notifications, or lost some, update() lists
+// the device paths again and still only reads the attributes of new ones.
+//
+// Not thread safe, update() and the lookups are called from one thread. The
+// pointers lookups return are valid until the next update() or rescan().
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace TouchmoteCore {
+
+	//What HidDevice offers without opening the device for reports.
+	struct HidDeviceInfo
+	{
+		std::string Path;
+		std::string Description;
+		uint16_t VendorId;
+		uint16_t ProductId;
+		uint16_t Version;
+	};
+
+	struct HidChange
+	{
+		bool Added;
+		std::string Path;
+	};
+
+	class HidBackend
+	{
+	public:
+		virtual ~HidBackend() {}
+
+		//Paths of all present HID devices. Returns false on failure.
+		virtual bool enumerate(std::vector<std::string> &paths) = 0;
+		//Attributes of one device, the expensive part. Returns false if it is gone or cannot be read.
+		virtual bool readInfo(const std::string &path, HidDeviceInfo &info) = 0;
+		//Appends the changes since the last call without waiting. Returns false if
+		//the backend has no notifications or dropped some, the registry rescans then.
+		virtual bool pollChanges(std::vector<HidChange> &changes) = 0;
+	};
+
+	class HidRegistryListener
+	{
+	public:
+		virtual ~HidRegistryListener() {}
+
+		virtual void onAdded(const HidDeviceInfo &device) = 0;
+		//device is still valid during the call.
+		virtual void onRemoved(const HidDeviceInfo &device) = 0;
+	};
+
+	class HidRegistry
+	{
+	public:
+		explicit HidRegistry(HidBackend &backend);
+
+		void setListener(HidRegistryListener *listener) { this->listener = listener; }
+
+		//Applies pending changes, scanning on the first call. Returns the number of
+		//devices added or removed.
+		int update();
+		//Lists all paths again and reconciles the cache with them.
+		int rescan();
+
+		//Bumped on every change, so callers can skip work when nothing changed.
+		uint64_t getGeneration() const { return generation; }
+		size_t size() const { return byPath.size(); }
+
+		//NULL if there is no such device.
+		const HidDeviceInfo *find(const std::string &path) const;
+		//Like Enumerate(vendorId, productIds), appends to found.
+		void find(uint16_t vendorId, const uint16_t *productIds, int productCount, std::vector<const HidDeviceInfo *> &found) const;
+		void findVendor(uint16_t vendorId, std::vector<const HidDeviceInfo *> &found) const;
+
+	private:
+		bool add(const std::string &path);
+		bool remove(const std::string &path);
+		void appendBucket(const std::unordered_map<uint32_t, std::vector<int> > &index, uint32_t key, std::vector<const HidDeviceInfo *> &found) const;
+		static void eraseFromBucket(std::unordered_map<uint32_t, std::vector<int> > &index, uint32_t key, int device);
+
+		HidBackend &backend;
+		HidRegistryListener *listener;
+		bool scanned;
+		uint64_t generation;
+
+		std::vector<HidDeviceInfo> devices;
+		std::vector<int> freeDevices;
+		std::unordered_map<std::string, int> byPath;
+		//Keyed by vendor << 16 | product, and by vendor.
+		std::unordered_map<uint32_t, std::vector<int> > byId;
+		std::unordered_map<uint32_t, std::vector<int> > byVendor;
+
+		//Scratch for update() and rescan().
+		std::vector<HidChange> changes;
+		std::vector<std::string> paths;
+		std::vector<char> present;
+	};
+
+}
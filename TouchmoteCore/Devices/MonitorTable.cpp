@@ -0,0 +1,45 @@
+// MonitorTable.cpp
+
+#include "MonitorTable.h"
+
+#include <algorithm>
+
+namespace TouchmoteCore {
+
+	//The map in enumerateMonitors was keyed by int.
+	static bool compareTargetId(const DisplayPath &a, const DisplayPath &b)
+	{
+		return (int32_t)a.TargetId < (int32_t)b.TargetId;
+	}
+
+	void enumerateMonitors(DisplayConfigProvider &provider, std::vector<DisplayPath> &paths, std::vector<MonitorEntry> &monitors)
+	{
+		paths.clear();
+		monitors.clear();
+		if (!provider.queryPaths(paths))
+			return;
+
+		//display paths lists relationships between virtual desktop (source) -> physical monitors (target)
+		//we will base the list on physical monitor ids
+		paths.erase(std::remove_if(paths.begin(), paths.end(), [](const DisplayPath &path) { return !path.Active; }), paths.end());
+		std::stable_sort(paths.begin(), paths.end(), compareTargetId);
+
+		for (size_t i = 0; i < paths.size(); i++)
+		{
+			//Later paths to the same monitor overwrite earlier ones.
+			if (i + 1 < paths.size() && paths[i + 1].TargetId == paths[i].TargetId)
+				continue;
+
+			const DisplayPath &path = paths[i];
+			monitors.push_back(MonitorEntry());
+			MonitorEntry &entry = monitors.back();
+			entry.TargetId = path.TargetId;
+			entry.DeviceName = provider.getGDIDeviceName(path.SourceAdapter, path.SourceId);
+			entry.DevicePath = provider.getMonitorDevicePath(path.TargetAdapter, path.TargetId);
+			entry.FriendlyName = provider.getFriendlyName(path.TargetAdapter, path.TargetId);
+			entry.Bounds = path.SourceBounds;
+			entry.Dpi = provider.getDpi(path.SourceBounds);
+		}
+	}
+
+}
@@ -0,0 +1,83 @@
+// MonitorTable.h
+//
+// Monitor table construction from WiiCPP's Monitors::enumerateMonitors. The
+// QueryDisplayConfig/DisplayConfigGetDeviceInfo calls are behind
+// DisplayConfigProvider, so the table can be built from a fake display layout.
+// Besides the names, every monitor has its place on the desktop and its DPI,
+// which the cursor overlay needs to render on each monitor by itself.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace TouchmoteCore {
+
+	//Same layout as a Win32 LUID.
+	struct DisplayAdapterId
+	{
+		uint32_t LowPart;
+		int32_t HighPart;
+	};
+
+	//Same layout as a Win32 RECT, in desktop pixels.
+	struct DesktopRect
+	{
+		int32_t Left;
+		int32_t Top;
+		int32_t Right;
+		int32_t Bottom;
+	};
+
+	//Effective DPI of a monitor at 100% scaling.
+	static const uint32_t DEFAULT_MONITOR_DPI = 96;
+
+	//The parts of DISPLAYCONFIG_PATH_INFO the table needs.
+	struct DisplayPath
+	{
+		DisplayAdapterId SourceAdapter;
+		uint32_t SourceId;
+		DisplayAdapterId TargetAdapter;
+		uint32_t TargetId;
+		bool Active;
+		//Position and size of the source mode on the desktop, empty if the path
+		//has no source mode.
+		DesktopRect SourceBounds;
+	};
+
+	class DisplayConfigProvider
+	{
+	public:
+		virtual ~DisplayConfigProvider() {}
+
+		//All paths, like QueryDisplayConfig(QDC_ALL_PATHS). Returns false on failure.
+		virtual bool queryPaths(std::vector<DisplayPath> &paths) = 0;
+
+		//GDI device name of a source, e.g. \\.\DISPLAY4.
+		virtual std::wstring getGDIDeviceName(const DisplayAdapterId &adapter, uint32_t sourceId) = 0;
+		//Device path of a target, e.g. \\?\DISPLAY#SAM0304#...
+		virtual std::wstring getMonitorDevicePath(const DisplayAdapterId &adapter, uint32_t targetId) = 0;
+		//Friendly name of a target, e.g. "SyncMaster".
+		virtual std::wstring getFriendlyName(const DisplayAdapterId &adapter, uint32_t targetId) = 0;
+		//Effective DPI of the monitor showing bounds, what GetDpiForMonitor gives.
+		virtual uint32_t getDpi(const DesktopRect &) { return DEFAULT_MONITOR_DPI; }
+	};
+
+	struct MonitorEntry
+	{
+		uint32_t TargetId;
+		std::wstring DevicePath;
+		std::wstring DeviceName;
+		std::wstring FriendlyName;
+		DesktopRect Bounds;
+		uint32_t Dpi;
+	};
+
+	//One entry per physical monitor of an active path, ordered by target id. When
+	//several active paths lead to the same monitor the last one wins, as it did
+	//with the std::map in enumerateMonitors. Names are only queried for the paths
+	//that end up in the table. Reuses the capacity of the given vectors.
+	void enumerateMonitors(DisplayConfigProvider &provider, std::vector<DisplayPath> &paths, std::vector<MonitorEntry> &monitors);
+
+}
@@ -0,0 +1,171 @@
+// SysfsHidBackend.cpp
+
+#include "SysfsHidBackend.h"
+
+#if defined(__linux__)
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+namespace TouchmoteCore {
+
+	static const char *DEVICE_DIRECTORY = "/dev/";
+
+	SysfsHidBackend::SysfsHidBackend(const std::string &root, bool hotplug)
+		: classPath(root + "/class/hidraw"), socket(-1)
+	{
+		if (!hotplug)
+			return;
+
+		socket = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+		if (socket == -1)
+			return;
+
+		//Group 1 gets the kernel's events.
+		struct sockaddr_nl address;
+		memset(&address, 0, sizeof(address));
+		address.nl_family = AF_NETLINK;
+		address.nl_groups = 1;
+		if (bind(socket, (struct sockaddr *)&address, sizeof(address)) != 0)
+		{
+			close(socket);
+			socket = -1;
+		}
+	}
+
+	SysfsHidBackend::~SysfsHidBackend()
+	{
+		if (socket != -1)
+			close(socket);
+	}
+
+	bool SysfsHidBackend::enumerate(std::vector<std::string> &paths)
+	{
+		DIR *directory = opendir(classPath.c_str());
+		if (directory == NULL)
+			return false;
+
+		struct dirent *entry;
+		while ((entry = readdir(directory)) != NULL)
+		{
+			if (strncmp(entry->d_name, "hidraw", 6) == 0)
+				paths.push_back(DEVICE_DIRECTORY + std::string(entry->d_name));
+		}
+		closedir(directory);
+		return true;
+	}
+
+	bool SysfsHidBackend::readInfo(const std::string &path, HidDeviceInfo &info)
+	{
+		size_t slash = path.rfind('/');
+		std::string file = classPath + "/" + path.substr(slash == std::string::npos ? 0 : slash + 1) + "/device/uevent";
+
+		int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd == -1)
+			return false;
+
+		char text[4096];
+		ssize_t length = read(fd, text, sizeof(text) - 1);
+		close(fd);
+		if (length <= 0)
+			return false;
+
+		text[length] = 0;
+		return parseHidUevent(text, (size_t)length, info);
+	}
+
+	bool SysfsHidBackend::pollChanges(std::vector<HidChange> &changes)
+	{
+		if (socket == -1)
+			return false;
+
+		char message[8192];
+		while (true)
+		{
+			ssize_t length = recv(socket, message, sizeof(message) - 1, 0);
+			if (length < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				//Anything but an empty queue, ENOBUFS included, means events were lost.
+				return errno == EAGAIN || errno == EWOULDBLOCK;
+			}
+			message[length] = 0;
+
+			//"action@devpath" followed by KEY=value strings, all zero terminated.
+			const char *action = NULL;
+			const char *subsystem = NULL;
+			const char *name = NULL;
+			for (const char *field = message; field < message + length; field += strlen(field) + 1)
+			{
+				if (strncmp(field, "ACTION=", 7) == 0)
+					action = field + 7;
+				else if (strncmp(field, "SUBSYSTEM=", 10) == 0)
+					subsystem = field + 10;
+				else if (strncmp(field, "DEVNAME=", 8) == 0)
+					name = field + 8;
+			}
+			if (action == NULL || subsystem == NULL || name == NULL || strcmp(subsystem, "hidraw") != 0)
+				continue;
+
+			bool added = strcmp(action, "add") == 0;
+			if (!added && strcmp(action, "remove") != 0)
+				continue;
+
+			//DEVNAME is relative to /dev.
+			const char *slash = strrchr(name, '/');
+			HidChange change;
+			change.Added = added;
+			change.Path = DEVICE_DIRECTORY + std::string(slash != NULL ? slash + 1 : name);
+			changes.push_back(change);
+		}
+	}
+
+	bool parseHidUevent(const char *text, size_t length, HidDeviceInfo &info)
+	{
+		bool found = false;
+		const char *end = text + length;
+		const char *line = text;
+		while (line < end)
+		{
+			const char *lineEnd = (const char *)memchr(line, '\n', end - line);
+			if (lineEnd == NULL)
+				lineEnd = end;
+
+			if (lineEnd - line > 7 && strncmp(line, "HID_ID=", 7) == 0)
+			{
+				//bus:vendor:product, in hex.
+				char *next;
+				strtoul(line + 7, &next, 16);
+				if (*next == ':')
+				{
+					unsigned long vendor = strtoul(next + 1, &next, 16);
+					if (*next == ':')
+					{
+						unsigned long product = strtoul(next + 1, &next, 16);
+						info.VendorId = (uint16_t)vendor;
+						info.ProductId = (uint16_t)product;
+						found = true;
+					}
+				}
+			}
+			else if (lineEnd - line > 9 && strncmp(line, "HID_NAME=", 9) == 0)
+			{
+				info.Description.assign(line + 9, lineEnd);
+			}
+			line = lineEnd + 1;
+		}
+		//Not in the uevent file.
+		info.Version = 0;
+		return found;
+	}
+
+}
+
+#endif
@@ -0,0 +1,48 @@
+// SysfsHidBackend.h
+//
+// HidBackend for Linux. Devices are the hidraw nodes under <root>/class/hidraw,
+// attributes come from the uevent file of the HID device behind each node
+// (HID_ID and HID_NAME), so nothing has to be opened. Hotplug notifications
+// are read from a kernel uevent netlink socket, the same source udev listens
+// to. root is normally /sys; pointing it at a copy of the tree gives a fake
+// device list.
+
+#pragma once
+
+#if defined(__linux__)
+
+#include <string>
+#include <vector>
+
+#include "HidRegistry.h"
+
+namespace TouchmoteCore {
+
+	class SysfsHidBackend : public HidBackend
+	{
+	public:
+		//Without hotplug, or if the socket cannot be opened, pollChanges always
+		//returns false and the registry rescans.
+		SysfsHidBackend(const std::string &root, bool hotplug);
+		~SysfsHidBackend();
+
+		bool hasHotplug() const { return socket != -1; }
+
+		virtual bool enumerate(std::vector<std::string> &paths);
+		virtual bool readInfo(const std::string &path, HidDeviceInfo &info);
+		virtual bool pollChanges(std::vector<HidChange> &changes);
+
+	private:
+		SysfsHidBackend(const SysfsHidBackend &);
+		SysfsHidBackend &operator=(const SysfsHidBackend &);
+
+		std::string classPath;
+		int socket;
+	};
+
+	//Parses a HID uevent file, text is zero terminated. Returns false if HID_ID is missing.
+	bool parseHidUevent(const char *text, size_t length, HidDeviceInfo &info);
+
+}
+
+#endif
@@ -0,0 +1,132 @@
+// Win32DisplayConfig.cpp
+
+#include "Win32DisplayConfig.h"
+
+#if defined(_WIN32)
+
+#include <windows.h>
+
+namespace TouchmoteCore {
+
+	static DisplayAdapterId toAdapterId(const LUID &luid)
+	{
+		DisplayAdapterId adapter = { luid.LowPart, luid.HighPart };
+		return adapter;
+	}
+
+	static LUID toLUID(const DisplayAdapterId &adapter)
+	{
+		LUID luid;
+		luid.LowPart = adapter.LowPart;
+		luid.HighPart = adapter.HighPart;
+		return luid;
+	}
+
+	static void getTargetName(const DisplayAdapterId &adapter, uint32_t targetId, DISPLAYCONFIG_TARGET_DEVICE_NAME &deviceName)
+	{
+		ZeroMemory(&deviceName, sizeof(deviceName));
+		deviceName.header.size = sizeof(DISPLAYCONFIG_TARGET_DEVICE_NAME);
+		deviceName.header.adapterId = toLUID(adapter);
+		deviceName.header.id = targetId;
+		deviceName.header.type = DISPLAYCONFIG_DEVICE_INFO_GET_TARGET_NAME;
+		DisplayConfigGetDeviceInfo(&deviceName.header);
+	}
+
+	bool Win32DisplayConfigProvider::queryPaths(std::vector<DisplayPath> &paths)
+	{
+		UINT32 num_of_paths = 0;
+		UINT32 num_of_modes = 0;
+		if (GetDisplayConfigBufferSizes(QDC_ALL_PATHS, &num_of_paths, &num_of_modes) != ERROR_SUCCESS)
+		{
+			return false;
+		}
+
+		std::vector<DISPLAYCONFIG_PATH_INFO> displayPaths(num_of_paths);
+		std::vector<DISPLAYCONFIG_MODE_INFO> displayModes(num_of_modes);
+		if (num_of_paths == 0 || QueryDisplayConfig(QDC_ALL_PATHS, &num_of_paths, &displayPaths[0], &num_of_modes, num_of_modes > 0 ? &displayModes[0] : NULL, NULL) != ERROR_SUCCESS)
+		{
+			return false;
+		}
+
+		for (UINT32 i = 0; i < num_of_paths; i++)
+		{
+			DisplayPath path;
+			path.SourceAdapter = toAdapterId(displayPaths[i].sourceInfo.adapterId);
+			path.SourceId = displayPaths[i].sourceInfo.id;
+			path.TargetAdapter = toAdapterId(displayPaths[i].targetInfo.adapterId);
+			path.TargetId = displayPaths[i].targetInfo.id;
+			path.Active = (displayPaths[i].flags & DISPLAYCONFIG_PATH_ACTIVE) != 0;
+
+			DesktopRect bounds = { 0, 0, 0, 0 };
+			UINT32 mode = displayPaths[i].sourceInfo.modeInfoIdx;
+			if (mode != DISPLAYCONFIG_PATH_MODE_IDX_INVALID && mode < num_of_modes && displayModes[mode].infoType == DISPLAYCONFIG_MODE_INFO_TYPE_SOURCE)
+			{
+				const DISPLAYCONFIG_SOURCE_MODE &source = displayModes[mode].sourceMode;
+				bounds.Left = source.position.x;
+				bounds.Top = source.position.y;
+				bounds.Right = source.position.x + (int32_t)source.width;
+				bounds.Bottom = source.position.y + (int32_t)source.height;
+			}
+			path.SourceBounds = bounds;
+			paths.push_back(path);
+		}
+		return true;
+	}
+
+	std::wstring Win32DisplayConfigProvider::getGDIDeviceName(const DisplayAdapterId &adapter, uint32_t sourceId)
+	{
+		DISPLAYCONFIG_SOURCE_DEVICE_NAME deviceName;
+		ZeroMemory(&deviceName, sizeof(deviceName));
+		deviceName.header.size = sizeof(DISPLAYCONFIG_SOURCE_DEVICE_NAME);
+		deviceName.header.adapterId = toLUID(adapter);
+		deviceName.header.id = sourceId;
+		deviceName.header.type = DISPLAYCONFIG_DEVICE_INFO_GET_SOURCE_NAME;
+		DisplayConfigGetDeviceInfo(&deviceName.header);
+		return deviceName.viewGdiDeviceName;
+	}
+
+	std::wstring Win32DisplayConfigProvider::getMonitorDevicePath(const DisplayAdapterId &adapter, uint32_t targetId)
+	{
+		DISPLAYCONFIG_TARGET_DEVICE_NAME deviceName;
+		getTargetName(adapter, targetId, deviceName);
+		return deviceName.monitorDevicePath;
+	}
+
+	std::wstring Win32DisplayConfigProvider::getFriendlyName(const DisplayAdapterId &adapter, uint32_t targetId)
+	{
+		DISPLAYCONFIG_TARGET_DEVICE_NAME deviceName;
+		getTargetName(adapter, targetId, deviceName);
+		return deviceName.monitorFriendlyDeviceName;
+	}
+
+	//HRESULT GetDpiForMonitor(HMONITOR, MONITOR_DPI_TYPE, UINT *, UINT *)
+	typedef HRESULT (WINAPI *GetDpiForMonitorFunction)(HMONITOR, int, UINT *, UINT *);
+	//MDT_EFFECTIVE_DPI
+	static const int EFFECTIVE_DPI = 0;
+
+	uint32_t Win32DisplayConfigProvider::getDpi(const DesktopRect &bounds)
+	{
+		static GetDpiForMonitorFunction getDpiForMonitor = NULL;
+		static bool loaded = false;
+		if (!loaded)
+		{
+			HMODULE shcore = LoadLibraryW(L"Shcore.dll");
+			if (shcore != NULL)
+				getDpiForMonitor = (GetDpiForMonitorFunction)GetProcAddress(shcore, "GetDpiForMonitor");
+			loaded = true;
+		}
+		if (getDpiForMonitor == NULL || bounds.Right <= bounds.Left)
+			return DEFAULT_MONITOR_DPI;
+
+		RECT rect = { bounds.Left, bounds.Top, bounds.Right, bounds.Bottom };
+		HMONITOR monitor = MonitorFromRect(&rect, MONITOR_DEFAULTTONULL);
+		UINT dpiX = 0;
+		UINT dpiY = 0;
+		if (monitor == NULL || FAILED(getDpiForMonitor(monitor, EFFECTIVE_DPI, &dpiX, &dpiY)) || dpiX == 0)
+			return DEFAULT_MONITOR_DPI;
+		return dpiX;
+	}
+
+}
+
+#endif
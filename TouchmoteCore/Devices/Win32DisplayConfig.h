@@ -0,0 +1,28 @@
+// Win32DisplayConfig.h
+//
+// DisplayConfigProvider on QueryDisplayConfig and DisplayConfigGetDeviceInfo,
+// shared by WiiCPP's Monitors::enumerateMonitors and the D3DCursor overlay.
+// The DPI comes from GetDpiForMonitor when Shcore.dll has it, Windows 8.1 and
+// later, and is DEFAULT_MONITOR_DPI before that.
+
+#pragma once
+
+#if defined(_WIN32)
+
+#include "MonitorTable.h"
+
+namespace TouchmoteCore {
+
+	class Win32DisplayConfigProvider : public DisplayConfigProvider
+	{
+	public:
+		virtual bool queryPaths(std::vector<DisplayPath> &paths);
+		virtual std::wstring getGDIDeviceName(const DisplayAdapterId &adapter, uint32_t sourceId);
+		virtual std::wstring getMonitorDevicePath(const DisplayAdapterId &adapter, uint32_t targetId);
+		virtual std::wstring getFriendlyName(const DisplayAdapterId &adapter, uint32_t targetId);
+		virtual uint32_t getDpi(const DesktopRect &bounds);
+	};
+
+}
+
+#endif
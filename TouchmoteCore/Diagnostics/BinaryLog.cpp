@@ -0,0 +1,175 @@
+// BinaryLog.cpp
+
+#include "BinaryLog.h"
+
+#include <string.h>
+
+namespace TouchmoteCore {
+
+	static const char MAGIC[5] = { 'T', 'M', 'L', 'O', 'G' };
+	static const uint8_t VERSION = 1;
+	static const uint8_t FORMAT_TAG = 'F';
+	static const uint8_t RECORD_TAG = 'R';
+	//Longest string written, file names and formats included.
+	static const size_t MAX_STRING = 0xffff;
+
+	static void writeNumber(FILE *file, uint64_t value, int bytes)
+	{
+		uint8_t buffer[8];
+		for (int b = 0; b < bytes; b++)
+			buffer[b] = (uint8_t)(value >> (8 * b));
+		fwrite(buffer, 1, bytes, file);
+	}
+
+	static void writeString(FILE *file, const char *text)
+	{
+		size_t length = strlen(text);
+		if (length > MAX_STRING)
+			length = MAX_STRING;
+		writeNumber(file, length, 2);
+		fwrite(text, 1, length, file);
+	}
+
+	static bool readNumber(FILE *file, uint64_t &value, int bytes)
+	{
+		uint8_t buffer[8];
+		if (fread(buffer, 1, bytes, file) != (size_t)bytes)
+			return false;
+		value = 0;
+		for (int b = 0; b < bytes; b++)
+			value |= (uint64_t)buffer[b] << (8 * b);
+		return true;
+	}
+
+	BinaryLogSink::BinaryLogSink(FILE *file)
+		: file(file)
+	{
+		fwrite(MAGIC, 1, sizeof(MAGIC), file);
+		writeNumber(file, VERSION, 1);
+	}
+
+	uint32_t BinaryLogSink::getFormatNumber(const LogFormat *format)
+	{
+		std::map<const LogFormat *, uint32_t>::iterator found = formats.find(format);
+		if (found != formats.end())
+			return found->second;
+
+		uint32_t number = (uint32_t)formats.size();
+		formats[format] = number;
+		writeNumber(file, FORMAT_TAG, 1);
+		writeNumber(file, number, 4);
+		writeNumber(file, (uint64_t)format->Level, 1);
+		writeNumber(file, (uint32_t)format->Line, 4);
+		writeString(file, format->File);
+		writeString(file, format->Format);
+		return number;
+	}
+
+	void BinaryLogSink::write(const LogRecord *records, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			const LogRecord &record = records[i];
+			uint32_t format = getFormatNumber(record.Format);
+			writeNumber(file, RECORD_TAG, 1);
+			writeNumber(file, format, 4);
+			writeNumber(file, record.Timestamp, 8);
+			writeNumber(file, record.Thread, 2);
+			writeNumber(file, record.Count, 1);
+			for (int a = 0; a < record.Count; a++)
+			{
+				writeNumber(file, (uint64_t)record.Types[a], 1);
+				if (record.Types[a] == LogArgumentType::String)
+					writeString(file, record.Arguments[a].String);
+				else
+					writeNumber(file, record.Arguments[a].Unsigned, 8);
+			}
+		}
+	}
+
+	BinaryLogReader::BinaryLogReader(FILE *file)
+		: file(file), valid(false)
+	{
+		char magic[sizeof(MAGIC)];
+		uint64_t version;
+		valid = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, MAGIC, sizeof(MAGIC)) == 0
+			&& readNumber(file, version, 1) && version == VERSION;
+	}
+
+	bool BinaryLogReader::readString(std::string &text)
+	{
+		uint64_t length;
+		if (!readNumber(file, length, 2))
+			return false;
+		text.resize((size_t)length);
+		return length == 0 || fread(&text[0], 1, (size_t)length, file) == length;
+	}
+
+	bool BinaryLogReader::next(DecodedLogRecord &decoded)
+	{
+		if (!valid)
+			return false;
+
+		uint64_t tag;
+		while (readNumber(file, tag, 1))
+		{
+			uint64_t number;
+			if (tag == FORMAT_TAG)
+			{
+				Format format;
+				uint64_t level;
+				uint64_t line;
+				if (!readNumber(file, number, 4) || number != formats.size() || !readNumber(file, level, 1) || !readNumber(file, line, 4)
+					|| !readString(format.File) || !readString(format.Text))
+					return false;
+				format.Level = (LogLevel)level;
+				format.Line = (int)line;
+				formats.push_back(format);
+				continue;
+			}
+			if (tag != RECORD_TAG)
+				return false;
+
+			uint64_t timestamp;
+			uint64_t thread;
+			uint64_t count;
+			if (!readNumber(file, number, 4) || number >= formats.size() || !readNumber(file, timestamp, 8)
+				|| !readNumber(file, thread, 2) || !readNumber(file, count, 1) || count > (uint64_t)LOG_MAX_ARGUMENTS)
+				return false;
+
+			LogRecord record;
+			memset(&record, 0, sizeof(record));
+			record.Count = (uint8_t)count;
+			for (int a = 0; a < record.Count; a++)
+			{
+				uint64_t type;
+				if (!readNumber(file, type, 1) || type > (uint64_t)LogArgumentType::String)
+					return false;
+				record.Types[a] = (LogArgumentType)type;
+				if (record.Types[a] == LogArgumentType::String)
+				{
+					if (!readString(strings[a]))
+						return false;
+					record.Arguments[a].String = strings[a].c_str();
+				}
+				else if (!readNumber(file, record.Arguments[a].Unsigned, 8))
+				{
+					return false;
+				}
+			}
+
+			const Format &format = formats[(size_t)number];
+			char message[1024];
+			size_t length = formatLogMessage(format.Text.c_str(), record, message, sizeof(message));
+			decoded.Level = format.Level;
+			decoded.File = format.File.c_str();
+			decoded.Line = format.Line;
+			decoded.Timestamp = timestamp;
+			decoded.Thread = (uint16_t)thread;
+			decoded.Message.assign(message, length < sizeof(message) ? length : sizeof(message) - 1);
+			return true;
+		}
+		return false;
+	}
+
+}
@@ -0,0 +1,81 @@
+// BinaryLog.h
+//
+// Log records written as they are, for formatting offline with
+// TouchmoteLogDecode. The logger thread then only copies bytes. A format is
+// written once, the first time a record uses it, and records refer to it by
+// number; string arguments are written out since their pointers mean nothing
+// in another process.
+//
+// The file starts with "TMLOG" and a version byte, then entries of a tag byte:
+//   'F' format number (4), level (1), line (4), file and format (2 + n each)
+//   'R' format number (4), timestamp (8), thread (2), argument count (1),
+//       then per argument its type (1) and 8 bytes, or 2 + n for a string
+// Numbers are little endian.
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Logger.h"
+
+namespace TouchmoteCore {
+
+	class BinaryLogSink : public LogSink
+	{
+	public:
+		//Writes the header to file, which stays open.
+		explicit BinaryLogSink(FILE *file);
+
+		virtual void write(const LogRecord *records, int count);
+		virtual void flush() { fflush(file); }
+
+	private:
+		uint32_t getFormatNumber(const LogFormat *format);
+
+		FILE *file;
+		std::map<const LogFormat *, uint32_t> formats;
+	};
+
+	struct DecodedLogRecord
+	{
+		LogLevel Level;
+		const char *File;
+		int Line;
+		uint64_t Timestamp;
+		uint16_t Thread;
+		std::string Message;
+	};
+
+	class BinaryLogReader
+	{
+	public:
+		//Checks the header. isValid() is false if it is not a binary log.
+		explicit BinaryLogReader(FILE *file);
+
+		bool isValid() const { return valid; }
+		//The next record, false at the end or if the rest is damaged.
+		bool next(DecodedLogRecord &record);
+
+	private:
+		struct Format
+		{
+			LogLevel Level;
+			int Line;
+			std::string File;
+			std::string Text;
+		};
+
+		bool readString(std::string &text);
+
+		FILE *file;
+		bool valid;
+		std::vector<Format> formats;
+		//Strings of the record being decoded, which LogRecord points into.
+		std::string strings[LOG_MAX_ARGUMENTS];
+	};
+
+}
@@ -0,0 +1,257 @@
+// Instrumentation.cpp
+
+#include "Instrumentation.h"
+
+#include <mutex>
+
+namespace TouchmoteCore {
+
+	static const int STAGE_COUNT = (int)PipelineStage::Count;
+	static const int COUNTER_COUNT = (int)InstrumentationCounter::Count;
+
+	//Histograms and counters written by a single thread. Recorders are never freed,
+	//when a thread exits its recorder is handed to the next new thread so what it
+	//recorded stays part of the snapshot.
+	struct ThreadRecorder
+	{
+		std::atomic<LatencyHistogram *> Histograms[STAGE_COUNT][INSTRUMENTATION_SLOTS];
+		std::atomic<uint64_t> Counters[COUNTER_COUNT][INSTRUMENTATION_SLOTS];
+		bool InUse;
+
+		ThreadRecorder() : InUse(true)
+		{
+			for (int s = 0; s < STAGE_COUNT; s++)
+				for (int c = 0; c < INSTRUMENTATION_SLOTS; c++)
+					Histograms[s][c].store(NULL, std::memory_order_relaxed);
+			for (int n = 0; n < COUNTER_COUNT; n++)
+				for (int c = 0; c < INSTRUMENTATION_SLOTS; c++)
+					Counters[n][c].store(0, std::memory_order_relaxed);
+		}
+	};
+
+	static std::mutex &getRegistryMutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	static std::vector<ThreadRecorder *> &getRegistry()
+	{
+		static std::vector<ThreadRecorder *> registry;
+		return registry;
+	}
+
+	struct RecorderHolder
+	{
+		ThreadRecorder *Recorder;
+
+		RecorderHolder() : Recorder(NULL) {}
+
+		~RecorderHolder()
+		{
+			if (Recorder != NULL)
+			{
+				std::lock_guard<std::mutex> lock(getRegistryMutex());
+				Recorder->InUse = false;
+			}
+		}
+	};
+
+	static thread_local RecorderHolder localRecorder;
+
+	static ThreadRecorder *acquireRecorder()
+	{
+		std::lock_guard<std::mutex> lock(getRegistryMutex());
+		std::vector<ThreadRecorder *> &registry = getRegistry();
+		for (size_t i = 0; i < registry.size(); i++)
+		{
+			if (!registry[i]->InUse)
+			{
+				registry[i]->InUse = true;
+				return registry[i];
+			}
+		}
+		ThreadRecorder *recorder = new ThreadRecorder();
+		registry.push_back(recorder);
+		return recorder;
+	}
+
+	static inline ThreadRecorder &getLocalRecorder()
+	{
+		RecorderHolder &holder = localRecorder;
+		if (holder.Recorder == NULL)
+			holder.Recorder = acquireRecorder();
+		return *holder.Recorder;
+	}
+
+	static inline int getSlot(int controller)
+	{
+		return controller >= 1 && controller <= MAX_INSTRUMENTED_CONTROLLERS ? controller : 0;
+	}
+
+	std::atomic<bool> Instrumentation::enabled(true);
+
+	const char *getCounterName(InstrumentationCounter counter)
+	{
+		switch (counter)
+		{
+		case InstrumentationCounter::ReportsReceived: return "reports";
+		case InstrumentationCounter::ReportsOverwritten: return "overwritten";
+		case InstrumentationCounter::FramesProcessed: return "frames";
+		case InstrumentationCounter::EventsEmitted: return "events";
+		default: return "unknown";
+		}
+	}
+
+	void Instrumentation::record(PipelineStage stage, int controller, uint64_t ns)
+	{
+		if (!isEnabled())
+			return;
+
+		std::atomic<LatencyHistogram *> &slot = getLocalRecorder().Histograms[(int)stage][getSlot(controller)];
+		LatencyHistogram *histogram = slot.load(std::memory_order_relaxed);
+		if (histogram == NULL)
+		{
+			//First sample for this stage and controller on this thread.
+			histogram = new LatencyHistogram();
+			slot.store(histogram, std::memory_order_release);
+		}
+		histogram->record(ns);
+	}
+
+	void Instrumentation::increment(InstrumentationCounter counter, int controller, uint64_t amount)
+	{
+		if (!isEnabled())
+			return;
+
+		std::atomic<uint64_t> &value = getLocalRecorder().Counters[(int)counter][getSlot(controller)];
+		value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+	}
+
+	void Instrumentation::reset()
+	{
+		std::lock_guard<std::mutex> lock(getRegistryMutex());
+		std::vector<ThreadRecorder *> &registry = getRegistry();
+		for (size_t i = 0; i < registry.size(); i++)
+		{
+			for (int s = 0; s < STAGE_COUNT; s++)
+			{
+				for (int c = 0; c < INSTRUMENTATION_SLOTS; c++)
+				{
+					LatencyHistogram *histogram = registry[i]->Histograms[s][c].load(std::memory_order_acquire);
+					if (histogram != NULL)
+						histogram->reset();
+				}
+			}
+			for (int n = 0; n < COUNTER_COUNT; n++)
+				for (int c = 0; c < INSTRUMENTATION_SLOTS; c++)
+					registry[i]->Counters[n][c].store(0, std::memory_order_relaxed);
+		}
+	}
+
+	//Caller holds the registry mutex.
+	static void mergeHistogram(PipelineStage stage, int slot, HistogramSnapshot &histogram)
+	{
+		std::vector<ThreadRecorder *> &registry = getRegistry();
+		for (size_t i = 0; i < registry.size(); i++)
+		{
+			LatencyHistogram *source = registry[i]->Histograms[(int)stage][slot].load(std::memory_order_acquire);
+			if (source != NULL)
+				histogram.add(*source);
+		}
+	}
+
+	static StageSummary summarize(PipelineStage stage, int controller, const HistogramSnapshot &histogram)
+	{
+		StageSummary summary;
+		summary.Stage = stage;
+		summary.Controller = controller;
+		summary.Count = histogram.Count;
+		summary.MeanNs = histogram.getMean();
+		summary.P50Ns = histogram.getPercentile(50);
+		summary.P90Ns = histogram.getPercentile(90);
+		summary.P99Ns = histogram.getPercentile(99);
+		summary.P999Ns = histogram.getPercentile(99.9);
+		summary.MaxNs = histogram.Max;
+		return summary;
+	}
+
+	void Instrumentation::snapshot(InstrumentationSnapshot &snapshot)
+	{
+		snapshot.Stages.clear();
+		snapshot.Counters.clear();
+
+		std::lock_guard<std::mutex> lock(getRegistryMutex());
+		std::vector<ThreadRecorder *> &registry = getRegistry();
+
+		for (int s = 0; s < STAGE_COUNT; s++)
+		{
+			HistogramSnapshot total;
+			for (int c = 0; c < INSTRUMENTATION_SLOTS; c++)
+			{
+				HistogramSnapshot histogram;
+				mergeHistogram((PipelineStage)s, c, histogram);
+				if (histogram.Count == 0)
+					continue;
+				snapshot.Stages.push_back(summarize((PipelineStage)s, c, histogram));
+				total.add(histogram);
+			}
+			if (total.Count > 0)
+				snapshot.Stages.push_back(summarize((PipelineStage)s, -1, total));
+		}
+
+		for (int n = 0; n < COUNTER_COUNT; n++)
+		{
+			uint64_t total = 0;
+			for (int c = 0; c < INSTRUMENTATION_SLOTS; c++)
+			{
+				uint64_t value = 0;
+				for (size_t i = 0; i < registry.size(); i++)
+					value += registry[i]->Counters[n][c].load(std::memory_order_relaxed);
+				if (value == 0)
+					continue;
+				CounterValue entry = { (InstrumentationCounter)n, c, value };
+				snapshot.Counters.push_back(entry);
+				total += value;
+			}
+			if (total > 0)
+			{
+				CounterValue entry = { (InstrumentationCounter)n, -1, total };
+				snapshot.Counters.push_back(entry);
+			}
+		}
+	}
+
+	void Instrumentation::getHistogram(PipelineStage stage, int controller, HistogramSnapshot &histogram)
+	{
+		std::lock_guard<std::mutex> lock(getRegistryMutex());
+		if (controller >= 0)
+		{
+			mergeHistogram(stage, getSlot(controller), histogram);
+			return;
+		}
+		for (int c = 0; c < INSTRUMENTATION_SLOTS; c++)
+			mergeHistogram(stage, c, histogram);
+	}
+
+	const StageSummary *InstrumentationSnapshot::findStage(PipelineStage stage, int controller) const
+	{
+		for (size_t i = 0; i < Stages.size(); i++)
+		{
+			if (Stages[i].Stage == stage && Stages[i].Controller == controller)
+				return &Stages[i];
+		}
+		return NULL;
+	}
+
+	uint64_t InstrumentationSnapshot::getCounter(InstrumentationCounter counter, int controller) const
+	{
+		for (size_t i = 0; i < Counters.size(); i++)
+		{
+			if (Counters[i].Counter == counter && Counters[i].Controller == controller)
+				return Counters[i].Value;
+		}
+		return 0;
+	}
+
+}
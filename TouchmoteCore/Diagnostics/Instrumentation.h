@@ -0,0 +1,124 @@
+// Instrumentation.h
+//
+// Per-stage latency histograms and counters for the input pipeline, tagged by
+// controller. Every thread records into its own set of histograms, so probes
+// never take a lock or share a cache line with another writer. snapshot() can be
+// called from any thread at any time and merges the per-thread data without
+// stopping the pipeline.
+//
+// Controllers are the Wiimote ids 1..MAX_INSTRUMENTED_CONTROLLERS. Anything
+// outside that range, including work which does not belong to a single
+// controller like classification, is recorded under controller 0.
+
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <vector>
+
+#include "LatencyHistogram.h"
+#include "../Pipeline/PipelineStage.h"
+
+namespace TouchmoteCore {
+
+	static const int MAX_INSTRUMENTED_CONTROLLERS = 16;
+	static const int INSTRUMENTATION_SLOTS = MAX_INSTRUMENTED_CONTROLLERS + 1;
+
+	enum class InstrumentationCounter
+	{
+		ReportsReceived,
+		//A report replaced by a newer one before any frame processed it.
+		ReportsOverwritten,
+		FramesProcessed,
+		EventsEmitted,
+		Count
+	};
+
+	const char *getCounterName(InstrumentationCounter counter);
+
+	struct StageSummary
+	{
+		PipelineStage Stage;
+		//-1 for the sum over all controllers.
+		int Controller;
+		uint64_t Count;
+		double MeanNs;
+		uint64_t P50Ns;
+		uint64_t P90Ns;
+		uint64_t P99Ns;
+		uint64_t P999Ns;
+		uint64_t MaxNs;
+	};
+
+	struct CounterValue
+	{
+		InstrumentationCounter Counter;
+		//-1 for the sum over all controllers.
+		int Controller;
+		uint64_t Value;
+	};
+
+	struct InstrumentationSnapshot
+	{
+		//Only stages and counters that have been recorded at least once.
+		std::vector<StageSummary> Stages;
+		std::vector<CounterValue> Counters;
+
+		const StageSummary *findStage(PipelineStage stage, int controller) const;
+		uint64_t getCounter(InstrumentationCounter counter, int controller) const;
+	};
+
+	class Instrumentation
+	{
+	public:
+		static uint64_t now()
+		{
+			return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+		static void setEnabled(bool value) { enabled.store(value, std::memory_order_relaxed); }
+
+		static void record(PipelineStage stage, int controller, uint64_t ns);
+		static void increment(InstrumentationCounter counter, int controller, uint64_t amount = 1);
+
+		//Clears everything recorded so far. Probes running at the same time may
+		//survive the reset, so only use it between runs.
+		static void reset();
+
+		//Reuses the capacity of the snapshot's vectors, so polling with the same
+		//snapshot object does not allocate once it has grown.
+		static void snapshot(InstrumentationSnapshot &snapshot);
+
+		//Merged histogram of one stage, controller -1 merges all controllers.
+		static void getHistogram(PipelineStage stage, int controller, HistogramSnapshot &histogram);
+
+	private:
+		static std::atomic<bool> enabled;
+	};
+
+	//Records the time between construction and destruction.
+	class StageProbe
+	{
+	public:
+		StageProbe(PipelineStage stage, int controller)
+			: stage(stage), controller(controller), start(Instrumentation::isEnabled() ? Instrumentation::now() : 0)
+		{
+		}
+
+		~StageProbe()
+		{
+			if (start != 0)
+				Instrumentation::record(stage, controller, Instrumentation::now() - start);
+		}
+
+	private:
+		StageProbe(const StageProbe &);
+		StageProbe &operator=(const StageProbe &);
+
+		PipelineStage stage;
+		int controller;
+		uint64_t start;
+	};
+
+}
@@ -0,0 +1,80 @@
+// LatencyHistogram.cpp
+
+#include "LatencyHistogram.h"
+
+#include <string.h>
+
+namespace TouchmoteCore {
+
+	LatencyHistogram::LatencyHistogram()
+	{
+		reset();
+	}
+
+	void LatencyHistogram::reset()
+	{
+		count.store(0, std::memory_order_relaxed);
+		total.store(0, std::memory_order_relaxed);
+		max.store(0, std::memory_order_relaxed);
+		for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+			buckets[i].store(0, std::memory_order_relaxed);
+	}
+
+	HistogramSnapshot::HistogramSnapshot()
+		: Count(0), Total(0), Max(0)
+	{
+		memset(Buckets, 0, sizeof(Buckets));
+	}
+
+	void HistogramSnapshot::add(const LatencyHistogram &histogram)
+	{
+		//Sum the buckets rather than trusting count, so percentiles stay consistent
+		//with the buckets even if the writer is halfway through a record.
+		uint64_t sum = 0;
+		for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+		{
+			uint32_t value = histogram.getBucket(i);
+			Buckets[i] += value;
+			sum += value;
+		}
+		Count += sum;
+		Total += histogram.getTotal();
+		if (histogram.getMax() > Max)
+			Max = histogram.getMax();
+	}
+
+	void HistogramSnapshot::add(const HistogramSnapshot &other)
+	{
+		for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+			Buckets[i] += other.Buckets[i];
+		Count += other.Count;
+		Total += other.Total;
+		if (other.Max > Max)
+			Max = other.Max;
+	}
+
+	uint64_t HistogramSnapshot::getPercentile(double percentile) const
+	{
+		if (Count == 0)
+			return 0;
+
+		uint64_t target = (uint64_t)(percentile / 100.0 * Count + 0.5);
+		if (target < 1)
+			target = 1;
+		if (target > Count)
+			target = Count;
+
+		uint64_t seen = 0;
+		for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+		{
+			seen += Buckets[i];
+			if (seen >= target)
+			{
+				uint64_t end = getHistogramBucketEnd(i);
+				return end < Max ? end : Max;
+			}
+		}
+		return Max;
+	}
+
+}
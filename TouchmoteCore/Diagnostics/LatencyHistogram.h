@@ -0,0 +1,131 @@
+// LatencyHistogram.h
+//
+// Log-linear latency histogram in the style of HdrHistogram. Values below 16ns are
+// counted exactly, above that every power of two is split into 16 linear buckets,
+// which keeps the relative error under 6.25% up to 2^35ns (~34s). Larger values
+// land in the last bucket.
+//
+// A histogram has exactly one writing thread. Writers only use relaxed loads and
+// stores, so recording is a handful of instructions and never blocks, while any
+// other thread may read the buckets at the same time to take a snapshot.
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace TouchmoteCore {
+
+	static const int HISTOGRAM_SUB_BUCKET_BITS = 4;
+	static const int HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BUCKET_BITS;
+	static const int HISTOGRAM_MAX_BIT = 35;
+	static const int HISTOGRAM_BUCKETS = (HISTOGRAM_MAX_BIT - HISTOGRAM_SUB_BUCKET_BITS + 2) * HISTOGRAM_SUB_BUCKETS;
+
+	//value must not be 0.
+	inline int getHighestBit(uint64_t value)
+	{
+#if defined(_MSC_VER) && defined(_M_IX86)
+		//No _BitScanReverse64 on 32-bit x86, scan the halves.
+		unsigned long index;
+		if (_BitScanReverse(&index, (unsigned long)(value >> 32)))
+			return (int)index + 32;
+		_BitScanReverse(&index, (unsigned long)value);
+		return (int)index;
+#elif defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return (int)index;
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+
+	inline int getHistogramBucket(uint64_t value)
+	{
+		if (value < (uint64_t)HISTOGRAM_SUB_BUCKETS)
+			return (int)value;
+
+		int bit = getHighestBit(value);
+		if (bit > HISTOGRAM_MAX_BIT)
+			return HISTOGRAM_BUCKETS - 1;
+
+		int shift = bit - HISTOGRAM_SUB_BUCKET_BITS;
+		return (shift + 1) * HISTOGRAM_SUB_BUCKETS + (int)((value >> shift) - HISTOGRAM_SUB_BUCKETS);
+	}
+
+	//Smallest value which falls into the bucket.
+	inline uint64_t getHistogramBucketStart(int bucket)
+	{
+		if (bucket < HISTOGRAM_SUB_BUCKETS)
+			return (uint64_t)bucket;
+
+		int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+		uint64_t sub = (uint64_t)(bucket % HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKETS);
+		return sub << shift;
+	}
+
+	//Largest value which falls into the bucket.
+	inline uint64_t getHistogramBucketEnd(int bucket)
+	{
+		if (bucket < HISTOGRAM_SUB_BUCKETS)
+			return (uint64_t)bucket;
+
+		int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+		return getHistogramBucketStart(bucket) + ((uint64_t)1 << shift) - 1;
+	}
+
+	class LatencyHistogram
+	{
+	public:
+		LatencyHistogram();
+
+		//Only call from the owning thread.
+		void record(uint64_t ns)
+		{
+			std::atomic<uint32_t> &bucket = buckets[getHistogramBucket(ns)];
+			bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			total.store(total.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+			if (ns > max.load(std::memory_order_relaxed))
+				max.store(ns, std::memory_order_relaxed);
+		}
+
+		uint64_t getCount() const { return count.load(std::memory_order_relaxed); }
+		uint64_t getTotal() const { return total.load(std::memory_order_relaxed); }
+		uint64_t getMax() const { return max.load(std::memory_order_relaxed); }
+		uint32_t getBucket(int bucket) const { return buckets[bucket].load(std::memory_order_relaxed); }
+
+		//Not atomic with respect to the writer, counts recorded meanwhile may survive.
+		void reset();
+
+	private:
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> total;
+		std::atomic<uint64_t> max;
+		std::atomic<uint32_t> buckets[HISTOGRAM_BUCKETS];
+	};
+
+	//A merged, plain copy of one or more histograms.
+	struct HistogramSnapshot
+	{
+		uint64_t Count;
+		uint64_t Total;
+		uint64_t Max;
+		uint64_t Buckets[HISTOGRAM_BUCKETS];
+
+		HistogramSnapshot();
+
+		void add(const LatencyHistogram &histogram);
+		void add(const HistogramSnapshot &other);
+
+		double getMean() const { return Count > 0 ? (double)Total / Count : 0; }
+
+		//Upper bound of the bucket holding the given percentile (0-100), capped at Max.
+		uint64_t getPercentile(double percentile) const;
+	};
+
+}
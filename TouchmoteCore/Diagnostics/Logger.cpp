@@ -0,0 +1,333 @@
+// Logger.cpp
+
+#include "Logger.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Instrumentation.h"
+
+namespace TouchmoteCore {
+
+	//Single producer, single consumer ring of one thread. Rings are never freed,
+	//when a thread exits its ring is handed to the next new thread, records it
+	//left behind included.
+	struct LogRing
+	{
+		LogRecord Records[LOG_RING_RECORDS];
+		//Producer and consumer on cache lines of their own.
+		char Padding0[64];
+		std::atomic<uint64_t> Head;
+		char Padding1[64];
+		std::atomic<uint64_t> Tail;
+		std::atomic<uint64_t> Dropped;
+		uint16_t Index;
+		bool InUse;
+
+		explicit LogRing(uint16_t index) : Head(0), Tail(0), Dropped(0), Index(index), InUse(true) {}
+	};
+
+	static std::mutex &getRegistryMutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	static std::vector<LogRing *> &getRegistry()
+	{
+		static std::vector<LogRing *> registry;
+		return registry;
+	}
+
+	struct RingHolder
+	{
+		LogRing *Ring;
+
+		RingHolder() : Ring(NULL) {}
+
+		~RingHolder()
+		{
+			if (Ring != NULL)
+			{
+				std::lock_guard<std::mutex> lock(getRegistryMutex());
+				Ring->InUse = false;
+			}
+		}
+	};
+
+	static thread_local RingHolder localRing;
+
+	static LogRing *acquireRing()
+	{
+		std::lock_guard<std::mutex> lock(getRegistryMutex());
+		std::vector<LogRing *> &registry = getRegistry();
+		for (size_t i = 0; i < registry.size(); i++)
+		{
+			if (!registry[i]->InUse)
+			{
+				registry[i]->InUse = true;
+				return registry[i];
+			}
+		}
+		LogRing *ring = new LogRing((uint16_t)registry.size());
+		registry.push_back(ring);
+		return ring;
+	}
+
+	std::atomic<int> Logger::minimum((int)LogLevel::Off);
+
+	const char *getLogLevelName(LogLevel level)
+	{
+		switch (level)
+		{
+		case LogLevel::Trace: return "trace";
+		case LogLevel::Debug: return "debug";
+		case LogLevel::Info: return "info";
+		case LogLevel::Warning: return "warning";
+		case LogLevel::Error: return "error";
+		default: return "off";
+		}
+	}
+
+	void Logger::submit(LogRecord &record)
+	{
+		RingHolder &holder = localRing;
+		if (holder.Ring == NULL)
+			holder.Ring = acquireRing();
+		LogRing &ring = *holder.Ring;
+
+		uint64_t head = ring.Head.load(std::memory_order_relaxed);
+		if (head - ring.Tail.load(std::memory_order_acquire) >= (uint64_t)LOG_RING_RECORDS)
+		{
+			ring.Dropped.store(ring.Dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return;
+		}
+
+		record.Timestamp = Instrumentation::now();
+		record.Thread = ring.Index;
+		ring.Records[head % LOG_RING_RECORDS] = record;
+		ring.Head.store(head + 1, std::memory_order_release);
+	}
+
+	//State of the logger thread.
+	struct LoggerThread
+	{
+		//Held while draining, so flush() and the thread take turns.
+		std::mutex DrainMutex;
+		std::vector<LogRecord> Batch;
+		//Read position and end of every ring during a drain.
+		std::vector<uint64_t> Tails;
+		std::vector<uint64_t> Heads;
+		LogSink *Sink;
+
+		std::mutex WakeMutex;
+		std::condition_variable Wake;
+		bool Stopping;
+		std::thread Thread;
+
+		LoggerThread() : Sink(NULL), Stopping(false) {}
+	};
+
+	static LoggerThread &getLoggerThread()
+	{
+		static LoggerThread thread;
+		return thread;
+	}
+
+	//Caller holds the drain mutex.
+	static void drain(LoggerThread &logger)
+	{
+		logger.Batch.clear();
+		{
+			std::lock_guard<std::mutex> lock(getRegistryMutex());
+			std::vector<LogRing *> &registry = getRegistry();
+			size_t rings = registry.size();
+			//Room for every ring being full. Only allocates on the first drain
+			//after a ring was added.
+			logger.Batch.reserve(rings * LOG_RING_RECORDS);
+			logger.Tails.resize(rings);
+			logger.Heads.resize(rings);
+			for (size_t i = 0; i < rings; i++)
+			{
+				logger.Tails[i] = registry[i]->Tail.load(std::memory_order_relaxed);
+				logger.Heads[i] = registry[i]->Head.load(std::memory_order_acquire);
+			}
+
+			//Every ring is in order, so the oldest record left is always the
+			//first of some ring. On a tie the ring registered first goes first.
+			for (;;)
+			{
+				size_t oldest = rings;
+				uint64_t timestamp = 0;
+				for (size_t i = 0; i < rings; i++)
+				{
+					if (logger.Tails[i] == logger.Heads[i])
+						continue;
+					uint64_t next = registry[i]->Records[logger.Tails[i] % LOG_RING_RECORDS].Timestamp;
+					if (oldest == rings || next < timestamp)
+					{
+						oldest = i;
+						timestamp = next;
+					}
+				}
+				if (oldest == rings)
+					break;
+				logger.Batch.push_back(registry[oldest]->Records[logger.Tails[oldest]++ % LOG_RING_RECORDS]);
+			}
+
+			for (size_t i = 0; i < rings; i++)
+				registry[i]->Tail.store(logger.Tails[i], std::memory_order_release);
+		}
+		if (logger.Batch.empty() || logger.Sink == NULL)
+			return;
+
+		logger.Sink->write(&logger.Batch[0], (int)logger.Batch.size());
+		logger.Sink->flush();
+	}
+
+	void Logger::start(LogSink &sink, LogLevel level, int intervalMs)
+	{
+		stop();
+
+		LoggerThread &logger = getLoggerThread();
+		{
+			std::lock_guard<std::mutex> lock(logger.DrainMutex);
+			logger.Sink = &sink;
+		}
+		logger.Stopping = false;
+		logger.Thread = std::thread([&logger, intervalMs]() {
+			std::unique_lock<std::mutex> lock(logger.WakeMutex);
+			while (!logger.Stopping)
+			{
+				logger.Wake.wait_for(lock, std::chrono::milliseconds(intervalMs));
+				lock.unlock();
+				{
+					std::lock_guard<std::mutex> drainLock(logger.DrainMutex);
+					drain(logger);
+				}
+				lock.lock();
+			}
+		});
+		setLevel(level);
+	}
+
+	void Logger::stop()
+	{
+		LoggerThread &logger = getLoggerThread();
+		if (!logger.Thread.joinable())
+			return;
+
+		setLevel(LogLevel::Off);
+		{
+			std::lock_guard<std::mutex> lock(logger.WakeMutex);
+			logger.Stopping = true;
+		}
+		logger.Wake.notify_all();
+		logger.Thread.join();
+
+		std::lock_guard<std::mutex> lock(logger.DrainMutex);
+		drain(logger);
+		logger.Sink = NULL;
+	}
+
+	void Logger::flush()
+	{
+		LoggerThread &logger = getLoggerThread();
+		std::lock_guard<std::mutex> lock(logger.DrainMutex);
+		drain(logger);
+	}
+
+	uint64_t Logger::getDropped()
+	{
+		std::lock_guard<std::mutex> lock(getRegistryMutex());
+		std::vector<LogRing *> &registry = getRegistry();
+		uint64_t dropped = 0;
+		for (size_t i = 0; i < registry.size(); i++)
+			dropped += registry[i]->Dropped.load(std::memory_order_relaxed);
+		return dropped;
+	}
+
+	//__FILE__ without the directories.
+	static const char *getFileName(const char *path)
+	{
+		const char *name = path;
+		for (const char *c = path; *c != 0; c++)
+		{
+			if (*c == '/' || *c == '\\')
+				name = c + 1;
+		}
+		return name;
+	}
+
+	void TextLogSink::write(const LogRecord *records, int count)
+	{
+		char message[512];
+		for (int i = 0; i < count; i++)
+		{
+			const LogRecord &record = records[i];
+			formatLogMessage(record.Format->Format, record, message, sizeof(message));
+			fprintf(file, "%12.6f %-7s %s:%d %s\n", record.Timestamp / 1e9, getLogLevelName(record.Format->Level),
+				getFileName(record.Format->File), record.Format->Line, message);
+		}
+	}
+
+	//snprintf that keeps going past the end of the buffer and tells how far.
+	static void append(char *buffer, size_t size, size_t &length, const char *text, size_t count)
+	{
+		if (length < size)
+			memcpy(buffer + length, text, std::min(count, size - length));
+		length += count;
+	}
+
+	size_t formatLogMessage(const char *format, const LogRecord &record, char *buffer, size_t size)
+	{
+		size_t length = 0;
+		int argument = 0;
+		const char *text = format;
+		while (*text != 0)
+		{
+			const char *placeholder = strstr(text, "{}");
+			if (placeholder == NULL)
+			{
+				append(buffer, size, length, text, strlen(text));
+				break;
+			}
+			append(buffer, size, length, text, placeholder - text);
+			text = placeholder + 2;
+
+			char value[64];
+			int count;
+			if (argument >= record.Count)
+			{
+				count = snprintf(value, sizeof(value), "{}");
+			}
+			else
+			{
+				const LogArgument &arg = record.Arguments[argument];
+				switch (record.Types[argument])
+				{
+				case LogArgumentType::Int: count = snprintf(value, sizeof(value), "%lld", (long long)arg.Int); break;
+				case LogArgumentType::Unsigned: count = snprintf(value, sizeof(value), "%llu", (unsigned long long)arg.Unsigned); break;
+				case LogArgumentType::Double: count = snprintf(value, sizeof(value), "%g", arg.Double); break;
+				default:
+					append(buffer, size, length, arg.String, strlen(arg.String));
+					count = 0;
+					break;
+				}
+			}
+			append(buffer, size, length, value, (size_t)std::max(0, std::min(count, (int)sizeof(value) - 1)));
+			argument++;
+		}
+
+		if (size > 0)
+			buffer[std::min(length, size - 1)] = 0;
+		return length;
+	}
+
+}
@@ -0,0 +1,207 @@
+// Logger.h
+//
+// Structured logging for the hot paths, in place of Console.WriteLine with
+// concatenated strings. A call site writes a fixed size binary record, a
+// pointer to its static format and up to LOG_MAX_ARGUMENTS numbers or static
+// strings, into a ring of its own thread. Formatting happens later on the
+// logger's thread, or offline from a binary log (see BinaryLog.h).
+//
+// Every thread writes to its own single producer ring, so logging never takes
+// a lock, and never waits: a record that does not fit is dropped and counted.
+// The level check of TOUCHMOTE_LOG is one relaxed load, and the arguments are
+// not evaluated below the level, so disabled logging costs next to nothing.
+//
+// Formats use {} for every argument, "power save after {}ms on slot {}".
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <type_traits>
+
+namespace TouchmoteCore {
+
+	enum class LogLevel
+	{
+		Trace,
+		Debug,
+		Info,
+		Warning,
+		Error,
+		//Above every level, for setLevel.
+		Off
+	};
+
+	const char *getLogLevelName(LogLevel level);
+
+	static const int LOG_MAX_ARGUMENTS = 5;
+	//Records a thread can have waiting for the logger thread.
+	static const int LOG_RING_RECORDS = 1024;
+
+	//One per call site, static.
+	struct LogFormat
+	{
+		LogLevel Level;
+		const char *Format;
+		const char *File;
+		int Line;
+	};
+
+	enum class LogArgumentType : uint8_t
+	{
+		Int,
+		Unsigned,
+		Double,
+		//A string that lives as long as the program, a literal or a name table.
+		String
+	};
+
+	union LogArgument
+	{
+		int64_t Int;
+		uint64_t Unsigned;
+		double Double;
+		const char *String;
+	};
+
+	struct LogRecord
+	{
+		const LogFormat *Format;
+		//Steady clock nanoseconds, Instrumentation::now().
+		uint64_t Timestamp;
+		//Index of the writing thread's ring.
+		uint16_t Thread;
+		uint8_t Count;
+		LogArgumentType Types[LOG_MAX_ARGUMENTS];
+		LogArgument Arguments[LOG_MAX_ARGUMENTS];
+	};
+
+	static_assert(sizeof(LogRecord) == 64, "a log record is one cache line");
+
+	//Gets records on the logger thread, oldest first.
+	class LogSink
+	{
+	public:
+		virtual ~LogSink() {}
+
+		virtual void write(const LogRecord *records, int count) = 0;
+		virtual void flush() {}
+	};
+
+	//One line per record, "seconds level file:line message", seconds on the
+	//steady clock.
+	class TextLogSink : public LogSink
+	{
+	public:
+		explicit TextLogSink(FILE *file) : file(file) {}
+
+		virtual void write(const LogRecord *records, int count);
+		virtual void flush() { fflush(file); }
+
+	private:
+		FILE *file;
+	};
+
+	//Writes format with the arguments of record in place of its {} to buffer,
+	//cut off at size. Returns the length it would have had, like snprintf.
+	size_t formatLogMessage(const char *format, const LogRecord &record, char *buffer, size_t size);
+
+	namespace LogDetail {
+
+		template <typename T>
+		inline void setArgument(LogRecord &record, int index, T value, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type * = 0)
+		{
+			record.Types[index] = LogArgumentType::Int;
+			record.Arguments[index].Int = value;
+		}
+
+		template <typename T>
+		inline void setArgument(LogRecord &record, int index, T value, typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type * = 0)
+		{
+			record.Types[index] = LogArgumentType::Unsigned;
+			record.Arguments[index].Unsigned = value;
+		}
+
+		template <typename T>
+		inline void setArgument(LogRecord &record, int index, T value, typename std::enable_if<std::is_floating_point<T>::value>::type * = 0)
+		{
+			record.Types[index] = LogArgumentType::Double;
+			record.Arguments[index].Double = value;
+		}
+
+		template <typename T>
+		inline void setArgument(LogRecord &record, int index, T value, typename std::enable_if<std::is_enum<T>::value>::type * = 0)
+		{
+			record.Types[index] = LogArgumentType::Int;
+			record.Arguments[index].Int = (int64_t)value;
+		}
+
+		inline void setArgument(LogRecord &record, int index, const char *value)
+		{
+			record.Types[index] = LogArgumentType::String;
+			record.Arguments[index].String = value != 0 ? value : "(null)";
+		}
+
+		inline void setArguments(LogRecord &, int)
+		{
+		}
+
+		template <typename T, typename... Rest>
+		inline void setArguments(LogRecord &record, int index, const T &value, const Rest &... rest)
+		{
+			setArgument(record, index, value);
+			setArguments(record, index + 1, rest...);
+		}
+
+	}
+
+	class Logger
+	{
+	public:
+		static bool isEnabled(LogLevel level) { return (int)level >= minimum.load(std::memory_order_relaxed); }
+		static LogLevel getLevel() { return (LogLevel)minimum.load(std::memory_order_relaxed); }
+		//Takes effect for calls that start after it, on every thread.
+		static void setLevel(LogLevel level) { minimum.store((int)level, std::memory_order_relaxed); }
+
+		template <typename... Args>
+		static void write(const LogFormat *format, const Args &... args)
+		{
+			static_assert(sizeof...(Args) <= LOG_MAX_ARGUMENTS, "too many log arguments");
+			LogRecord record;
+			record.Format = format;
+			record.Count = (uint8_t)sizeof...(Args);
+			LogDetail::setArguments(record, 0, args...);
+			submit(record);
+		}
+
+		//Starts the logger thread, which hands the records to sink every
+		//intervalMs and sets the level. Until then nothing is logged.
+		static void start(LogSink &sink, LogLevel level, int intervalMs = 10);
+		//Hands what was logged so far to the sink and stops the thread.
+		static void stop();
+		//Hands what was logged so far to the sink now, from the calling thread.
+		static void flush();
+
+		//Records dropped because the ring of their thread was full.
+		static uint64_t getDropped();
+
+	private:
+		static void submit(LogRecord &record);
+
+		static std::atomic<int> minimum;
+	};
+
+}
+
+//Logs at level if that is enabled; the arguments are only evaluated then.
+#define TOUCHMOTE_LOG(level, format, ...) \
+	do \
+	{ \
+		if (TouchmoteCore::Logger::isEnabled(level)) \
+		{ \
+			static const TouchmoteCore::LogFormat touchmoteLogFormat = { level, format, __FILE__, __LINE__ }; \
+			TouchmoteCore::Logger::write(&touchmoteLogFormat, ##__VA_ARGS__); \
+		} \
+	} while (0)
@@ -0,0 +1,31 @@
+// CoordFilter.cpp
+
+#include "CoordFilter.h"
+
+namespace TouchmoteCore {
+
+	CoordFilter::CoordFilter()
+		: Freq(120.0), xFilter(0.02, 0.007, 2.0), yFilter(0.02, 0.007, 2.0)
+	{
+	}
+
+	CoordFilter::CoordFilter(double freq, double mincutoff, double beta, double dcutoff)
+		: Freq(freq), xFilter(mincutoff, beta, dcutoff), yFilter(mincutoff, beta, dcutoff)
+	{
+	}
+
+	Vector CoordFilter::AddGetFilteredCoord(Vector point, double width, double height)
+	{
+		Vector filtered;
+		filtered.X = xFilter.Filter(point.X / width, 1 / Freq) * width;
+		filtered.Y = yFilter.Filter(point.Y / height, 1 / Freq) * height;
+		return filtered;
+	}
+
+	void CoordFilter::reset()
+	{
+		xFilter.reset();
+		yFilter.reset();
+	}
+
+}
@@ -0,0 +1,28 @@
+// CoordFilter.h
+//
+// Port of WiiTUIO/Filters/CoordFilter.cs
+
+#pragma once
+
+#include "OneEuroFilter.h"
+#include "../Vector.h"
+
+namespace TouchmoteCore {
+
+	class CoordFilter
+	{
+	public:
+		CoordFilter();
+		CoordFilter(double freq, double mincutoff, double beta, double dcutoff);
+
+		double Freq;
+
+		Vector AddGetFilteredCoord(Vector point, double width, double height);
+		void reset();
+
+	private:
+		OneEuroFilter xFilter;
+		OneEuroFilter yFilter;
+	};
+
+}
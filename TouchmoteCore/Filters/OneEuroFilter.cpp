@@ -0,0 +1,66 @@
+// OneEuroFilter.cpp
+
+#include "OneEuroFilter.h"
+
+#include <cmath>
+
+namespace TouchmoteCore {
+
+	static const double PI = 3.14159265358979323846;
+
+	LowpassFilter::LowpassFilter()
+		: firstTime(true), hatXPrev(0)
+	{
+	}
+
+	double LowpassFilter::Filter(double x, double alpha)
+	{
+		double hatX;
+		if (firstTime)
+		{
+			firstTime = false;
+			hatX = x;
+		}
+		else
+		{
+			hatX = alpha * x + (1 - alpha) * hatXPrev;
+		}
+
+		hatXPrev = hatX;
+
+		return hatX;
+	}
+
+	//The managed constructor assigns its dcutoff parameter to itself, so the derivative
+	//filter has always run with a zero cutoff. Keep it that way so replays match the live chain.
+	OneEuroFilter::OneEuroFilter(double minCutoff, double beta, double /*dcutoff*/)
+		: MinCutoff(minCutoff), Beta(beta), firstTime(true), dcutoff(0)
+	{
+	}
+
+	double OneEuroFilter::Filter(double x, double rate)
+	{
+		double dx = firstTime ? 0 : (x - xFilt.Last()) * rate;
+		firstTime = false;
+
+		double edx = dxFilt.Filter(dx, Alpha(rate, dcutoff));
+		double cutoff = MinCutoff + Beta * std::fabs(edx);
+
+		return xFilt.Filter(x, Alpha(rate, cutoff));
+	}
+
+	void OneEuroFilter::reset()
+	{
+		firstTime = true;
+		xFilt.reset();
+		dxFilt.reset();
+	}
+
+	double OneEuroFilter::Alpha(double rate, double cutoff) const
+	{
+		double tau = 1.0 / (2 * PI * cutoff);
+		double te = 1.0 / rate;
+		return 1.0 / (1.0 + tau / te);
+	}
+
+}
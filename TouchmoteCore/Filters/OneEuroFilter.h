@@ -0,0 +1,44 @@
+// OneEuroFilter.h
+//
+// Port of WiiTUIO/Filters/OneEuroFilter.cs
+// http://www.lifl.fr/~casiez/1euro/
+
+#pragma once
+
+namespace TouchmoteCore {
+
+	class LowpassFilter
+	{
+	public:
+		LowpassFilter();
+
+		double Last() const { return hatXPrev; }
+		double Filter(double x, double alpha);
+		void reset() { firstTime = true; }
+
+	private:
+		bool firstTime;
+		double hatXPrev;
+	};
+
+	class OneEuroFilter
+	{
+	public:
+		OneEuroFilter(double minCutoff, double beta, double dcutoff);
+
+		double MinCutoff;
+		double Beta;
+
+		double Filter(double x, double rate);
+		void reset();
+
+	private:
+		double Alpha(double rate, double cutoff) const;
+
+		bool firstTime;
+		double dcutoff;
+		LowpassFilter xFilt;
+		LowpassFilter dxFilt;
+	};
+
+}
@@ -0,0 +1,146 @@
+// PredictiveFilter.cpp
+
+#include "PredictiveFilter.h"
+
+#include <cmath>
+
+namespace TouchmoteCore {
+
+	//Initial uncertainty of velocity and acceleration, generous compared to what a hand does
+	//in normalized screen units so the first few reports dominate.
+	static const double INITIAL_VELOCITY_VARIANCE = 1;
+	static const double INITIAL_ACCELERATION_VARIANCE = 100;
+
+	KalmanAxis::KalmanAxis()
+	{
+		reset(0, 0);
+	}
+
+	void KalmanAxis::reset(double position, double measurementNoise)
+	{
+		x[0] = position;
+		x[1] = 0;
+		x[2] = 0;
+		for (int i = 0; i < 3; i++)
+			for (int j = 0; j < 3; j++)
+				P[i][j] = 0;
+		P[0][0] = measurementNoise;
+		P[1][1] = INITIAL_VELOCITY_VARIANCE;
+		P[2][2] = INITIAL_ACCELERATION_VARIANCE;
+	}
+
+	void KalmanAxis::predict(double dt, double processNoise)
+	{
+		//x = F x with F = [1 dt dt^2/2; 0 1 dt; 0 0 1]
+		double dt2 = dt * dt / 2;
+		x[0] += x[1] * dt + x[2] * dt2;
+		x[1] += x[2] * dt;
+
+		//P = F P F^T
+		double FP[3][3];
+		for (int j = 0; j < 3; j++)
+		{
+			FP[0][j] = P[0][j] + dt * P[1][j] + dt2 * P[2][j];
+			FP[1][j] = P[1][j] + dt * P[2][j];
+			FP[2][j] = P[2][j];
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			P[i][0] = FP[i][0] + dt * FP[i][1] + dt2 * FP[i][2];
+			P[i][1] = FP[i][1] + dt * FP[i][2];
+			P[i][2] = FP[i][2];
+		}
+
+		//+ Q for white noise jerk
+		double t2 = dt * dt, t3 = t2 * dt, t4 = t3 * dt, t5 = t4 * dt;
+		P[0][0] += processNoise * t5 / 20;
+		P[0][1] += processNoise * t4 / 8;
+		P[0][2] += processNoise * t3 / 6;
+		P[1][0] += processNoise * t4 / 8;
+		P[1][1] += processNoise * t3 / 3;
+		P[1][2] += processNoise * t2 / 2;
+		P[2][0] += processNoise * t3 / 6;
+		P[2][1] += processNoise * t2 / 2;
+		P[2][2] += processNoise * dt;
+	}
+
+	void KalmanAxis::update(double measurement, double measurementNoise)
+	{
+		//H = [1 0 0], so S = P00 + R and K = P[:][0] / S.
+		double s = P[0][0] + measurementNoise;
+		if (s <= 0)
+			return;
+
+		double k[3] = { P[0][0] / s, P[1][0] / s, P[2][0] / s };
+		double y = measurement - x[0];
+		for (int i = 0; i < 3; i++)
+			x[i] += k[i] * y;
+
+		double row[3] = { P[0][0], P[0][1], P[0][2] };
+		for (int i = 0; i < 3; i++)
+			for (int j = 0; j < 3; j++)
+				P[i][j] -= k[i] * row[j];
+	}
+
+	double KalmanAxis::extrapolate(double dt) const
+	{
+		double v = x[1], a = x[2];
+
+		//Decelerating: do not go past the point where the axis comes to rest.
+		if (v * a < 0)
+		{
+			double stop = -v / a;
+			if (stop < dt)
+				dt = stop;
+		}
+		return x[0] + v * dt + a * dt * dt / 2;
+	}
+
+	PredictiveFilter::PredictiveFilter()
+		: ProcessNoise(2000), MeasurementNoise(1e-6), MaxDistance(0.02), FadeSpeed(0.3), MaxExtrapolation(50000),
+		initialized(false), lastTimestamp(0)
+	{
+	}
+
+	void PredictiveFilter::update(Vector point, uint64_t timestamp)
+	{
+		if (!initialized || timestamp <= lastTimestamp || timestamp - lastTimestamp > MaxGap)
+		{
+			xAxis.reset(point.X, MeasurementNoise);
+			yAxis.reset(point.Y, MeasurementNoise);
+			initialized = true;
+			lastTimestamp = timestamp;
+			return;
+		}
+
+		double dt = (timestamp - lastTimestamp) / 1000000.0;
+		xAxis.predict(dt, ProcessNoise);
+		yAxis.predict(dt, ProcessNoise);
+		xAxis.update(point.X, MeasurementNoise);
+		yAxis.update(point.Y, MeasurementNoise);
+		lastTimestamp = timestamp;
+	}
+
+	Vector PredictiveFilter::predict(uint64_t timestamp) const
+	{
+		Vector position(xAxis.Position(), yAxis.Position());
+		if (timestamp <= lastTimestamp)
+			return position;
+
+		uint64_t ahead = timestamp - lastTimestamp;
+		if (ahead > MaxExtrapolation)
+			ahead = MaxExtrapolation;
+
+		double dt = ahead / 1000000.0;
+		Vector offset = Vector(xAxis.extrapolate(dt), yAxis.extrapolate(dt)) - position;
+		double speed = std::sqrt(xAxis.Velocity() * xAxis.Velocity() + yAxis.Velocity() * yAxis.Velocity());
+		if (speed < FadeSpeed)
+			offset = offset * (speed / FadeSpeed) * (speed / FadeSpeed);
+
+		double length = offset.Length();
+		if (length > MaxDistance)
+			offset = offset * (MaxDistance / length);
+		return position + offset;
+	}
+
+}
@@ -0,0 +1,80 @@
+// PredictiveFilter.h
+//
+// Constant acceleration Kalman filter over the pointer position, updated with
+// the report timestamps and read out at the time the cursor is expected to be
+// on screen. Used instead of CoordFilter when pointer_prediction is set, so the
+// cursor does not trail behind fast wrist movements.
+//
+// Extrapolation stops where a decelerating axis would come to rest instead of
+// reversing, and the total prediction is clamped to MaxDistance, so a sudden
+// stop overshoots by a bounded amount.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "../Vector.h"
+
+namespace TouchmoteCore {
+
+	//One axis of the filter. State is position, velocity and acceleration, time in seconds.
+	class KalmanAxis
+	{
+	public:
+		KalmanAxis();
+
+		void reset(double position, double measurementNoise);
+
+		//Advances the state by dt seconds.
+		void predict(double dt, double processNoise);
+		void update(double measurement, double measurementNoise);
+
+		//Position dt seconds ahead of the current state.
+		double extrapolate(double dt) const;
+
+		double Position() const { return x[0]; }
+		double Velocity() const { return x[1]; }
+		double Acceleration() const { return x[2]; }
+
+	private:
+		double x[3];
+		double P[3][3];
+	};
+
+	class PredictiveFilter
+	{
+	public:
+		PredictiveFilter();
+
+		//Spectral density of the jerk, in (units/s^3)^2 * s.
+		double ProcessNoise;
+		//Variance of a measurement, in units^2.
+		double MeasurementNoise;
+		//Largest distance between the filtered position and the prediction.
+		double MaxDistance;
+		//Below this speed, in units/s, the prediction fades out so sensor noise on a
+		//still hand is not extrapolated into jitter.
+		double FadeSpeed;
+		//Never extrapolate further than this past the last measurement, in microseconds.
+		uint64_t MaxExtrapolation;
+
+		//Timestamps in microseconds. A measurement at or before the last one, or
+		//more than MaxGap after it, restarts the filter at that point.
+		void update(Vector point, uint64_t timestamp);
+
+		//Expected position at the given time. Only valid once initialized.
+		Vector predict(uint64_t timestamp) const;
+
+		bool isInitialized() const { return initialized; }
+		void reset() { initialized = false; }
+
+		static const uint64_t MaxGap = 100000;
+
+	private:
+		KalmanAxis xAxis;
+		KalmanAxis yAxis;
+		bool initialized;
+		uint64_t lastTimestamp;
+	};
+
+}
@@ -0,0 +1,27 @@
+// RadiusBuffer.cpp
+
+#include "RadiusBuffer.h"
+
+namespace TouchmoteCore {
+
+	RadiusBuffer::RadiusBuffer(double radius)
+		: Radius(radius)
+	{
+	}
+
+	Vector RadiusBuffer::AddAndGet(Vector item)
+	{
+		//Only follow the input once it leaves a circle of Radius around the current value.
+		Vector d = item - Value;
+		if (d.Length() > Radius)
+		{
+			Vector D = d;
+			D.Normalize();
+
+			d -= D * Radius;
+			Value += d;
+		}
+		return Value;
+	}
+
+}
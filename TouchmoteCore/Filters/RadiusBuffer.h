@@ -0,0 +1,24 @@
+// RadiusBuffer.h
+//
+// Port of WiiTUIO/Filters/RadiusBuffer.cs. The managed class keeps a circular
+// history as well, but only Value is ever read, so only Value is kept here.
+
+#pragma once
+
+#include "../Vector.h"
+
+namespace TouchmoteCore {
+
+	class RadiusBuffer
+	{
+	public:
+		explicit RadiusBuffer(double radius);
+
+		double Radius;
+		Vector Value;
+
+		Vector AddAndGet(Vector item);
+		void reset() { Value = Vector(); }
+	};
+
+}
@@ -0,0 +1,41 @@
+// SmoothingBuffer.cpp
+
+#include "SmoothingBuffer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace TouchmoteCore {
+
+	SmoothingBuffer::SmoothingBuffer(int iSmoothSize)
+		: iSmoothIndex(0)
+	{
+		if (iSmoothSize <= 0)
+			throw std::out_of_range("Cannot have a smooth size that is <= 0.");
+
+		tSmoothBuffer.resize(iSmoothSize);
+	}
+
+	void SmoothingBuffer::addValue(double x, double y)
+	{
+		int iIndex = iSmoothIndex % (int)tSmoothBuffer.size();
+		tSmoothBuffer[iIndex].X = x;
+		tSmoothBuffer[iIndex].Y = y;
+		++iSmoothIndex;
+	}
+
+	Vector SmoothingBuffer::getSmoothedValue() const
+	{
+		Vector tSmooth;
+		int iMax = std::min(iSmoothIndex, (int)tSmoothBuffer.size());
+		if (iMax == 0)
+			throw std::logic_error("No values in the smoothing buffer!");
+
+		for (int i = 0; i < iMax; ++i)
+			tSmooth += tSmoothBuffer[i];
+
+		tSmooth /= iMax;
+		return tSmooth;
+	}
+
+}
@@ -0,0 +1,32 @@
+// SmoothingBuffer.h
+//
+// Port of WiiTUIO/Filters/SmoothingBuffer.cs: a linear smoothing buffer which
+// averages over the last N values pushed into it.
+
+#pragma once
+
+#include <vector>
+
+#include "../Vector.h"
+
+namespace TouchmoteCore {
+
+	class SmoothingBuffer
+	{
+	public:
+		explicit SmoothingBuffer(int iSmoothSize);
+
+		int getSmoothSize() const { return (int)tSmoothBuffer.size(); }
+		void clear() { iSmoothIndex = 0; }
+		void addValue(double x, double y);
+		void addValue(Vector vPoint) { addValue(vPoint.X, vPoint.Y); }
+
+		//Returns the average of the buffered values. The buffer must not be empty.
+		Vector getSmoothedValue() const;
+
+	private:
+		std::vector<Vector> tSmoothBuffer;
+		int iSmoothIndex;
+	};
+
+}
@@ -0,0 +1,409 @@
+// CalibrationSolver.cpp
+
+#include "CalibrationSolver.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace TouchmoteCore {
+
+	//Rounds of refitting to the inliers, they settle in two or three.
+	static const int MAX_REFITS = 5;
+	//Hypotheses drawn even when the first explains everything, a quad of
+	//neighbouring targets extrapolates poorly to the far ones.
+	static const int MIN_ITERATIONS = 10;
+
+	void makeCalibrationGrid(int columns, int rows, double margin, double width, double height, std::vector<Vector> &targets)
+	{
+		targets.clear();
+		for (int r = 0; r < rows; r++)
+		{
+			for (int c = 0; c < columns; c++)
+			{
+				double x = columns > 1 ? margin + (1 - 2 * margin) * c / (columns - 1) : 0.5;
+				double y = rows > 1 ? margin + (1 - 2 * margin) * r / (rows - 1) : 0.5;
+				targets.push_back(Vector(x * width, y * height));
+			}
+		}
+	}
+
+	//Eigenvalues of the symmetric matrix a into d and eigenvectors into the
+	//columns of v, by cyclic Jacobi rotations. a is destroyed.
+	static void getEigenvectors(double a[9][9], double v[9][9], double d[9])
+	{
+		for (int i = 0; i < 9; i++)
+		{
+			for (int j = 0; j < 9; j++)
+				v[i][j] = i == j ? 1 : 0;
+		}
+
+		double norm = 0;
+		for (int i = 0; i < 9; i++)
+		{
+			for (int j = 0; j < 9; j++)
+				norm += a[i][j] * a[i][j];
+		}
+
+		for (int sweep = 0; sweep < 64; sweep++)
+		{
+			double off = 0;
+			for (int p = 0; p < 9; p++)
+			{
+				for (int q = p + 1; q < 9; q++)
+					off += a[p][q] * a[p][q];
+			}
+			if (off <= 1e-30 * norm)
+				break;
+
+			for (int p = 0; p < 9; p++)
+			{
+				for (int q = p + 1; q < 9; q++)
+				{
+					if (a[p][q] == 0)
+						continue;
+					double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+					double t = (theta >= 0 ? 1 : -1) / (std::fabs(theta) + std::sqrt(theta * theta + 1));
+					double c = 1 / std::sqrt(t * t + 1);
+					double s = t * c;
+					for (int k = 0; k < 9; k++)
+					{
+						double kp = a[k][p], kq = a[k][q];
+						a[k][p] = c * kp - s * kq;
+						a[k][q] = s * kp + c * kq;
+					}
+					for (int k = 0; k < 9; k++)
+					{
+						double pk = a[p][k], qk = a[q][k];
+						a[p][k] = c * pk - s * qk;
+						a[q][k] = s * pk + c * qk;
+					}
+					for (int k = 0; k < 9; k++)
+					{
+						double kp = v[k][p], kq = v[k][q];
+						v[k][p] = c * kp - s * kq;
+						v[k][q] = s * kp + c * kq;
+					}
+				}
+			}
+		}
+
+		for (int i = 0; i < 9; i++)
+			d[i] = a[i][i];
+	}
+
+	//Moves the centroid to the origin and scales to a mean distance of sqrt(2),
+	//which keeps the DLT well conditioned whatever the units.
+	static bool getNormalization(const CalibrationSample *samples, int count, bool camera, Homography &result)
+	{
+		Vector centroid;
+		for (int i = 0; i < count; i++)
+			centroid += camera ? samples[i].Camera : samples[i].Screen;
+		centroid /= count;
+
+		double distance = 0;
+		for (int i = 0; i < count; i++)
+			distance += ((camera ? samples[i].Camera : samples[i].Screen) - centroid).Length();
+		distance /= count;
+		if (distance < 1e-12)
+			return false;
+
+		double scale = std::sqrt(2.0) / distance;
+		result = Homography::scale(scale, scale);
+		result.M[2] = -scale * centroid.X;
+		result.M[5] = -scale * centroid.Y;
+		return true;
+	}
+
+	bool fitHomography(const CalibrationSample *samples, int count, Homography &result)
+	{
+		Homography toCamera, toScreen, fromScreen;
+		if (count < 4 || !getNormalization(samples, count, true, toCamera) || !getNormalization(samples, count, false, toScreen)
+			|| !toScreen.invert(fromScreen))
+			return false;
+
+		//Normal equations of the DLT rows
+		//  (-x, -y, -1, 0, 0, 0, ux, uy, u) and (0, 0, 0, -x, -y, -1, vx, vy, v),
+		//solved by the eigenvector of the smallest eigenvalue.
+		double ata[9][9] = {};
+		for (int i = 0; i < count; i++)
+		{
+			Vector c = toCamera.apply(samples[i].Camera);
+			Vector s = toScreen.apply(samples[i].Screen);
+			double rows[2][9] = {
+				{ -c.X, -c.Y, -1, 0, 0, 0, s.X * c.X, s.X * c.Y, s.X },
+				{ 0, 0, 0, -c.X, -c.Y, -1, s.Y * c.X, s.Y * c.Y, s.Y },
+			};
+			for (int r = 0; r < 2; r++)
+			{
+				for (int j = 0; j < 9; j++)
+				{
+					for (int k = j; k < 9; k++)
+						ata[j][k] += rows[r][j] * rows[r][k];
+				}
+			}
+		}
+		for (int j = 0; j < 9; j++)
+		{
+			for (int k = 0; k < j; k++)
+				ata[j][k] = ata[k][j];
+		}
+
+		double vectors[9][9];
+		double values[9];
+		getEigenvectors(ata, vectors, values);
+
+		int order[9];
+		for (int i = 0; i < 9; i++)
+			order[i] = i;
+		std::sort(order, order + 9, [&values](int a, int b) { return values[a] < values[b]; });
+		//A second null direction means the samples leave the mapping open, three on a line.
+		if (values[order[1]] <= 1e-10 * values[order[8]])
+			return false;
+
+		Homography normalized;
+		for (int i = 0; i < 9; i++)
+			normalized.M[i] = vectors[i][order[0]];
+
+		Homography mapping = fromScreen * normalized * toCamera;
+		if (std::fabs(mapping.M[8]) < 1e-12)
+			return false;
+		for (int i = 0; i < 9; i++)
+			mapping.M[i] /= mapping.M[8];
+		result = mapping;
+		return true;
+	}
+
+	//Small generator so results do not depend on the platform's <random>.
+	static uint32_t nextRandom(uint32_t &state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	static double getCross(Vector a, Vector b, Vector c)
+	{
+		return (b.X - a.X) * (c.Y - a.Y) - (b.Y - a.Y) * (c.X - a.X);
+	}
+
+	//Three of the four on a line, relative to the size of the quad.
+	static bool isDegenerate(const Vector quad[4])
+	{
+		double size = 0;
+		for (int i = 1; i < 4; i++)
+			size = std::max(size, (quad[i] - quad[0]).LengthSquared());
+		for (int skip = 0; skip < 4; skip++)
+		{
+			Vector p[3];
+			int n = 0;
+			for (int i = 0; i < 4; i++)
+			{
+				if (i != skip)
+					p[n++] = quad[i];
+			}
+			if (std::fabs(getCross(p[0], p[1], p[2])) < 1e-3 * size)
+				return true;
+		}
+		return false;
+	}
+
+	static double getSquaredResidual(const Homography &mapping, const CalibrationSample &sample)
+	{
+		return (mapping.apply(sample.Camera) - sample.Screen).LengthSquared();
+	}
+
+	//Inlier threshold, squared, from the median residual: a multiple of it keeps
+	//nearly all samples of gaussian noise whatever its size.
+	static double getThreshold(const CalibrationOptions &options, std::vector<double> &residuals)
+	{
+		std::nth_element(residuals.begin(), residuals.begin() + residuals.size() / 2, residuals.end());
+		double threshold = std::max(options.InlierThreshold, std::min(3 * residuals[residuals.size() / 2], options.MaxInlierThreshold));
+		return threshold * threshold;
+	}
+
+	bool solveCalibration(const std::vector<CalibrationSample> &samples, const CalibrationOptions &options, CalibrationResult &result)
+	{
+		int count = (int)samples.size();
+		if (count < 4)
+			return false;
+
+		//Points hypotheses are drawn from, every target, or every sample if
+		//targets are not known. Samples of point p are order[first[p]..first[p + 1]).
+		std::vector<int> order(count);
+		std::vector<int> first;
+		bool grouped = true;
+		for (int i = 0; i < count && grouped; i++)
+			grouped = samples[i].Target >= 0;
+		if (grouped)
+		{
+			std::vector<std::pair<int, int> > byTarget(count);
+			for (int i = 0; i < count; i++)
+				byTarget[i] = std::make_pair(samples[i].Target, i);
+			std::sort(byTarget.begin(), byTarget.end());
+			for (int i = 0; i < count; i++)
+			{
+				order[i] = byTarget[i].second;
+				if (i == 0 || byTarget[i].first != byTarget[i - 1].first)
+					first.push_back(i);
+			}
+		}
+		else
+		{
+			for (int i = 0; i < count; i++)
+			{
+				order[i] = i;
+				first.push_back(i);
+			}
+		}
+		int points = (int)first.size();
+		first.push_back(count);
+		if (points < 4)
+			return false;
+
+		//The median camera position of every point, which stays on target while
+		//less than half of its samples are outliers.
+		std::vector<Vector> medians(points);
+		std::vector<double> xs;
+		std::vector<double> ys;
+		for (int p = 0; p < points; p++)
+		{
+			xs.clear();
+			ys.clear();
+			for (int i = first[p]; i < first[p + 1]; i++)
+			{
+				xs.push_back(samples[order[i]].Camera.X);
+				ys.push_back(samples[order[i]].Camera.Y);
+			}
+			std::nth_element(xs.begin(), xs.begin() + xs.size() / 2, xs.end());
+			std::nth_element(ys.begin(), ys.begin() + ys.size() / 2, ys.end());
+			medians[p] = Vector(xs[xs.size() / 2], ys[ys.size() / 2]);
+		}
+
+		double threshold = options.InlierThreshold * options.InlierThreshold;
+		double bestCost = HUGE_VAL;
+		Homography best;
+		uint32_t random = options.Seed != 0 ? options.Seed : 0x9e3779b9u;
+		int iterations = options.MaxIterations;
+		int iteration = 0;
+		for (; iteration < iterations; iteration++)
+		{
+			int picked[4];
+			for (int k = 0; k < 4; k++)
+			{
+				bool repeated;
+				do
+				{
+					picked[k] = (int)(nextRandom(random) % (uint32_t)points);
+					repeated = false;
+					for (int j = 0; j < k; j++)
+						repeated = repeated || picked[j] == picked[k];
+				} while (repeated);
+			}
+
+			//Every other hypothesis uses single samples of the targets, for the
+			//targets whose median is off because most of their samples are.
+			Vector camera[4];
+			Vector screen[4];
+			for (int k = 0; k < 4; k++)
+			{
+				int p = picked[k];
+				const CalibrationSample &sample = samples[order[first[p] + nextRandom(random) % (uint32_t)(first[p + 1] - first[p])]];
+				camera[k] = (iteration & 1) == 0 ? medians[p] : sample.Camera;
+				screen[k] = sample.Screen;
+			}
+			Homography mapping;
+			if (isDegenerate(camera) || isDegenerate(screen) || !Homography::quadToQuad(camera, screen, mapping))
+				continue;
+
+			//Truncated squared error, and no need to finish once it is worse.
+			double cost = 0;
+			for (int i = 0; i < count && cost < bestCost; i++)
+				cost += std::min(getSquaredResidual(mapping, samples[i]), threshold);
+			if (cost >= bestCost)
+				continue;
+
+			bestCost = cost;
+			best = mapping;
+			//Draws needed to get four good points at once with the given
+			//confidence, half of them from medians and half from samples.
+			int goodMedians = 0;
+			for (int p = 0; p < points; p++)
+			{
+				if ((best.apply(medians[p]) - samples[order[first[p]]].Screen).LengthSquared() < threshold)
+					goodMedians++;
+			}
+			int goodSamples = 0;
+			for (int i = 0; i < count; i++)
+			{
+				if (getSquaredResidual(best, samples[i]) < threshold)
+					goodSamples++;
+			}
+			double clean = (std::pow((double)goodMedians / points, 4) + std::pow((double)goodSamples / count, 4)) / 2;
+			int needed = options.MaxIterations;
+			if (clean >= 1)
+				needed = 0;
+			else if (clean > 0)
+				needed = (int)std::min((double)needed, std::ceil(std::log(1 - options.Confidence) / std::log(1 - clean)));
+			iterations = std::min(iterations, std::max(needed, MIN_ITERATIONS));
+		}
+		if (bestCost == HUGE_VAL)
+			return false;
+
+		std::vector<CalibrationSample> inlierSamples;
+		std::vector<bool> inliers(count, false);
+		std::vector<double> &residuals = result.Residuals;
+		residuals.resize(count);
+		Homography mapping = best;
+		for (int refit = 0; refit < MAX_REFITS; refit++)
+		{
+			//The hypothesis is only good near its four points, the first inliers
+			//are the ones it was judged by.
+			if (refit > 0)
+			{
+				for (int i = 0; i < count; i++)
+					residuals[i] = std::sqrt(getSquaredResidual(mapping, samples[i]));
+				threshold = getThreshold(options, residuals);
+			}
+
+			bool changed = false;
+			inlierSamples.clear();
+			for (int i = 0; i < count; i++)
+			{
+				bool inlier = getSquaredResidual(mapping, samples[i]) < threshold;
+				changed = changed || inlier != inliers[i];
+				inliers[i] = inlier;
+				if (inlier)
+					inlierSamples.push_back(samples[i]);
+			}
+			if (!changed && refit > 0)
+				break;
+			if (inlierSamples.size() < 4 || !fitHomography(&inlierSamples[0], (int)inlierSamples.size(), mapping))
+				return false;
+		}
+
+		result.Mapping = mapping;
+		result.Inliers.assign(count, false);
+		result.InlierCount = 0;
+		result.Threshold = std::sqrt(threshold);
+		result.MaxError = 0;
+		result.Iterations = iteration;
+		double sum = 0;
+		for (int i = 0; i < count; i++)
+		{
+			double squared = getSquaredResidual(mapping, samples[i]);
+			residuals[i] = std::sqrt(squared);
+			if (squared < threshold)
+			{
+				result.Inliers[i] = true;
+				result.InlierCount++;
+				sum += squared;
+				result.MaxError = std::max(result.MaxError, residuals[i]);
+			}
+		}
+		result.RmsError = result.InlierCount > 0 ? std::sqrt(sum / result.InlierCount) : 0;
+		return result.InlierCount >= 4;
+	}
+
+}
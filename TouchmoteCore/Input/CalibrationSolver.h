@@ -0,0 +1,81 @@
+// CalibrationSolver.h
+//
+// Calibration from many samples instead of the four corners of
+// Calibrate.stepCalibration, where one bad sample skews the whole mapping.
+// Samples are camera positions of the IR dot taken while the user points at a
+// target, any number per target, for example on a 3x3 or 5x5 grid.
+//
+// Outliers are rejected with RANSAC: a hypothesis maps four targets through
+// Homography::quadToQuad, the closed form of Warper, using the median of each
+// target's samples or, every other time, one of its samples. The hypothesis
+// with the lowest truncated squared error over all samples wins. The mapping
+// is then refit to its inliers by least squares with the normalized DLT, and
+// the inliers are picked again from the refit, until they stay the same. The
+// inlier threshold follows the median residual, so it adapts to the noise.
+// Every sample gets its residual on the screen.
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "Homography.h"
+#include "../Vector.h"
+
+namespace TouchmoteCore {
+
+	struct CalibrationSample
+	{
+		//Camera coordinates, like WiimoteReport IR positions.
+		Vector Camera;
+		//Where the target was on the screen, in pixels.
+		Vector Screen;
+		//Index of the target, samples of one target share it. Negative if unknown,
+		//then hypotheses are drawn from single samples.
+		int Target;
+	};
+
+	struct CalibrationOptions
+	{
+		//Bounds of the distance, in screen pixels, past which a sample is an
+		//outlier. The hypotheses are judged at the lower bound.
+		double InlierThreshold;
+		double MaxInlierThreshold;
+		int MaxIterations;
+		//Of having drawn one hypothesis without outliers, stops RANSAC early.
+		double Confidence;
+		uint32_t Seed;
+
+		CalibrationOptions() : InlierThreshold(12), MaxInlierThreshold(48), MaxIterations(500), Confidence(0.99999), Seed(1) {}
+	};
+
+	struct CalibrationResult
+	{
+		//Camera coordinates to screen pixels.
+		Homography Mapping;
+		//Screen distance from each sample, mapped, to its target, by sample index.
+		std::vector<double> Residuals;
+		std::vector<bool> Inliers;
+		int InlierCount;
+		//The inlier threshold used in the end.
+		double Threshold;
+		//Over the inliers.
+		double RmsError;
+		double MaxError;
+		int Iterations;
+	};
+
+	//Targets on a columns x rows grid covering the screen, margin being the
+	//fraction of the screen left free on every side like fCalibrationMargin.
+	//Row by row from the top left, so target indices match.
+	void makeCalibrationGrid(int columns, int rows, double margin, double width, double height, std::vector<Vector> &targets);
+
+	//Least squares fit over count samples with the normalized DLT, at least 4.
+	//Returns false if the samples do not determine a mapping.
+	bool fitHomography(const CalibrationSample *samples, int count, Homography &result);
+
+	//Returns false if there are fewer than 4 inliers or targets, or they do not
+	//determine a mapping; result is not valid then.
+	bool solveCalibration(const std::vector<CalibrationSample> &samples, const CalibrationOptions &options, CalibrationResult &result);
+
+}
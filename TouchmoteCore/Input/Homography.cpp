@@ -0,0 +1,100 @@
+// Homography.cpp
+
+#include "Homography.h"
+
+#include <cmath>
+
+namespace TouchmoteCore {
+
+	Homography::Homography()
+	{
+		for (int i = 0; i < 9; i++)
+			M[i] = (i % 4 == 0) ? 1 : 0;
+	}
+
+	Homography Homography::scale(double sx, double sy)
+	{
+		Homography h;
+		h.M[0] = sx;
+		h.M[4] = sy;
+		return h;
+	}
+
+	bool Homography::squareToQuad(const Vector quad[4], Homography &result)
+	{
+		//Warper.computeSquareToQuad, with the corners renamed to their place in the square.
+		double dx1 = quad[1].X - quad[3].X, dy1 = quad[1].Y - quad[3].Y;
+		double dx2 = quad[2].X - quad[3].X, dy2 = quad[2].Y - quad[3].Y;
+		double sx = quad[0].X - quad[1].X + quad[3].X - quad[2].X;
+		double sy = quad[0].Y - quad[1].Y + quad[3].Y - quad[2].Y;
+		double det = dx1 * dy2 - dx2 * dy1;
+		if (std::fabs(det) < 1e-12)
+			return false;
+
+		double g = (sx * dy2 - dx2 * sy) / det;
+		double h = (dx1 * sy - sx * dy1) / det;
+
+		Homography m;
+		m.M[0] = quad[1].X - quad[0].X + g * quad[1].X;
+		m.M[1] = quad[2].X - quad[0].X + h * quad[2].X;
+		m.M[2] = quad[0].X;
+		m.M[3] = quad[1].Y - quad[0].Y + g * quad[1].Y;
+		m.M[4] = quad[2].Y - quad[0].Y + h * quad[2].Y;
+		m.M[5] = quad[0].Y;
+		m.M[6] = g;
+		m.M[7] = h;
+		m.M[8] = 1;
+		result = m;
+		return true;
+	}
+
+	bool Homography::quadToQuad(const Vector source[4], const Vector destination[4], Homography &result)
+	{
+		Homography toSource, toDestination, fromSource;
+		if (!squareToQuad(source, toSource) || !squareToQuad(destination, toDestination) || !toSource.invert(fromSource))
+			return false;
+
+		result = toDestination * fromSource;
+		return true;
+	}
+
+	bool Homography::invert(Homography &result) const
+	{
+		//Adjugate over determinant, like Warper.computeQuadToSquare.
+		double a = M[0], b = M[1], c = M[2];
+		double d = M[3], e = M[4], f = M[5];
+		double g = M[6], h = M[7], i = M[8];
+
+		double A = e * i - f * h;
+		double B = c * h - b * i;
+		double C = b * f - c * e;
+		double D = f * g - d * i;
+		double E = a * i - c * g;
+		double F = c * d - a * f;
+		double G = d * h - e * g;
+		double H = b * g - a * h;
+		double I = a * e - b * d;
+
+		double det = a * A + b * D + c * G;
+		if (std::fabs(det) < 1e-12)
+			return false;
+
+		double idet = 1.0 / det;
+		result.M[0] = A * idet; result.M[1] = B * idet; result.M[2] = C * idet;
+		result.M[3] = D * idet; result.M[4] = E * idet; result.M[5] = F * idet;
+		result.M[6] = G * idet; result.M[7] = H * idet; result.M[8] = I * idet;
+		return true;
+	}
+
+	Homography Homography::operator*(const Homography &other) const
+	{
+		Homography result;
+		for (int r = 0; r < 3; r++)
+		{
+			for (int c = 0; c < 3; c++)
+				result.M[r * 3 + c] = M[r * 3] * other.M[c] + M[r * 3 + 1] * other.M[3 + c] + M[r * 3 + 2] * other.M[6 + c];
+		}
+		return result;
+	}
+
+}
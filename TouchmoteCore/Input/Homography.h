@@ -0,0 +1,42 @@
+// Homography.h
+//
+// Port of the projective mapping in WiiTUIO/Input/WiiProvider/Warper.cs, in
+// doubles and as a plain 3x3 matrix. Maps camera coordinates of a calibrated
+// Wiimote onto the screen.
+
+#pragma once
+
+#include "../Vector.h"
+
+namespace TouchmoteCore {
+
+	struct Homography
+	{
+		//Row major, applied to column vectors (x, y, 1).
+		double M[9];
+
+		//Identity mapping.
+		Homography();
+
+		static Homography scale(double sx, double sy);
+
+		//Maps the unit square (0,0), (1,0), (0,1), (1,1) onto the quad. Corners are in the
+		//same order as Warper.setSource: top left, top right, bottom left, bottom right.
+		//Returns false and leaves the result untouched if the quad is degenerate.
+		static bool squareToQuad(const Vector quad[4], Homography &result);
+
+		//Same as Warper.setSource, setDestination and computeWarp.
+		static bool quadToQuad(const Vector source[4], const Vector destination[4], Homography &result);
+
+		bool invert(Homography &result) const;
+
+		Homography operator*(const Homography &other) const;
+
+		Vector apply(Vector point) const
+		{
+			double w = M[6] * point.X + M[7] * point.Y + M[8];
+			return Vector((M[0] * point.X + M[1] * point.Y + M[2]) / w, (M[3] * point.X + M[4] * point.Y + M[5]) / w);
+		}
+	};
+
+}
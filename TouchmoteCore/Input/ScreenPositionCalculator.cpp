@@ -0,0 +1,206 @@
+// ScreenPositionCalculator.cpp
+
+#include "ScreenPositionCalculator.h"
+
+#include <cmath>
+
+namespace TouchmoteCore {
+
+	//Convert.ToInt32 rounds half to even, which is also what rint does in the default rounding mode.
+	static int ToInt32(double value)
+	{
+		return (int)std::rint(value);
+	}
+
+	ScreenPositionCalculator::ScreenPositionCalculator(const PipelineSettings &settings)
+		: smoothedX(0), smoothedZ(0), smoothedRotation(0),
+		orientation(0),
+		leftPoint(-1),
+		lastReportTimestamp(0),
+		smoothingBuffer(settings.pointer_positionRadius)
+	{
+		recalculateScreenBounds(settings);
+	}
+
+	void ScreenPositionCalculator::recalculateScreenBounds(const PipelineSettings &settings)
+	{
+		screenWidth = settings.screenWidth;
+		screenHeight = settings.screenHeight;
+		considerRotation = settings.pointer_considerRotation;
+		prediction = settings.pointer_prediction;
+		predictionHorizon = (uint64_t)(settings.pointer_predictionHorizon > 0 ? settings.pointer_predictionHorizon : 0) * 1000;
+		predictiveFilter.ProcessNoise = settings.pointer_predictionProcessNoise;
+		predictiveFilter.MeasurementNoise = settings.pointer_predictionMeasurementNoise;
+		predictiveFilter.MaxDistance = settings.pointer_predictionMaxDistance;
+		predictiveFilter.FadeSpeed = settings.pointer_predictionFadeSpeed;
+		sensorBarPos = settings.pointer_sensorBarPos;
+		smoothingBuffer.Radius = settings.pointer_positionRadius;
+
+		minXPos = -(int)(screenWidth * settings.pointer_marginsLeftRight);
+		maxXPos = screenWidth + (int)(screenWidth * settings.pointer_marginsLeftRight);
+		maxWidth = maxXPos - minXPos;
+		minYPos = -(int)(screenHeight * settings.pointer_marginsTopBottom);
+		maxYPos = screenHeight + (int)(screenHeight * settings.pointer_marginsTopBottom);
+		maxHeight = maxYPos - minYPos;
+		SBPositionOffset = (int)(screenHeight * settings.pointer_sensorBarPosCompensation);
+	}
+
+	CursorPos ScreenPositionCalculator::CalculateCursorPos(const WiimoteReport &report)
+	{
+		return CalculateCursorPos(report, report.Timestamp);
+	}
+
+	CursorPos ScreenPositionCalculator::CalculateCursorPos(const WiimoteReport &report, uint64_t frameTimestamp)
+	{
+		const IRSensor *sensors = report.IR;
+
+		float relativeX = 0;
+		float relativeY = 0;
+
+		bool foundMidpoint = false;
+		for (int i = 0; i < IR_SENSOR_COUNT && !foundMidpoint; i++)
+		{
+			if (!sensors[i].Found)
+				continue;
+
+			for (int j = i + 1; j < IR_SENSOR_COUNT && !foundMidpoint; j++)
+			{
+				if (!sensors[j].Found)
+					continue;
+
+				foundMidpoint = true;
+
+				relativeX = (sensors[i].X + sensors[j].X) / 2.0f;
+				relativeY = (sensors[i].Y + sensors[j].Y) / 2.0f;
+
+				if (considerRotation)
+				{
+					smoothedX = smoothedX * 0.9f + report.AccelRaw[0] * 0.1f;
+					smoothedZ = smoothedZ * 0.9f + report.AccelRaw[2] * 0.1f;
+
+					int l = leftPoint, r;
+					if (leftPoint == -1)
+					{
+						double absx = std::fabs(smoothedX - 128), absz = std::fabs(smoothedZ - 128);
+
+						if (orientation == 0 || orientation == 2) absx -= 5;
+						if (orientation == 1 || orientation == 3) absz -= 5;
+
+						if (absz >= absx)
+						{
+							if (absz > 5)
+								orientation = (smoothedZ > 128) ? 0 : 2;
+						}
+						else
+						{
+							if (absx > 5)
+								orientation = (smoothedX > 128) ? 3 : 1;
+						}
+
+						switch (orientation)
+						{
+						case 0: l = (sensors[i].RawX < sensors[j].RawX) ? i : j; break;
+						case 1: l = (sensors[i].RawY > sensors[j].RawY) ? i : j; break;
+						case 2: l = (sensors[i].RawX > sensors[j].RawX) ? i : j; break;
+						case 3: l = (sensors[i].RawY < sensors[j].RawY) ? i : j; break;
+						}
+					}
+					leftPoint = l;
+					r = l == i ? j : i;
+
+					double dx = sensors[r].RawX - sensors[l].RawX;
+					double dy = sensors[r].RawY - sensors[l].RawY;
+
+					double d = std::sqrt(dx * dx + dy * dy);
+
+					dx /= d;
+					dy /= d;
+
+					smoothedRotation = std::atan2(dy, dx);
+				}
+			}
+		}
+
+		if (!foundMidpoint)
+		{
+			CursorPos err = lastPos;
+			err.OutOfReach = true;
+			leftPoint = -1;
+			predictiveFilter.reset();
+
+			return err;
+		}
+
+		int offsetY = 0;
+
+		if (sensorBarPos == SensorBarPos::Top)
+		{
+			offsetY = -SBPositionOffset;
+		}
+		else if (sensorBarPos == SensorBarPos::Bottom)
+		{
+			offsetY = SBPositionOffset;
+		}
+
+		relativeX = 1 - relativeX;
+
+		if (considerRotation)
+		{
+			relativeX = relativeX - 0.5f;
+			relativeY = relativeY - 0.5f;
+
+			double sin = std::sin(smoothedRotation);
+			double cos = std::cos(smoothedRotation);
+
+			float rotatedX = (float)(relativeX * cos - relativeY * sin);
+			float rotatedY = (float)(relativeX * sin + relativeY * cos);
+
+			relativeX = rotatedX + 0.5f;
+			relativeY = rotatedY + 0.5f;
+		}
+
+		Vector filteredPoint;
+		if (prediction)
+		{
+			//The frame loop hands in the same report until a new one arrives, only new ones are measurements.
+			if (!predictiveFilter.isInitialized() || report.Timestamp != lastReportTimestamp)
+				predictiveFilter.update(Vector(relativeX, relativeY), report.Timestamp);
+			lastReportTimestamp = report.Timestamp;
+			filteredPoint = predictiveFilter.predict(frameTimestamp + predictionHorizon);
+		}
+		else
+		{
+			filteredPoint = coordFilter.AddGetFilteredCoord(Vector(relativeX, relativeY), 1.0, 1.0);
+		}
+
+		relativeX = (float)filteredPoint.X;
+		relativeY = (float)filteredPoint.Y;
+
+		Vector smoothedPoint = smoothingBuffer.AddAndGet(Vector(relativeX, relativeY));
+
+		int x = ToInt32((float)maxWidth * smoothedPoint.X + minXPos);
+		int y = ToInt32((float)maxHeight * smoothedPoint.Y + minYPos) + offsetY;
+
+		if (x <= 0)
+		{
+			x = 0;
+		}
+		else if (x >= screenWidth)
+		{
+			x = screenWidth - 1;
+		}
+		if (y <= 0)
+		{
+			y = 0;
+		}
+		else if (y >= screenHeight)
+		{
+			y = screenHeight - 1;
+		}
+
+		CursorPos result(x, y, smoothedPoint.X, smoothedPoint.Y, smoothedRotation);
+		lastPos = result;
+		return result;
+	}
+
+}
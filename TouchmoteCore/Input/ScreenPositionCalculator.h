@@ -0,0 +1,74 @@
+// ScreenPositionCalculator.h
+//
+// Port of WiiTUIO/Input/WiiProvider/Pointer/ScreenPositionCalculator.cs.
+// Turns the IR sensor bar dots of a report into a screen cursor position.
+
+#pragma once
+
+#include "WiimoteReport.h"
+#include "../Filters/CoordFilter.h"
+#include "../Filters/PredictiveFilter.h"
+#include "../Filters/RadiusBuffer.h"
+#include "../Pipeline/PipelineSettings.h"
+
+namespace TouchmoteCore {
+
+	struct CursorPos
+	{
+		int X;
+		int Y;
+		double RelativeX;
+		double RelativeY;
+		double Rotation;
+		bool OutOfReach;
+
+		CursorPos() : X(0), Y(0), RelativeX(0), RelativeY(0), Rotation(0), OutOfReach(false) {}
+		CursorPos(int x, int y, double relativeX, double relativeY, double rotation)
+			: X(x), Y(y), RelativeX(relativeX), RelativeY(relativeY), Rotation(rotation), OutOfReach(false) {}
+	};
+
+	class ScreenPositionCalculator
+	{
+	public:
+		explicit ScreenPositionCalculator(const PipelineSettings &settings);
+
+		//Call when the screen bounds or pointer margins change.
+		void recalculateScreenBounds(const PipelineSettings &settings);
+
+		CursorPos CalculateCursorPos(const WiimoteReport &report);
+
+		//With pointer_prediction the position is predicted for frameTimestamp plus
+		//the prediction horizon (microseconds, on the report clock). Without it this
+		//is the same as CalculateCursorPos(report).
+		CursorPos CalculateCursorPos(const WiimoteReport &report, uint64_t frameTimestamp);
+
+	private:
+		int minXPos;
+		int maxXPos;
+		int maxWidth;
+
+		int minYPos;
+		int maxYPos;
+		int maxHeight;
+		int SBPositionOffset;
+
+		int screenWidth;
+		int screenHeight;
+		bool considerRotation;
+		bool prediction;
+		uint64_t predictionHorizon;
+		SensorBarPos sensorBarPos;
+
+		double smoothedX, smoothedZ, smoothedRotation;
+		int orientation;
+		int leftPoint;
+		uint64_t lastReportTimestamp;
+
+		CursorPos lastPos;
+
+		RadiusBuffer smoothingBuffer;
+		CoordFilter coordFilter;
+		PredictiveFilter predictiveFilter;
+	};
+
+}
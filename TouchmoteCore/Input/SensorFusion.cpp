@@ -0,0 +1,225 @@
+// SensorFusion.cpp
+
+#include "SensorFusion.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace TouchmoteCore {
+
+	SensorFusion::SensorFusion()
+		: MergeDistance(40),
+		MaxAge(30000),
+		EdgeMargin(0.05),
+		EdgeWeight(0.25),
+		frameTimestamp(0)
+	{
+	}
+
+	void SensorFusion::setCalibration(int camera, const Homography &mapping, double confidence)
+	{
+		if (camera < 1 || camera > MaxCameras)
+			return;
+
+		Camera &entry = cameras[camera - 1];
+		entry.Calibrated = true;
+		entry.Mapping = mapping;
+		entry.Confidence = confidence;
+	}
+
+	void SensorFusion::clearCalibration(int camera)
+	{
+		if (camera < 1 || camera > MaxCameras)
+			return;
+
+		cameras[camera - 1] = Camera();
+	}
+
+	void SensorFusion::beginFrame(uint64_t timestamp)
+	{
+		frameTimestamp = timestamp;
+		observations.clear();
+	}
+
+	void SensorFusion::addReport(const WiimoteReport &report)
+	{
+		if (report.Slot < 1 || report.Slot > MaxCameras)
+			return;
+
+		uint64_t age = frameTimestamp > report.Timestamp ? frameTimestamp - report.Timestamp : 0;
+		if (age > MaxAge)
+			return;
+
+		const Camera &camera = cameras[report.Slot - 1];
+		const Homography &mapping = camera.Calibrated ? camera.Mapping : defaultMapping;
+		//Half weight for a report that is just about to expire.
+		double weight = camera.Confidence * (1.0 - 0.5 * (double)age / (double)(MaxAge > 0 ? MaxAge : 1));
+
+		for (int s = 0; s < IR_SENSOR_COUNT; s++)
+		{
+			const IRSensor &sensor = report.IR[s];
+			if (!sensor.Found)
+				continue;
+
+			double pointWeight = weight;
+			double edge = std::min(std::min((double)sensor.X, 1.0 - sensor.X), std::min((double)sensor.Y, 1.0 - sensor.Y));
+			if (edge < EdgeMargin)
+				pointWeight *= EdgeWeight + (1.0 - EdgeWeight) * std::max(edge, 0.0) / EdgeMargin;
+
+			addObservation(report.Slot, mapping.apply(Vector(sensor.X, sensor.Y)), pointWeight);
+		}
+	}
+
+	void SensorFusion::addObservation(int camera, Vector position, double weight)
+	{
+		//A zero weight cluster has no position.
+		if (camera < 1 || camera > MaxCameras || !(weight > 0))
+			return;
+
+		Observation observation;
+		observation.Position = position;
+		observation.Weight = weight;
+		observation.Camera = camera;
+		observations.push_back(observation);
+	}
+
+	int SensorFusion::findCell(int64_t key) const
+	{
+		size_t mask = cells.size() - 1;
+		size_t index = (size_t)(((uint64_t)key * 0x9e3779b97f4a7c15ull) >> 32) & mask;
+		while (cells[index].Used && cells[index].Key != key)
+			index = (index + 1) & mask;
+		return (int)index;
+	}
+
+	static int64_t makeCellKey(int64_t x, int64_t y)
+	{
+		return (int64_t)(((uint64_t)x << 32) | (uint32_t)y);
+	}
+
+	int64_t SensorFusion::getCellKey(Vector position) const
+	{
+		double cellSize = MergeDistance > 0 ? MergeDistance : 1;
+		return makeCellKey((int64_t)std::floor(position.X / cellSize), (int64_t)std::floor(position.Y / cellSize));
+	}
+
+	void SensorFusion::fileCluster(int cluster)
+	{
+		Cell &cell = cells[findCell(clusters[cluster].CellKey)];
+		cell.Key = clusters[cluster].CellKey;
+		cell.Used = true;
+		clusters[cluster].Next = cell.First;
+		cell.First = cluster;
+	}
+
+	void SensorFusion::unfileCluster(int cluster)
+	{
+		int *link = &cells[findCell(clusters[cluster].CellKey)].First;
+		while (*link != cluster)
+			link = &clusters[*link].Next;
+		*link = clusters[cluster].Next;
+	}
+
+	void SensorFusion::fuse()
+	{
+		clusters.clear();
+		fused.clear();
+		if (observations.empty())
+			return;
+
+		//At most half full, so probing stays short. Every observation uses at most one
+		//new cell, for a new cluster or for a cluster whose mean moved.
+		size_t capacity = 16;
+		while (capacity < observations.size() * 2)
+			capacity *= 2;
+		Cell empty;
+		empty.Key = 0;
+		empty.First = -1;
+		empty.Used = false;
+		cells.assign(capacity, empty);
+
+		double cellSize = MergeDistance > 0 ? MergeDistance : 1;
+		double maxDistanceSquared = MergeDistance * MergeDistance;
+
+		for (size_t i = 0; i < observations.size(); i++)
+		{
+			const Observation &observation = observations[i];
+			uint32_t cameraBit = 1u << (observation.Camera - 1);
+			int64_t cellX = (int64_t)std::floor(observation.Position.X / cellSize);
+			int64_t cellY = (int64_t)std::floor(observation.Position.Y / cellSize);
+
+			//Nearest cluster that this camera has not contributed to yet. Two dots of one
+			//camera are always two sources. A mean within MergeDistance is in one of the
+			//nine cells around the observation.
+			int best = -1;
+			double bestDistance = maxDistanceSquared;
+			for (int64_t dy = -1; dy <= 1; dy++)
+			{
+				for (int64_t dx = -1; dx <= 1; dx++)
+				{
+					const Cell &cell = cells[findCell(makeCellKey(cellX + dx, cellY + dy))];
+					for (int c = cell.First; c != -1; c = clusters[c].Next)
+					{
+						const Cluster &cluster = clusters[c];
+						if (cluster.Cameras & cameraBit)
+							continue;
+
+						Vector delta = cluster.Sum / cluster.Weight - observation.Position;
+						double distance = delta.LengthSquared();
+						if (distance <= bestDistance)
+						{
+							//Ties go to the older cluster so the result does not depend on hashing.
+							if (distance == bestDistance && best != -1 && best < c)
+								continue;
+							best = c;
+							bestDistance = distance;
+						}
+					}
+				}
+			}
+
+			if (best != -1)
+			{
+				Cluster &cluster = clusters[best];
+				cluster.Sum += observation.Position * observation.Weight;
+				cluster.Weight += observation.Weight;
+				cluster.Cameras |= cameraBit;
+
+				//The mean moved, and may have left its cell.
+				int64_t meanKey = getCellKey(cluster.Sum / cluster.Weight);
+				if (meanKey != cluster.CellKey)
+				{
+					unfileCluster(best);
+					clusters[best].CellKey = meanKey;
+					fileCluster(best);
+				}
+				continue;
+			}
+
+			Cluster cluster;
+			cluster.Sum = observation.Position * observation.Weight;
+			cluster.Weight = observation.Weight;
+			cluster.Cameras = cameraBit;
+			cluster.CellKey = makeCellKey(cellX, cellY);
+			cluster.Next = -1;
+			clusters.push_back(cluster);
+			fileCluster((int)clusters.size() - 1);
+		}
+
+		fused.resize(clusters.size());
+		for (size_t c = 0; c < clusters.size(); c++)
+		{
+			fused[c].Position = clusters[c].Sum / clusters[c].Weight;
+			fused[c].Weight = clusters[c].Weight;
+			fused[c].Cameras = clusters[c].Cameras;
+		}
+	}
+
+	void SensorFusion::getPositions(std::vector<Vector> &positions) const
+	{
+		positions.clear();
+		for (size_t c = 0; c < fused.size(); c++)
+			positions.push_back(fused[c].Position);
+	}
+
+}
@@ -0,0 +1,131 @@
+// SensorFusion.h
+//
+// Merges the IR points of several Wiimotes looking at the same surface into one
+// set of contacts before they reach the SpatioTemporalClassifier. Every point is
+// mapped onto the screen through the homography of its camera, and points of
+// different cameras that land within MergeDistance of each other are fused
+// into their confidence weighted mean. Without this, a source seen by two
+// cameras becomes two contacts, or one contact jumping between them.
+//
+// A point's weight is the confidence of its camera, lowered towards the edge of
+// the camera's view where dots get clipped, and for reports older than the
+// frame. Reports older than MaxAge are left out.
+//
+// Clustering goes through a uniform grid of MergeDistance sized cells, with
+// every cluster filed under the cell of its current mean, so a frame costs time
+// linear in the number of points.
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "Homography.h"
+#include "WiimoteReport.h"
+#include "../Vector.h"
+
+namespace TouchmoteCore {
+
+	struct FusedContact
+	{
+		//Screen pixels.
+		Vector Position;
+		//Sum of the weights of the fused points.
+		double Weight;
+		//Bit (camera - 1) is set for every camera that saw the contact.
+		uint32_t Cameras;
+	};
+
+	class SensorFusion
+	{
+	public:
+		//Cameras are controller slots, 1 to MaxCameras.
+		static const int MaxCameras = 32;
+
+		SensorFusion();
+
+		//Largest distance in pixels between two observations of the same source.
+		double MergeDistance;
+		//Observations from reports this much older than the frame are dropped, in microseconds.
+		uint64_t MaxAge;
+		//Width of the band along the edge of the camera view, in normalized camera
+		//units, over which the weight falls off to EdgeWeight.
+		double EdgeMargin;
+		double EdgeWeight;
+
+		//Mapping for cameras without a calibration, normalized camera to screen pixels.
+		void setDefaultMapping(const Homography &mapping) { defaultMapping = mapping; }
+
+		//Mapping from normalized camera coordinates to screen pixels for one camera,
+		//confidence scales the weight of all its points.
+		void setCalibration(int camera, const Homography &mapping, double confidence);
+		void clearCalibration(int camera);
+
+		void beginFrame(uint64_t timestamp);
+
+		//Adds the found IR points of the report, camera is report.Slot.
+		void addReport(const WiimoteReport &report);
+		//Screen position in pixels.
+		void addObservation(int camera, Vector position, double weight);
+
+		//Clusters the observations of this frame. Contacts are in the order their first
+		//observation was added, so the result only depends on the input.
+		void fuse();
+
+		const std::vector<FusedContact> &contacts() const { return fused; }
+
+		//Convenience for the classifier, positions of contacts().
+		void getPositions(std::vector<Vector> &positions) const;
+
+	private:
+		struct Camera
+		{
+			bool Calibrated;
+			Homography Mapping;
+			double Confidence;
+
+			Camera() : Calibrated(false), Confidence(1) {}
+		};
+
+		struct Observation
+		{
+			Vector Position;
+			double Weight;
+			int Camera;
+		};
+
+		struct Cluster
+		{
+			Vector Sum;
+			double Weight;
+			uint32_t Cameras;
+			//Cell of the mean the cluster is filed under.
+			int64_t CellKey;
+			int Next;
+		};
+
+		struct Cell
+		{
+			int64_t Key;
+			int First;
+			//Stays set when the last cluster moves out, so probing goes past it.
+			bool Used;
+		};
+
+		int findCell(int64_t key) const;
+		int64_t getCellKey(Vector position) const;
+		void fileCluster(int cluster);
+		void unfileCluster(int cluster);
+
+		Camera cameras[MaxCameras];
+		Homography defaultMapping;
+		uint64_t frameTimestamp;
+
+		//Scratch, kept between frames to avoid reallocating.
+		std::vector<Observation> observations;
+		std::vector<Cluster> clusters;
+		std::vector<Cell> cells;
+		std::vector<FusedContact> fused;
+	};
+
+}
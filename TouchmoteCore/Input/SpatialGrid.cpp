@@ -0,0 +1,67 @@
+// SpatialGrid.cpp
+
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace TouchmoteCore {
+
+	SpatialGrid::SpatialGrid()
+		: minX(0), minY(0), cellSize(1), columns(1), rows(1)
+	{
+		cellStart.assign(2, 0);
+		indices.push_back(0);
+	}
+
+	void SpatialGrid::build(const std::vector<Vector> &points, double minCellSize)
+	{
+		double maxX = 0;
+		double maxY = 0;
+		minX = minY = 0;
+		if (!points.empty())
+		{
+			minX = maxX = points[0].X;
+			minY = maxY = points[0].Y;
+		}
+		for (size_t i = 1; i < points.size(); i++)
+		{
+			minX = std::min(minX, points[i].X);
+			maxX = std::max(maxX, points[i].X);
+			minY = std::min(minY, points[i].Y);
+			maxY = std::max(maxY, points[i].Y);
+		}
+
+		//About sqrt(n) cells along the longer side. For points on a line that is
+		//sqrt(n) points per cell, still far from n.
+		double extent = std::max(maxX - minX, maxY - minY);
+		double perSide = std::ceil(std::sqrt((double)points.size()));
+		cellSize = std::max(minCellSize, perSide > 0 ? extent / perSide : 0);
+		if (!(cellSize > 0))
+			cellSize = 1;
+		columns = (int)((maxX - minX) / cellSize) + 1;
+		rows = (int)((maxY - minY) / cellSize) + 1;
+
+		int cells = columns * rows;
+		cellStart.assign(cells + 1, 0);
+		pointCell.resize(points.size());
+		for (size_t i = 0; i < points.size(); i++)
+		{
+			int cell = rowOf(points[i].Y) * columns + columnOf(points[i].X);
+			pointCell[i] = cell;
+			++cellStart[cell + 1];
+		}
+		for (int c = 0; c < cells; c++)
+			cellStart[c + 1] += cellStart[c];
+
+		//Placed in ascending order, so every cell lists its points ascending.
+		indices.resize(std::max(points.size(), (size_t)1));
+		for (size_t i = 0; i < points.size(); i++)
+			indices[cellStart[pointCell[i]]++] = (int)i;
+		//The placing moved each start to the next cell's; shift them back.
+		for (int c = cells; c > 0; c--)
+			cellStart[c] = cellStart[c - 1];
+		cellStart[0] = 0;
+	}
+
+}
@@ -0,0 +1,63 @@
+// SpatialGrid.h
+//
+// Uniform grid over a set of points, rebuilt from scratch every frame in linear
+// time with a counting sort. The grid spans the bounding box of the points, so
+// it works in screen pixels as well as in normalized coordinates. Cells are
+// square, at least the given size, and sized for about one point per cell when
+// the points are spread evenly. Used by SpatioTemporalClassifier to look at
+// neighbouring cells only, instead of every pair of points.
+
+#pragma once
+
+#include <vector>
+
+#include "../Vector.h"
+
+namespace TouchmoteCore {
+
+	class SpatialGrid
+	{
+	public:
+		SpatialGrid();
+
+		//Points must be finite. Reuses the capacity of the previous build.
+		void build(const std::vector<Vector> &points, double minCellSize);
+
+		int getColumns() const { return columns; }
+		int getRows() const { return rows; }
+		double getCellSize() const { return cellSize; }
+
+		//Cell of a coordinate, clamped to the grid.
+		int columnOf(double x) const { return clampCell((x - minX) / cellSize, columns); }
+		int rowOf(double y) const { return clampCell((y - minY) / cellSize, rows); }
+
+		//Edges of a cell; the right edge of one is the left edge of the next.
+		double columnLeft(int column) const { return minX + column * cellSize; }
+		double rowTop(int row) const { return minY + row * cellSize; }
+
+		//Indices of the points in the cell, in ascending order.
+		const int *cellBegin(int column, int row) const { return &indices[0] + cellStart[row * columns + column]; }
+		const int *cellEnd(int column, int row) const { return &indices[0] + cellStart[row * columns + column + 1]; }
+
+	private:
+		static int clampCell(double cell, int count)
+		{
+			if (!(cell >= 0))
+				return 0;
+			if (cell >= count)
+				return count - 1;
+			return (int)cell;
+		}
+
+		double minX;
+		double minY;
+		double cellSize;
+		int columns;
+		int rows;
+		//Per cell the offset of its first index, plus the total at the end.
+		std::vector<int> cellStart;
+		std::vector<int> pointCell;
+		std::vector<int> indices;
+	};
+
+}
@@ -0,0 +1,389 @@
+// SpatioTemporalClassifier.cpp
+
+#include "SpatioTemporalClassifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace TouchmoteCore {
+
+	unsigned int SpatioTemporalTracker::StrongLockThreshold = 0;
+	unsigned int SpatioTemporalTracker::StrongLockLostThreshold = 0;
+
+	SpatioTemporalTracker::SpatioTemporalTracker(int iSmoothSize, uint64_t iID, double predictionScale)
+		: ID(iID),
+		PredictionScale(predictionScale),
+		eTrackerState(TrackerState::Discover),
+		smoothingBuffer(iSmoothSize),
+		iTrackerLock(0),
+		iTrackerLostLock(0)
+	{
+	}
+
+	void SpatioTemporalTracker::consumeInput(Vector vInput)
+	{
+		smoothingBuffer.addValue(vInput);
+
+		Vector tLastPosition = Position;
+		Position = smoothingBuffer.getSmoothedValue();
+
+		Forward = tLastPosition - Position;
+		NormalForward = Forward;
+		NormalForward.Normalize();
+
+		//If our tracker lock is 0 then it is sorta-safe to say we are the starting position.
+		if (iTrackerLock == 0)
+			StartPosition = Position;
+
+		++iTrackerLock;
+		iTrackerLostLock = 0;
+	}
+
+	double SpatioTemporalTracker::getClassificationRanking(Vector vInput) const
+	{
+		//Select the smallest of the distance to the current and predicted position (an optimistic algorithm).
+		double fDistanceFromBest = (Position - vInput).Length();
+		double fDistanceFromPredicted = (PredictedNextPosition() - vInput).Length();
+		return std::min(fDistanceFromBest, fDistanceFromPredicted);
+	}
+
+	SpatioTemporalClassifier::SpatioTemporalClassifier()
+		: DefaultSmoothSize(3),
+		DuplicateDistance(10),
+		PredictionScale(1920),
+		GridMinimumPoints(8),
+		iNextID(0),
+		listener(NULL)
+	{
+		lTrackers.reserve(4);
+	}
+
+	void SpatioTemporalClassifier::reset()
+	{
+		lTrackers.clear();
+		iNextID = 0;
+	}
+
+	void SpatioTemporalClassifier::removeTracker(SpatioTemporalTracker *pRemove)
+	{
+		for (size_t i = 0; i < lTrackers.size(); ++i)
+		{
+			if (lTrackers[i].get() == pRemove)
+			{
+				pRemove->eTrackerState = TrackerState::Destroy;
+				if (pRemove->StrongLock() && listener != NULL)
+					listener->onTrackerEnd(*pRemove);
+				lTrackers.erase(lTrackers.begin() + i);
+				return;
+			}
+		}
+	}
+
+	//Best first, in table order on a tie, which is the order a stable sort by
+	//ranking gives without the buffer it allocates. NaN rankings go last.
+	bool SpatioTemporalClassifier::rankingBefore(const ProcessPair &a, const ProcessPair &b)
+	{
+		if (a.fRanking < b.fRanking)
+			return true;
+		if (b.fRanking < a.fRanking)
+			return false;
+		bool aNaN = std::isnan(a.fRanking);
+		bool bNaN = std::isnan(b.fRanking);
+		if (aNaN != bNaN)
+			return bNaN;
+		if (a.iTracker != b.iTracker)
+			return a.iTracker < b.iTracker;
+		return a.iInput < b.iInput;
+	}
+
+	bool SpatioTemporalClassifier::allFinite(const std::vector<Vector> &points)
+	{
+		for (size_t i = 0; i < points.size(); ++i)
+		{
+			if (!std::isfinite(points[i].X) || !std::isfinite(points[i].Y))
+				return false;
+		}
+		return true;
+	}
+
+	void SpatioTemporalClassifier::removeDuplicates()
+	{
+		if (lTrackers.size() > 1 && (int)lTrackers.size() >= GridMinimumPoints)
+		{
+			lPositions.clear();
+			for (size_t i = 0; i < lTrackers.size(); ++i)
+				lPositions.push_back(lTrackers[i]->Position);
+			if (allFinite(lPositions))
+			{
+				removeDuplicatesInGrid();
+				return;
+			}
+		}
+
+		//Trackers which are this close are overlapping and stealing each others inputs, drop the older one.
+		bool bFound = true;
+		while (bFound)
+		{
+			bFound = false;
+			for (size_t i = 0; i < lTrackers.size() && !bFound; ++i)
+			{
+				for (size_t j = i + 1; j < lTrackers.size(); ++j)
+				{
+					if ((lTrackers[i]->Position - lTrackers[j]->Position).Length() < DuplicateDistance)
+					{
+						removeTracker(lTrackers[i].get());
+						bFound = true;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	//The loop above removes the first tracker with a later one too close, then
+	//starts over. Nothing before it can match again, so it removes exactly the
+	//trackers with a later one too close, in order. Cells at least
+	//DuplicateDistance wide, a little more against rounding, put every such
+	//pair in neighbouring cells.
+	void SpatioTemporalClassifier::removeDuplicatesInGrid()
+	{
+		lRemove.clear();
+		if (!(DuplicateDistance > 0))
+			return;
+
+		grid.build(lPositions, DuplicateDistance * (1 + 1e-6));
+		for (size_t i = 0; i < lPositions.size(); ++i)
+		{
+			int column = grid.columnOf(lPositions[i].X);
+			int row = grid.rowOf(lPositions[i].Y);
+			bool bFound = false;
+			for (int y = std::max(row - 1, 0); y <= std::min(row + 1, grid.getRows() - 1) && !bFound; ++y)
+			{
+				for (int x = std::max(column - 1, 0); x <= std::min(column + 1, grid.getColumns() - 1) && !bFound; ++x)
+				{
+					for (const int *j = grid.cellBegin(x, y); j != grid.cellEnd(x, y); ++j)
+					{
+						if (*j > (int)i && (lPositions[i] - lPositions[*j]).Length() < DuplicateDistance)
+						{
+							bFound = true;
+							break;
+						}
+					}
+				}
+			}
+			if (bFound)
+				lRemove.push_back(lTrackers[i].get());
+		}
+
+		for (size_t r = 0; r < lRemove.size(); ++r)
+			removeTracker(lRemove[r]);
+	}
+
+	//Each tracker's best pair of the sorted table is its input with the lowest
+	//ranking, the lowest index on a tie, and lBest is ordered by ranking, then
+	//by tracker. The ranking is the smaller distance to the position and the
+	//predicted position, so the search grows a ring of cells around both. An
+	//input outside both rings is further from each than the nearest ring edge
+	//not at the border of the grid; once that is more than the best ranking no
+	//unvisited input can beat or tie it.
+	bool SpatioTemporalClassifier::findBestInGrid(const std::vector<Vector> &lInputs)
+	{
+		for (size_t t = 0; t < lTrackers.size(); ++t)
+		{
+			Vector vPredicted = lTrackers[t]->PredictedNextPosition();
+			if (!std::isfinite(lTrackers[t]->Position.X) || !std::isfinite(lTrackers[t]->Position.Y)
+				|| !std::isfinite(vPredicted.X) || !std::isfinite(vPredicted.Y))
+				return false;
+		}
+		if (!allFinite(lInputs))
+			return false;
+
+		grid.build(lInputs, 0);
+		const int columns = grid.getColumns();
+		const int rows = grid.getRows();
+		lBest.clear();
+		for (size_t t = 0; t < lTrackers.size(); ++t)
+		{
+			SpatioTemporalTracker *pTracker = lTrackers[t].get();
+			Vector vQuery[2] = { pTracker->Position, pTracker->PredictedNextPosition() };
+			int iColumn[2];
+			int iRow[2];
+			for (int q = 0; q < 2; ++q)
+			{
+				iColumn[q] = grid.columnOf(vQuery[q].X);
+				iRow[q] = grid.rowOf(vQuery[q].Y);
+			}
+
+			ProcessPair best;
+			best.pTracker = pTracker;
+			best.iTracker = (int)t;
+			best.iInput = -1;
+			best.fRanking = 0;
+			for (int r = 0; ; ++r)
+			{
+				bool bCovered = false;
+				double fBound = std::numeric_limits<double>::infinity();
+				for (int q = 0; q < 2; ++q)
+				{
+					int left = iColumn[q] - r;
+					int right = iColumn[q] + r;
+					int top = iRow[q] - r;
+					int bottom = iRow[q] + r;
+					for (int y = std::max(top, 0); y <= std::min(bottom, rows - 1); ++y)
+					{
+						//Whole rows at the top and bottom of the ring, the two ends in between.
+						int step = (y == top || y == bottom) ? 1 : 2 * r;
+						for (int x = left; x <= right; x += step)
+						{
+							if (x < 0 || x >= columns)
+								continue;
+							for (const int *i = grid.cellBegin(x, y); i != grid.cellEnd(x, y); ++i)
+							{
+								double fRanking = pTracker->getClassificationRanking(lInputs[*i]);
+								if (best.iInput < 0 || fRanking < best.fRanking || (fRanking == best.fRanking && *i < best.iInput))
+								{
+									best.iInput = *i;
+									best.fRanking = fRanking;
+								}
+							}
+						}
+					}
+
+					if (left <= 0 && right >= columns - 1 && top <= 0 && bottom >= rows - 1)
+					{
+						bCovered = true;
+						continue;
+					}
+					if (left > 0)
+						fBound = std::min(fBound, vQuery[q].X - grid.columnLeft(left));
+					if (right < columns - 1)
+						fBound = std::min(fBound, grid.columnLeft(right + 1) - vQuery[q].X);
+					if (top > 0)
+						fBound = std::min(fBound, vQuery[q].Y - grid.rowTop(top));
+					if (bottom < rows - 1)
+						fBound = std::min(fBound, grid.rowTop(bottom + 1) - vQuery[q].Y);
+				}
+
+				//Every input has been ranked once one ring covers the grid.
+				if (bCovered)
+					break;
+				//A margin for the rounding of the cell edges.
+				if (best.iInput >= 0 && fBound > best.fRanking + (best.fRanking + grid.getCellSize()) * 1e-9)
+					break;
+			}
+			lBest.push_back(best);
+		}
+
+		std::sort(lBest.begin(), lBest.end(), rankingBefore);
+		return true;
+	}
+
+	void SpatioTemporalClassifier::processFrame(const std::vector<Vector> &lInputs)
+	{
+		if (lInputs.size() + lTrackers.size() == 0)
+			return;
+
+		removeDuplicates();
+
+		bool bGrid = !lTrackers.empty() && !lInputs.empty() && (int)lInputs.size() >= GridMinimumPoints && findBestInGrid(lInputs);
+		if (!bGrid)
+		{
+			//Build the table of all tracker-input rankings and sort it, best first.
+			lTable.clear();
+			for (size_t t = 0; t < lTrackers.size(); ++t)
+			{
+				for (size_t i = 0; i < lInputs.size(); ++i)
+				{
+					ProcessPair pair;
+					pair.pTracker = lTrackers[t].get();
+					pair.iTracker = (int)t;
+					pair.iInput = (int)i;
+					pair.fRanking = pair.pTracker->getClassificationRanking(lInputs[i]);
+					lTable.push_back(pair);
+				}
+			}
+
+			std::sort(lTable.begin(), lTable.end(), rankingBefore);
+
+			//Keep the best pair of each tracker. Like the managed version, an input may end up with several trackers.
+			lBest.clear();
+			for (size_t p = 0; p < lTable.size(); ++p)
+			{
+				bool bContains = false;
+				for (size_t b = 0; b < lBest.size(); ++b)
+				{
+					if (lBest[b].pTracker == lTable[p].pTracker)
+					{
+						bContains = true;
+						break;
+					}
+				}
+				if (!bContains)
+					lBest.push_back(lTable[p]);
+			}
+		}
+
+		//With the grid every tracker has its pair.
+		lRemove.clear();
+		for (size_t t = 0; t < lTrackers.size() && !bGrid; ++t)
+		{
+			bool bContains = false;
+			for (size_t b = 0; b < lBest.size(); ++b)
+			{
+				if (lBest[b].pTracker == lTrackers[t].get())
+				{
+					bContains = true;
+					break;
+				}
+			}
+			if (!bContains)
+				lRemove.push_back(lTrackers[t].get());
+		}
+
+		lInputUsed.assign(lInputs.size(), false);
+		for (size_t b = 0; b < lBest.size(); ++b)
+			lInputUsed[lBest[b].iInput] = true;
+
+		//Update the best matches.
+		for (size_t b = 0; b < lBest.size(); ++b)
+		{
+			SpatioTemporalTracker *pTracker = lBest[b].pTracker;
+			pTracker->consumeInput(lInputs[lBest[b].iInput]);
+			if (pTracker->StrongLock())
+			{
+				if (pTracker->eTrackerState == TrackerState::Discover)
+				{
+					pTracker->eTrackerState = TrackerState::Forward;
+					if (listener != NULL)
+						listener->onTrackerStart(*pTracker);
+				}
+				else if (listener != NULL)
+				{
+					listener->onTrackerUpdate(*pTracker);
+				}
+			}
+		}
+
+		//Remove the old.
+		for (size_t r = 0; r < lRemove.size(); ++r)
+		{
+			lRemove[r]->consumeNothing();
+			if (lRemove[r]->StrongLostLock())
+				removeTracker(lRemove[r]);
+		}
+
+		//Create the new.
+		for (size_t i = 0; i < lInputs.size(); ++i)
+		{
+			if (lInputUsed[i])
+				continue;
+
+			std::unique_ptr<SpatioTemporalTracker> pTracker(new SpatioTemporalTracker(DefaultSmoothSize, ++iNextID, PredictionScale));
+			pTracker->consumeInput(lInputs[i]);
+			pTracker->eTrackerState = TrackerState::Discover;
+			lTrackers.push_back(std::move(pTracker));
+		}
+	}
+
+}
@@ -0,0 +1,127 @@
+// SpatioTemporalClassifier.h
+//
+// Port of WiiTUIO/Input/WiiProvider/SpatiotemporalClassifier.cs.
+// Classifies a frame of points into trackers based on the previous frames, which
+// gives IR points a stable identity even though the Wiimote reports them unordered.
+//
+// With many points, from pens, several LED sources or several cameras, frames go
+// through a SpatialGrid instead of testing every pair. Each tracker searches the
+// input cells around its position and its predicted position outward, until no
+// unvisited cell can hold a better input, and duplicate trackers are only looked
+// for in the neighbouring cells. The trackers, the events and their order are
+// the same as with the pairwise loops, which small frames keep using.
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "../Filters/SmoothingBuffer.h"
+#include "SpatialGrid.h"
+#include "../Vector.h"
+
+namespace TouchmoteCore {
+
+	enum class TrackerState
+	{
+		Discover = 0,
+		Destroy = 1,
+		Forward = 2
+	};
+
+	class SpatioTemporalTracker
+	{
+	public:
+		static unsigned int StrongLockThreshold;
+		static unsigned int StrongLockLostThreshold;
+
+		SpatioTemporalTracker(int iSmoothSize, uint64_t iID, double predictionScale);
+
+		Vector Position;
+		Vector Forward;
+		Vector NormalForward;
+		Vector StartPosition;
+		uint64_t ID;
+		double PredictionScale;
+		TrackerState eTrackerState;
+
+		bool StrongLock() const { return iTrackerLock > (int)StrongLockThreshold; }
+		bool StrongLostLock() const { return iTrackerLostLock > (int)StrongLockLostThreshold; }
+
+		Vector PredictedNextPosition() const { return Position + NormalForward * PredictionScale; }
+
+		void consumeInput(Vector vInput);
+		void consumeNothing() { ++iTrackerLostLock; }
+
+		//Lower is better.
+		double getClassificationRanking(Vector vInput) const;
+
+	private:
+		SmoothingBuffer smoothingBuffer;
+		int iTrackerLock;
+		int iTrackerLostLock;
+	};
+
+	class TrackerListener
+	{
+	public:
+		virtual ~TrackerListener() {}
+
+		virtual void onTrackerStart(const SpatioTemporalTracker &tracker) = 0;
+		virtual void onTrackerUpdate(const SpatioTemporalTracker &tracker) = 0;
+		virtual void onTrackerEnd(const SpatioTemporalTracker &tracker) = 0;
+	};
+
+	class SpatioTemporalClassifier
+	{
+	public:
+		SpatioTemporalClassifier();
+
+		int DefaultSmoothSize;
+		double DuplicateDistance;
+		//Max(screen width, screen height), used by every new tracker.
+		double PredictionScale;
+		//Frames with at least this many inputs, or trackers for the duplicate
+		//test, use the spatial grid. 0 always uses it, INT_MAX never does.
+		int GridMinimumPoints;
+
+		void setListener(TrackerListener *listener) { this->listener = listener; }
+		void reset();
+
+		void processFrame(const std::vector<Vector> &lInputs);
+
+		const std::vector<std::unique_ptr<SpatioTemporalTracker> > &trackers() const { return lTrackers; }
+
+	private:
+		struct ProcessPair
+		{
+			SpatioTemporalTracker *pTracker;
+			//Index of the tracker in lTrackers.
+			int iTracker;
+			int iInput;
+			double fRanking;
+		};
+
+		static bool rankingBefore(const ProcessPair &a, const ProcessPair &b);
+
+		void removeDuplicates();
+		void removeDuplicatesInGrid();
+		bool findBestInGrid(const std::vector<Vector> &lInputs);
+		static bool allFinite(const std::vector<Vector> &points);
+		void removeTracker(SpatioTemporalTracker *pRemove);
+
+		std::vector<std::unique_ptr<SpatioTemporalTracker> > lTrackers;
+		uint64_t iNextID;
+		TrackerListener *listener;
+
+		//Scratch tables, kept between frames to avoid reallocating.
+		std::vector<ProcessPair> lTable;
+		std::vector<ProcessPair> lBest;
+		std::vector<SpatioTemporalTracker *> lRemove;
+		std::vector<bool> lInputUsed;
+		SpatialGrid grid;
+		std::vector<Vector> lPositions;
+	};
+
+}
@@ -0,0 +1,92 @@
+// WiimoteReport.h
+//
+// A raw Wiimote input report as delivered by WiimoteLib, reduced to the fields
+// the pointer pipeline and keymapper consume.
+
+#pragma once
+
+#include <stdint.h>
+
+namespace TouchmoteCore {
+
+	//Same bit layout as WiiKeyMapper.ButtonFlag.
+	enum ButtonFlag
+	{
+		Button_A = (1 << 0),
+		Button_B = (1 << 1),
+		Button_Up = (1 << 2),
+		Button_Down = (1 << 3),
+		Button_Left = (1 << 4),
+		Button_Right = (1 << 5),
+		Button_Minus = (1 << 6),
+		Button_Plus = (1 << 7),
+		Button_Home = (1 << 8),
+		Button_One = (1 << 9),
+		Button_Two = (1 << 10),
+		Button_NunchukC = (1 << 11),
+		Button_NunchukZ = (1 << 12),
+		Button_ClassicA = (1 << 13),
+		Button_ClassicB = (1 << 14),
+		Button_ClassicX = (1 << 15),
+		Button_ClassicY = (1 << 16),
+		Button_ClassicUp = (1 << 17),
+		Button_ClassicDown = (1 << 18),
+		Button_ClassicLeft = (1 << 19),
+		Button_ClassicRight = (1 << 20),
+		Button_ClassicHome = (1 << 21),
+		Button_ClassicPlus = (1 << 22),
+		Button_ClassicMinus = (1 << 23),
+		Button_ClassicL = (1 << 24),
+		Button_ClassicR = (1 << 25),
+		Button_ClassicZL = (1 << 26),
+		Button_ClassicZR = (1 << 27)
+	};
+
+	enum class ExtensionType : uint8_t
+	{
+		None = 0,
+		Nunchuk = 1,
+		ClassicController = 2
+	};
+
+	//Slots are the WiimoteStatus.ID of a controller, 1..MAX_CONTROLLER_SLOTS.
+	static const int MAX_CONTROLLER_SLOTS = 16;
+
+	static const int IR_SENSOR_COUNT = 4;
+	static const int MAX_EXTENSION_BYTES = 6;
+
+	struct IRSensor
+	{
+		bool Found;
+		int RawX;	//0..1023
+		int RawY;	//0..767
+		int Size;
+		//Normalized position, computed the same way as WiimoteLib.
+		float X;
+		float Y;
+
+		void setRawPosition(int rawX, int rawY)
+		{
+			RawX = rawX;
+			RawY = rawY;
+			X = (float)rawX / 1023.5f;
+			Y = (float)rawY / 767.5f;
+		}
+	};
+
+	struct WiimoteReport
+	{
+		//Microseconds on the capture clock.
+		uint64_t Timestamp;
+		//WiimoteStatus.ID of the controller, starting at 1.
+		int Slot;
+		uint32_t Buttons;
+		uint8_t AccelRaw[3];
+		uint8_t BatteryRaw;
+		IRSensor IR[IR_SENSOR_COUNT];
+		ExtensionType Extension;
+		//Nunchuk: joystick x, y, accel x, y, z. Classic: left x, y, right x, y, trigger l, r.
+		uint8_t ExtensionData[MAX_EXTENSION_BYTES];
+	};
+
+}
@@ -0,0 +1,207 @@
+// DuoTouch.cpp
+
+#include "DuoTouch.h"
+
+#include "TouchOutputStage.h"
+
+namespace TouchmoteCore {
+
+	const char *getContactTypeName(ContactType type)
+	{
+		switch (type)
+		{
+		case ContactType::Start: return "Start";
+		case ContactType::Move: return "Move";
+		case ContactType::End: return "End";
+		case ContactType::Hover: return "Hover";
+		case ContactType::EndToHover: return "EndToHover";
+		case ContactType::EndFromHover: return "EndFromHover";
+		}
+		return "Unknown";
+	}
+
+	DuoTouch::DuoTouch(uint64_t startId, const PipelineSettings &settings)
+		: startId(startId), masterId(startId), slaveId(startId + 1), masterPriority((int)startId), slavePriority((int)startId + 1),
+		masterState(MasterState::Hovering), slaveState(SlaveState::Idle), masterReleased(true), slaveReleased(true),
+		hoverDisabled(false), stepIdsPending(false), usingMidpoint(false), masterX(0), masterY(0), slaveX(0), slaveY(0),
+		firstMasterX(0), firstMasterY(0), midpointX(0), midpointY(0), lastMasterX(0), lastMasterY(0), lastSlaveX(0), lastSlaveY(0)
+	{
+		applySettings(settings);
+	}
+
+	void DuoTouch::applySettings(const PipelineSettings &settings)
+	{
+		screenWidth = settings.screenWidth;
+		screenHeight = settings.screenHeight;
+		edgeHelperMargins = settings.touch_edgeGestureHelperMargins;
+		edgeHelperRelease = settings.touch_edgeGestureHelperRelease;
+	}
+
+	void DuoTouch::setMasterPosition(double x, double y)
+	{
+		masterX = x;
+		masterY = y;
+	}
+
+	void DuoTouch::setSlavePosition(double x, double y)
+	{
+		if (slaveReleased)
+		{
+			slaveX = x;
+			slaveY = y;
+		}
+	}
+
+	void DuoTouch::stepIds()
+	{
+		masterId = (masterId - startId + 2) % DUO_TOUCH_ID_SPAN + startId;
+		slaveId = (slaveId - startId + 2) % DUO_TOUCH_ID_SPAN + startId;
+		stepIdsPending = false;
+	}
+
+	//In the order of DuoTouch, so the top and bottom helpers see what the left
+	//and right ones did.
+	void DuoTouch::applyEdgeHelper()
+	{
+		if (firstMasterX < edgeHelperMargins && masterX < edgeHelperRelease)
+			masterY = (firstMasterY + firstMasterY + masterY) / 3;
+		if (firstMasterX > screenWidth - edgeHelperMargins && masterX > screenWidth - edgeHelperRelease)
+			masterY = (firstMasterY + firstMasterY + masterY) / 3;
+		if (firstMasterY < edgeHelperMargins && masterY < edgeHelperRelease)
+			masterX = (firstMasterX + firstMasterX + masterX) / 3;
+		if (firstMasterY > screenHeight - edgeHelperMargins && masterY > screenHeight - edgeHelperRelease)
+			masterX = (firstMasterX + firstMasterX + masterX) / 3;
+	}
+
+	bool DuoTouch::getFrame(ContactFrame &frame)
+	{
+		if (frame.getFree() < DUO_TOUCH_CONTACTS)
+			return false;
+
+		ContactType type;
+		if (!masterReleased)
+		{
+			if (masterState == MasterState::Hovering)
+			{
+				type = ContactType::Start;
+				masterState = MasterState::Down;
+				firstMasterX = masterX;
+				firstMasterY = masterY;
+			}
+			else
+			{
+				type = ContactType::Move;
+				applyEdgeHelper();
+			}
+		}
+		else if (masterState == MasterState::Down)
+		{
+			type = hoverDisabled ? ContactType::End : ContactType::EndToHover;
+			masterX = lastMasterX;
+			masterY = lastMasterY;
+			masterState = MasterState::Hovering;
+		}
+		else
+		{
+			type = ContactType::Hover;
+		}
+
+		if (type != ContactType::Hover || !hoverDisabled)
+		{
+			TouchContact master = { masterId, type, masterX, masterY, masterPriority };
+			if (stepIdsPending && type == ContactType::EndToHover)
+			{
+				master.Type = ContactType::End;
+				stepIds();
+			}
+			frame.push(master);
+			lastMasterX = masterX;
+			lastMasterY = masterY;
+		}
+
+		if (!slaveReleased)
+		{
+			type = slaveState == SlaveState::Down ? ContactType::Move : ContactType::Start;
+			slaveState = SlaveState::Down;
+			if (!masterReleased)
+			{
+				//Pinned when the slave goes down with the master.
+				if (!usingMidpoint)
+				{
+					midpointX = (masterX + slaveX) / 2;
+					midpointY = (masterY + slaveY) / 2;
+					usingMidpoint = true;
+				}
+				slaveX = midpointX - (masterX - midpointX);
+				slaveY = midpointY - (masterY - midpointY);
+				if (slaveX < 0)
+					slaveX = 0;
+				if (slaveY < 0)
+					slaveY = 0;
+				if (slaveX > screenWidth)
+					slaveX = screenWidth - 1;
+				if (slaveY > screenHeight)
+					slaveY = screenHeight - 1;
+			}
+			else
+			{
+				usingMidpoint = false;
+			}
+			stepIdsPending = false;
+		}
+		else if (slaveState == SlaveState::Down)
+		{
+			type = ContactType::EndToHover;
+			slaveX = lastSlaveX;
+			slaveY = lastSlaveY;
+			slaveState = SlaveState::Lifted;
+		}
+		else if (slaveState == SlaveState::Lifted)
+		{
+			type = ContactType::EndFromHover;
+			slaveState = SlaveState::Idle;
+		}
+		else
+		{
+			return true;
+		}
+
+		TouchContact slave = { slaveId, type, slaveX, slaveY, slavePriority };
+		frame.push(slave);
+		lastSlaveX = slaveX;
+		lastSlaveY = slaveY;
+		if (type == ContactType::EndFromHover)
+		{
+			//Lifted before the master, the IDs step once the master is lifted too.
+			if (!masterReleased)
+				stepIdsPending = true;
+			else
+				stepIds();
+		}
+		return true;
+	}
+
+	void queueContacts(const ContactFrame &frame, TouchOutputStage &stage)
+	{
+		for (int i = 0; i < frame.getCount(); i++)
+		{
+			const TouchContact &contact = frame[i];
+			switch (contact.Type)
+			{
+			case ContactType::Start:
+			case ContactType::Move:
+				stage.setContact((uint32_t)contact.ID, contact.X, contact.Y, true);
+				break;
+			case ContactType::Hover:
+			case ContactType::EndToHover:
+				stage.setContact((uint32_t)contact.ID, contact.X, contact.Y, false);
+				break;
+			case ContactType::End:
+			case ContactType::EndFromHover:
+				stage.removeContact((uint32_t)contact.ID);
+				break;
+			}
+		}
+	}
+
+}
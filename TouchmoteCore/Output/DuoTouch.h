@@ -0,0 +1,174 @@
+// DuoTouch.h
+//
+// Native counterpart of DuoTouch: turns the cursor of one controller and its
+// two touch buttons into a master and a slave touch contact. Instead of a new
+// Queue of WiiContacts per getFrame, and another one merging the queues of all
+// controllers, a frame is written into a ContactFrame the caller owns; the
+// generators of all controllers append to the same frame.
+//
+// The semantics are those of the managed class, with its flags folded into an
+// explicit state per contact:
+// - The master starts on contact and moves with the cursor. Lifted, it ends to
+//   hover where it was last down, or just ends with hover disabled, and then
+//   hovers with the cursor.
+// - A contact that went down within touch_edgeGestureHelperMargins of a screen
+//   edge is pulled towards the line it started on while it stays within
+//   touch_edgeGestureHelperRelease of that edge, to help edge swipes.
+// - The slave goes down where the cursor is and then mirrors the master through
+//   the midpoint of the two, for pinch and rotate gestures. Lifted, it ends to
+//   hover and is ended for good the frame after.
+// - Once the slave ended both IDs step by two within the span of four. If the
+//   master is still down then, they step when it ends to hover, and its end is
+//   sent as End, so Windows takes it as the primary contact again.
+//
+// touch_touchTapThreshold is read like DuoTouch does, but its hold snap is
+// commented out there, so a contact is never held at its first position here
+// either.
+//
+// Not thread safe; positions are set and frames taken on the frame thread.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "../Pipeline/PipelineSettings.h"
+
+namespace TouchmoteCore {
+
+	//At most this many contacts per generator and frame.
+	static const int DUO_TOUCH_CONTACTS = 2;
+	//IDs of a generator, TouchHandler starts them at (id - 1) * 4 + 1.
+	static const int DUO_TOUCH_ID_SPAN = 4;
+
+	//Same as ContactType of WiiContact.
+	enum class ContactType
+	{
+		Start,
+		Move,
+		End,
+		Hover,
+		EndToHover,
+		EndFromHover
+	};
+
+	const char *getContactTypeName(ContactType type);
+
+	struct TouchContact
+	{
+		uint64_t ID;
+		ContactType Type;
+		//Screen pixels.
+		double X;
+		double Y;
+		//The first ID of the contact, lower is the master.
+		int Priority;
+	};
+
+	//The contacts of a frame, in an array of the caller.
+	class ContactFrame
+	{
+	public:
+		ContactFrame(TouchContact *contacts, int capacity) : contacts(contacts), capacity(capacity), count(0) {}
+
+		void clear() { count = 0; }
+		//Returns false if the frame is full.
+		bool push(const TouchContact &contact)
+		{
+			if (count == capacity)
+				return false;
+			contacts[count++] = contact;
+			return true;
+		}
+
+		int getCount() const { return count; }
+		int getFree() const { return capacity - count; }
+		const TouchContact &operator[](int index) const { return contacts[index]; }
+
+	private:
+		TouchContact *contacts;
+		int capacity;
+		int count;
+	};
+
+	class TouchOutputStage;
+
+	class DuoTouch
+	{
+	public:
+		//startId is the first of DUO_TOUCH_ID_SPAN IDs.
+		DuoTouch(uint64_t startId, const PipelineSettings &settings);
+
+		//Screen size and the touch_* thresholds, on a settings change.
+		void applySettings(const PipelineSettings &settings);
+
+		void setMasterPosition(double x, double y);
+		//Only while the slave is lifted, once down it follows the master.
+		void setSlavePosition(double x, double y);
+		void setContactMaster() { masterReleased = false; }
+		void setContactSlave() { slaveReleased = false; }
+		void releaseContactMaster() { masterReleased = true; }
+		void releaseContactSlave() { slaveReleased = true; }
+		void setHoverEnabled(bool enabled) { hoverDisabled = !enabled; }
+
+		//Appends the contacts of this frame, master first. Returns false and does
+		//nothing if the frame has room for fewer than DUO_TOUCH_CONTACTS.
+		bool getFrame(ContactFrame &frame);
+
+	private:
+		enum class MasterState
+		{
+			Hovering,
+			Down
+		};
+
+		enum class SlaveState
+		{
+			//Ended, nothing is sent.
+			Idle,
+			Down,
+			//Ended to hover, ends from hover with the next frame it is not down.
+			Lifted
+		};
+
+		void stepIds();
+		void applyEdgeHelper();
+
+		uint64_t startId;
+		uint64_t masterId;
+		uint64_t slaveId;
+		int masterPriority;
+		int slavePriority;
+
+		double screenWidth;
+		double screenHeight;
+		double edgeHelperMargins;
+		double edgeHelperRelease;
+
+		MasterState masterState;
+		SlaveState slaveState;
+		bool masterReleased;
+		bool slaveReleased;
+		bool hoverDisabled;
+		//The slave was lifted while the master was still down.
+		bool stepIdsPending;
+		bool usingMidpoint;
+
+		double masterX;
+		double masterY;
+		double slaveX;
+		double slaveY;
+		double firstMasterX;
+		double firstMasterY;
+		double midpointX;
+		double midpointY;
+		double lastMasterX;
+		double lastMasterY;
+		double lastSlaveX;
+		double lastSlaveY;
+	};
+
+	//Hands the contacts of a frame to the touch output stage, what
+	//processEventFrame of TouchInjectProviderHandler does with its queue.
+	void queueContacts(const ContactFrame &frame, TouchOutputStage &stage);
+
+}
@@ -0,0 +1,131 @@
+// GamepadReport.cpp
+
+#include "GamepadReport.h"
+
+#include <string.h>
+
+namespace TouchmoteCore {
+
+	int16_t toThumbValue(double value)
+	{
+		//Written so NaN fails both comparisons and ends up in the middle.
+		if (!(value > 0.0))
+			return value <= 0.0 ? -32767 : 0;
+		if (value >= 1.0)
+			return 32767;
+		//Truncates like the cast in XinputReport.
+		return (int16_t)((value - 0.5) * 2 * 32767);
+	}
+
+	uint8_t toTriggerValue(double value)
+	{
+		if (!(value > 0.0))
+			return 0;
+		if (value >= 1.0)
+			return 255;
+		return (uint8_t)(value * 255);
+	}
+
+	static void setNeutral(XinputGamepadReport &report)
+	{
+		memset(&report, 0, sizeof(report));
+		report.Length = (uint8_t)sizeof(report);
+	}
+
+	GamepadReportBuilder::GamepadReportBuilder(GamepadSink &sink)
+		: sink(sink), dirty(0), forced(false)
+	{
+		memset(&stats, 0, sizeof(stats));
+		setNeutral(report);
+		setNeutral(sent);
+	}
+
+	void GamepadReportBuilder::updateDirty(uint32_t bit, bool changed)
+	{
+		if (changed)
+			dirty |= bit;
+		else
+			dirty &= ~bit;
+	}
+
+	void GamepadReportBuilder::setButton(uint16_t button, bool down)
+	{
+		if (down)
+			report.Buttons |= button;
+		else
+			report.Buttons &= (uint16_t)~button;
+		updateDirty(GAMEPAD_CHANGED_BUTTONS, report.Buttons != sent.Buttons);
+	}
+
+	void GamepadReportBuilder::setStick(GamepadAxis axis, double value)
+	{
+		int16_t thumb = toThumbValue(value);
+		switch (axis)
+		{
+		case GamepadAxis::LeftX:
+			report.ThumbLX = thumb;
+			updateDirty(GAMEPAD_CHANGED_THUMB_LX, thumb != sent.ThumbLX);
+			break;
+		case GamepadAxis::LeftY:
+			report.ThumbLY = thumb;
+			updateDirty(GAMEPAD_CHANGED_THUMB_LY, thumb != sent.ThumbLY);
+			break;
+		case GamepadAxis::RightX:
+			report.ThumbRX = thumb;
+			updateDirty(GAMEPAD_CHANGED_THUMB_RX, thumb != sent.ThumbRX);
+			break;
+		case GamepadAxis::RightY:
+			report.ThumbRY = thumb;
+			updateDirty(GAMEPAD_CHANGED_THUMB_RY, thumb != sent.ThumbRY);
+			break;
+		}
+	}
+
+	void GamepadReportBuilder::setTrigger(GamepadTrigger trigger, double value)
+	{
+		uint8_t raw = toTriggerValue(value);
+		if (trigger == GamepadTrigger::Left)
+		{
+			report.LeftTrigger = raw;
+			updateDirty(GAMEPAD_CHANGED_LEFT_TRIGGER, raw != sent.LeftTrigger);
+		}
+		else
+		{
+			report.RightTrigger = raw;
+			updateDirty(GAMEPAD_CHANGED_RIGHT_TRIGGER, raw != sent.RightTrigger);
+		}
+	}
+
+	bool GamepadReportBuilder::endUpdate(uint64_t timestamp)
+	{
+		stats.Updates++;
+		if (dirty == 0 && !forced)
+		{
+			stats.Unchanged++;
+			return false;
+		}
+		if (!sink.send(report, forced ? GAMEPAD_CHANGED_ALL : dirty, timestamp))
+		{
+			stats.Failures++;
+			return false;
+		}
+		sent = report;
+		dirty = 0;
+		forced = false;
+		stats.Sent++;
+		return true;
+	}
+
+	void GamepadReportBuilder::reset()
+	{
+		setNeutral(report);
+		updateDirty(GAMEPAD_CHANGED_BUTTONS, report.Buttons != sent.Buttons);
+		updateDirty(GAMEPAD_CHANGED_LEFT_TRIGGER, report.LeftTrigger != sent.LeftTrigger);
+		updateDirty(GAMEPAD_CHANGED_RIGHT_TRIGGER, report.RightTrigger != sent.RightTrigger);
+		updateDirty(GAMEPAD_CHANGED_THUMB_LX, report.ThumbLX != sent.ThumbLX);
+		updateDirty(GAMEPAD_CHANGED_THUMB_LY, report.ThumbLY != sent.ThumbLY);
+		updateDirty(GAMEPAD_CHANGED_THUMB_RX, report.ThumbRX != sent.ThumbRX);
+		updateDirty(GAMEPAD_CHANGED_THUMB_RY, report.ThumbRY != sent.ThumbRY);
+	}
+
+}
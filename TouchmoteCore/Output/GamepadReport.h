@@ -0,0 +1,148 @@
+// GamepadReport.h
+//
+// Native counterpart of XinputHandler and XinputReport. The state of a virtual
+// controller is the 20 byte input report of an Xbox 360 controller itself, not
+// doubles and bools turned into a new byte array for every send. Stick and
+// trigger values of the keymapper are converted when they are set, with the
+// rounding of XinputReport and saturating at the ends of the range.
+//
+// Every field has a dirty bit that is set while its value differs from the one
+// last sent, so a frame that sets tilt, stick and buttons sends one report at
+// endUpdate(), and a frame that ends where the last one did sends none.
+//
+// Not thread safe; values are set and frames sent from the frame thread.
+
+#pragma once
+
+#include <stdint.h>
+
+namespace TouchmoteCore {
+
+	//Input report of the Xbox 360 controller, what XInputGetState returns in
+	//XINPUT_GAMEPAD after the two byte header. Multi byte fields are little endian.
+	struct XinputGamepadReport
+	{
+		//0x00 for an input report.
+		uint8_t MessageType;
+		//Size of the report, 0x14.
+		uint8_t Length;
+		//XINPUT_BUTTON_ bits.
+		uint16_t Buttons;
+		uint8_t LeftTrigger;
+		uint8_t RightTrigger;
+		//-32767..32767, up and right positive.
+		int16_t ThumbLX;
+		int16_t ThumbLY;
+		int16_t ThumbRX;
+		int16_t ThumbRY;
+		uint8_t Reserved[6];
+	};
+
+	static_assert(sizeof(XinputGamepadReport) == 20, "XinputGamepadReport must have the layout of the controller's report");
+
+	//Same values as XINPUT_GAMEPAD_ of the XInput headers.
+	static const uint16_t XINPUT_BUTTON_DPAD_UP = 0x0001;
+	static const uint16_t XINPUT_BUTTON_DPAD_DOWN = 0x0002;
+	static const uint16_t XINPUT_BUTTON_DPAD_LEFT = 0x0004;
+	static const uint16_t XINPUT_BUTTON_DPAD_RIGHT = 0x0008;
+	static const uint16_t XINPUT_BUTTON_START = 0x0010;
+	static const uint16_t XINPUT_BUTTON_BACK = 0x0020;
+	static const uint16_t XINPUT_BUTTON_LEFT_THUMB = 0x0040;
+	static const uint16_t XINPUT_BUTTON_RIGHT_THUMB = 0x0080;
+	static const uint16_t XINPUT_BUTTON_LEFT_SHOULDER = 0x0100;
+	static const uint16_t XINPUT_BUTTON_RIGHT_SHOULDER = 0x0200;
+	static const uint16_t XINPUT_BUTTON_GUIDE = 0x0400;
+	static const uint16_t XINPUT_BUTTON_A = 0x1000;
+	static const uint16_t XINPUT_BUTTON_B = 0x2000;
+	static const uint16_t XINPUT_BUTTON_X = 0x4000;
+	static const uint16_t XINPUT_BUTTON_Y = 0x8000;
+
+	enum class GamepadAxis
+	{
+		LeftX,
+		LeftY,
+		RightX,
+		RightY
+	};
+
+	enum class GamepadTrigger
+	{
+		Left,
+		Right
+	};
+
+	//Dirty bits, one per field of the report.
+	static const uint32_t GAMEPAD_CHANGED_BUTTONS = 0x01;
+	static const uint32_t GAMEPAD_CHANGED_LEFT_TRIGGER = 0x02;
+	static const uint32_t GAMEPAD_CHANGED_RIGHT_TRIGGER = 0x04;
+	static const uint32_t GAMEPAD_CHANGED_THUMB_LX = 0x08;
+	static const uint32_t GAMEPAD_CHANGED_THUMB_LY = 0x10;
+	static const uint32_t GAMEPAD_CHANGED_THUMB_RX = 0x20;
+	static const uint32_t GAMEPAD_CHANGED_THUMB_RY = 0x40;
+	static const uint32_t GAMEPAD_CHANGED_ALL = 0x7f;
+
+	//Stick value of the keymapper, 0..1 with 0.5 in the middle, to a thumb axis.
+	//Outside 0..1 saturates at -32767 and 32767, NaN is the middle.
+	int16_t toThumbValue(double value);
+	//Trigger value 0..1 to 0..255, saturating the same way, NaN is released.
+	uint8_t toTriggerValue(double value);
+
+	class GamepadSink
+	{
+	public:
+		virtual ~GamepadSink() {}
+
+		//The whole report, changed has a GAMEPAD_CHANGED_ bit for every field that
+		//differs from the report sent before. Timestamp in microseconds. Returns
+		//false on failure.
+		virtual bool send(const XinputGamepadReport &report, uint32_t changed, uint64_t timestamp) = 0;
+	};
+
+	struct GamepadReportStats
+	{
+		uint64_t Updates;
+		uint64_t Sent;
+		//Updates with nothing to send.
+		uint64_t Unchanged;
+		uint64_t Failures;
+	};
+
+	class GamepadReportBuilder
+	{
+	public:
+		//The sink is assumed to start out with a neutral report.
+		explicit GamepadReportBuilder(GamepadSink &sink);
+
+		void setButton(uint16_t button, bool down);
+		//0..1 with 0.5 in the middle, what XinputReport.StickLX and the others hold.
+		void setStick(GamepadAxis axis, double value);
+		//0..1.
+		void setTrigger(GamepadTrigger trigger, double value);
+
+		//Sends the report if any field changed since the last one sent. A failed
+		//report stays dirty and goes again next time. Returns true if sent.
+		bool endUpdate(uint64_t timestamp);
+
+		//Buttons up, sticks centered and triggers released, sent with the next
+		//endUpdate() if that is a change. What reset() of the handler does.
+		void reset();
+		//Sends the report with the next endUpdate() and every field as changed,
+		//for a newly connected device.
+		void invalidate() { forced = true; }
+
+		const XinputGamepadReport &getReport() const { return report; }
+		uint32_t getDirty() const { return dirty; }
+		const GamepadReportStats &getStats() const { return stats; }
+
+	private:
+		void updateDirty(uint32_t bit, bool changed);
+
+		GamepadSink &sink;
+		XinputGamepadReport report;
+		XinputGamepadReport sent;
+		uint32_t dirty;
+		bool forced;
+		GamepadReportStats stats;
+	};
+
+}
@@ -0,0 +1,184 @@
+// TouchOutputStage.cpp
+
+#include "TouchOutputStage.h"
+
+#include <string.h>
+
+namespace TouchmoteCore {
+
+	TouchOutputStage::TouchOutputStage(TouchSink &sink)
+		: sink(sink), hoverEnabled(true), currentCount(0), previousCount(0)
+	{
+		memset(&stats, 0, sizeof(stats));
+	}
+
+	//Index of the contact, or where it would be inserted.
+	int TouchOutputStage::findContact(uint32_t id, bool &found) const
+	{
+		int low = 0;
+		int high = currentCount;
+		while (low < high)
+		{
+			int middle = (low + high) / 2;
+			if (current[middle].ID < id)
+				low = middle + 1;
+			else
+				high = middle;
+		}
+		found = low < currentCount && current[low].ID == id;
+		return low;
+	}
+
+	bool TouchOutputStage::setContact(uint32_t id, double x, double y, bool inContact)
+	{
+		bool found;
+		int index = findContact(id, found);
+		if (!found)
+		{
+			if (currentCount == MAX_TOUCH_CONTACTS)
+				return false;
+
+			memmove(&current[index + 1], &current[index], (currentCount - index) * sizeof(Contact));
+			currentCount++;
+			current[index].ID = id;
+		}
+
+		//Like the (int) casts of the handler.
+		current[index].X = (int32_t)x;
+		current[index].Y = (int32_t)y;
+		current[index].InContact = inContact;
+		return true;
+	}
+
+	void TouchOutputStage::removeContact(uint32_t id)
+	{
+		bool found;
+		int index = findContact(id, found);
+		if (!found)
+			return;
+
+		currentCount--;
+		memmove(&current[index], &current[index + 1], (currentCount - index) * sizeof(Contact));
+	}
+
+	void TouchOutputStage::onEvent(const OutputEvent &event)
+	{
+		switch (event.EventType)
+		{
+		case OutputEvent::Type::ContactStart:
+		case OutputEvent::Type::ContactUpdate:
+			setContact((uint32_t)event.ID, event.X, event.Y, true);
+			break;
+		case OutputEvent::Type::ContactEnd:
+			removeContact((uint32_t)event.ID);
+			break;
+		default:
+			break;
+		}
+	}
+
+	static void setPointer(TouchPointer &pointer, uint32_t id, int32_t x, int32_t y, uint32_t flags)
+	{
+		pointer.ID = id;
+		pointer.X = x;
+		pointer.Y = y;
+		pointer.Flags = flags;
+	}
+
+	//Merges the two sorted arrays. Pointers keep the flags of ContactType in
+	//processEventFrame: Start, Move, End, Hover, EndToHover and EndFromHover.
+	int TouchOutputStage::buildPointers()
+	{
+		int count = 0;
+		int c = 0;
+		int p = 0;
+		while (c < currentCount || p < previousCount)
+		{
+			if (c < currentCount && !current[c].InContact && !hoverEnabled)
+			{
+				c++;
+				continue;
+			}
+
+			bool hasCurrent = c < currentCount && (p == previousCount || current[c].ID <= previous[p].ID);
+			bool hasPrevious = p < previousCount && (c == currentCount || previous[p].ID <= current[c].ID);
+			if (hasCurrent)
+			{
+				const Contact &contact = current[c++];
+				uint32_t flags;
+				if (contact.InContact)
+					flags = (hasPrevious && previous[p].InContact ? TOUCH_FLAG_UPDATE : TOUCH_FLAG_DOWN) | TOUCH_FLAG_INRANGE | TOUCH_FLAG_INCONTACT;
+				else if (hasPrevious && previous[p].InContact)
+					flags = TOUCH_FLAG_UP | TOUCH_FLAG_INRANGE;
+				else
+					flags = TOUCH_FLAG_UPDATE | TOUCH_FLAG_INRANGE;
+				if (hasPrevious)
+					p++;
+				setPointer(pointers[count++], contact.ID, contact.X, contact.Y, flags);
+			}
+			else
+			{
+				//Gone: lifted, or left the range while hovering.
+				const Contact &contact = previous[p++];
+				setPointer(pointers[count++], contact.ID, contact.X, contact.Y, contact.InContact ? TOUCH_FLAG_UP : TOUCH_FLAG_UPDATE);
+			}
+		}
+		return count;
+	}
+
+	void TouchOutputStage::submitFrame(uint64_t timestamp)
+	{
+		stats.Frames++;
+		int count = buildPointers();
+
+		//What was submitted, without the contacts left out.
+		previousCount = 0;
+		for (int c = 0; c < currentCount; c++)
+		{
+			if (current[c].InContact || hoverEnabled)
+				previous[previousCount++] = current[c];
+		}
+
+		if (count == 0)
+			return;
+
+		stats.Injections++;
+		stats.Pointers += count;
+		if (sink.inject(pointers, count, timestamp))
+			return;
+
+		//Start over with every contact new. If that fails too, they go down again
+		//with the next frame.
+		stats.Failures++;
+		stats.Resets++;
+		int submitted = previousCount;
+		previousCount = 0;
+		if (!sink.reset())
+			return;
+
+		count = 0;
+		for (int c = 0; c < submitted; c++)
+		{
+			const Contact &contact = previous[c];
+			uint32_t flags = contact.InContact ? TOUCH_FLAG_DOWN | TOUCH_FLAG_INRANGE | TOUCH_FLAG_INCONTACT : TOUCH_FLAG_UPDATE | TOUCH_FLAG_INRANGE;
+			setPointer(pointers[count++], contact.ID, contact.X, contact.Y, flags);
+		}
+		if (count == 0)
+			return;
+
+		stats.Injections++;
+		stats.Pointers += count;
+		if (sink.inject(pointers, count, timestamp))
+			previousCount = submitted;
+		else
+			stats.Failures++;
+	}
+
+	void TouchOutputStage::reset()
+	{
+		stats.Resets++;
+		previousCount = 0;
+		sink.reset();
+	}
+
+}
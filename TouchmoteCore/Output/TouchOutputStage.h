@@ -0,0 +1,117 @@
+// TouchOutputStage.h
+//
+// Native counterpart of TouchInjectProviderHandler.processEventFrame. Instead
+// of a queue of contact events turned into a new List and array every frame,
+// the stage keeps the contacts that are down in a fixed array, compares it with
+// what it submitted the frame before and derives the DOWN, UPDATE and UP flags
+// from that. A frame is one call to the TouchSink with all pointers.
+//
+// When the sink fails, the stage resets it and submits the frame again with
+// every contact as new, in place of relaunching ResetTouchInjection.exe.
+//
+// Not thread safe; contacts are set and frames submitted from the frame thread.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "../Pipeline/OutputEvent.h"
+
+namespace TouchmoteCore {
+
+	//Same as maxTouchPoints of the handler, the limit of InjectTouchInput.
+	static const int MAX_TOUCH_CONTACTS = 256;
+
+	//Same values as the POINTER_FLAG_ constants, so the Windows sink can pass them on.
+	static const uint32_t TOUCH_FLAG_INRANGE = 0x00000002;
+	static const uint32_t TOUCH_FLAG_INCONTACT = 0x00000004;
+	static const uint32_t TOUCH_FLAG_CANCELED = 0x00008000;
+	static const uint32_t TOUCH_FLAG_DOWN = 0x00010000;
+	static const uint32_t TOUCH_FLAG_UPDATE = 0x00020000;
+	static const uint32_t TOUCH_FLAG_UP = 0x00040000;
+
+	struct TouchPointer
+	{
+		uint32_t ID;
+		//Screen pixels.
+		int32_t X;
+		int32_t Y;
+		uint32_t Flags;
+	};
+
+	class TouchSink
+	{
+	public:
+		virtual ~TouchSink() {}
+
+		//All pointers of a frame, timestamp in microseconds. Returns false on failure.
+		virtual bool inject(const TouchPointer *pointers, int count, uint64_t timestamp) = 0;
+		//Drops every contact the system still has and gets ready to inject again,
+		//what ResetTouchInjection.exe did. Returns false if the sink is unusable.
+		virtual bool reset() = 0;
+	};
+
+	struct TouchOutputStats
+	{
+		uint64_t Frames;
+		uint64_t Injections;
+		uint64_t Pointers;
+		uint64_t Failures;
+		uint64_t Resets;
+	};
+
+	class TouchOutputStage : public EventSink
+	{
+	public:
+		explicit TouchOutputStage(TouchSink &sink);
+
+		//pointer_customCursor: hovering contacts are left out, a contact lifted to
+		//hover is ended.
+		void setHoverEnabled(bool enabled) { hoverEnabled = enabled; }
+
+		//Adds or moves a contact, inContact false is hovering. Returns false if
+		//MAX_TOUCH_CONTACTS are down already.
+		bool setContact(uint32_t id, double x, double y, bool inContact);
+		void removeContact(uint32_t id);
+		void clearContacts() { currentCount = 0; }
+
+		//Contact events of the pipeline: starts and updates set the contact, ends remove it.
+		virtual void onEvent(const OutputEvent &event);
+
+		//Injects the changes since the last frame, in one call to the sink. A frame
+		//without any contact, now or before, is not injected.
+		void submitFrame(uint64_t timestamp);
+
+		//Resets the sink, on connect and when the display settings changed. Contacts
+		//that are still set go down again with the next frame.
+		void reset();
+
+		const TouchOutputStats &getStats() const { return stats; }
+
+	private:
+		struct Contact
+		{
+			uint32_t ID;
+			int32_t X;
+			int32_t Y;
+			bool InContact;
+		};
+
+		int findContact(uint32_t id, bool &found) const;
+		int buildPointers();
+
+		TouchSink &sink;
+		bool hoverEnabled;
+
+		//Both sorted by id.
+		Contact current[MAX_TOUCH_CONTACTS];
+		int currentCount;
+		Contact previous[MAX_TOUCH_CONTACTS];
+		int previousCount;
+		//Every contact of both frames at most.
+		TouchPointer pointers[2 * MAX_TOUCH_CONTACTS];
+
+		TouchOutputStats stats;
+	};
+
+}
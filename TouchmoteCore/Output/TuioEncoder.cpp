@@ -0,0 +1,155 @@
+// TuioEncoder.cpp
+
+#include "TuioEncoder.h"
+
+#include <string.h>
+
+namespace TouchmoteCore {
+
+	static const char BUNDLE[] = "#bundle";
+	static const char CURSOR_PROFILE[] = "/tuio/2Dcur";
+
+	//OSC is big endian and pads strings and blobs to four bytes.
+	class OscWriter
+	{
+	public:
+		OscWriter(uint8_t *buffer, size_t capacity)
+			: buffer(buffer), capacity(capacity), size(0), overflow(false)
+		{
+		}
+
+		void writeInt(int32_t value)
+		{
+			if (!reserve(4))
+				return;
+			uint32_t bits = (uint32_t)value;
+			buffer[size] = (uint8_t)(bits >> 24);
+			buffer[size + 1] = (uint8_t)(bits >> 16);
+			buffer[size + 2] = (uint8_t)(bits >> 8);
+			buffer[size + 3] = (uint8_t)bits;
+			size += 4;
+		}
+
+		void writeFloat(float value)
+		{
+			int32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			writeInt(bits);
+		}
+
+		//With the terminating zero and padding.
+		void writeString(const char *text, size_t length)
+		{
+			size_t padded = (length + 4) & ~(size_t)3;
+			if (!reserve(padded))
+				return;
+			memcpy(buffer + size, text, length);
+			memset(buffer + size + length, 0, padded - length);
+			size += padded;
+		}
+
+		void writeString(const char *text) { writeString(text, strlen(text)); }
+
+		//Starts a bundle element, whose size endElement fills in.
+		size_t beginElement()
+		{
+			size_t start = size;
+			writeInt(0);
+			return start;
+		}
+
+		void endElement(size_t start)
+		{
+			if (overflow)
+				return;
+			size_t end = size;
+			size = start;
+			writeInt((int32_t)(end - start - 4));
+			size = end;
+		}
+
+		size_t getSize() const { return overflow ? 0 : size; }
+
+	private:
+		bool reserve(size_t bytes)
+		{
+			if (overflow || size + bytes > capacity)
+			{
+				overflow = true;
+				return false;
+			}
+			return true;
+		}
+
+		uint8_t *buffer;
+		size_t capacity;
+		size_t size;
+		bool overflow;
+	};
+
+	size_t encodeTuioFrame(const TuioCursor *cursors, int count, int32_t frame, uint8_t *buffer, size_t capacity)
+	{
+		if (count > MAX_TUIO_CURSORS)
+			count = MAX_TUIO_CURSORS;
+		if (count < 0)
+			count = 0;
+
+		OscWriter writer(buffer, capacity);
+		writer.writeString(BUNDLE, sizeof(BUNDLE) - 1);
+		//Time tag 1 is "immediately".
+		writer.writeInt(0);
+		writer.writeInt(1);
+
+		size_t alive = writer.beginElement();
+		writer.writeString(CURSOR_PROFILE, sizeof(CURSOR_PROFILE) - 1);
+		char tags[MAX_TUIO_CURSORS + 3] = ",s";
+		memset(tags + 2, 'i', count);
+		writer.writeString(tags, 2 + count);
+		writer.writeString("alive", 5);
+		for (int c = 0; c < count; c++)
+			writer.writeInt((int32_t)cursors[c].ID);
+		writer.endElement(alive);
+
+		for (int c = 0; c < count; c++)
+		{
+			const TuioCursor &cursor = cursors[c];
+			size_t set = writer.beginElement();
+			writer.writeString(CURSOR_PROFILE, sizeof(CURSOR_PROFILE) - 1);
+			writer.writeString(",sifffffff", 10);
+			writer.writeString("set", 3);
+			writer.writeInt((int32_t)cursor.ID);
+			writer.writeFloat(cursor.X);
+			writer.writeFloat(cursor.Y);
+			//Velocity and motion acceleration, which the handler never computed.
+			writer.writeFloat(0);
+			writer.writeFloat(0);
+			writer.writeFloat(0);
+			//WiiContact.Size.X then Y, which the handler labels height and width.
+			writer.writeFloat(cursor.Width);
+			writer.writeFloat(cursor.Height);
+			writer.endElement(set);
+		}
+
+		size_t fseq = writer.beginElement();
+		writer.writeString(CURSOR_PROFILE, sizeof(CURSOR_PROFILE) - 1);
+		writer.writeString(",si", 3);
+		writer.writeString("fseq", 4);
+		writer.writeInt(frame);
+		writer.endElement(fseq);
+		return writer.getSize();
+	}
+
+	int32_t getTuioFrame(const uint8_t *packet, size_t size)
+	{
+		//The fseq message is last, and its argument the last four bytes.
+		static const char FSEQ_TAIL[12] = { ',', 's', 'i', 0, 'f', 's', 'e', 'q', 0, 0, 0, 0 };
+		size_t tail = sizeof(FSEQ_TAIL);
+		if (size < 16 + tail + 4 || memcmp(packet, BUNDLE, sizeof(BUNDLE)) != 0
+			|| memcmp(packet + size - 4 - tail, FSEQ_TAIL, tail) != 0)
+			return -1;
+
+		const uint8_t *value = packet + size - 4;
+		return (int32_t)((uint32_t)value[0] << 24 | (uint32_t)value[1] << 16 | (uint32_t)value[2] << 8 | (uint32_t)value[3]);
+	}
+
+}
@@ -0,0 +1,40 @@
+// TuioEncoder.h
+//
+// The OSC bundle TUIOProviderHandler.processEventFrame builds for a frame of
+// /tuio/2Dcur cursors, written straight into a buffer instead of through
+// OSCBundle and OSCMessage objects. The set messages carry the same arguments
+// as the handler's, the contact size after the motion acceleration. The
+// messages are in the order of the TUIO 1.1 spec, alive, set and fseq last,
+// since clients apply a frame when they see its fseq.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace TouchmoteCore {
+
+	//Cursors of one frame, more are dropped. A bundle of this many fits into
+	//TUIO_MAX_PACKET.
+	static const int MAX_TUIO_CURSORS = 32;
+	static const size_t TUIO_MAX_PACKET = 4096;
+
+	struct TuioCursor
+	{
+		uint32_t ID;
+		//0..1 of the screen, like WiiContact.NormalPosition.
+		float X;
+		float Y;
+		//WiiContact.Size.
+		float Width;
+		float Height;
+	};
+
+	//Writes the bundle of one frame to buffer and returns its size, 0 if it does
+	//not fit into capacity.
+	size_t encodeTuioFrame(const TuioCursor *cursors, int count, int32_t frame, uint8_t *buffer, size_t capacity);
+
+	//The fseq of a bundle written by encodeTuioFrame, -1 if it is not one.
+	int32_t getTuioFrame(const uint8_t *packet, size_t size);
+
+}
@@ -0,0 +1,365 @@
+// TuioServer.cpp
+
+#include "TuioServer.h"
+
+#include <string.h>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <errno.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+#include "../Diagnostics/Instrumentation.h"
+
+namespace TouchmoteCore {
+
+	//Room for a burst of frames while the sender is not scheduled.
+	static const int SEND_BUFFER_SIZE = 1 << 20;
+
+	static void closeSocket(intptr_t socket)
+	{
+#if defined(_WIN32)
+		closesocket((SOCKET)socket);
+#else
+		close((int)socket);
+#endif
+	}
+
+	TuioServer *TuioServer::create(int queueCapacity)
+	{
+#if defined(_WIN32)
+		WSADATA data;
+		if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+			return NULL;
+		SOCKET handle = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if (handle == INVALID_SOCKET)
+		{
+			WSACleanup();
+			return NULL;
+		}
+		intptr_t fd = (intptr_t)handle;
+#else
+		int handle = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+		if (handle == -1)
+			return NULL;
+		intptr_t fd = handle;
+#endif
+
+		//Multicast clients only on the local network.
+		unsigned char ttl = 1;
+		setsockopt(handle, IPPROTO_IP, IP_MULTICAST_TTL, (const char *)&ttl, sizeof(ttl));
+		int bufferSize = SEND_BUFFER_SIZE;
+		setsockopt(handle, SOL_SOCKET, SO_SNDBUF, (const char *)&bufferSize, sizeof(bufferSize));
+
+		return new TuioServer(fd, queueCapacity < 1 ? 1 : queueCapacity);
+	}
+
+	TuioServer::TuioServer(intptr_t socket, int queueCapacity)
+		: socket(socket), queueCapacity(queueCapacity), stopping(false), queued(0), writing(-1), frameNumber(0), nextClient(0)
+	{
+		memset(&stats, 0, sizeof(stats));
+
+		//Queued frames are among the last queueCapacity published, and a batch
+		//holds at most TUIO_SEND_BATCH more, so publish() always finds a free one.
+		frames.resize(queueCapacity + TUIO_SEND_BATCH + 1);
+		for (int f = (int)frames.size() - 1; f > 0; f--)
+			freeFrames.push_back(f);
+		writing = 0;
+
+		for (int c = 0; c < MAX_TUIO_CLIENTS; c++)
+		{
+			Client &client = clients[c];
+			client.Active = false;
+			client.Address = 0;
+			client.Port = 0;
+			client.Head = 0;
+			client.Count = 0;
+			memset(&client.Stats, 0, sizeof(client.Stats));
+		}
+
+		sender = std::thread(&TuioServer::senderMain, this);
+	}
+
+	TuioServer::~TuioServer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		sender.join();
+		closeSocket(socket);
+#if defined(_WIN32)
+		WSACleanup();
+#endif
+	}
+
+	int TuioServer::addClient(const char *host, uint16_t port)
+	{
+		struct addrinfo hints;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_DGRAM;
+		struct addrinfo *found = NULL;
+		if (getaddrinfo(host, NULL, &hints, &found) != 0 || found == NULL)
+			return -1;
+		uint32_t address = ((const struct sockaddr_in *)found->ai_addr)->sin_addr.s_addr;
+		freeaddrinfo(found);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		for (int c = 0; c < MAX_TUIO_CLIENTS; c++)
+		{
+			Client &client = clients[c];
+			if (client.Active)
+				continue;
+
+			client.Active = true;
+			client.Address = address;
+			client.Port = htons(port);
+			client.Queue.assign(queueCapacity, -1);
+			client.Head = 0;
+			client.Count = 0;
+			memset(&client.Stats, 0, sizeof(client.Stats));
+			return c;
+		}
+		return -1;
+	}
+
+	void TuioServer::removeClient(int client)
+	{
+		if (client < 0 || client >= MAX_TUIO_CLIENTS)
+			return;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		Client &removed = clients[client];
+		for (; removed.Count > 0; removed.Count--)
+		{
+			release(removed.Queue[removed.Head]);
+			removed.Head = (removed.Head + 1) % queueCapacity;
+			queued--;
+		}
+		removed.Active = false;
+	}
+
+	int TuioServer::getClientCount() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		int count = 0;
+		for (int c = 0; c < MAX_TUIO_CLIENTS; c++)
+			count += clients[c].Active ? 1 : 0;
+		return count;
+	}
+
+	void TuioServer::release(int frame)
+	{
+		if (--frames[frame].References == 0)
+			freeFrames.push_back(frame);
+	}
+
+	int32_t TuioServer::publish(const TuioCursor *cursors, int count)
+	{
+		int32_t number = ++frameNumber;
+		uint64_t now = Instrumentation::now();
+		//Encoded outside the lock, the frame belongs to this thread until it is queued.
+		if (writing != -1)
+		{
+			Frame &frame = frames[writing];
+			frame.Size = encodeTuioFrame(cursors, count, number, frame.Data, sizeof(frame.Data));
+			frame.Published = now;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stats.Frames++;
+			if (writing != -1 && frames[writing].Size > 0)
+			{
+				int references = 0;
+				for (int c = 0; c < MAX_TUIO_CLIENTS; c++)
+				{
+					Client &client = clients[c];
+					if (!client.Active)
+						continue;
+
+					if (client.Count == queueCapacity)
+					{
+						release(client.Queue[client.Head]);
+						client.Head = (client.Head + 1) % queueCapacity;
+						client.Count--;
+						client.Stats.Dropped++;
+						stats.Dropped++;
+						queued--;
+					}
+					client.Queue[(client.Head + client.Count) % queueCapacity] = writing;
+					client.Count++;
+					queued++;
+					references++;
+				}
+				frames[writing].References = references;
+				//Without clients the frame is simply written again next time.
+				if (references > 0)
+					writing = -1;
+			}
+			if (writing == -1 && !freeFrames.empty())
+			{
+				writing = freeFrames.back();
+				freeFrames.pop_back();
+			}
+		}
+		wake.notify_one();
+		return number;
+	}
+
+	int TuioServer::takeBatch(BatchEntry *batch)
+	{
+		//Round robin one frame per client, so a client with a long queue does not
+		//keep the others waiting.
+		int count = 0;
+		bool any = true;
+		while (any && count < TUIO_SEND_BATCH)
+		{
+			any = false;
+			for (int i = 0; i < MAX_TUIO_CLIENTS && count < TUIO_SEND_BATCH; i++)
+			{
+				int c = (nextClient + i) % MAX_TUIO_CLIENTS;
+				Client &client = clients[c];
+				if (!client.Active || client.Count == 0)
+					continue;
+
+				BatchEntry &entry = batch[count++];
+				entry.Frame = client.Queue[client.Head];
+				entry.Client = c;
+				entry.Address = client.Address;
+				entry.Port = client.Port;
+				client.Head = (client.Head + 1) % queueCapacity;
+				client.Count--;
+				queued--;
+				any = true;
+			}
+		}
+		nextClient = (nextClient + 1) % MAX_TUIO_CLIENTS;
+		return count;
+	}
+
+	void TuioServer::sendBatch(const BatchEntry *batch, int count, bool *sent)
+	{
+		struct sockaddr_in addresses[TUIO_SEND_BATCH];
+		memset(addresses, 0, sizeof(addresses));
+		for (int i = 0; i < count; i++)
+		{
+			addresses[i].sin_family = AF_INET;
+			addresses[i].sin_addr.s_addr = batch[i].Address;
+			addresses[i].sin_port = batch[i].Port;
+		}
+
+#if defined(__linux__)
+		struct iovec vectors[TUIO_SEND_BATCH];
+		struct mmsghdr messages[TUIO_SEND_BATCH];
+		memset(messages, 0, sizeof(messages));
+		for (int i = 0; i < count; i++)
+		{
+			const Frame &frame = frames[batch[i].Frame];
+			vectors[i].iov_base = (void *)frame.Data;
+			vectors[i].iov_len = frame.Size;
+			messages[i].msg_hdr.msg_name = &addresses[i];
+			messages[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+			messages[i].msg_hdr.msg_iov = &vectors[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		int done = 0;
+		while (done < count)
+		{
+			int result = sendmmsg((int)socket, messages + done, count - done, 0);
+			if (result < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				//The first one failed, the rest is tried again without it.
+				sent[done++] = false;
+				continue;
+			}
+			for (int i = done; i < done + result; i++)
+				sent[i] = true;
+			done += result;
+		}
+#else
+		for (int i = 0; i < count; i++)
+		{
+			const Frame &frame = frames[batch[i].Frame];
+			sent[i] = sendto((SOCKET)socket, (const char *)frame.Data, (int)frame.Size, 0,
+				(const struct sockaddr *)&addresses[i], sizeof(addresses[i])) == (int)frame.Size;
+		}
+#endif
+
+		uint64_t now = Instrumentation::now();
+		for (int i = 0; i < count; i++)
+		{
+			if (sent[i])
+				sendLatency.record(now - frames[batch[i].Frame].Published);
+		}
+	}
+
+	void TuioServer::senderMain()
+	{
+		BatchEntry batch[TUIO_SEND_BATCH];
+		bool sent[TUIO_SEND_BATCH];
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			wake.wait(lock, [this]() { return stopping || queued > 0; });
+			if (stopping)
+				return;
+
+			int count = takeBatch(batch);
+			lock.unlock();
+			sendBatch(batch, count, sent);
+			lock.lock();
+
+			stats.Batches++;
+			for (int i = 0; i < count; i++)
+			{
+				//The slot may have been given to another client meanwhile.
+				Client &client = clients[batch[i].Client];
+				bool same = client.Active && client.Address == batch[i].Address && client.Port == batch[i].Port;
+				if (sent[i])
+				{
+					stats.Sent++;
+					if (same)
+						client.Stats.Sent++;
+				}
+				else
+				{
+					stats.Errors++;
+					if (same)
+						client.Stats.Errors++;
+				}
+				release(batch[i].Frame);
+			}
+		}
+	}
+
+	TuioServerStats TuioServer::getStats() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return stats;
+	}
+
+	TuioClientStats TuioServer::getClientStats(int client) const
+	{
+		TuioClientStats result;
+		memset(&result, 0, sizeof(result));
+		if (client < 0 || client >= MAX_TUIO_CLIENTS)
+			return result;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		return clients[client].Stats;
+	}
+
+}
@@ -0,0 +1,143 @@
+// TuioServer.h
+//
+// TUIO output to any number of consumers, in place of the single
+// OSCTransmitter of TUIOProviderHandler that sends inline on the pipeline
+// thread. publish() encodes a frame once and queues it for every client;
+// a sender thread of its own sends the queued bundles from one socket,
+// batched with sendmmsg on Linux. The pipeline thread only ever takes a
+// short lock, it never waits for the network.
+//
+// Every client has a bounded queue. When the sender falls behind, the oldest
+// frame of a full queue is dropped, a TUIO consumer only wants the newest
+// state anyway. Encoded frames are shared by the queues and come from a fixed
+// pool, so publishing does not allocate.
+//
+// Clients are IPv4 UDP endpoints; multicast groups work the same, with a TTL
+// of 1 so they stay on the local network.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../Diagnostics/LatencyHistogram.h"
+#include "TuioEncoder.h"
+
+namespace TouchmoteCore {
+
+	static const int MAX_TUIO_CLIENTS = 32;
+	//Datagrams of one sendmmsg call.
+	static const int TUIO_SEND_BATCH = 64;
+
+	struct TuioClientStats
+	{
+		uint64_t Sent;
+		uint64_t Dropped;
+		uint64_t Errors;
+	};
+
+	struct TuioServerStats
+	{
+		uint64_t Frames;
+		uint64_t Sent;
+		//Frames dropped from full queues.
+		uint64_t Dropped;
+		uint64_t Errors;
+		uint64_t Batches;
+	};
+
+	class TuioServer
+	{
+	public:
+		//Opens the socket and starts the sender thread. queueCapacity is the
+		//number of frames a client may fall behind. NULL if there is no socket.
+		static TuioServer *create(int queueCapacity);
+		~TuioServer();
+
+		//host is an IPv4 address or name, port the tuio_port of the consumer.
+		//Returns the client's id, -1 if the host is not found or
+		//MAX_TUIO_CLIENTS are registered already.
+		int addClient(const char *host, uint16_t port);
+		//Frames still queued for it are dropped.
+		void removeClient(int client);
+		int getClientCount() const;
+
+		//Pipeline thread: the frame that TUIOProviderHandler.processEventFrame would
+		//send. Returns the frame number of its fseq.
+		int32_t publish(const TuioCursor *cursors, int count);
+
+		TuioServerStats getStats() const;
+		TuioClientStats getClientStats(int client) const;
+		//Nanoseconds from publish() to the datagram being handed to the socket.
+		//Written by the sender thread, a snapshot may be taken any time.
+		const LatencyHistogram &getSendLatency() const { return sendLatency; }
+
+	private:
+		struct Frame
+		{
+			uint8_t Data[TUIO_MAX_PACKET];
+			size_t Size;
+			//Queue entries and batch entries pointing at it.
+			int References;
+			uint64_t Published;
+		};
+
+		struct Client
+		{
+			bool Active;
+			//Network byte order.
+			uint32_t Address;
+			uint16_t Port;
+			//Ring of frame indices, Count of them from Head on.
+			std::vector<int> Queue;
+			int Head;
+			int Count;
+			TuioClientStats Stats;
+		};
+
+		struct BatchEntry
+		{
+			int Frame;
+			int Client;
+			uint32_t Address;
+			uint16_t Port;
+		};
+
+		TuioServer(intptr_t socket, int queueCapacity);
+		TuioServer(const TuioServer &);
+		TuioServer &operator=(const TuioServer &);
+
+		void release(int frame);
+		int takeBatch(BatchEntry *batch);
+		//Sends the batch and returns which of them went out.
+		void sendBatch(const BatchEntry *batch, int count, bool *sent);
+		void senderMain();
+
+		intptr_t socket;
+		int queueCapacity;
+
+		mutable std::mutex mutex;
+		std::condition_variable wake;
+		bool stopping;
+		std::vector<Frame> frames;
+		//Frames that are not queued, being sent or written.
+		std::vector<int> freeFrames;
+		//Queue entries of all clients.
+		int queued;
+		//Owned by the thread in publish(), taken out of freeFrames.
+		int writing;
+		int32_t frameNumber;
+		Client clients[MAX_TUIO_CLIENTS];
+		//Round robin start of the next batch.
+		int nextClient;
+		TuioServerStats stats;
+
+		LatencyHistogram sendLatency;
+		std::thread sender;
+	};
+
+}
@@ -0,0 +1,169 @@
+// UinputGamepadSink.cpp
+
+#include "UinputGamepadSink.h"
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/uinput.h>
+
+namespace TouchmoteCore {
+
+	struct ButtonCode
+	{
+		uint16_t Button;
+		uint16_t Code;
+	};
+
+	//The mapping of xpad, the d-pad is the hat.
+	static const ButtonCode BUTTON_CODES[] = {
+		{ XINPUT_BUTTON_A, BTN_A },
+		{ XINPUT_BUTTON_B, BTN_B },
+		{ XINPUT_BUTTON_X, BTN_X },
+		{ XINPUT_BUTTON_Y, BTN_Y },
+		{ XINPUT_BUTTON_LEFT_SHOULDER, BTN_TL },
+		{ XINPUT_BUTTON_RIGHT_SHOULDER, BTN_TR },
+		{ XINPUT_BUTTON_BACK, BTN_SELECT },
+		{ XINPUT_BUTTON_START, BTN_START },
+		{ XINPUT_BUTTON_GUIDE, BTN_MODE },
+		{ XINPUT_BUTTON_LEFT_THUMB, BTN_THUMBL },
+		{ XINPUT_BUTTON_RIGHT_THUMB, BTN_THUMBR },
+	};
+
+	static const uint16_t DPAD_BUTTONS = XINPUT_BUTTON_DPAD_UP | XINPUT_BUTTON_DPAD_DOWN | XINPUT_BUTTON_DPAD_LEFT | XINPUT_BUTTON_DPAD_RIGHT;
+
+	static int32_t getHat(uint16_t buttons, uint16_t negative, uint16_t positive)
+	{
+		return ((buttons & positive) != 0 ? 1 : 0) - ((buttons & negative) != 0 ? 1 : 0);
+	}
+
+	//Evdev has y growing downwards; xpad flips it the same way.
+	static int32_t flipY(int16_t value)
+	{
+		return ~(int32_t)value;
+	}
+
+	UinputGamepadSink *UinputGamepadSink::create(const char *name)
+	{
+		int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+		if (fd == -1)
+			return NULL;
+
+		bool ok = ioctl(fd, UI_SET_EVBIT, EV_SYN) == 0
+			&& ioctl(fd, UI_SET_EVBIT, EV_KEY) == 0
+			&& ioctl(fd, UI_SET_EVBIT, EV_ABS) == 0;
+		for (size_t b = 0; ok && b < sizeof(BUTTON_CODES) / sizeof(BUTTON_CODES[0]); b++)
+			ok = ioctl(fd, UI_SET_KEYBIT, BUTTON_CODES[b].Code) == 0;
+
+		struct uinput_user_dev device;
+		memset(&device, 0, sizeof(device));
+		strncpy(device.name, name, UINPUT_MAX_NAME_SIZE - 1);
+		device.id.bustype = BUS_VIRTUAL;
+		device.id.vendor = 0x045e;
+		device.id.product = 0x028e;
+		device.id.version = 1;
+		static const int sticks[] = { ABS_X, ABS_Y, ABS_RX, ABS_RY };
+		for (size_t a = 0; ok && a < sizeof(sticks) / sizeof(sticks[0]); a++)
+		{
+			ok = ioctl(fd, UI_SET_ABSBIT, sticks[a]) == 0;
+			device.absmin[sticks[a]] = -32768;
+			device.absmax[sticks[a]] = 32767;
+			device.absfuzz[sticks[a]] = 16;
+			device.absflat[sticks[a]] = 128;
+		}
+		static const int triggers[] = { ABS_Z, ABS_RZ };
+		for (size_t a = 0; ok && a < sizeof(triggers) / sizeof(triggers[0]); a++)
+		{
+			ok = ioctl(fd, UI_SET_ABSBIT, triggers[a]) == 0;
+			device.absmax[triggers[a]] = 255;
+		}
+		static const int hats[] = { ABS_HAT0X, ABS_HAT0Y };
+		for (size_t a = 0; ok && a < sizeof(hats) / sizeof(hats[0]); a++)
+		{
+			ok = ioctl(fd, UI_SET_ABSBIT, hats[a]) == 0;
+			device.absmin[hats[a]] = -1;
+			device.absmax[hats[a]] = 1;
+		}
+
+		ok = ok && write(fd, &device, sizeof(device)) == (ssize_t)sizeof(device) && ioctl(fd, UI_DEV_CREATE) == 0;
+		if (!ok)
+		{
+			close(fd);
+			return NULL;
+		}
+		return new UinputGamepadSink(fd, true);
+	}
+
+	UinputGamepadSink::UinputGamepadSink(int fd, bool destroy)
+		: fd(fd), destroy(destroy), buttons(0), eventCount(0)
+	{
+		memset(events, 0, sizeof(events));
+	}
+
+	UinputGamepadSink::~UinputGamepadSink()
+	{
+		if (destroy)
+			ioctl(fd, UI_DEV_DESTROY);
+		close(fd);
+	}
+
+	void UinputGamepadSink::add(uint16_t type, uint16_t code, int32_t value)
+	{
+		struct input_event &event = events[eventCount++];
+		event.type = type;
+		event.code = code;
+		event.value = value;
+	}
+
+	bool UinputGamepadSink::send(const XinputGamepadReport &report, uint32_t changed, uint64_t)
+	{
+		eventCount = 0;
+		if ((changed & GAMEPAD_CHANGED_BUTTONS) != 0)
+		{
+			uint16_t toggled = (uint16_t)(report.Buttons ^ buttons);
+			for (size_t b = 0; b < sizeof(BUTTON_CODES) / sizeof(BUTTON_CODES[0]); b++)
+			{
+				if ((toggled & BUTTON_CODES[b].Button) != 0)
+					add(EV_KEY, BUTTON_CODES[b].Code, (report.Buttons & BUTTON_CODES[b].Button) != 0 ? 1 : 0);
+			}
+			if ((toggled & DPAD_BUTTONS) != 0)
+			{
+				add(EV_ABS, ABS_HAT0X, getHat(report.Buttons, XINPUT_BUTTON_DPAD_LEFT, XINPUT_BUTTON_DPAD_RIGHT));
+				add(EV_ABS, ABS_HAT0Y, getHat(report.Buttons, XINPUT_BUTTON_DPAD_UP, XINPUT_BUTTON_DPAD_DOWN));
+			}
+		}
+		if ((changed & GAMEPAD_CHANGED_THUMB_LX) != 0)
+			add(EV_ABS, ABS_X, report.ThumbLX);
+		if ((changed & GAMEPAD_CHANGED_THUMB_LY) != 0)
+			add(EV_ABS, ABS_Y, flipY(report.ThumbLY));
+		if ((changed & GAMEPAD_CHANGED_THUMB_RX) != 0)
+			add(EV_ABS, ABS_RX, report.ThumbRX);
+		if ((changed & GAMEPAD_CHANGED_THUMB_RY) != 0)
+			add(EV_ABS, ABS_RY, flipY(report.ThumbRY));
+		if ((changed & GAMEPAD_CHANGED_LEFT_TRIGGER) != 0)
+			add(EV_ABS, ABS_Z, report.LeftTrigger);
+		if ((changed & GAMEPAD_CHANGED_RIGHT_TRIGGER) != 0)
+			add(EV_ABS, ABS_RZ, report.RightTrigger);
+		add(EV_SYN, SYN_REPORT, 0);
+
+		size_t size = eventCount * sizeof(struct input_event);
+		eventCount = 0;
+		ssize_t written;
+		do
+		{
+			written = write(fd, events, size);
+		} while (written < 0 && errno == EINTR);
+		if (written != (ssize_t)size)
+			return false;
+
+		buttons = report.Buttons;
+		return true;
+	}
+
+}
+
+#endif
@@ -0,0 +1,52 @@
+// UinputGamepadSink.h
+//
+// GamepadSink for Linux: a virtual Xbox 360 controller through uinput, with
+// the buttons and axes the xpad driver gives a real one, so games and SDL see
+// the same controller. Only the fields that changed are written, all in one
+// write() ending with SYN_REPORT, so the report path can be run and its
+// latency measured on Linux.
+
+#pragma once
+
+#if defined(__linux__)
+
+#include <stdint.h>
+#include <linux/input.h>
+
+#include "GamepadReport.h"
+
+namespace TouchmoteCore {
+
+	class UinputGamepadSink : public GamepadSink
+	{
+	public:
+		//Creates the device on /dev/uinput. NULL if uinput is not available or
+		//not writable.
+		static UinputGamepadSink *create(const char *name);
+
+		//Writes the events to fd, which it closes when done. With destroy the fd is
+		//a uinput device and is destroyed first.
+		UinputGamepadSink(int fd, bool destroy);
+		~UinputGamepadSink();
+
+		virtual bool send(const XinputGamepadReport &report, uint32_t changed, uint64_t timestamp);
+
+	private:
+		UinputGamepadSink(const UinputGamepadSink &);
+		UinputGamepadSink &operator=(const UinputGamepadSink &);
+
+		void add(uint16_t type, uint16_t code, int32_t value);
+
+		int fd;
+		bool destroy;
+		//Buttons written last, to find the ones that changed.
+		uint16_t buttons;
+
+		//Up to 16 buttons, the two hat axes, sticks and triggers and SYN_REPORT.
+		struct input_event events[16 + 2 + 6 + 1];
+		int eventCount;
+	};
+
+}
+
+#endif
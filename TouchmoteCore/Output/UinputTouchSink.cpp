@@ -0,0 +1,210 @@
+// UinputTouchSink.cpp
+
+#include "UinputTouchSink.h"
+
+#if defined(__linux__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/uinput.h>
+
+namespace TouchmoteCore {
+
+	UinputTouchSink *UinputTouchSink::create(int width, int height, const char *name)
+	{
+		int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+		if (fd == -1)
+			return NULL;
+
+		static const int absolute[] = { ABS_X, ABS_Y, ABS_MT_SLOT, ABS_MT_TRACKING_ID, ABS_MT_POSITION_X, ABS_MT_POSITION_Y };
+		bool ok = ioctl(fd, UI_SET_EVBIT, EV_SYN) == 0
+			&& ioctl(fd, UI_SET_EVBIT, EV_KEY) == 0
+			&& ioctl(fd, UI_SET_KEYBIT, BTN_TOUCH) == 0
+			&& ioctl(fd, UI_SET_EVBIT, EV_ABS) == 0
+			&& ioctl(fd, UI_SET_PROPBIT, INPUT_PROP_DIRECT) == 0;
+		for (size_t a = 0; ok && a < sizeof(absolute) / sizeof(absolute[0]); a++)
+			ok = ioctl(fd, UI_SET_ABSBIT, absolute[a]) == 0;
+
+		struct uinput_user_dev device;
+		memset(&device, 0, sizeof(device));
+		strncpy(device.name, name, UINPUT_MAX_NAME_SIZE - 1);
+		device.id.bustype = BUS_VIRTUAL;
+		device.id.vendor = 0x057e;
+		device.id.product = 0x0306;
+		device.id.version = 1;
+		device.absmax[ABS_X] = device.absmax[ABS_MT_POSITION_X] = width - 1;
+		device.absmax[ABS_Y] = device.absmax[ABS_MT_POSITION_Y] = height - 1;
+		device.absmax[ABS_MT_SLOT] = UINPUT_TOUCH_SLOTS - 1;
+		device.absmax[ABS_MT_TRACKING_ID] = 65535;
+
+		ok = ok && write(fd, &device, sizeof(device)) == (ssize_t)sizeof(device) && ioctl(fd, UI_DEV_CREATE) == 0;
+		if (!ok)
+		{
+			close(fd);
+			return NULL;
+		}
+		return new UinputTouchSink(fd, true);
+	}
+
+	UinputTouchSink::UinputTouchSink(int fd, bool destroy)
+		: fd(fd), destroy(destroy), trackingId(0), touching(false), currentSlot(-1), eventCount(0)
+	{
+		memset(slots, 0, sizeof(slots));
+		memset(events, 0, sizeof(events));
+	}
+
+	UinputTouchSink::~UinputTouchSink()
+	{
+		if (destroy)
+			ioctl(fd, UI_DEV_DESTROY);
+		close(fd);
+	}
+
+	int UinputTouchSink::findSlot(uint32_t id) const
+	{
+		for (int s = 0; s < UINPUT_TOUCH_SLOTS; s++)
+		{
+			if (slots[s].Active && slots[s].ID == id)
+				return s;
+		}
+		return -1;
+	}
+
+	int UinputTouchSink::findFreeSlot() const
+	{
+		for (int s = 0; s < UINPUT_TOUCH_SLOTS; s++)
+		{
+			if (!slots[s].Active)
+				return s;
+		}
+		return -1;
+	}
+
+	void UinputTouchSink::add(uint16_t type, uint16_t code, int32_t value)
+	{
+		struct input_event &event = events[eventCount++];
+		event.type = type;
+		event.code = code;
+		event.value = value;
+	}
+
+	void UinputTouchSink::selectSlot(int slot)
+	{
+		if (slot != currentSlot)
+			add(EV_ABS, ABS_MT_SLOT, slot);
+		currentSlot = slot;
+	}
+
+	bool UinputTouchSink::flush()
+	{
+		bool anyActive = false;
+		int first = -1;
+		for (int s = 0; s < UINPUT_TOUCH_SLOTS; s++)
+		{
+			if (slots[s].Active && first == -1)
+				first = s;
+			anyActive = anyActive || slots[s].Active;
+		}
+		if (anyActive != touching)
+			add(EV_KEY, BTN_TOUCH, anyActive ? 1 : 0);
+		touching = anyActive;
+		//Single touch emulation follows the lowest slot.
+		if (first != -1)
+		{
+			add(EV_ABS, ABS_X, slots[first].X);
+			add(EV_ABS, ABS_Y, slots[first].Y);
+		}
+		add(EV_SYN, SYN_REPORT, 0);
+
+		size_t size = eventCount * sizeof(struct input_event);
+		eventCount = 0;
+		ssize_t written;
+		do
+		{
+			written = write(fd, events, size);
+		} while (written < 0 && errno == EINTR);
+		return written == (ssize_t)size;
+	}
+
+	bool UinputTouchSink::inject(const TouchPointer *pointers, int count, uint64_t)
+	{
+		eventCount = 0;
+
+		//Lifts first, so their slots can be taken by new contacts of the same frame.
+		for (int i = 0; i < count; i++)
+		{
+			const TouchPointer &pointer = pointers[i];
+			if ((pointer.Flags & TOUCH_FLAG_INCONTACT) != 0)
+				continue;
+
+			int slot = findSlot(pointer.ID);
+			if (slot == -1)
+				continue;
+
+			selectSlot(slot);
+			add(EV_ABS, ABS_MT_TRACKING_ID, -1);
+			slots[slot].Active = false;
+		}
+
+		for (int i = 0; i < count; i++)
+		{
+			const TouchPointer &pointer = pointers[i];
+			if ((pointer.Flags & TOUCH_FLAG_INCONTACT) == 0)
+				continue;
+
+			int slot = findSlot(pointer.ID);
+			if (slot == -1)
+			{
+				slot = findFreeSlot();
+				if (slot == -1)
+					continue;
+
+				selectSlot(slot);
+				add(EV_ABS, ABS_MT_TRACKING_ID, trackingId);
+				trackingId = (trackingId + 1) & 0xffff;
+				slots[slot].Active = true;
+				slots[slot].ID = pointer.ID;
+				//Always sent for a new contact.
+				slots[slot].X = pointer.X + 1;
+				slots[slot].Y = pointer.Y + 1;
+			}
+
+			TouchSlot &touch = slots[slot];
+			if (pointer.X != touch.X)
+			{
+				selectSlot(slot);
+				add(EV_ABS, ABS_MT_POSITION_X, pointer.X);
+				touch.X = pointer.X;
+			}
+			if (pointer.Y != touch.Y)
+			{
+				selectSlot(slot);
+				add(EV_ABS, ABS_MT_POSITION_Y, pointer.Y);
+				touch.Y = pointer.Y;
+			}
+		}
+
+		return flush();
+	}
+
+	bool UinputTouchSink::reset()
+	{
+		eventCount = 0;
+		for (int s = 0; s < UINPUT_TOUCH_SLOTS; s++)
+		{
+			if (!slots[s].Active)
+				continue;
+
+			selectSlot(s);
+			add(EV_ABS, ABS_MT_TRACKING_ID, -1);
+			slots[s].Active = false;
+		}
+		return flush();
+	}
+
+}
+
+#endif
@@ -0,0 +1,70 @@
+// UinputTouchSink.h
+//
+// TouchSink for Linux: a virtual touchscreen through uinput, speaking the
+// multitouch protocol B. Every contact in contact gets a slot and a tracking
+// id, hovering contacts are not reported. A frame is written with one write()
+// and ends with SYN_REPORT, so the stage can be run and measured on Linux.
+
+#pragma once
+
+#if defined(__linux__)
+
+#include <stdint.h>
+#include <linux/input.h>
+
+#include "TouchOutputStage.h"
+
+namespace TouchmoteCore {
+
+	//Contacts touching at the same time, more are dropped.
+	static const int UINPUT_TOUCH_SLOTS = 16;
+
+	class UinputTouchSink : public TouchSink
+	{
+	public:
+		//Creates the device on /dev/uinput for a screen of the given size. NULL
+		//if uinput is not available or not writable.
+		static UinputTouchSink *create(int width, int height, const char *name);
+
+		//Writes the events to fd, which it closes when done. With destroy the fd is
+		//a uinput device and is destroyed first.
+		UinputTouchSink(int fd, bool destroy);
+		~UinputTouchSink();
+
+		virtual bool inject(const TouchPointer *pointers, int count, uint64_t timestamp);
+		virtual bool reset();
+
+	private:
+		UinputTouchSink(const UinputTouchSink &);
+		UinputTouchSink &operator=(const UinputTouchSink &);
+
+		struct TouchSlot
+		{
+			bool Active;
+			uint32_t ID;
+			int32_t X;
+			int32_t Y;
+		};
+
+		int findSlot(uint32_t id) const;
+		int findFreeSlot() const;
+		void add(uint16_t type, uint16_t code, int32_t value);
+		void selectSlot(int slot);
+		bool flush();
+
+		int fd;
+		bool destroy;
+		int trackingId;
+		bool touching;
+		int currentSlot;
+		TouchSlot slots[UINPUT_TOUCH_SLOTS];
+
+		//A frame: per slot at most a lift and a new contact, then the single
+		//touch events and SYN_REPORT.
+		struct input_event events[UINPUT_TOUCH_SLOTS * 6 + 8];
+		int eventCount;
+	};
+
+}
+
+#endif
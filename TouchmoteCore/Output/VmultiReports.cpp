@@ -0,0 +1,173 @@
+// VmultiReports.cpp
+
+#include "VmultiReports.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace TouchmoteCore {
+
+	bool MemoryVmultiSink::send(VmultiReportType type, const uint8_t *report, size_t length)
+	{
+		if (Failing || length > sizeof(Record().Data))
+			return false;
+
+		Record record = Record();
+		record.Type = type;
+		memcpy(record.Data, report, length);
+		record.Length = length;
+		Records.push_back(record);
+		return true;
+	}
+
+	VmultiReportAccumulator::VmultiReportAccumulator(VmultiSink &sink)
+		: sink(sink)
+	{
+		memset(&stats, 0, sizeof(stats));
+		reset();
+		lastKeyboard = keyboard;
+		lastMouse = mouse;
+		lastJoystick = joystick;
+	}
+
+	bool VmultiReportAccumulator::keyDown(uint8_t usage)
+	{
+		for (int k = 0; k < VMULTI_KEYBOARD_KEYS; k++)
+		{
+			if (keyboard.Keys[k] == usage)
+				return true;
+			if (keyboard.Keys[k] == 0)
+			{
+				keyboard.Keys[k] = usage;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void VmultiReportAccumulator::keyUp(uint8_t usage)
+	{
+		uint8_t *end = keyboard.Keys + VMULTI_KEYBOARD_KEYS;
+		uint8_t *key = std::find(keyboard.Keys, end, usage);
+		if (key == end)
+			return;
+
+		//Keep the keys that are left in the order they went down.
+		memmove(key, key + 1, end - key - 1);
+		end[-1] = 0;
+	}
+
+	void VmultiReportAccumulator::moveMouse(int x, int y)
+	{
+		mouseX += x;
+		mouseY += y;
+	}
+
+	void VmultiReportAccumulator::scroll(int wheel)
+	{
+		mouseWheel += wheel;
+	}
+
+	void VmultiReportAccumulator::setJoystickButton(int button, bool down)
+	{
+		if (button < 0 || button >= 16)
+			return;
+
+		uint8_t bit = (uint8_t)(1 << (button % 8));
+		if (down)
+			joystick.Buttons[button / 8] |= bit;
+		else
+			joystick.Buttons[button / 8] &= (uint8_t)~bit;
+	}
+
+	void VmultiReportAccumulator::setAxis(JoystickAxis axis, uint8_t value)
+	{
+		switch (axis)
+		{
+		case JoystickAxis::X: joystick.X = value; break;
+		case JoystickAxis::Y: joystick.Y = value; break;
+		case JoystickAxis::RX: joystick.RX = value; break;
+		case JoystickAxis::RY: joystick.RY = value; break;
+		}
+	}
+
+	void VmultiReportAccumulator::reset()
+	{
+		memset(&keyboard, 0, sizeof(keyboard));
+		keyboard.ReportID = VMULTI_REPORTID_KEYBOARD;
+		memset(&mouse, 0, sizeof(mouse));
+		mouse.ReportID = VMULTI_REPORTID_RELATIVE_MOUSE;
+		memset(&joystick, 0, sizeof(joystick));
+		joystick.ReportID = VMULTI_REPORTID_JOYSTICK;
+		joystick.Hat = VMULTI_HAT_CENTER;
+		joystick.X = joystick.Y = joystick.RX = joystick.RY = 128;
+		mouseX = 0;
+		mouseY = 0;
+		mouseWheel = 0;
+	}
+
+	static int8_t takeMotion(int &pending)
+	{
+		int value = std::max(-127, std::min(127, pending));
+		pending -= value;
+		return (int8_t)value;
+	}
+
+	bool VmultiReportAccumulator::send(VmultiReportType type, const void *report, void *last, size_t length, bool changed)
+	{
+		if (!changed)
+		{
+			stats.Suppressed[(int)type]++;
+			return false;
+		}
+		if (!sink.send(type, (const uint8_t *)report, length))
+		{
+			stats.Failures++;
+			return false;
+		}
+		memcpy(last, report, length);
+		stats.Sent[(int)type]++;
+		return true;
+	}
+
+	int VmultiReportAccumulator::flush(bool force)
+	{
+		int sent = 0;
+		if (send(VmultiReportType::Keyboard, &keyboard, &lastKeyboard, sizeof(keyboard), force || memcmp(&keyboard, &lastKeyboard, sizeof(keyboard)) != 0))
+			sent++;
+
+		//Motion is taken out of the pending amount only once it was sent.
+		int x = mouseX;
+		int y = mouseY;
+		int wheel = mouseWheel;
+		mouse.X = takeMotion(x);
+		mouse.Y = takeMotion(y);
+		mouse.Wheel = takeMotion(wheel);
+		bool moved = mouse.X != 0 || mouse.Y != 0 || mouse.Wheel != 0;
+		if (send(VmultiReportType::Mouse, &mouse, &lastMouse, sizeof(mouse), force || moved || mouse.Buttons != lastMouse.Buttons))
+		{
+			mouseX = x;
+			mouseY = y;
+			mouseWheel = wheel;
+			sent++;
+		}
+
+		if (send(VmultiReportType::Joystick, &joystick, &lastJoystick, sizeof(joystick), force || memcmp(&joystick, &lastJoystick, sizeof(joystick)) != 0))
+			sent++;
+		return sent;
+	}
+
+	int VmultiReportAccumulator::endUpdate()
+	{
+		stats.Updates++;
+		return flush(false);
+	}
+
+	int VmultiReportAccumulator::releaseAll()
+	{
+		reset();
+		stats.Updates++;
+		return flush(true);
+	}
+
+}
@@ -0,0 +1,179 @@
+// VmultiReports.h
+//
+// Native counterpart of the report handling of VmultiKeyboardHandler: every
+// output action of a frame changes one preallocated report per vmulti device,
+// and endUpdate() sends each report at most once. A keyboard or joystick
+// report that is byte for byte what was sent last is not sent again, so a
+// keymap firing several key changes in one frame, or none at all, costs the
+// driver one report or nothing. Mouse motion is relative and always sent while
+// there is some.
+//
+// Reports have the layout of the vmulti HID reports, report id first, so a
+// sink can hand them to the driver as they are.
+//
+// Not thread safe; actions and updates come from the frame thread.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace TouchmoteCore {
+
+	enum class VmultiReportType
+	{
+		Keyboard,
+		Mouse,
+		Joystick
+	};
+
+	static const int VMULTI_REPORT_TYPES = 3;
+
+	//Report ids of vmulti.
+	static const uint8_t VMULTI_REPORTID_JOYSTICK = 0x02;
+	static const uint8_t VMULTI_REPORTID_RELATIVE_MOUSE = 0x04;
+	static const uint8_t VMULTI_REPORTID_KEYBOARD = 0x07;
+
+	//Keys down at the same time, the boot keyboard limit. More are ignored, like
+	//KeyboardReport of the wrapper does.
+	static const int VMULTI_KEYBOARD_KEYS = 6;
+	//Hat switch value without a direction, 0..7 are the directions clockwise from up.
+	static const uint8_t VMULTI_HAT_CENTER = 8;
+
+	struct VmultiKeyboardReport
+	{
+		uint8_t ReportID;
+		//KeyboardModifier bits.
+		uint8_t Modifiers;
+		uint8_t Reserved;
+		//HID usages in the order they went down, 0 for unused.
+		uint8_t Keys[VMULTI_KEYBOARD_KEYS];
+	};
+
+	struct VmultiMouseReport
+	{
+		uint8_t ReportID;
+		uint8_t Buttons;
+		int8_t X;
+		int8_t Y;
+		int8_t Wheel;
+	};
+
+	struct VmultiJoystickReport
+	{
+		uint8_t ReportID;
+		uint8_t Buttons[2];
+		uint8_t Hat;
+		uint8_t X;
+		uint8_t Y;
+		uint8_t RX;
+		uint8_t RY;
+	};
+
+	class VmultiSink
+	{
+	public:
+		virtual ~VmultiSink() {}
+
+		//One report, length bytes starting with the report id. Returns false on failure.
+		virtual bool send(VmultiReportType type, const uint8_t *report, size_t length) = 0;
+	};
+
+	//Keeps every report sent, for checking what the driver would have seen.
+	class MemoryVmultiSink : public VmultiSink
+	{
+	public:
+		struct Record
+		{
+			VmultiReportType Type;
+			//Bytes of the report, the rest is zero.
+			uint8_t Data[16];
+			size_t Length;
+		};
+
+		MemoryVmultiSink() : Failing(false) {}
+
+		//While set, send() fails and records nothing.
+		bool Failing;
+		std::vector<Record> Records;
+
+		virtual bool send(VmultiReportType type, const uint8_t *report, size_t length);
+	};
+
+	enum class JoystickAxis
+	{
+		X,
+		Y,
+		RX,
+		RY
+	};
+
+	struct VmultiReportStats
+	{
+		uint64_t Updates;
+		uint64_t Sent[VMULTI_REPORT_TYPES];
+		//Reports that were the same as the last one sent.
+		uint64_t Suppressed[VMULTI_REPORT_TYPES];
+		uint64_t Failures;
+	};
+
+	class VmultiReportAccumulator
+	{
+	public:
+		explicit VmultiReportAccumulator(VmultiSink &sink);
+
+		//Keyboard, usage is a KeyboardKey, mask a KeyboardModifier. keyDown returns
+		//false if VMULTI_KEYBOARD_KEYS keys are down already.
+		bool keyDown(uint8_t usage);
+		void keyUp(uint8_t usage);
+		void modifierDown(uint8_t mask) { keyboard.Modifiers |= mask; }
+		void modifierUp(uint8_t mask) { keyboard.Modifiers &= (uint8_t)~mask; }
+
+		//Mouse, motion adds up until the next update.
+		void mouseButtonDown(uint8_t mask) { mouse.Buttons |= mask; }
+		void mouseButtonUp(uint8_t mask) { mouse.Buttons &= (uint8_t)~mask; }
+		void moveMouse(int x, int y);
+		void scroll(int wheel);
+
+		//Joystick, buttons 0..15, axes 0..255 with 128 in the middle.
+		void setJoystickButton(int button, bool down);
+		void setHat(uint8_t hat) { joystick.Hat = hat; }
+		void setAxis(JoystickAxis axis, uint8_t value);
+
+		//Sends every report that changed since it was last sent, once. The driver
+		//starts out with everything up, so that counts as sent. Motion beyond what
+		//a mouse report holds is kept for the next update. Returns the number of
+		//reports sent; a report that failed goes again next time.
+		int endUpdate();
+
+		//Everything up and centered, sent with the next endUpdate(), what reset()
+		//of the handler did with a new KeyboardReport.
+		void reset();
+		//reset() and sending all three reports whether they changed or not, for
+		//disconnect, since the driver may have missed a release.
+		int releaseAll();
+
+		const VmultiKeyboardReport &keyboardReport() const { return keyboard; }
+		const VmultiJoystickReport &joystickReport() const { return joystick; }
+		const VmultiReportStats &getStats() const { return stats; }
+
+	private:
+		int flush(bool force);
+		bool send(VmultiReportType type, const void *report, void *last, size_t length, bool changed);
+
+		VmultiSink &sink;
+		VmultiKeyboardReport keyboard;
+		VmultiKeyboardReport lastKeyboard;
+		VmultiMouseReport mouse;
+		VmultiMouseReport lastMouse;
+		VmultiJoystickReport joystick;
+		VmultiJoystickReport lastJoystick;
+		//Motion not sent yet.
+		int mouseX;
+		int mouseY;
+		int mouseWheel;
+		VmultiReportStats stats;
+	};
+
+}
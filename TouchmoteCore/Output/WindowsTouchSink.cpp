@@ -0,0 +1,98 @@
+// WindowsTouchSink.cpp
+
+#include "WindowsTouchSink.h"
+
+#if defined(_WIN32)
+
+#if !defined(_WIN32_WINNT) || _WIN32_WINNT < 0x0602
+#undef _WIN32_WINNT
+#define _WIN32_WINNT 0x0602
+#endif
+#include <windows.h>
+#include <string.h>
+
+namespace TouchmoteCore {
+
+	WindowsTouchSink::WindowsTouchSink(bool feedback)
+		: feedback(feedback), available(false), infos(new POINTER_TOUCH_INFO[MAX_TOUCH_CONTACTS])
+	{
+		memset(infos, 0, sizeof(POINTER_TOUCH_INFO) * MAX_TOUCH_CONTACTS);
+		active.reserve(MAX_TOUCH_CONTACTS);
+		available = initialize();
+	}
+
+	WindowsTouchSink::~WindowsTouchSink()
+	{
+		delete[] (POINTER_TOUCH_INFO *)infos;
+	}
+
+	bool WindowsTouchSink::initialize()
+	{
+		return InitializeTouchInjection(MAX_TOUCH_CONTACTS, feedback ? TOUCH_FEEDBACK_INDIRECT : TOUCH_FEEDBACK_NONE) != FALSE;
+	}
+
+	bool WindowsTouchSink::inject(const TouchPointer *pointers, int count, uint64_t)
+	{
+		if (!available)
+			return false;
+		if (count > MAX_TOUCH_CONTACTS)
+			count = MAX_TOUCH_CONTACTS;
+
+		//Same fields as processEventFrame sets, the rest stays zero.
+		POINTER_TOUCH_INFO *touches = (POINTER_TOUCH_INFO *)infos;
+		LARGE_INTEGER counter;
+		QueryPerformanceCounter(&counter);
+		for (int i = 0; i < count; i++)
+		{
+			POINTER_INFO &info = touches[i].pointerInfo;
+			info.pointerType = PT_TOUCH;
+			info.pointerId = pointers[i].ID;
+			info.ptPixelLocation.x = pointers[i].X;
+			info.ptPixelLocation.y = pointers[i].Y;
+			info.pointerFlags = pointers[i].Flags;
+			info.PerformanceCount = (UINT64)counter.QuadPart;
+		}
+		if (InjectTouchInput((UINT32)count, touches) == FALSE)
+			return false;
+
+		for (int i = 0; i < count; i++)
+		{
+			size_t a = 0;
+			while (a < active.size() && active[a].ID != pointers[i].ID)
+				a++;
+			bool inRange = (pointers[i].Flags & TOUCH_FLAG_INRANGE) != 0 && (pointers[i].Flags & TOUCH_FLAG_UP) == 0;
+			if (inRange && a == active.size())
+				active.push_back(pointers[i]);
+			else if (inRange)
+				active[a] = pointers[i];
+			else if (a < active.size())
+				active.erase(active.begin() + a);
+		}
+		return true;
+	}
+
+	bool WindowsTouchSink::reset()
+	{
+		if (available && !active.empty())
+		{
+			POINTER_TOUCH_INFO *touches = (POINTER_TOUCH_INFO *)infos;
+			for (size_t a = 0; a < active.size(); a++)
+			{
+				POINTER_INFO &info = touches[a].pointerInfo;
+				info.pointerType = PT_TOUCH;
+				info.pointerId = active[a].ID;
+				info.ptPixelLocation.x = active[a].X;
+				info.ptPixelLocation.y = active[a].Y;
+				info.pointerFlags = POINTER_FLAG_UP | POINTER_FLAG_CANCELED;
+				info.PerformanceCount = 0;
+			}
+			InjectTouchInput((UINT32)active.size(), touches);
+		}
+		active.clear();
+		available = initialize();
+		return available;
+	}
+
+}
+
+#endif
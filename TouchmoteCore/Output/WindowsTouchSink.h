@@ -0,0 +1,49 @@
+// WindowsTouchSink.h
+//
+// TouchSink on InjectTouchInput, what TouchInjectProviderHandler uses through
+// TCD.System.TouchInjection. Needs Windows 8. The POINTER_TOUCH_INFO array is
+// allocated once and filled in place every frame.
+
+#pragma once
+
+#if defined(_WIN32)
+
+#include <stdint.h>
+#include <vector>
+
+#include "TouchOutputStage.h"
+
+namespace TouchmoteCore {
+
+	class WindowsTouchSink : public TouchSink
+	{
+	public:
+		//feedback false is TOUCH_FEEDBACK_NONE, what pointer_customCursor selects.
+		explicit WindowsTouchSink(bool feedback);
+		~WindowsTouchSink();
+
+		//False if InitializeTouchInjection failed, before Windows 8 for example.
+		bool isAvailable() const { return available; }
+
+		virtual bool inject(const TouchPointer *pointers, int count, uint64_t timestamp);
+		//Cancels the pointers that are still down and initializes injection again.
+		virtual bool reset();
+
+	private:
+		WindowsTouchSink(const WindowsTouchSink &);
+		WindowsTouchSink &operator=(const WindowsTouchSink &);
+
+		bool initialize();
+
+		bool feedback;
+		bool available;
+		//POINTER_TOUCH_INFO[MAX_TOUCH_CONTACTS], kept opaque so this header does
+		//not need the Windows 8 SDK definitions.
+		void *infos;
+		//Pointers in range after the last injection.
+		std::vector<TouchPointer> active;
+	};
+
+}
+
+#endif
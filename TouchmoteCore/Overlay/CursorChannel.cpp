@@ -0,0 +1,223 @@
+// CursorChannel.cpp
+
+#include "CursorChannel.h"
+
+#include <atomic>
+#include <string.h>
+
+#include "MultiMonitorOverlay.h"
+
+namespace TouchmoteCore {
+
+	//The atomics are shared between processes, which only works if they are lock free.
+	static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "cursor channel needs lock free atomics");
+
+	static const uint32_t CHANNEL_MAGIC = 0x4343544d; //"MTCC"
+	static const uint32_t CHANNEL_VERSION = 1;
+	static const size_t CACHE_LINE = 64;
+	//Attempts of a read before it gives up until the next call.
+	static const int READ_ATTEMPTS = 4;
+
+	struct ChannelHeader
+	{
+		//Written last by the writer's constructor.
+		std::atomic<uint32_t> Magic;
+		uint32_t Version;
+		uint32_t FrameCount;
+		uint32_t StateSize;
+		//Number of the newest complete frame, 0 before the first. Frame n is in
+		//ring entry n % CURSOR_CHANNEL_FRAMES.
+		std::atomic<uint64_t> Latest;
+	};
+
+	struct ChannelFrame
+	{
+		//2n - 1 while frame n is written, 2n once it is complete.
+		std::atomic<uint64_t> Sequence;
+		uint64_t Reserved;
+		CursorChannelState State;
+	};
+
+	static size_t roundToCacheLine(size_t size)
+	{
+		return (size + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+	}
+
+	//The header and every frame on cache lines of their own.
+	static const size_t HEADER_SIZE = roundToCacheLine(sizeof(ChannelHeader));
+	static const size_t FRAME_SIZE = roundToCacheLine(sizeof(ChannelFrame));
+
+	size_t getCursorChannelSize()
+	{
+		return HEADER_SIZE + CURSOR_CHANNEL_FRAMES * FRAME_SIZE;
+	}
+
+	static ChannelHeader &getHeader(const unsigned char *memory)
+	{
+		return *(ChannelHeader *)memory;
+	}
+
+	static ChannelFrame &getFrame(const unsigned char *memory, uint64_t frame)
+	{
+		return *(ChannelFrame *)(memory + HEADER_SIZE + (size_t)(frame % CURSOR_CHANNEL_FRAMES) * FRAME_SIZE);
+	}
+
+	CursorChannelWriter::CursorChannelWriter(void *memory)
+		: memory((unsigned char *)memory), published(0)
+	{
+		memset(&next, 0, sizeof(next));
+
+		//Numbering goes on from an earlier writer, so a reader that saw its
+		//frames does not mistake an old ring entry for a new one.
+		ChannelHeader &header = getHeader(this->memory);
+		if (header.Magic.load(std::memory_order_acquire) == CHANNEL_MAGIC)
+			published = header.Latest.load(std::memory_order_relaxed);
+		header.Version = CHANNEL_VERSION;
+		header.FrameCount = CURSOR_CHANNEL_FRAMES;
+		header.StateSize = (uint32_t)sizeof(CursorChannelState);
+		header.Latest.store(published, std::memory_order_relaxed);
+		header.Magic.store(CHANNEL_MAGIC, std::memory_order_release);
+	}
+
+	void CursorChannelWriter::addCursor(int id, uint32_t color)
+	{
+		if (id < 0 || id >= MAX_OVERLAY_CURSORS)
+			return;
+
+		//Starts over like CursorOverlay::addCursor.
+		CursorChannelCursor &cursor = next.Cursors[id];
+		uint8_t generation = (uint8_t)(cursor.Generation + 1);
+		memset(&cursor, 0, sizeof(cursor));
+		cursor.Enabled = 1;
+		cursor.Color = color;
+		cursor.Generation = generation;
+	}
+
+	void CursorChannelWriter::removeCursor(int id)
+	{
+		if (id >= 0 && id < MAX_OVERLAY_CURSORS)
+			next.Cursors[id].Enabled = 0;
+	}
+
+	void CursorChannelWriter::setPosition(int id, int x, int y)
+	{
+		if (id < 0 || id >= MAX_OVERLAY_CURSORS)
+			return;
+
+		next.Cursors[id].X = x;
+		next.Cursors[id].Y = y;
+	}
+
+	void CursorChannelWriter::setPressed(int id, bool pressed)
+	{
+		if (id >= 0 && id < MAX_OVERLAY_CURSORS)
+			next.Cursors[id].Pressed = pressed ? 1 : 0;
+	}
+
+	void CursorChannelWriter::setHidden(int id, bool hidden)
+	{
+		if (id >= 0 && id < MAX_OVERLAY_CURSORS)
+			next.Cursors[id].Hidden = hidden ? 1 : 0;
+	}
+
+	void CursorChannelWriter::setWindow(int x, int y, int width, int height, bool topmost)
+	{
+		next.WindowX = x;
+		next.WindowY = y;
+		next.WindowWidth = width;
+		next.WindowHeight = height;
+		next.Topmost = topmost ? 1 : 0;
+	}
+
+	void CursorChannelWriter::publish(uint64_t timestamp)
+	{
+		published++;
+		next.Timestamp = timestamp;
+
+		ChannelFrame &frame = getFrame(memory, published);
+		frame.Sequence.store(2 * published - 1, std::memory_order_relaxed);
+		//Keeps the copy from moving above the odd sequence.
+		std::atomic_thread_fence(std::memory_order_release);
+		memcpy(&frame.State, &next, sizeof(next));
+		frame.Sequence.store(2 * published, std::memory_order_release);
+		getHeader(memory).Latest.store(published, std::memory_order_release);
+	}
+
+	CursorChannelReader::CursorChannelReader(const void *memory)
+		: memory((const unsigned char *)memory), lastFrame(0), skipped(0), retries(0)
+	{
+	}
+
+	bool CursorChannelReader::read(CursorChannelState &state)
+	{
+		ChannelHeader &header = getHeader(memory);
+		if (header.Magic.load(std::memory_order_acquire) != CHANNEL_MAGIC || header.Version != CHANNEL_VERSION
+			|| header.StateSize != sizeof(CursorChannelState))
+			return false;
+
+		//As in any seqlock the copy may race with the writer; the sequence tells
+		//whether it did, and such a copy is thrown away.
+		CursorChannelState copy;
+		for (int attempt = 0; attempt < READ_ATTEMPTS; attempt++)
+		{
+			uint64_t latest = header.Latest.load(std::memory_order_acquire);
+			if (latest == 0 || latest == lastFrame)
+				return false;
+
+			ChannelFrame &frame = getFrame(memory, latest);
+			uint64_t sequence = frame.Sequence.load(std::memory_order_acquire);
+			if (sequence == 2 * latest)
+			{
+				memcpy(&copy, &frame.State, sizeof(copy));
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (frame.Sequence.load(std::memory_order_relaxed) == sequence)
+				{
+					if (latest > lastFrame)
+						skipped += latest - lastFrame - 1;
+					lastFrame = latest;
+					state = copy;
+					return true;
+				}
+			}
+			retries++;
+		}
+		return false;
+	}
+
+	template<typename Overlay> static void applyChanges(Overlay &overlay, const CursorChannelState &previous, const CursorChannelState &current, double now)
+	{
+		for (int id = 0; id < MAX_OVERLAY_CURSORS; id++)
+		{
+			const CursorChannelCursor &before = previous.Cursors[id];
+			const CursorChannelCursor &after = current.Cursors[id];
+			if (!after.Enabled)
+			{
+				if (before.Enabled)
+					overlay.removeCursor(id);
+				continue;
+			}
+
+			//A new cursor starts out neither pressed nor hidden.
+			bool added = !before.Enabled || before.Generation != after.Generation;
+			if (added)
+				overlay.addCursor(id, after.Color);
+			if (added || before.X != after.X || before.Y != after.Y)
+				overlay.setPosition(id, after.X, after.Y);
+			if (after.Pressed != (added ? 0 : before.Pressed))
+				overlay.setPressed(id, after.Pressed != 0, now);
+			if (after.Hidden != (added ? 0 : before.Hidden))
+				overlay.setHidden(id, after.Hidden != 0, now);
+		}
+	}
+
+	void applyCursorState(CursorOverlay &overlay, const CursorChannelState &previous, const CursorChannelState &current, double now)
+	{
+		applyChanges(overlay, previous, current, now);
+	}
+
+	void applyCursorState(MultiMonitorOverlay &overlay, const CursorChannelState &previous, const CursorChannelState &current, double now)
+	{
+		applyChanges(overlay, previous, current, now);
+	}
+
+}
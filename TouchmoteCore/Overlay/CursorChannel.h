@@ -0,0 +1,123 @@
+// CursorChannel.h
+//
+// Cursor state from the app to an overlay renderer in another process, through
+// shared memory instead of a DllImport call per change on the UI dispatcher.
+// The region holds a header and a ring of CURSOR_CHANNEL_FRAMES frames, each
+// guarded by its own sequence number (a seqlock). The writer fills the next
+// frame of the ring and then points the header at it; a reader copies the
+// newest frame and checks the sequence did not change meanwhile.
+//
+// The writer never waits: a reader that stalls or crashes halfway through a
+// copy cannot hold up input processing, it only has to retry. With a ring the
+// writer has to lap it before it touches the frame a reader is copying, so
+// retries are rare even at input rate. A reader never waits either, it gives
+// up after a few attempts and keeps the state it has.
+//
+// One writer, any number of readers. The layout has no pointers; the header
+// records the frame size, and a reader of another build refuses a channel
+// whose size does not match.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "CursorOverlay.h"
+
+namespace TouchmoteCore {
+
+	static const int CURSOR_CHANNEL_FRAMES = 4;
+
+	class MultiMonitorOverlay;
+
+	struct CursorChannelCursor
+	{
+		int32_t X;
+		int32_t Y;
+		uint32_t Color;
+		uint8_t Enabled;
+		uint8_t Pressed;
+		uint8_t Hidden;
+		//Counts addCursor calls, so a cursor removed and added again between two
+		//frames still starts over.
+		uint8_t Generation;
+	};
+
+	struct CursorChannelState
+	{
+		//Nanoseconds on the steady clock when the writer published it, which is
+		//CLOCK_MONOTONIC on Linux and the same in every process.
+		uint64_t Timestamp;
+		//Overlay window, what StartD3DCursorWindow and SetD3DCursorWindowPosition get.
+		int32_t WindowX;
+		int32_t WindowY;
+		int32_t WindowWidth;
+		int32_t WindowHeight;
+		float CursorScale;
+		uint32_t Topmost;
+		CursorChannelCursor Cursors[MAX_OVERLAY_CURSORS];
+	};
+
+	//Bytes of shared memory a channel needs.
+	size_t getCursorChannelSize();
+
+	class CursorChannelWriter
+	{
+	public:
+		//memory is getCursorChannelSize() bytes, zeroed or left by an earlier
+		//writer. Readers see the channel once the constructor returns.
+		explicit CursorChannelWriter(void *memory);
+
+		//Same calls as the D3DCursor exports. They change the next frame only,
+		//publish() hands it to the readers. Ids outside 0..MAX_OVERLAY_CURSORS-1
+		//are ignored.
+		void addCursor(int id, uint32_t color);
+		void removeCursor(int id);
+		void setPosition(int id, int x, int y);
+		void setPressed(int id, bool pressed);
+		void setHidden(int id, bool hidden);
+		void setWindow(int x, int y, int width, int height, bool topmost);
+		void setCursorScale(float scale) { next.CursorScale = scale; }
+
+		//Timestamp in steady clock nanoseconds. Wait free.
+		void publish(uint64_t timestamp);
+
+		uint64_t getPublished() const { return published; }
+
+	private:
+		CursorChannelWriter(const CursorChannelWriter &);
+		CursorChannelWriter &operator=(const CursorChannelWriter &);
+
+		unsigned char *memory;
+		CursorChannelState next;
+		uint64_t published;
+	};
+
+	class CursorChannelReader
+	{
+	public:
+		//memory is the same region, mapped in this process.
+		explicit CursorChannelReader(const void *memory);
+
+		//Copies the newest state if the writer published one since the last read.
+		//Returns false and leaves state alone if there is nothing new, no writer
+		//yet, or the writer overwrote the frame on every attempt.
+		bool read(CursorChannelState &state);
+
+		//Frames published but never read, and copies that had to be retried.
+		uint64_t getSkipped() const { return skipped; }
+		uint64_t getRetries() const { return retries; }
+
+	private:
+		const unsigned char *memory;
+		uint64_t lastFrame;
+		uint64_t skipped;
+		uint64_t retries;
+	};
+
+	//Applies the changes from previous to current to the overlay, now is the
+	//animation clock of setPressed and setHidden. The window is left to the caller.
+	void applyCursorState(CursorOverlay &overlay, const CursorChannelState &previous, const CursorChannelState &current, double now);
+	void applyCursorState(MultiMonitorOverlay &overlay, const CursorChannelState &previous, const CursorChannelState &current, double now);
+
+}
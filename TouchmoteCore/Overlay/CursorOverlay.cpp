@@ -0,0 +1,199 @@
+// CursorOverlay.cpp
+
+#include "CursorOverlay.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace TouchmoteCore {
+
+	float easeInOutQuint(float elapsedTime, float startValue, float changeInValue, float duration)
+	{
+		elapsedTime /= duration / 2;
+		if (elapsedTime < 1) return changeInValue / 2 * elapsedTime * elapsedTime * elapsedTime * elapsedTime * elapsedTime + startValue;
+		elapsedTime -= 2;
+		return changeInValue / 2 * (elapsedTime * elapsedTime * elapsedTime * elapsedTime * elapsedTime + 2) + startValue;
+	}
+
+	OverlayCursor::OverlayCursor()
+		: X(0), Y(0), Rotation(0), LastRenderedX(0), LastRenderedY(0), Scaling(0), SnapshotScaling(0),
+		Hidden(false), Enabled(false), Pressed(false), Color(0), AnimationStart(0)
+	{
+	}
+
+	void CursorScales::recalculate(float screenRelativeScale, int surfaceWidth)
+	{
+		Normal = (screenRelativeScale * surfaceWidth) / CURSOR_SPRITE_SIZE;
+		Pressed = 0.8f * Normal;
+	}
+
+	void stepCursorAnimation(OverlayCursor &cursor, const CursorScales &scales, double now)
+	{
+		float target = cursor.Hidden ? scales.Hidden : (cursor.Pressed ? scales.Pressed : scales.Normal);
+
+		if (cursor.Scaling == target)
+		{
+
+		}
+		else if (std::fabs(cursor.Scaling - target) > 0.01)
+		{
+			float diff = (float)(now - cursor.AnimationStart);
+			cursor.Scaling = easeInOutQuint(diff, cursor.SnapshotScaling, target - cursor.SnapshotScaling, CURSOR_ANIMATION_DURATION);
+		}
+		else
+		{
+			cursor.Scaling = target;
+		}
+
+		if (cursor.Scaling < 0)
+		{
+			cursor.Scaling = scales.Hidden;
+		}
+
+		if (cursor.Scaling > scales.Normal)
+		{
+			cursor.Scaling = scales.Normal;
+		}
+	}
+
+	CursorOverlay::CursorOverlay()
+		: removedCount(0), enabledCount(0)
+	{
+		bounds.Left = bounds.Top = bounds.Right = bounds.Bottom = 0;
+	}
+
+	void CursorOverlay::setCursorScale(float screenRelativeScale, int surfaceWidth)
+	{
+		cursorScales.recalculate(screenRelativeScale, surfaceWidth);
+	}
+
+	void CursorOverlay::addCursor(int id, uint32_t color)
+	{
+		if (id < 0 || id >= MAX_OVERLAY_CURSORS)
+			return;
+
+		if (!cursors[id].Enabled)
+			enabledCount++;
+
+		OverlayCursor cursor;
+		cursor.Scaling = cursorScales.Normal;
+		cursor.Enabled = true;
+		cursor.Color = color;
+		cursors[id] = cursor;
+	}
+
+	void CursorOverlay::removeCursor(int id)
+	{
+		if (id < 0 || id >= MAX_OVERLAY_CURSORS || !cursors[id].Enabled)
+			return;
+
+		cursors[id].Enabled = false;
+		enabledCount--;
+		if (removedCount < MAX_OVERLAY_CURSORS)
+		{
+			removedX[removedCount] = cursors[id].LastRenderedX;
+			removedY[removedCount] = cursors[id].LastRenderedY;
+			removedCount++;
+		}
+	}
+
+	void CursorOverlay::setPosition(int id, int x, int y)
+	{
+		if (id < 0 || id >= MAX_OVERLAY_CURSORS)
+			return;
+
+		cursors[id].X = (float)x;
+		cursors[id].Y = (float)y;
+	}
+
+	void CursorOverlay::setPressed(int id, bool pressed, double now)
+	{
+		if (id < 0 || id >= MAX_OVERLAY_CURSORS)
+			return;
+
+		OverlayCursor &cursor = cursors[id];
+		if (cursor.Pressed != pressed)
+		{
+			cursor.Pressed = pressed;
+			cursor.AnimationStart = now;
+			cursor.SnapshotScaling = cursor.Scaling;
+		}
+	}
+
+	void CursorOverlay::setHidden(int id, bool hidden, double now)
+	{
+		if (id < 0 || id >= MAX_OVERLAY_CURSORS)
+			return;
+
+		OverlayCursor &cursor = cursors[id];
+		if (cursor.Hidden != hidden)
+		{
+			cursor.Hidden = hidden;
+			cursor.AnimationStart = now;
+			cursor.SnapshotScaling = cursor.Scaling;
+		}
+	}
+
+	DamageRect CursorOverlay::getClearRect(float x, float y) const
+	{
+		//Truncated like the float to LONG conversion into D3DRECT.
+		float half = CURSOR_SPRITE_SIZE * cursorScales.Normal;
+		DamageRect rect;
+		rect.Left = (int32_t)(x - half);
+		rect.Right = (int32_t)(x + half);
+		rect.Top = (int32_t)(y - half);
+		rect.Bottom = (int32_t)(y + half);
+		return rect;
+	}
+
+	void CursorOverlay::stepFrame(double now)
+	{
+		clear.clear();
+		dirty.clear();
+
+		for (int i = 0; i < MAX_OVERLAY_CURSORS; i++)
+		{
+			if (cursors[i].Enabled)
+				clear.push_back(getClearRect(cursors[i].LastRenderedX, cursors[i].LastRenderedY));
+		}
+		for (int i = 0; i < removedCount; i++)
+			clear.push_back(getClearRect(removedX[i], removedY[i]));
+		removedCount = 0;
+
+		dirty.insert(dirty.end(), clear.begin(), clear.end());
+
+		for (int i = 0; i < MAX_OVERLAY_CURSORS; i++)
+		{
+			OverlayCursor &cursor = cursors[i];
+			if (!cursor.Enabled)
+				continue;
+
+			cursor.LastRenderedX = cursor.X;
+			cursor.LastRenderedY = cursor.Y;
+
+			float x = cursor.X - (CURSOR_SPRITE_SIZE / 2);
+			float y = cursor.Y - (CURSOR_SPRITE_SIZE / 2);
+			DamageRect rect;
+			rect.Left = (int32_t)x;
+			rect.Right = (int32_t)(x + CURSOR_SPRITE_SIZE);
+			rect.Top = (int32_t)y;
+			rect.Bottom = (int32_t)(y + CURSOR_SPRITE_SIZE);
+			dirty.push_back(rect);
+
+			stepCursorAnimation(cursor, cursorScales, now);
+		}
+
+		DamageRect empty = { 0, 0, 0, 0 };
+		dirty.push_back(empty);
+
+		bounds = dirty[0];
+		for (size_t i = 1; i < dirty.size(); i++)
+		{
+			bounds.Left = std::min(bounds.Left, dirty[i].Left);
+			bounds.Right = std::max(bounds.Right, dirty[i].Right);
+			bounds.Top = std::min(bounds.Top, dirty[i].Top);
+			bounds.Bottom = std::max(bounds.Bottom, dirty[i].Bottom);
+		}
+	}
+
+}
@@ -0,0 +1,111 @@
+// CursorOverlay.h
+//
+// Platform independent part of the D3DCursor overlay: the cursor table, the
+// press/hide scale animation and the clear and dirty rectangles of a frame.
+// D3DCursor/main.cpp keeps the Direct3D device and only draws and presents what
+// stepFrame() leaves behind.
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace TouchmoteCore {
+
+	static const int MAX_OVERLAY_CURSORS = 16;
+	static const int CURSOR_SPRITE_SIZE = 128;
+	//Milliseconds.
+	static const float CURSOR_ANIMATION_DURATION = 100;
+
+	float easeInOutQuint(float elapsedTime, float startValue, float changeInValue, float duration);
+
+	//Same layout as a Win32 RECT.
+	struct DamageRect
+	{
+		int32_t Left;
+		int32_t Top;
+		int32_t Right;
+		int32_t Bottom;
+	};
+
+	struct OverlayCursor
+	{
+		float X;
+		float Y;
+		float Rotation;
+		float LastRenderedX;
+		float LastRenderedY;
+		float Scaling;
+		float SnapshotScaling;
+		bool Hidden;
+		bool Enabled;
+		bool Pressed;
+		uint32_t Color;
+		//Milliseconds, on the clock passed to setPressed/setHidden/stepFrame.
+		double AnimationStart;
+
+		OverlayCursor();
+	};
+
+	struct CursorScales
+	{
+		float Normal;
+		float Pressed;
+		float Hidden;
+
+		CursorScales() : Normal(0.5f), Pressed(0.4f), Hidden(0.0f) {}
+
+		//screenRelativeScale is the sprite width as a fraction of the surface width.
+		void recalculate(float screenRelativeScale, int surfaceWidth);
+	};
+
+	//Moves cursor.Scaling towards the scale of its current state.
+	void stepCursorAnimation(OverlayCursor &cursor, const CursorScales &scales, double now);
+
+	class CursorOverlay
+	{
+	public:
+		CursorOverlay();
+
+		void setCursorScale(float screenRelativeScale, int surfaceWidth);
+		const CursorScales &scales() const { return cursorScales; }
+
+		//Ids outside 0..MAX_OVERLAY_CURSORS-1 are ignored.
+		void addCursor(int id, uint32_t color);
+		void removeCursor(int id);
+		void setPosition(int id, int x, int y);
+		void setPressed(int id, bool pressed, double now);
+		void setHidden(int id, bool hidden, double now);
+
+		int getEnabledCount() const { return enabledCount; }
+		const OverlayCursor &cursor(int id) const { return cursors[id]; }
+
+		//Collects the rectangles to clear (where cursors were drawn last frame and
+		//where removed cursors were), moves the cursors to their new position and
+		//steps their animation. The dirty region covers both the cleared and the
+		//newly drawn sprites and ends with the empty rectangle Render() has always
+		//passed to PresentEx. Neither vector reallocates once it has grown.
+		void stepFrame(double now);
+
+		const std::vector<DamageRect> &clearRects() const { return clear; }
+		const std::vector<DamageRect> &dirtyRects() const { return dirty; }
+		//Bounding box of dirtyRects(), including the trailing empty rectangle.
+		const DamageRect &dirtyBounds() const { return bounds; }
+
+	private:
+		DamageRect getClearRect(float x, float y) const;
+
+		OverlayCursor cursors[MAX_OVERLAY_CURSORS];
+		//Last rendered positions of cursors removed since the previous frame.
+		float removedX[MAX_OVERLAY_CURSORS];
+		float removedY[MAX_OVERLAY_CURSORS];
+		int removedCount;
+		int enabledCount;
+		CursorScales cursorScales;
+
+		std::vector<DamageRect> clear;
+		std::vector<DamageRect> dirty;
+		DamageRect bounds;
+	};
+
+}
@@ -0,0 +1,213 @@
+// MultiMonitorOverlay.cpp
+
+#include "MultiMonitorOverlay.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace TouchmoteCore {
+
+	MultiMonitorOverlay::MultiMonitorOverlay()
+		: removed(0), originX(0), originY(0), screenRelativeScale(0.02f)
+	{
+		for (int i = 0; i < MAX_OVERLAY_CURSORS; i++)
+		{
+			RoutedCursor cursor = { 0, 0, 0, false, false, false };
+			cursors[i] = cursor;
+		}
+	}
+
+	void MultiMonitorOverlay::setLayout(const std::vector<MonitorEntry> &entries, int x, int y)
+	{
+		monitors.clear();
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			const DesktopRect &bounds = entries[i].Bounds;
+			if (bounds.Right <= bounds.Left || bounds.Bottom <= bounds.Top)
+				continue;
+
+			monitors.push_back(OverlayMonitor());
+			OverlayMonitor &monitor = monitors.back();
+			monitor.TargetId = entries[i].TargetId;
+			monitor.Bounds = bounds;
+			monitor.Dpi = entries[i].Dpi != 0 ? entries[i].Dpi : DEFAULT_MONITOR_DPI;
+			monitor.DirtyBounds.Left = monitor.DirtyBounds.Top = monitor.DirtyBounds.Right = monitor.DirtyBounds.Bottom = 0;
+			monitor.Present = false;
+			monitor.Cursors = 0;
+		}
+		originX = x;
+		originY = y;
+		removed = 0;
+		applyScales();
+	}
+
+	void MultiMonitorOverlay::setCursorScale(float scale)
+	{
+		screenRelativeScale = scale;
+		applyScales();
+	}
+
+	//The monitor at the origin sets the size, the others scale it by their DPI.
+	void MultiMonitorOverlay::applyScales()
+	{
+		if (monitors.empty())
+			return;
+
+		int reference = findMonitor(originX, originY);
+		if (reference < 0)
+			reference = 0;
+		const OverlayMonitor &base = monitors[reference];
+		double logicalWidth = (double)base.getWidth() * DEFAULT_MONITOR_DPI / base.Dpi;
+		for (size_t i = 0; i < monitors.size(); i++)
+		{
+			int surfaceWidth = (int)std::floor(logicalWidth * monitors[i].Dpi / DEFAULT_MONITOR_DPI + 0.5);
+			monitors[i].Overlay.setCursorScale(screenRelativeScale, surfaceWidth);
+		}
+	}
+
+	void MultiMonitorOverlay::addCursor(int id, uint32_t color)
+	{
+		if (id < 0 || id >= MAX_OVERLAY_CURSORS)
+			return;
+
+		RoutedCursor &cursor = cursors[id];
+		//Starts over on every monitor, like CursorOverlay::addCursor.
+		if (cursor.Enabled)
+			removed |= 1u << id;
+		RoutedCursor added = { cursor.X, cursor.Y, color, true, false, false };
+		cursor = added;
+	}
+
+	void MultiMonitorOverlay::removeCursor(int id)
+	{
+		if (id < 0 || id >= MAX_OVERLAY_CURSORS || !cursors[id].Enabled)
+			return;
+
+		cursors[id].Enabled = false;
+		removed |= 1u << id;
+	}
+
+	void MultiMonitorOverlay::setPosition(int id, int x, int y)
+	{
+		if (id < 0 || id >= MAX_OVERLAY_CURSORS)
+			return;
+
+		cursors[id].X = originX + x;
+		cursors[id].Y = originY + y;
+	}
+
+	void MultiMonitorOverlay::setPressed(int id, bool pressed, double now)
+	{
+		if (id < 0 || id >= MAX_OVERLAY_CURSORS)
+			return;
+
+		cursors[id].Pressed = pressed;
+		for (size_t m = 0; m < monitors.size(); m++)
+		{
+			if (monitors[m].Cursors & (1u << id))
+				monitors[m].Overlay.setPressed(id, pressed, now);
+		}
+	}
+
+	void MultiMonitorOverlay::setHidden(int id, bool hidden, double now)
+	{
+		if (id < 0 || id >= MAX_OVERLAY_CURSORS)
+			return;
+
+		cursors[id].Hidden = hidden;
+		for (size_t m = 0; m < monitors.size(); m++)
+		{
+			if (monitors[m].Cursors & (1u << id))
+				monitors[m].Overlay.setHidden(id, hidden, now);
+		}
+	}
+
+	//Within the area the monitor's overlay clears around the cursor.
+	bool MultiMonitorOverlay::touches(const OverlayMonitor &monitor, const RoutedCursor &cursor) const
+	{
+		float half = CURSOR_SPRITE_SIZE * monitor.Overlay.scales().Normal;
+		return cursor.X + half > monitor.Bounds.Left && cursor.X - half < monitor.Bounds.Right
+			&& cursor.Y + half > monitor.Bounds.Top && cursor.Y - half < monitor.Bounds.Bottom;
+	}
+
+	void MultiMonitorOverlay::clip(const std::vector<DamageRect> &rects, const OverlayMonitor &monitor, std::vector<DamageRect> &clipped)
+	{
+		clipped.clear();
+		for (size_t i = 0; i < rects.size(); i++)
+		{
+			DamageRect rect;
+			rect.Left = std::max(rects[i].Left, 0);
+			rect.Top = std::max(rects[i].Top, 0);
+			rect.Right = std::min(rects[i].Right, monitor.getWidth());
+			rect.Bottom = std::min(rects[i].Bottom, monitor.getHeight());
+			if (rect.Right > rect.Left && rect.Bottom > rect.Top)
+				clipped.push_back(rect);
+		}
+	}
+
+	void MultiMonitorOverlay::stepFrame(double now)
+	{
+		for (size_t m = 0; m < monitors.size(); m++)
+		{
+			OverlayMonitor &monitor = monitors[m];
+			for (int id = 0; id < MAX_OVERLAY_CURSORS; id++)
+			{
+				uint32_t bit = 1u << id;
+				const RoutedCursor &cursor = cursors[id];
+				if ((monitor.Cursors & bit) && ((removed & bit) || !cursor.Enabled))
+				{
+					monitor.Overlay.removeCursor(id);
+					monitor.Cursors &= ~bit;
+				}
+				if (!cursor.Enabled)
+					continue;
+
+				bool member = (monitor.Cursors & bit) != 0;
+				bool on = touches(monitor, cursor) && (member || !cursor.Hidden);
+				if (on && !member)
+				{
+					monitor.Overlay.addCursor(id, cursor.Color);
+					if (cursor.Pressed)
+						monitor.Overlay.setPressed(id, true, now);
+					monitor.Cursors |= bit;
+				}
+				else if (!on && member)
+				{
+					monitor.Overlay.removeCursor(id);
+					monitor.Cursors &= ~bit;
+				}
+				if (on)
+					monitor.Overlay.setPosition(id, cursor.X - monitor.Bounds.Left, cursor.Y - monitor.Bounds.Top);
+			}
+
+			monitor.Overlay.stepFrame(now);
+			clip(monitor.Overlay.clearRects(), monitor, monitor.Clear);
+			clip(monitor.Overlay.dirtyRects(), monitor, monitor.Dirty);
+			monitor.Present = !monitor.Dirty.empty();
+			if (monitor.Present)
+			{
+				monitor.DirtyBounds = monitor.Dirty[0];
+				for (size_t i = 1; i < monitor.Dirty.size(); i++)
+				{
+					monitor.DirtyBounds.Left = std::min(monitor.DirtyBounds.Left, monitor.Dirty[i].Left);
+					monitor.DirtyBounds.Top = std::min(monitor.DirtyBounds.Top, monitor.Dirty[i].Top);
+					monitor.DirtyBounds.Right = std::max(monitor.DirtyBounds.Right, monitor.Dirty[i].Right);
+					monitor.DirtyBounds.Bottom = std::max(monitor.DirtyBounds.Bottom, monitor.Dirty[i].Bottom);
+				}
+			}
+		}
+		removed = 0;
+	}
+
+	int MultiMonitorOverlay::findMonitor(int x, int y) const
+	{
+		for (size_t m = 0; m < monitors.size(); m++)
+		{
+			const DesktopRect &bounds = monitors[m].Bounds;
+			if (x >= bounds.Left && x < bounds.Right && y >= bounds.Top && y < bounds.Bottom)
+				return (int)m;
+		}
+		return -1;
+	}
+
+}
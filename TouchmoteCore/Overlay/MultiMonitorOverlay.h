@@ -0,0 +1,106 @@
+// MultiMonitorOverlay.h
+//
+// The cursor overlay split into one CursorOverlay per monitor, in place of one
+// window spanning the x, y, width, height StartD3DCursorWindow gets. A
+// spanning window presents one surface as large as all monitors together,
+// while each monitor here has a render target of its own size and presents
+// only the damage that falls on it. A monitor without damage presents nothing.
+//
+// Cursor positions come in relative to the overlay origin, what the window
+// position was, and are routed every frame to each monitor the cursor sprite
+// touches, in that monitor's own pixels. A cursor on the border between two
+// monitors is drawn on both. A hidden cursor does not move onto a monitor it
+// was not already on, since there is nothing to show there.
+//
+// Cursors are scaled per monitor by its DPI. screenRelativeScale is still a
+// fraction of the width of the monitor at the origin, as it was of the window;
+// on a monitor with twice that monitor's DPI the cursor gets twice as many
+// pixels, so it has the same size on the wall where a projector has a finer
+// grid. With one monitor the scale is the one CursorOverlay always had.
+//
+// The monitors come from enumerateMonitors, so they can be a fake layout.
+// Not thread safe; the D3DCursor exports and Render() run on one thread.
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "CursorOverlay.h"
+#include "../Devices/MonitorTable.h"
+
+namespace TouchmoteCore {
+
+	struct OverlayMonitor
+	{
+		uint32_t TargetId;
+		//Desktop pixels.
+		DesktopRect Bounds;
+		uint32_t Dpi;
+		//Cursors in monitor pixels, scaled for this monitor.
+		CursorOverlay Overlay;
+		//Clipped to the monitor, in monitor pixels, without empty rectangles.
+		std::vector<DamageRect> Clear;
+		std::vector<DamageRect> Dirty;
+		DamageRect DirtyBounds;
+		//False if nothing changed on the monitor this frame.
+		bool Present;
+		//Bit n is set while cursor n is routed to the monitor.
+		uint32_t Cursors;
+
+		int getWidth() const { return Bounds.Right - Bounds.Left; }
+		int getHeight() const { return Bounds.Bottom - Bounds.Top; }
+	};
+
+	class MultiMonitorOverlay
+	{
+	public:
+		MultiMonitorOverlay();
+
+		//Monitors with empty bounds are left out. originX and originY are where
+		//cursor position 0, 0 is on the desktop. Cursors stay and are routed to
+		//the new monitors with the next frame.
+		void setLayout(const std::vector<MonitorEntry> &monitors, int originX, int originY);
+		void setCursorScale(float screenRelativeScale);
+
+		//Same as CursorOverlay; ids outside 0..MAX_OVERLAY_CURSORS-1 are ignored.
+		void addCursor(int id, uint32_t color);
+		void removeCursor(int id);
+		void setPosition(int id, int x, int y);
+		void setPressed(int id, bool pressed, double now);
+		void setHidden(int id, bool hidden, double now);
+
+		//Routes the cursors and steps the overlay of every monitor.
+		void stepFrame(double now);
+
+		int getMonitorCount() const { return (int)monitors.size(); }
+		const OverlayMonitor &monitor(int index) const { return monitors[index]; }
+		//Index of the monitor at the desktop point, -1 if there is none.
+		int findMonitor(int x, int y) const;
+
+	private:
+		struct RoutedCursor
+		{
+			//Desktop pixels.
+			int X;
+			int Y;
+			uint32_t Color;
+			bool Enabled;
+			bool Pressed;
+			bool Hidden;
+		};
+
+		void applyScales();
+		bool touches(const OverlayMonitor &monitor, const RoutedCursor &cursor) const;
+		static void clip(const std::vector<DamageRect> &rects, const OverlayMonitor &monitor, std::vector<DamageRect> &clipped);
+
+		std::vector<OverlayMonitor> monitors;
+		RoutedCursor cursors[MAX_OVERLAY_CURSORS];
+		//Removed since the last frame, still routed to some monitor.
+		uint32_t removed;
+		int originX;
+		int originY;
+		float screenRelativeScale;
+	};
+
+}
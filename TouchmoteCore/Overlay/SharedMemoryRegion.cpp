@@ -0,0 +1,113 @@
+// SharedMemoryRegion.cpp
+
+#include "SharedMemoryRegion.h"
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace TouchmoteCore {
+
+	SharedMemoryRegion::SharedMemoryRegion(void *memory, size_t length, void *handle)
+		: memory(memory), length(length), handle(handle)
+	{
+	}
+
+#if defined(_WIN32)
+
+	SharedMemoryRegion *SharedMemoryRegion::create(const char *name, size_t size)
+	{
+		HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((uint64_t)size >> 32), (DWORD)size, name);
+		if (mapping == NULL)
+			return NULL;
+
+		//Pages of a new mapping are zero.
+		void *memory = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+		if (memory == NULL)
+		{
+			CloseHandle(mapping);
+			return NULL;
+		}
+		return new SharedMemoryRegion(memory, size, mapping);
+	}
+
+	SharedMemoryRegion *SharedMemoryRegion::open(const char *name, size_t size)
+	{
+		HANDLE mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+		if (mapping == NULL)
+			return NULL;
+
+		void *memory = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+		if (memory == NULL)
+		{
+			CloseHandle(mapping);
+			return NULL;
+		}
+		return new SharedMemoryRegion(memory, size, mapping);
+	}
+
+	SharedMemoryRegion::~SharedMemoryRegion()
+	{
+		UnmapViewOfFile(memory);
+		CloseHandle((HANDLE)handle);
+	}
+
+#else
+
+	static void *mapFile(int fd, size_t size)
+	{
+		void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		return memory != MAP_FAILED ? memory : NULL;
+	}
+
+	SharedMemoryRegion *SharedMemoryRegion::create(const char *name, size_t size)
+	{
+		int fd = ::open(name, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+		if (fd == -1)
+			return NULL;
+
+		//Only ever grown: shrinking or truncating the file would SIGBUS a renderer
+		//that still maps it, and the contents let a new writer continue where an
+		//earlier one stopped. Growing zeroes the new part.
+		struct stat status;
+		if (fstat(fd, &status) != 0 || ((size_t)status.st_size < size && ftruncate(fd, (off_t)size) != 0))
+		{
+			close(fd);
+			return NULL;
+		}
+		void *memory = mapFile(fd, size);
+		return memory != NULL ? new SharedMemoryRegion(memory, size, NULL) : NULL;
+	}
+
+	SharedMemoryRegion *SharedMemoryRegion::open(const char *name, size_t size)
+	{
+		int fd = ::open(name, O_RDWR | O_CLOEXEC);
+		if (fd == -1)
+			return NULL;
+
+		struct stat status;
+		if (fstat(fd, &status) != 0 || (size_t)status.st_size < size)
+		{
+			close(fd);
+			return NULL;
+		}
+		void *memory = mapFile(fd, size);
+		return memory != NULL ? new SharedMemoryRegion(memory, size, NULL) : NULL;
+	}
+
+	SharedMemoryRegion::~SharedMemoryRegion()
+	{
+		munmap(memory, length);
+	}
+
+#endif
+
+}
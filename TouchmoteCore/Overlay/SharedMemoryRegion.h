@@ -0,0 +1,40 @@
+// SharedMemoryRegion.h
+//
+// A block of memory two processes can map at the same time: a file mapped with
+// mmap on Linux, a named file mapping backed by the paging file on Windows. The
+// creator sizes it, others open it by name. A new region starts out zeroed; one
+// that already exists keeps its contents on both systems, so a process that
+// still has it mapped is not cut off. Nothing here synchronizes access; that is
+// up to what is placed in the region.
+
+#pragma once
+
+#include <stddef.h>
+
+namespace TouchmoteCore {
+
+	class SharedMemoryRegion
+	{
+	public:
+		//name is a file path on Linux, e.g. under /dev/shm, and a mapping name on
+		//Windows, e.g. Local\TouchmoteCursors. NULL on failure.
+		static SharedMemoryRegion *create(const char *name, size_t size);
+		//Maps an existing region, which must be at least size bytes. NULL on failure.
+		static SharedMemoryRegion *open(const char *name, size_t size);
+		~SharedMemoryRegion();
+
+		void *data() const { return memory; }
+		size_t size() const { return length; }
+
+	private:
+		SharedMemoryRegion(void *memory, size_t length, void *handle);
+		SharedMemoryRegion(const SharedMemoryRegion &);
+		SharedMemoryRegion &operator=(const SharedMemoryRegion &);
+
+		void *memory;
+		size_t length;
+		//The file mapping on Windows, unused on Linux where the mapping outlives the fd.
+		void *handle;
+	};
+
+}
@@ -0,0 +1,87 @@
+// SoftwareCursorRenderer.cpp
+
+#include "SoftwareCursorRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../Diagnostics/Instrumentation.h"
+
+namespace TouchmoteCore {
+
+	SoftwareCursorRenderer::SoftwareCursorRenderer(int width, int height)
+		: width(std::max(width, 1)), height(std::max(height, 1))
+	{
+		buffer.assign((size_t)this->width * this->height, 0);
+	}
+
+	uint64_t SoftwareCursorRenderer::fill(const DamageRect &rect, uint32_t color)
+	{
+		int left = std::max(rect.Left, 0);
+		int top = std::max(rect.Top, 0);
+		int right = std::min(rect.Right, width);
+		int bottom = std::min(rect.Bottom, height);
+		if (right <= left || bottom <= top)
+			return 0;
+
+		for (int y = top; y < bottom; y++)
+			std::fill(&buffer[(size_t)y * width + left], &buffer[(size_t)y * width + right], color);
+		return (uint64_t)(right - left) * (bottom - top);
+	}
+
+	//Pixels whose centre is inside the circle.
+	uint64_t SoftwareCursorRenderer::drawCircle(const DamageRect &clip, float x, float y, float radius, uint32_t color)
+	{
+		if (radius <= 0)
+			return 0;
+
+		int top = std::max((int)std::floor(y - radius), std::max(clip.Top, 0));
+		int bottom = std::min((int)std::ceil(y + radius), std::min(clip.Bottom, height));
+		int clipLeft = std::max(clip.Left, 0);
+		int clipRight = std::min(clip.Right, width);
+		uint64_t written = 0;
+		for (int row = top; row < bottom; row++)
+		{
+			float dy = row + 0.5f - y;
+			float span = radius * radius - dy * dy;
+			if (span < 0)
+				continue;
+			float half = std::sqrt(span);
+			int left = std::max((int)std::ceil(x - half - 0.5f), clipLeft);
+			int right = std::min((int)std::floor(x + half - 0.5f) + 1, clipRight);
+			if (right <= left)
+				continue;
+			std::fill(&buffer[(size_t)row * width + left], &buffer[(size_t)row * width + right], color);
+			written += right - left;
+		}
+		return written;
+	}
+
+	uint64_t SoftwareCursorRenderer::render(const CursorOverlay &overlay)
+	{
+		StageProbe probe(PipelineStage::Render, 0);
+		uint64_t written = 0;
+		const std::vector<DamageRect> &clear = overlay.clearRects();
+		for (size_t i = 0; i < clear.size(); i++)
+			written += fill(clear[i], 0);
+
+		const std::vector<DamageRect> &dirty = overlay.dirtyRects();
+		for (int id = 0; id < MAX_OVERLAY_CURSORS; id++)
+		{
+			const OverlayCursor &cursor = overlay.cursor(id);
+			if (!cursor.Enabled)
+				continue;
+
+			//The sprite is scaled about its centre, which Render() puts on the cursor.
+			float radius = CURSOR_SPRITE_SIZE / 2 * cursor.Scaling;
+			for (size_t i = 0; i < dirty.size(); i++)
+			{
+				written += drawCircle(dirty[i], cursor.X, cursor.Y, radius, 0xff000000u | cursor.Color);
+				written += drawCircle(dirty[i], cursor.X, cursor.Y, radius * 0.9f, 0xff000000u);
+				written += drawCircle(dirty[i], cursor.X, cursor.Y, radius * 0.45f, 0xffffffffu);
+			}
+		}
+		return written;
+	}
+
+}
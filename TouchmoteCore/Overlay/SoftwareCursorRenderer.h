@@ -0,0 +1,44 @@
+// SoftwareCursorRenderer.h
+//
+// Draws the frames of a CursorOverlay into a 32-bit ARGB buffer, what Render()
+// of D3DCursor does with the device: the clear rectangles go transparent, then
+// every cursor is drawn as the three circles of its sprite, the colour at the
+// cursor's scaling, black at 0.9 of it and white at half of that. Drawing is
+// limited to the dirty rectangles, like PresentEx only shows those. For running
+// the overlay headless, in benchmarks and on systems without Direct3D.
+//
+// The sprite texture is taken to be a filled circle as wide as the sprite, and
+// edges are not antialiased.
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "CursorOverlay.h"
+
+namespace TouchmoteCore {
+
+	class SoftwareCursorRenderer
+	{
+	public:
+		SoftwareCursorRenderer(int width, int height);
+
+		//After overlay.stepFrame(). Returns the number of pixels written.
+		uint64_t render(const CursorOverlay &overlay);
+
+		int getWidth() const { return width; }
+		int getHeight() const { return height; }
+		//Row after row, 0 is transparent.
+		const uint32_t *pixels() const { return &buffer[0]; }
+
+	private:
+		uint64_t fill(const DamageRect &rect, uint32_t color);
+		uint64_t drawCircle(const DamageRect &clip, float x, float y, float radius, uint32_t color);
+
+		int width;
+		int height;
+		std::vector<uint32_t> buffer;
+	};
+
+}
@@ -0,0 +1,47 @@
+// FrameClock.cpp
+
+#include "FrameClock.h"
+
+#include <chrono>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace TouchmoteCore {
+
+	uint64_t SteadyFrameClock::now()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void SteadyFrameClock::sleepFor(uint64_t ns)
+	{
+		std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+	}
+
+	void SteadyFrameClock::relax()
+	{
+		//Lets the other hyperthread run while spinning.
+#if defined(_MSC_VER)
+		_mm_pause();
+#elif defined(__i386__) || defined(__x86_64__)
+		__builtin_ia32_pause();
+#elif defined(__aarch64__)
+		asm volatile("yield");
+#endif
+	}
+
+	VirtualFrameClock::VirtualFrameClock(uint64_t start)
+		: SleepGranularity(1), SleepLatency(0), RelaxTime(1000), time(start)
+	{
+	}
+
+	void VirtualFrameClock::sleepFor(uint64_t ns)
+	{
+		uint64_t granularity = SleepGranularity > 0 ? SleepGranularity : 1;
+		time += (ns + granularity - 1) / granularity * granularity + SleepLatency;
+	}
+
+}
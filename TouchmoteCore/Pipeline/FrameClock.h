@@ -0,0 +1,60 @@
+// FrameClock.h
+//
+// Time source of the FrameScheduler. SteadyFrameClock is the monotonic clock
+// the pipeline runs on; VirtualFrameClock only moves when it is told to, so a
+// scheduler can be run through hours of frames in a moment and with sleeps as
+// coarse as a Windows timer tick.
+
+#pragma once
+
+#include <stdint.h>
+
+namespace TouchmoteCore {
+
+	class FrameClock
+	{
+	public:
+		virtual ~FrameClock() {}
+
+		//Nanoseconds, never goes backwards.
+		virtual uint64_t now() = 0;
+		//Sleeps at least ns, usually longer.
+		virtual void sleepFor(uint64_t ns) = 0;
+		//One iteration of a busy wait.
+		virtual void relax() = 0;
+	};
+
+	//std::chrono::steady_clock, which is QueryPerformanceCounter on Windows and
+	//CLOCK_MONOTONIC on Linux.
+	class SteadyFrameClock : public FrameClock
+	{
+	public:
+		virtual uint64_t now();
+		virtual void sleepFor(uint64_t ns);
+		virtual void relax();
+	};
+
+	class VirtualFrameClock : public FrameClock
+	{
+	public:
+		explicit VirtualFrameClock(uint64_t start = 0);
+
+		//A sleep is rounded up to a multiple of SleepGranularity and then lasts
+		//SleepLatency longer, like a timer interrupt driven sleep.
+		uint64_t SleepGranularity;
+		uint64_t SleepLatency;
+		//How long one relax() takes.
+		uint64_t RelaxTime;
+
+		//Simulates work taking ns.
+		void advance(uint64_t ns) { time += ns; }
+
+		virtual uint64_t now() { return time; }
+		virtual void sleepFor(uint64_t ns);
+		virtual void relax() { time += RelaxTime; }
+
+	private:
+		uint64_t time;
+	};
+
+}
@@ -0,0 +1,156 @@
+// FrameScheduler.cpp
+
+#include "FrameScheduler.h"
+
+#include <algorithm>
+
+namespace TouchmoteCore {
+
+	FrameScheduler::FrameScheduler(FrameClock &clock, uint64_t period)
+		: MinSpin(50000),
+		MaxSpin(2000000),
+		clock(clock),
+		period(period > 0 ? period : 1),
+		nextDeadline(0),
+		frameStart(0),
+		spinWindow(1000000),
+		frames(0),
+		overruns(0),
+		skippedFrames(0)
+	{
+	}
+
+	uint64_t FrameScheduler::getPeriodForFPS(int fps)
+	{
+		return 1000000000ull / (uint64_t)(fps > 0 ? fps : 1);
+	}
+
+	void FrameScheduler::setPeriod(uint64_t period)
+	{
+		if (period == 0 || period == this->period)
+			return;
+
+		nextDeadline = nextDeadline - this->period + period;
+		this->period = period;
+	}
+
+	void FrameScheduler::start()
+	{
+		nextDeadline = clock.now() + period;
+	}
+
+	void FrameScheduler::observeSleep(uint64_t requested, uint64_t slept)
+	{
+		//Jumps up to any larger overshoot straight away and decays by 1/256 per sleep,
+		//so a single slow wakeup widens the window for a few seconds of frames.
+		uint64_t overshoot = slept > requested ? slept - requested : 0;
+		spinWindow = std::max(overshoot + overshoot / 4, spinWindow - spinWindow / 256);
+		spinWindow = std::min(std::max(spinWindow, MinSpin), MaxSpin);
+	}
+
+	uint64_t FrameScheduler::waitForFrame()
+	{
+		uint64_t deadline = nextDeadline;
+		uint64_t now = clock.now();
+
+		if (now >= deadline + period)
+		{
+			uint64_t missed = (now - deadline) / period;
+			deadline += missed * period;
+			skippedFrames.store(skippedFrames.load(std::memory_order_relaxed) + missed, std::memory_order_relaxed);
+		}
+
+		while (now < deadline)
+		{
+			uint64_t remaining = deadline - now;
+			if (remaining > spinWindow)
+			{
+				uint64_t requested = remaining - spinWindow;
+				clock.sleepFor(requested);
+				uint64_t woke = clock.now();
+				observeSleep(requested, woke - now);
+				now = woke;
+			}
+			else
+			{
+				clock.relax();
+				now = clock.now();
+			}
+		}
+
+		lateness.record(now - deadline);
+		frameStart = now;
+		nextDeadline = deadline + period;
+		return deadline;
+	}
+
+	void FrameScheduler::endFrame()
+	{
+		uint64_t now = clock.now();
+		work.record(now - frameStart);
+		frames.store(frames.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		if (now > nextDeadline)
+			overruns.store(overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	void FrameScheduler::getStats(FrameSchedulerStats &stats) const
+	{
+		stats.Frames = frames.load(std::memory_order_relaxed);
+		stats.Overruns = overruns.load(std::memory_order_relaxed);
+		stats.SkippedFrames = skippedFrames.load(std::memory_order_relaxed);
+		stats.Lateness = HistogramSnapshot();
+		stats.Lateness.add(lateness);
+		stats.Work = HistogramSnapshot();
+		stats.Work.add(work);
+	}
+
+	void FrameScheduler::resetStats()
+	{
+		frames.store(0, std::memory_order_relaxed);
+		overruns.store(0, std::memory_order_relaxed);
+		skippedFrames.store(0, std::memory_order_relaxed);
+		lateness.reset();
+		work.reset();
+	}
+
+	FrameLoop::FrameLoop(FrameClock &clock, uint64_t period, const FrameFunction &frame)
+		: frameScheduler(clock, period), frame(frame), running(false), pendingPeriod(period)
+	{
+	}
+
+	FrameLoop::~FrameLoop()
+	{
+		stop();
+	}
+
+	void FrameLoop::start()
+	{
+		std::lock_guard<std::mutex> lock(threadMutex);
+		if (running.load())
+			return;
+
+		running.store(true);
+		frameScheduler.start();
+		thread = std::thread(&FrameLoop::run, this);
+	}
+
+	void FrameLoop::stop()
+	{
+		std::lock_guard<std::mutex> lock(threadMutex);
+		running.store(false);
+		if (thread.joinable())
+			thread.join();
+	}
+
+	void FrameLoop::run()
+	{
+		while (running.load(std::memory_order_relaxed))
+		{
+			frameScheduler.setPeriod(pendingPeriod.load(std::memory_order_relaxed));
+			uint64_t deadline = frameScheduler.waitForFrame();
+			frame(deadline);
+			frameScheduler.endFrame();
+		}
+	}
+
+}
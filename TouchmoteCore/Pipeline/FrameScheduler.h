@@ -0,0 +1,123 @@
+// FrameScheduler.h
+//
+// Paces the frame loop. Replaces the DateTime.Now and Thread.Sleep((int)wait)
+// pacing of MultiWiiPointerProvider.WiimoteHandlerWorker, which truncates the
+// period to whole milliseconds, measures from when the last frame happened to
+// start and inherits the sleep granularity as jitter.
+//
+// Deadlines are origin + n * period on a monotonic clock, so lateness of one
+// frame does not shift the following ones. Waiting sleeps until shortly before
+// the deadline and spins the rest. The spin window follows how much the sleeps
+// of this thread have overshot recently, so it is short where sleep is precise
+// and grows where it is not. A frame that starts more than a period late skips
+// the deadlines it missed instead of running them back to back.
+//
+// Stats are written by the frame thread only and can be read from any thread.
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "FrameClock.h"
+#include "../Diagnostics/LatencyHistogram.h"
+
+namespace TouchmoteCore {
+
+	struct FrameSchedulerStats
+	{
+		uint64_t Frames;
+		//Frames whose work ended after the deadline of the next frame.
+		uint64_t Overruns;
+		//Deadlines dropped because the loop was more than a period late.
+		uint64_t SkippedFrames;
+		//From the deadline to when the frame started, in ns.
+		HistogramSnapshot Lateness;
+		//From the start to the end of the frame's work, in ns.
+		HistogramSnapshot Work;
+	};
+
+	class FrameScheduler
+	{
+	public:
+		//Period in nanoseconds.
+		FrameScheduler(FrameClock &clock, uint64_t period);
+
+		//Bounds of the spin window, in nanoseconds.
+		uint64_t MinSpin;
+		uint64_t MaxSpin;
+
+		//1000000000 / fps, without rounding to whole milliseconds.
+		static uint64_t getPeriodForFPS(int fps);
+
+		//Takes effect after the next frame; the new deadlines continue from the last one.
+		void setPeriod(uint64_t period);
+		uint64_t getPeriod() const { return period; }
+
+		//The first deadline is one period from now.
+		void start();
+
+		//Blocks until the next deadline and returns it.
+		uint64_t waitForFrame();
+		//Call when the work of the frame returned by waitForFrame is done.
+		void endFrame();
+
+		void getStats(FrameSchedulerStats &stats) const;
+		//Only call from the frame thread or while it is stopped.
+		void resetStats();
+
+		//Current spin window, for diagnostics.
+		uint64_t getSpinWindow() const { return spinWindow; }
+
+	private:
+		void observeSleep(uint64_t requested, uint64_t slept);
+
+		FrameClock &clock;
+		uint64_t period;
+		uint64_t nextDeadline;
+		uint64_t frameStart;
+		uint64_t spinWindow;
+
+		std::atomic<uint64_t> frames;
+		std::atomic<uint64_t> overruns;
+		std::atomic<uint64_t> skippedFrames;
+		LatencyHistogram lateness;
+		LatencyHistogram work;
+	};
+
+	//Runs a FrameScheduler on its own thread and calls the frame function with
+	//every deadline, like WiimoteHandlerWorker does for the controllers and
+	//processEventFrame.
+	class FrameLoop
+	{
+	public:
+		typedef std::function<void(uint64_t deadline)> FrameFunction;
+
+		FrameLoop(FrameClock &clock, uint64_t period, const FrameFunction &frame);
+		~FrameLoop();
+
+		void start();
+		//Waits for the current frame to finish.
+		void stop();
+		bool isRunning() const { return running.load(); }
+
+		//Safe from any thread.
+		void setPeriod(uint64_t period) { pendingPeriod.store(period); }
+
+		FrameScheduler &scheduler() { return frameScheduler; }
+
+	private:
+		void run();
+
+		FrameScheduler frameScheduler;
+		FrameFunction frame;
+		std::atomic<bool> running;
+		std::atomic<uint64_t> pendingPeriod;
+		std::mutex threadMutex;
+		std::thread thread;
+	};
+
+}
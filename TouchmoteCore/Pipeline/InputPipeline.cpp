@@ -0,0 +1,316 @@
+// InputPipeline.cpp
+
+#include "InputPipeline.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+#include "../Diagnostics/Instrumentation.h"
+
+namespace TouchmoteCore {
+
+	//Millisecond ticks; the first level covers 64ms, a few frames, the second 4s.
+	static const uint64_t TIMEOUT_RESOLUTION = 1000;
+	static const int TIMEOUT_SLOTS = 64;
+
+	InputPipeline::InputPipeline(const PipelineSettings &settings, EventSink &sink)
+		: currentSettings(settings), settingsVersion(0), sink(sink), jobs(NULL), timers(TIMEOUT_RESOLUTION, TIMEOUT_SLOTS, 0), frame(0), frameTimestamp(0)
+	{
+		memset(timeouts, 0, sizeof(timeouts));
+		classifier.setListener(this);
+		applySettings(settings);
+	}
+
+	void InputPipeline::applySettings(const PipelineSettings &settings)
+	{
+		currentSettings = settings;
+		classifier.PredictionScale = std::max(settings.screenWidth, settings.screenHeight);
+		fusion.MergeDistance = settings.pointer_fusionDistance;
+		fusion.MaxAge = (uint64_t)std::max(settings.pointer_fusionMaxAge, 0) * 1000;
+		fusion.setDefaultMapping(Homography::scale(settings.screenWidth, settings.screenHeight));
+		for (size_t i = 0; i < slots.size(); i++)
+			slots[i]->Calculator.recalculateScreenBounds(settings);
+	}
+
+	void InputPipeline::setSettingsStore(SettingsStore *store)
+	{
+		settingsReader.reset(store != NULL ? new SettingsReader(*store) : NULL);
+		settingsVersion = 0;
+	}
+
+	uint64_t InputPipeline::getFramePeriod() const
+	{
+		int fps = currentSettings.pointer_FPS > 0 ? currentSettings.pointer_FPS : 1;
+		return (uint64_t)(1000 / fps) * 1000;
+	}
+
+	InputPipeline::Slot *InputPipeline::findSlot(int slot)
+	{
+		for (size_t i = 0; i < slots.size(); i++)
+		{
+			if (slots[i]->ID == slot)
+				return slots[i].get();
+		}
+		return NULL;
+	}
+
+	void InputPipeline::emit(OutputEvent::Type type, uint64_t timestamp, int slot, uint64_t id, double x, double y, bool outOfReach, uint32_t buttons)
+	{
+		OutputEvent event;
+		event.EventType = type;
+		event.Frame = frame;
+		event.Timestamp = timestamp;
+		event.Slot = slot;
+		event.ID = id;
+		event.X = x;
+		event.Y = y;
+		event.OutOfReach = outOfReach;
+		event.Buttons = buttons;
+		sink.onEvent(event);
+		Instrumentation::increment(InstrumentationCounter::EventsEmitted, slot);
+	}
+
+	void InputPipeline::connect(int slot, uint64_t timestamp)
+	{
+		if (slot < 1 || slot > MAX_CONTROLLER_SLOTS || findSlot(slot) != NULL)
+			return;
+
+		ReportMailbox &mailbox = mailboxes[slot - 1];
+		mailbox.open();
+
+		//Keep slots ordered by id so frames visit controllers in a stable order.
+		std::unique_ptr<Slot> entry(new Slot(slot, mailbox, currentSettings));
+		size_t index = 0;
+		while (index < slots.size() && slots[index]->ID < slot)
+			index++;
+		slots.insert(slots.begin() + index, std::move(entry));
+
+		emit(OutputEvent::Type::Connect, timestamp, slot, 0, 0, 0, false, 0);
+	}
+
+	void InputPipeline::disconnect(int slot, uint64_t timestamp)
+	{
+		for (size_t i = 0; i < slots.size(); i++)
+		{
+			if (slots[i]->ID == slot)
+			{
+				slots[i]->Mailbox.close();
+				slots.erase(slots.begin() + i);
+				for (int t = 0; t < CURSOR_TIMEOUT_COUNT; t++)
+					disarmTimeout(slot, (CursorTimeout)t);
+				emit(OutputEvent::Type::Disconnect, timestamp, slot, 0, 0, 0, false, 0);
+				return;
+			}
+		}
+	}
+
+	void InputPipeline::setCalibration(int slot, const Homography &mapping, double confidence)
+	{
+		fusion.setCalibration(slot, mapping, confidence);
+	}
+
+	void InputPipeline::clearCalibration(int slot)
+	{
+		fusion.clearCalibration(slot);
+	}
+
+	void InputPipeline::pushReport(const WiimoteReport &report)
+	{
+		//Only the mailbox is touched here, the slot table belongs to the frame thread.
+		if (report.Slot < 1 || report.Slot > MAX_CONTROLLER_SLOTS)
+			return;
+
+		ReportMailbox &mailbox = mailboxes[report.Slot - 1];
+		if (!mailbox.isOpen())
+			return;
+
+		Instrumentation::increment(InstrumentationCounter::ReportsReceived, report.Slot);
+		if (mailbox.publish(report))
+			Instrumentation::increment(InstrumentationCounter::ReportsOverwritten, report.Slot);
+	}
+
+	void InputPipeline::armTimeout(int slot, CursorTimeout timeout, uint64_t deadline)
+	{
+		if (slot < 1 || slot > MAX_CONTROLLER_SLOTS)
+			return;
+
+		TimerWheel::Handle &handle = timeouts[slot - 1][(int)timeout];
+		if (handle == 0 || !timers.reschedule(handle, deadline))
+			handle = timers.schedule(deadline, &InputPipeline::onTimeout, this, ((uint64_t)slot << 32) | (uint32_t)timeout);
+	}
+
+	void InputPipeline::disarmTimeout(int slot, CursorTimeout timeout)
+	{
+		if (slot < 1 || slot > MAX_CONTROLLER_SLOTS)
+			return;
+
+		TimerWheel::Handle &handle = timeouts[slot - 1][(int)timeout];
+		if (handle != 0)
+			timers.cancel(handle);
+		handle = 0;
+	}
+
+	void InputPipeline::onTimeout(void *context, uint64_t data)
+	{
+		InputPipeline &pipeline = *(InputPipeline *)context;
+		int slot = (int)(data >> 32);
+		CursorTimeout timeout = (CursorTimeout)(data & 0xffffffffu);
+		pipeline.timeouts[slot - 1][(int)timeout] = 0;
+
+		if (timeout != CursorTimeout::StillHide)
+		{
+			pipeline.emit(OutputEvent::Type::Timeout, pipeline.frameTimestamp, slot, (uint64_t)timeout, 0, 0, false, 0);
+			return;
+		}
+
+		Slot *entry = pipeline.findSlot(slot);
+		if (entry == NULL)
+			return;
+		entry->Hidden = true;
+		pipeline.emit(OutputEvent::Type::CursorHide, pipeline.frameTimestamp, slot, 0, entry->Position.X, entry->Position.Y, entry->Position.OutOfReach, 0);
+	}
+
+	//Same rule as setPosition of TouchHandler: the cursor is still while no button
+	//is held and it stays within pointer_cursorStillThreshold of where it stopped.
+	//Instead of stopping the timer when the cursor moves and starting it again the
+	//next frame, the timeout is moved.
+	void InputPipeline::updateStillTimeout(Slot &slot, uint64_t timestamp, uint32_t buttons)
+	{
+		if (currentSettings.pointer_cursorStillHideTimeout <= 0)
+		{
+			disarmTimeout(slot.ID, CursorTimeout::StillHide);
+			if (slot.Hidden)
+			{
+				slot.Hidden = false;
+				emit(OutputEvent::Type::CursorShow, timestamp, slot.ID, 0, slot.Position.X, slot.Position.Y, slot.Position.OutOfReach, buttons);
+			}
+			return;
+		}
+
+		double threshold = currentSettings.pointer_cursorStillThreshold;
+		bool moved = buttons != 0 || fabs(slot.Position.X - slot.StillX) >= threshold || fabs(slot.Position.Y - slot.StillY) >= threshold;
+		bool armed = timeouts[slot.ID - 1][(int)CursorTimeout::StillHide] != 0;
+		if (!moved && (armed || slot.Hidden))
+			return;
+
+		slot.StillX = slot.Position.X;
+		slot.StillY = slot.Position.Y;
+		armTimeout(slot.ID, CursorTimeout::StillHide, timestamp + (uint64_t)currentSettings.pointer_cursorStillHideTimeout * 1000);
+		if (slot.Hidden)
+		{
+			slot.Hidden = false;
+			emit(OutputEvent::Type::CursorShow, timestamp, slot.ID, 0, slot.Position.X, slot.Position.Y, slot.Position.OutOfReach, buttons);
+		}
+	}
+
+	void InputPipeline::filterSlot(Slot &slot)
+	{
+		//Like the managed loop, the latest report is processed again until a new one arrives.
+		if (slot.Mailbox.update())
+			slot.HasReport = true;
+		if (!slot.HasReport)
+			return;
+
+		StageProbe probe(PipelineStage::Filter, slot.ID);
+		slot.Position = slot.Calculator.CalculateCursorPos(slot.Mailbox.latest(), frameTimestamp);
+	}
+
+	void InputPipeline::filterSlotJob(void *context, int index)
+	{
+		InputPipeline *pipeline = static_cast<InputPipeline *>(context);
+		pipeline->filterSlot(*pipeline->slots[index]);
+	}
+
+	void InputPipeline::processFrame(uint64_t timestamp)
+	{
+		frame++;
+		frameTimestamp = timestamp;
+		irPoints.clear();
+		if (settingsReader)
+		{
+			//Stays pinned until the next frame, which keeps at most one old snapshot alive.
+			const SettingsSnapshot &snapshot = settingsReader->acquire();
+			if (snapshot.Version != settingsVersion)
+			{
+				applySettings(snapshot.Values);
+				settingsVersion = snapshot.Version;
+			}
+		}
+		bool fuse = currentSettings.pointer_fusion;
+		if (fuse)
+			fusion.beginFrame(timestamp);
+
+		//The per controller part fans out over the job system; everything that
+		//emits events runs afterwards in slot order, so the output does not depend
+		//on which thread filtered which controller.
+		if (jobs != NULL && slots.size() > 1)
+		{
+			jobs->run(&InputPipeline::filterSlotJob, this, (int)slots.size());
+		}
+		else
+		{
+			for (size_t i = 0; i < slots.size(); i++)
+				filterSlot(*slots[i]);
+		}
+
+		for (size_t i = 0; i < slots.size(); i++)
+		{
+			Slot &slot = *slots[i];
+			if (!slot.HasReport)
+				continue;
+
+			const WiimoteReport &latest = slot.Mailbox.latest();
+			{
+				StageProbe probe(PipelineStage::Output, slot.ID);
+				updateStillTimeout(slot, timestamp, latest.Buttons);
+				emit(OutputEvent::Type::Cursor, timestamp, slot.ID, 0, slot.Position.X, slot.Position.Y, slot.Position.OutOfReach, latest.Buttons);
+			}
+
+			if (fuse)
+			{
+				fusion.addReport(latest);
+				continue;
+			}
+
+			for (int s = 0; s < IR_SENSOR_COUNT; s++)
+			{
+				const IRSensor &sensor = latest.IR[s];
+				if (sensor.Found)
+					irPoints.push_back(Vector(sensor.X * currentSettings.screenWidth, sensor.Y * currentSettings.screenHeight));
+			}
+		}
+
+		timers.advance(timestamp);
+
+		if (fuse)
+		{
+			StageProbe probe(PipelineStage::Fuse, 0);
+			fusion.fuse();
+			fusion.getPositions(irPoints);
+		}
+
+		//Classifier events are emitted from the listener callbacks, so this also covers their output.
+		{
+			StageProbe probe(PipelineStage::Classify, 0);
+			classifier.processFrame(irPoints);
+		}
+		Instrumentation::increment(InstrumentationCounter::FramesProcessed, 0);
+	}
+
+	void InputPipeline::onTrackerStart(const SpatioTemporalTracker &tracker)
+	{
+		emit(OutputEvent::Type::ContactStart, frameTimestamp, 0, tracker.ID, tracker.Position.X, tracker.Position.Y, false, 0);
+	}
+
+	void InputPipeline::onTrackerUpdate(const SpatioTemporalTracker &tracker)
+	{
+		emit(OutputEvent::Type::ContactUpdate, frameTimestamp, 0, tracker.ID, tracker.Position.X, tracker.Position.Y, false, 0);
+	}
+
+	void InputPipeline::onTrackerEnd(const SpatioTemporalTracker &tracker)
+	{
+		emit(OutputEvent::Type::ContactEnd, frameTimestamp, 0, tracker.ID, tracker.Position.X, tracker.Position.Y, false, 0);
+	}
+
+}
@@ -0,0 +1,136 @@
+// InputPipeline.h
+//
+// Native counterpart of the frame loop in MultiWiiPointerProvider.WiimoteHandlerWorker:
+// reports are buffered per controller as they arrive and a frame processes the
+// latest report of every connected controller. pushReport may be called from
+// the reader thread of each controller while frames run, see ReportMailbox;
+// everything else belongs to the frame thread. With a JobSystem the filtering
+// of the controllers runs in parallel, and the events are still emitted in
+// slot order. Nothing in here reads the wall clock, so feeding it the same
+// reports and frame times gives the same events.
+// Stage latencies are recorded through Instrumentation, tagged with the slot.
+// With pointer_fusion the IR points of all controllers go through SensorFusion
+// before the classifier, otherwise every point is classified on its own.
+// Per cursor timeouts run on one TimerWheel advanced by the frames, in place of
+// a System.Timers.Timer per handler, so they fire on the frame thread and in
+// the frame at or after their deadline.
+// With a SettingsStore every frame starts by checking its version and applies
+// a newer snapshot, so settings change on the frame thread between frames.
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "OutputEvent.h"
+#include "JobSystem.h"
+#include "PipelineSettings.h"
+#include "ReportMailbox.h"
+#include "SettingsStore.h"
+#include "TimerWheel.h"
+#include "../Input/ScreenPositionCalculator.h"
+#include "../Input/SensorFusion.h"
+#include "../Input/SpatioTemporalClassifier.h"
+#include "../Input/WiimoteReport.h"
+
+namespace TouchmoteCore {
+
+	enum class CursorTimeout
+	{
+		//pointer_cursorStillHideTimeout, armed and moved by the pipeline itself.
+		StillHide,
+		PowerSave,
+		Rumble,
+		AnimationEnd
+	};
+
+	static const int CURSOR_TIMEOUT_COUNT = 4;
+
+	class InputPipeline : private TrackerListener
+	{
+	public:
+		InputPipeline(const PipelineSettings &settings, EventSink &sink);
+
+		void applySettings(const PipelineSettings &settings);
+
+		//Runs the per controller part of a frame on the job system, NULL runs it
+		//on the frame thread. The job system must outlive its use here.
+		void setJobSystem(JobSystem *jobs) { this->jobs = jobs; }
+		const PipelineSettings &settings() const { return currentSettings; }
+		//Follows the snapshots of store from the next frame on, NULL stops. The
+		//store must outlive its use here.
+		void setSettingsStore(SettingsStore *store);
+
+		//Slots are 1..MAX_CONTROLLER_SLOTS, others are ignored.
+		void connect(int slot, uint64_t timestamp);
+		void disconnect(int slot, uint64_t timestamp);
+
+		//Mapping from normalized camera coordinates of the slot to screen pixels, used
+		//with pointer_fusion. Uncalibrated slots are scaled to the screen size.
+		void setCalibration(int slot, const Homography &mapping, double confidence);
+		void clearCalibration(int slot);
+
+		//Same as MultiWiiPointerProvider.handleWiimoteChanged: only remembers the report.
+		//Lock free, at most one thread per slot.
+		void pushReport(const WiimoteReport &report);
+
+		//Emits a Timeout event for the slot in the first frame at or after deadline,
+		//in microseconds on the frame clock. Arming an armed timeout moves it.
+		void armTimeout(int slot, CursorTimeout timeout, uint64_t deadline);
+		void disarmTimeout(int slot, CursorTimeout timeout);
+
+		void processFrame(uint64_t timestamp);
+
+		//Frame period in microseconds. Like the managed loop this is 1000 / pointer_FPS
+		//in whole milliseconds, so 120 FPS actually runs at 125 Hz.
+		uint64_t getFramePeriod() const;
+
+	private:
+		struct Slot
+		{
+			int ID;
+			bool HasReport;
+			ReportMailbox &Mailbox;
+			ScreenPositionCalculator Calculator;
+			//Result of the filter for the current frame.
+			CursorPos Position;
+			//Where the cursor was when the still timeout was last moved.
+			double StillX;
+			double StillY;
+			bool Hidden;
+
+			Slot(int id, ReportMailbox &mailbox, const PipelineSettings &settings) : ID(id), HasReport(false), Mailbox(mailbox), Calculator(settings), StillX(0), StillY(0), Hidden(false) {}
+		};
+
+		Slot *findSlot(int slot);
+		void filterSlot(Slot &slot);
+		static void filterSlotJob(void *context, int index);
+		void updateStillTimeout(Slot &slot, uint64_t timestamp, uint32_t buttons);
+		static void onTimeout(void *context, uint64_t data);
+		void emit(OutputEvent::Type type, uint64_t timestamp, int slot, uint64_t id, double x, double y, bool outOfReach, uint32_t buttons);
+
+		virtual void onTrackerStart(const SpatioTemporalTracker &tracker);
+		virtual void onTrackerUpdate(const SpatioTemporalTracker &tracker);
+		virtual void onTrackerEnd(const SpatioTemporalTracker &tracker);
+
+		PipelineSettings currentSettings;
+		std::unique_ptr<SettingsReader> settingsReader;
+		//Of the snapshot applied last, 0 for none.
+		uint64_t settingsVersion;
+		EventSink &sink;
+		JobSystem *jobs;
+		std::vector<std::unique_ptr<Slot> > slots;
+		ReportMailbox mailboxes[MAX_CONTROLLER_SLOTS];
+		SpatioTemporalClassifier classifier;
+		SensorFusion fusion;
+		std::vector<Vector> irPoints;
+		TimerWheel timers;
+		//Indexed by slot - 1, 0 when not armed.
+		TimerWheel::Handle timeouts[MAX_CONTROLLER_SLOTS][CURSOR_TIMEOUT_COUNT];
+
+		uint64_t frame;
+		uint64_t frameTimestamp;
+	};
+
+}
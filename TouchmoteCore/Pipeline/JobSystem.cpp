@@ -0,0 +1,137 @@
+// JobSystem.cpp
+
+#include "JobSystem.h"
+
+namespace TouchmoteCore {
+
+	//Rounds of looking for work before an idle worker goes to sleep.
+	static const int IDLE_SPINS = 2000;
+
+	JobSystem::JobSystem(int workers)
+		: pending(0), steals(0), batch(0), stopping(false)
+	{
+		if (workers < 0)
+			workers = 0;
+
+		//Queue 0 belongs to the caller of run().
+		for (int q = 0; q <= workers; q++)
+			queues.push_back(std::unique_ptr<Queue>(new Queue()));
+		for (int w = 1; w <= workers; w++)
+			threads.push_back(std::thread(&JobSystem::workerMain, this, w));
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (size_t t = 0; t < threads.size(); t++)
+			threads[t].join();
+	}
+
+	bool JobSystem::popOwn(int queue, Job &job)
+	{
+		Queue &own = *queues[queue];
+		std::lock_guard<std::mutex> lock(own.Mutex);
+		if (own.Jobs.empty())
+			return false;
+
+		job = own.Jobs.back();
+		own.Jobs.pop_back();
+		return true;
+	}
+
+	bool JobSystem::steal(int queue, Job &job)
+	{
+		int count = (int)queues.size();
+		for (int i = 1; i < count; i++)
+		{
+			Queue &victim = *queues[(queue + i) % count];
+			std::lock_guard<std::mutex> lock(victim.Mutex);
+			if (victim.Jobs.empty())
+				continue;
+
+			job = victim.Jobs.front();
+			victim.Jobs.pop_front();
+			steals.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+		return false;
+	}
+
+	bool JobSystem::runOne(int queue)
+	{
+		Job job;
+		if (!popOwn(queue, job) && !steal(queue, job))
+			return false;
+
+		job.Function(job.Context, job.Index);
+		pending.fetch_sub(1, std::memory_order_acq_rel);
+		return true;
+	}
+
+	void JobSystem::run(JobFunction function, void *context, int count)
+	{
+		if (count <= 0)
+			return;
+
+		if (threads.empty() || count == 1)
+		{
+			for (int i = 0; i < count; i++)
+				function(context, i);
+			return;
+		}
+
+		pending.store(count, std::memory_order_relaxed);
+		int queueCount = (int)queues.size();
+		//Deal in reverse so every thread pops its lowest index first.
+		for (int i = count - 1; i >= 0; i--)
+		{
+			Queue &queue = *queues[i % queueCount];
+			Job job = { function, context, i };
+			std::lock_guard<std::mutex> lock(queue.Mutex);
+			queue.Jobs.push_back(job);
+		}
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+			batch++;
+		}
+		wake.notify_all();
+
+		while (pending.load(std::memory_order_acquire) > 0)
+		{
+			if (!runOne(0))
+				std::this_thread::yield();
+		}
+	}
+
+	void JobSystem::workerMain(int queue)
+	{
+		uint64_t seen = 0;
+		while (true)
+		{
+			int idle = 0;
+			while (idle < IDLE_SPINS)
+			{
+				if (runOne(queue))
+				{
+					idle = 0;
+				}
+				else
+				{
+					idle++;
+					std::this_thread::yield();
+				}
+			}
+
+			std::unique_lock<std::mutex> lock(wakeMutex);
+			wake.wait(lock, [this, &seen]() { return stopping || batch != seen; });
+			if (stopping)
+				return;
+			seen = batch;
+		}
+	}
+
+}
@@ -0,0 +1,79 @@
+// JobSystem.h
+//
+// Fixed pool of worker threads for fanning the per-controller part of a frame
+// out over the cores. run() hands out one job per index and returns once all
+// of them are done, the calling thread works along instead of waiting.
+//
+// Every thread, the caller included, has its own queue. Jobs are dealt round
+// robin over the queues; a thread takes work from the back of its own queue
+// and, once that is empty, steals from the front of the others. So a controller
+// whose filter is slow does not hold up jobs queued behind it.
+//
+// Idle workers spin briefly before they block, since the next frame is
+// usually only a few milliseconds away.
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace TouchmoteCore {
+
+	class JobSystem
+	{
+	public:
+		typedef void (*JobFunction)(void *context, int index);
+
+		//workers threads besides the caller, 0 runs everything on the caller.
+		explicit JobSystem(int workers);
+		~JobSystem();
+
+		int getWorkerCount() const { return (int)threads.size(); }
+
+		//Calls function(context, i) for every i in [0, count) and waits for all of
+		//them. Only one thread may call run at a time.
+		void run(JobFunction function, void *context, int count);
+
+		//Jobs that ran on another queue than the one they were dealt to, for diagnostics.
+		uint64_t getSteals() const { return steals.load(std::memory_order_relaxed); }
+
+	private:
+		struct Job
+		{
+			JobFunction Function;
+			void *Context;
+			int Index;
+		};
+
+		struct Queue
+		{
+			std::mutex Mutex;
+			std::deque<Job> Jobs;
+		};
+
+		bool popOwn(int queue, Job &job);
+		bool steal(int queue, Job &job);
+		//Runs one job from the own queue or a stolen one, returns false if there was none.
+		bool runOne(int queue);
+		void workerMain(int queue);
+
+		std::vector<std::unique_ptr<Queue> > queues;
+		std::vector<std::thread> threads;
+
+		std::atomic<int> pending;
+		std::atomic<uint64_t> steals;
+
+		std::mutex wakeMutex;
+		std::condition_variable wake;
+		//Bumped for every batch so sleeping workers know there is work.
+		uint64_t batch;
+		bool stopping;
+	};
+
+}
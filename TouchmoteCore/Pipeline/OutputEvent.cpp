@@ -0,0 +1,24 @@
+// OutputEvent.cpp
+
+#include "OutputEvent.h"
+
+namespace TouchmoteCore {
+
+	const char *getEventTypeName(OutputEvent::Type type)
+	{
+		switch (type)
+		{
+		case OutputEvent::Type::Connect: return "connect";
+		case OutputEvent::Type::Disconnect: return "disconnect";
+		case OutputEvent::Type::Cursor: return "cursor";
+		case OutputEvent::Type::ContactStart: return "start";
+		case OutputEvent::Type::ContactUpdate: return "update";
+		case OutputEvent::Type::ContactEnd: return "end";
+		case OutputEvent::Type::CursorHide: return "hide";
+		case OutputEvent::Type::CursorShow: return "show";
+		case OutputEvent::Type::Timeout: return "timeout";
+		default: return "unknown";
+		}
+	}
+
+}
@@ -0,0 +1,54 @@
+// OutputEvent.h
+//
+// What the pipeline hands to the output handlers for each frame.
+
+#pragma once
+
+#include <stdint.h>
+
+namespace TouchmoteCore {
+
+	struct OutputEvent
+	{
+		enum class Type
+		{
+			Connect,
+			Disconnect,
+			//Cursor position of a controller, what ICursorHandler.setPosition receives.
+			Cursor,
+			//Classifier tracker events, what WiiProvider turned into WiiContacts.
+			ContactStart,
+			ContactUpdate,
+			ContactEnd,
+			//The cursor of the slot stood still for pointer_cursorStillHideTimeout, what
+			//timeoutTimer_Elapsed of TouchHandler hid, and moved again after that.
+			CursorHide,
+			CursorShow,
+			//A timeout armed with InputPipeline::armTimeout, the CursorTimeout is in ID.
+			Timeout
+		};
+
+		Type EventType;
+		uint64_t Frame;
+		//Microseconds on the capture clock.
+		uint64_t Timestamp;
+		int Slot;
+		//Tracker id for contact events.
+		uint64_t ID;
+		double X;
+		double Y;
+		bool OutOfReach;
+		uint32_t Buttons;
+	};
+
+	const char *getEventTypeName(OutputEvent::Type type);
+
+	class EventSink
+	{
+	public:
+		virtual ~EventSink() {}
+
+		virtual void onEvent(const OutputEvent &event) = 0;
+	};
+
+}
@@ -0,0 +1,142 @@
+// PipelineSettings.cpp
+
+#include "PipelineSettings.h"
+
+#include <cstdlib>
+
+namespace TouchmoteCore {
+
+	bool SettingValue::asBool() const
+	{
+		switch (type)
+		{
+		case Type::Bool: return b;
+		case Type::Int: return i != 0;
+		case Type::Double: return d != 0;
+		default: return s == "true" || s == "True";
+		}
+	}
+
+	int SettingValue::asInt() const
+	{
+		switch (type)
+		{
+		case Type::Bool: return b ? 1 : 0;
+		case Type::Int: return i;
+		case Type::Double: return (int)d;
+		default: return std::atoi(s.c_str());
+		}
+	}
+
+	double SettingValue::asDouble() const
+	{
+		switch (type)
+		{
+		case Type::Bool: return b ? 1 : 0;
+		case Type::Int: return i;
+		case Type::Double: return d;
+		default: return std::atof(s.c_str());
+		}
+	}
+
+	PipelineSettings::PipelineSettings()
+		: screenWidth(1920),
+		screenHeight(1080),
+		pointer_marginsLeftRight(0.4),
+		pointer_marginsTopBottom(0.5),
+		pointer_sensorBarPosCompensation(0.30),
+		pointer_sensorBarPos(SensorBarPos::Center),
+		pointer_considerRotation(true),
+		pointer_customCursor(true),
+		pointer_FPS(120),
+		pointer_positionSmoothing(3),
+		pointer_positionRadius(0.002),
+		pointer_cursorStillHideTimeout(3000),
+		pointer_cursorStillThreshold(10),
+		pointer_prediction(false),
+		pointer_predictionHorizon(16),
+		pointer_predictionMaxDistance(0.02),
+		pointer_predictionFadeSpeed(0.3),
+		pointer_predictionProcessNoise(2000),
+		pointer_predictionMeasurementNoise(1e-6),
+		pointer_fusion(false),
+		pointer_fusionDistance(40),
+		pointer_fusionMaxAge(30),
+		touch_touchTapThreshold(40),
+		touch_edgeGestureHelperMargins(30),
+		touch_edgeGestureHelperRelease(60)
+	{
+	}
+
+	bool PipelineSettings::setValue(const std::string &key, const SettingValue &value)
+	{
+		if (key == "screenWidth") screenWidth = value.asInt();
+		else if (key == "screenHeight") screenHeight = value.asInt();
+		else if (key == "pointer_marginsLeftRight") pointer_marginsLeftRight = value.asDouble();
+		else if (key == "pointer_marginsTopBottom") pointer_marginsTopBottom = value.asDouble();
+		else if (key == "pointer_sensorBarPosCompensation") pointer_sensorBarPosCompensation = value.asDouble();
+		else if (key == "pointer_sensorBarPos")
+		{
+			if (value.s == "top") pointer_sensorBarPos = SensorBarPos::Top;
+			else if (value.s == "bottom") pointer_sensorBarPos = SensorBarPos::Bottom;
+			else pointer_sensorBarPos = SensorBarPos::Center;
+		}
+		else if (key == "pointer_considerRotation") pointer_considerRotation = value.asBool();
+		else if (key == "pointer_customCursor") pointer_customCursor = value.asBool();
+		else if (key == "pointer_FPS") pointer_FPS = value.asInt();
+		else if (key == "pointer_positionSmoothing") pointer_positionSmoothing = value.asInt();
+		else if (key == "pointer_positionRadius") pointer_positionRadius = value.asDouble();
+		else if (key == "pointer_cursorStillHideTimeout") pointer_cursorStillHideTimeout = value.asInt();
+		else if (key == "pointer_cursorStillThreshold") pointer_cursorStillThreshold = value.asInt();
+		else if (key == "pointer_prediction") pointer_prediction = value.asBool();
+		else if (key == "pointer_predictionHorizon") pointer_predictionHorizon = value.asInt();
+		else if (key == "pointer_predictionMaxDistance") pointer_predictionMaxDistance = value.asDouble();
+		else if (key == "pointer_predictionFadeSpeed") pointer_predictionFadeSpeed = value.asDouble();
+		else if (key == "pointer_predictionProcessNoise") pointer_predictionProcessNoise = value.asDouble();
+		else if (key == "pointer_predictionMeasurementNoise") pointer_predictionMeasurementNoise = value.asDouble();
+		else if (key == "pointer_fusion") pointer_fusion = value.asBool();
+		else if (key == "pointer_fusionDistance") pointer_fusionDistance = value.asDouble();
+		else if (key == "pointer_fusionMaxAge") pointer_fusionMaxAge = value.asInt();
+		else if (key == "touch_touchTapThreshold") touch_touchTapThreshold = value.asInt();
+		else if (key == "touch_edgeGestureHelperMargins") touch_edgeGestureHelperMargins = value.asInt();
+		else if (key == "touch_edgeGestureHelperRelease") touch_edgeGestureHelperRelease = value.asInt();
+		else return false;
+		return true;
+	}
+
+	std::vector<SettingEntry> PipelineSettings::toEntries() const
+	{
+		const char *sensorBarPos = pointer_sensorBarPos == SensorBarPos::Top ? "top"
+			: pointer_sensorBarPos == SensorBarPos::Bottom ? "bottom" : "center";
+
+		SettingEntry entries[] = {
+			{ "screenWidth", SettingValue::fromInt(screenWidth) },
+			{ "screenHeight", SettingValue::fromInt(screenHeight) },
+			{ "pointer_marginsLeftRight", SettingValue::fromDouble(pointer_marginsLeftRight) },
+			{ "pointer_marginsTopBottom", SettingValue::fromDouble(pointer_marginsTopBottom) },
+			{ "pointer_sensorBarPosCompensation", SettingValue::fromDouble(pointer_sensorBarPosCompensation) },
+			{ "pointer_sensorBarPos", SettingValue::fromString(sensorBarPos) },
+			{ "pointer_considerRotation", SettingValue::fromBool(pointer_considerRotation) },
+			{ "pointer_customCursor", SettingValue::fromBool(pointer_customCursor) },
+			{ "pointer_FPS", SettingValue::fromInt(pointer_FPS) },
+			{ "pointer_positionSmoothing", SettingValue::fromInt(pointer_positionSmoothing) },
+			{ "pointer_positionRadius", SettingValue::fromDouble(pointer_positionRadius) },
+			{ "pointer_cursorStillHideTimeout", SettingValue::fromInt(pointer_cursorStillHideTimeout) },
+			{ "pointer_cursorStillThreshold", SettingValue::fromInt(pointer_cursorStillThreshold) },
+			{ "pointer_prediction", SettingValue::fromBool(pointer_prediction) },
+			{ "pointer_predictionHorizon", SettingValue::fromInt(pointer_predictionHorizon) },
+			{ "pointer_predictionMaxDistance", SettingValue::fromDouble(pointer_predictionMaxDistance) },
+			{ "pointer_predictionFadeSpeed", SettingValue::fromDouble(pointer_predictionFadeSpeed) },
+			{ "pointer_predictionProcessNoise", SettingValue::fromDouble(pointer_predictionProcessNoise) },
+			{ "pointer_predictionMeasurementNoise", SettingValue::fromDouble(pointer_predictionMeasurementNoise) },
+			{ "pointer_fusion", SettingValue::fromBool(pointer_fusion) },
+			{ "pointer_fusionDistance", SettingValue::fromDouble(pointer_fusionDistance) },
+			{ "pointer_fusionMaxAge", SettingValue::fromInt(pointer_fusionMaxAge) },
+			{ "touch_touchTapThreshold", SettingValue::fromInt(touch_touchTapThreshold) },
+			{ "touch_edgeGestureHelperMargins", SettingValue::fromInt(touch_edgeGestureHelperMargins) },
+			{ "touch_edgeGestureHelperRelease", SettingValue::fromInt(touch_edgeGestureHelperRelease) },
+		};
+		return std::vector<SettingEntry>(entries, entries + sizeof(entries) / sizeof(entries[0]));
+	}
+
+}
@@ -0,0 +1,106 @@
+// PipelineSettings.h
+//
+// The subset of WiiTUIO.Properties.Settings read by the native pipeline.
+// Field names match the managed property names so captures can carry them by key.
+// The pointer_prediction and pointer_fusion settings only exist on the native
+// side; captures from the managed recorder leave them at their defaults.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace TouchmoteCore {
+
+	enum class SensorBarPos
+	{
+		Center,
+		Top,
+		Bottom
+	};
+
+	struct SettingValue
+	{
+		enum class Type
+		{
+			Bool,
+			Int,
+			Double,
+			String
+		};
+
+		Type type;
+		bool b;
+		int i;
+		double d;
+		std::string s;
+
+		SettingValue() : type(Type::Int), b(false), i(0), d(0) {}
+
+		static SettingValue fromBool(bool value) { SettingValue v; v.type = Type::Bool; v.b = value; return v; }
+		static SettingValue fromInt(int value) { SettingValue v; v.type = Type::Int; v.i = value; return v; }
+		static SettingValue fromDouble(double value) { SettingValue v; v.type = Type::Double; v.d = value; return v; }
+		static SettingValue fromString(const std::string &value) { SettingValue v; v.type = Type::String; v.s = value; return v; }
+
+		//Numeric values convert between each other, the managed side is not strict about int/double.
+		bool asBool() const;
+		int asInt() const;
+		double asDouble() const;
+	};
+
+	struct SettingEntry
+	{
+		std::string key;
+		SettingValue value;
+	};
+
+	struct PipelineSettings
+	{
+		//Bounds of Settings.primaryMonitor, in pixels.
+		int screenWidth;
+		int screenHeight;
+
+		double pointer_marginsLeftRight;
+		double pointer_marginsTopBottom;
+		double pointer_sensorBarPosCompensation;
+		SensorBarPos pointer_sensorBarPos;
+		bool pointer_considerRotation;
+		bool pointer_customCursor;
+		int pointer_FPS;
+		int pointer_positionSmoothing;
+		double pointer_positionRadius;
+		int pointer_cursorStillHideTimeout;
+		int pointer_cursorStillThreshold;
+
+		//Kalman prediction instead of CoordFilter, see PredictiveFilter.
+		bool pointer_prediction;
+		//How far past the frame time the cursor is predicted, in milliseconds.
+		int pointer_predictionHorizon;
+		//In normalized screen units.
+		double pointer_predictionMaxDistance;
+		//Normalized screen units per second.
+		double pointer_predictionFadeSpeed;
+		double pointer_predictionProcessNoise;
+		double pointer_predictionMeasurementNoise;
+
+		//Fuse the IR points of all controllers before classifying, see SensorFusion.
+		bool pointer_fusion;
+		//In pixels.
+		double pointer_fusionDistance;
+		//In milliseconds.
+		int pointer_fusionMaxAge;
+
+		int touch_touchTapThreshold;
+		int touch_edgeGestureHelperMargins;
+		int touch_edgeGestureHelperRelease;
+
+		//Defaults are the ones in WiiTUIO/Properties/Settings.cs.
+		PipelineSettings();
+
+		//Returns false if the key is not a pipeline setting.
+		bool setValue(const std::string &key, const SettingValue &value);
+
+		std::vector<SettingEntry> toEntries() const;
+	};
+
+}
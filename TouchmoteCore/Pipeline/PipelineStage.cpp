@@ -0,0 +1,21 @@
+// PipelineStage.cpp
+
+#include "PipelineStage.h"
+
+namespace TouchmoteCore {
+
+	const char *getStageName(PipelineStage stage)
+	{
+		switch (stage)
+		{
+		case PipelineStage::Decode: return "decode";
+		case PipelineStage::Filter: return "filter";
+		case PipelineStage::Fuse: return "fuse";
+		case PipelineStage::Classify: return "classify";
+		case PipelineStage::Output: return "output";
+		case PipelineStage::Render: return "render";
+		default: return "unknown";
+		}
+	}
+
+}
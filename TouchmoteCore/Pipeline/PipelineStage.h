@@ -0,0 +1,26 @@
+// PipelineStage.h
+
+#pragma once
+
+namespace TouchmoteCore {
+
+	enum class PipelineStage
+	{
+		//Raw report to WiimoteReport.
+		Decode,
+		//ScreenPositionCalculator.CalculateCursorPos including CoordFilter and the smoothing buffer.
+		Filter,
+		//SensorFusion of the IR points of all controllers, with pointer_fusion.
+		Fuse,
+		//SpatioTemporalClassifier.processFrame.
+		Classify,
+		//Handing the frame to the output handlers and injecting it.
+		Output,
+		//Overlay Render() including PresentEx, or SoftwareCursorRenderer.render.
+		Render,
+		Count
+	};
+
+	const char *getStageName(PipelineStage stage);
+
+}
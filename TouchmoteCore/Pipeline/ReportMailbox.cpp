@@ -0,0 +1,22 @@
+// ReportMailbox.cpp
+
+#include "ReportMailbox.h"
+
+#include <string.h>
+
+namespace TouchmoteCore {
+
+	ReportMailbox::ReportMailbox()
+		: middle(1), back(0), front(2), opened(false)
+	{
+		memset(buffers, 0, sizeof(buffers));
+	}
+
+	void ReportMailbox::open()
+	{
+		//Whatever was published while closed belongs to an earlier connection.
+		update();
+		opened.store(true, std::memory_order_relaxed);
+	}
+
+}
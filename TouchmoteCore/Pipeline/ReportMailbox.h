@@ -0,0 +1,79 @@
+// ReportMailbox.h
+//
+// Hands the newest report of one controller from its HID reader thread to the
+// frame thread without a lock. Replaces eventBuffer and pDeviceMutex of
+// MultiWiiPointerProvider: the reader never waits for a frame, and a frame
+// never waits for the reader or for connection handling.
+//
+// It is a triple buffer. The producer fills its own buffer and swaps it with
+// the middle one, the consumer swaps the middle one with its own buffer when it
+// was refreshed. Neither side ever touches a buffer the other side is using, so
+// reads are never torn and both sides finish in a bounded number of steps.
+// Reports replaced before the consumer got to them are simply lost, only the
+// latest one matters.
+//
+// Exactly one producer thread and one consumer thread per mailbox. Mailboxes
+// are indexed by slot, 1..MAX_CONTROLLER_SLOTS.
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#include "../Input/WiimoteReport.h"
+
+namespace TouchmoteCore {
+
+	class ReportMailbox
+	{
+	public:
+		ReportMailbox();
+
+		//Producer. Returns true if this replaced a report the consumer had not taken yet.
+		bool publish(const WiimoteReport &report)
+		{
+			buffers[back] = report;
+			uint8_t previous = middle.exchange((uint8_t)(back | FRESH), std::memory_order_acq_rel);
+			back = previous & INDEX;
+			return (previous & FRESH) != 0;
+		}
+
+		//Consumer. Takes the newest report if one was published since the last call,
+		//latest() then returns it. Returns false and keeps latest() otherwise.
+		bool update()
+		{
+			if ((middle.load(std::memory_order_relaxed) & FRESH) == 0)
+				return false;
+
+			uint8_t previous = middle.exchange(front, std::memory_order_acq_rel);
+			front = previous & INDEX;
+			return true;
+		}
+
+		//Consumer. Only valid after update() returned true once.
+		const WiimoteReport &latest() const { return buffers[front]; }
+
+		//Whether the producer should publish at all. Set by the consumer side on
+		//connect and disconnect; a report that slips through is dropped by update() on
+		//the next open().
+		bool isOpen() const { return opened.load(std::memory_order_relaxed); }
+		void open();
+		void close() { opened.store(false, std::memory_order_relaxed); }
+
+	private:
+		static const uint8_t INDEX = 3;
+		static const uint8_t FRESH = 4;
+
+		WiimoteReport buffers[3];
+		//Each side's index on its own cache line, so they do not slow each other down.
+		//Padding rather than alignas, C++11 new does not honour extended alignment.
+		char padding0[64];
+		std::atomic<uint8_t> middle;
+		char padding1[64];
+		uint8_t back;
+		char padding2[64];
+		uint8_t front;
+		std::atomic<bool> opened;
+	};
+
+}
@@ -0,0 +1,177 @@
+// SettingsStore.cpp
+
+#include "SettingsStore.h"
+
+#include <algorithm>
+
+namespace TouchmoteCore {
+
+	static bool isSameValue(const SettingValue &a, const SettingValue &b)
+	{
+		if (a.type != b.type)
+			return false;
+		switch (a.type)
+		{
+		case SettingValue::Type::Bool: return a.b == b.b;
+		case SettingValue::Type::Int: return a.i == b.i;
+		case SettingValue::Type::Double: return a.d == b.d;
+		default: return a.s == b.s;
+		}
+	}
+
+	SettingsStore::SettingsStore(const PipelineSettings &values)
+		: current(new SettingsSnapshot(1, values))
+	{
+	}
+
+	SettingsStore::~SettingsStore()
+	{
+		delete current.load(std::memory_order_relaxed);
+		for (size_t i = 0; i < retired.size(); i++)
+			delete retired[i];
+	}
+
+	bool SettingsStore::set(const std::string &key, const SettingValue &value)
+	{
+		SettingEntry entry = { key, value };
+		return update(std::vector<SettingEntry>(1, entry));
+	}
+
+	bool SettingsStore::update(const std::vector<SettingEntry> &entries)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		PipelineSettings values = current.load(std::memory_order_relaxed)->Values;
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			if (!values.setValue(entries[i].key, entries[i].value))
+				return false;
+		}
+		publish(values);
+		return true;
+	}
+
+	void SettingsStore::replace(const PipelineSettings &values)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		publish(values);
+	}
+
+	void SettingsStore::publish(const PipelineSettings &values)
+	{
+		const SettingsSnapshot *previous = current.load(std::memory_order_relaxed);
+		std::vector<SettingEntry> before = previous->Values.toEntries();
+		std::vector<SettingEntry> after = values.toEntries();
+		std::vector<std::string> changed;
+		for (size_t i = 0; i < after.size(); i++)
+		{
+			if (!isSameValue(before[i].value, after[i].value))
+				changed.push_back(after[i].key);
+		}
+		if (changed.empty())
+			return;
+
+		const SettingsSnapshot *snapshot = new SettingsSnapshot(previous->Version + 1, values);
+		current.store(snapshot, std::memory_order_seq_cst);
+		retired.push_back(previous);
+		reclaim();
+
+		std::vector<std::string> keys;
+		for (size_t s = 0; s < subscriptions.size(); s++)
+		{
+			const Subscription &subscription = subscriptions[s];
+			if (subscription.Keys.empty())
+			{
+				subscription.Listener->onSettingsChanged(*snapshot, changed);
+				continue;
+			}
+			keys.clear();
+			for (size_t k = 0; k < changed.size(); k++)
+			{
+				if (std::find(subscription.Keys.begin(), subscription.Keys.end(), changed[k]) != subscription.Keys.end())
+					keys.push_back(changed[k]);
+			}
+			if (!keys.empty())
+				subscription.Listener->onSettingsChanged(*snapshot, keys);
+		}
+	}
+
+	void SettingsStore::reclaim()
+	{
+		//The current snapshot was stored with seq_cst before these loads, so a
+		//reader either pinned a retired snapshot before that or sees the new one
+		//when it validates its pin.
+		std::vector<const SettingsSnapshot *> pinned;
+		for (size_t h = 0; h < hazards.size(); h++)
+		{
+			const SettingsSnapshot *snapshot = hazards[h]->Snapshot.load(std::memory_order_seq_cst);
+			if (snapshot != NULL)
+				pinned.push_back(snapshot);
+		}
+
+		size_t kept = 0;
+		for (size_t i = 0; i < retired.size(); i++)
+		{
+			if (std::find(pinned.begin(), pinned.end(), retired[i]) != pinned.end())
+				retired[kept++] = retired[i];
+			else
+				delete retired[i];
+		}
+		retired.resize(kept);
+	}
+
+	void SettingsStore::subscribe(SettingsListener &listener, const std::vector<std::string> &keys)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		Subscription subscription;
+		subscription.Listener = &listener;
+		subscription.Keys = keys;
+		subscriptions.push_back(subscription);
+	}
+
+	void SettingsStore::unsubscribe(SettingsListener &listener)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		size_t kept = 0;
+		for (size_t s = 0; s < subscriptions.size(); s++)
+		{
+			if (subscriptions[s].Listener != &listener)
+				subscriptions[kept++] = subscriptions[s];
+		}
+		subscriptions.resize(kept);
+	}
+
+	size_t SettingsStore::getRetiredCount() const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return retired.size();
+	}
+
+	SettingsReader::SettingsReader(SettingsStore &store)
+		: store(store), hazard(NULL)
+	{
+		std::lock_guard<std::mutex> lock(store.mutex);
+		for (size_t h = 0; h < store.hazards.size() && hazard == NULL; h++)
+		{
+			if (!store.hazards[h]->InUse)
+			{
+				hazard = store.hazards[h].get();
+				hazard->InUse = true;
+			}
+		}
+		if (hazard == NULL)
+		{
+			store.hazards.push_back(std::unique_ptr<SettingsStore::Hazard>(new SettingsStore::Hazard()));
+			hazard = store.hazards.back().get();
+		}
+	}
+
+	SettingsReader::~SettingsReader()
+	{
+		std::lock_guard<std::mutex> lock(store.mutex);
+		hazard->Snapshot.store(NULL, std::memory_order_release);
+		hazard->InUse = false;
+		//Whatever only this reader kept alive can go now.
+		store.reclaim();
+	}
+
+}
@@ -0,0 +1,149 @@
+// SettingsStore.h
+//
+// The pipeline settings as immutable, versioned snapshots behind one atomic
+// pointer, in place of reading Properties.Settings.Default on every call:
+// CalculateCursorPos looks up pointer_considerRotation and compares the
+// pointer_sensorBarPos string per report, the frame loop reads
+// pointer_customCursor and DuoTouch the touch_* thresholds, each a lookup
+// through the settings provider. A reader here gets the current snapshot with
+// one load and reads plain fields from it.
+//
+// A change copies the current values, applies the change and publishes the
+// copy with a new version; an update that changes nothing publishes nothing.
+// Replaced snapshots are freed once no reader has them pinned: every reader
+// has one hazard pointer, set by acquire(), and the writer only deletes
+// snapshots none of them points to. A reader that acquires every frame and
+// never releases keeps at most one old snapshot alive.
+//
+// Listeners are told which keys changed, on the writer's thread after the new
+// snapshot is published. Writers are serialized; a listener must not change
+// settings itself.
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "PipelineSettings.h"
+
+namespace TouchmoteCore {
+
+	struct SettingsSnapshot
+	{
+		//Starts at 1 and grows by one per published change.
+		const uint64_t Version;
+		const PipelineSettings Values;
+
+		SettingsSnapshot(uint64_t version, const PipelineSettings &values) : Version(version), Values(values) {}
+	};
+
+	class SettingsListener
+	{
+	public:
+		virtual ~SettingsListener() {}
+
+		//keys are the changed keys the listener subscribed to, in the order of
+		//PipelineSettings::toEntries.
+		virtual void onSettingsChanged(const SettingsSnapshot &snapshot, const std::vector<std::string> &keys) = 0;
+	};
+
+	class SettingsReader;
+
+	class SettingsStore
+	{
+	public:
+		explicit SettingsStore(const PipelineSettings &values = PipelineSettings());
+		//Readers and listeners must be gone by then.
+		~SettingsStore();
+
+		//Version of the current snapshot. The values are read through a SettingsReader.
+		uint64_t getVersion() const { return current.load(std::memory_order_acquire)->Version; }
+
+		//Returns false and changes nothing if a key is not a pipeline setting.
+		bool set(const std::string &key, const SettingValue &value);
+		//All entries in one snapshot.
+		bool update(const std::vector<SettingEntry> &entries);
+		void replace(const PipelineSettings &values);
+
+		//Without keys the listener hears about every change, otherwise only about
+		//changes to those keys.
+		void subscribe(SettingsListener &listener, const std::vector<std::string> &keys = std::vector<std::string>());
+		void unsubscribe(SettingsListener &listener);
+
+		//Replaced snapshots not freed yet, because a reader had them pinned at the
+		//last change.
+		size_t getRetiredCount() const;
+
+	private:
+		friend class SettingsReader;
+
+		struct Subscription
+		{
+			SettingsListener *Listener;
+			std::vector<std::string> Keys;
+		};
+
+		//Padded so readers on different threads do not share a cache line.
+		struct Hazard
+		{
+			std::atomic<const SettingsSnapshot *> Snapshot;
+			bool InUse;
+			char Padding[64 - sizeof(std::atomic<const SettingsSnapshot *>) - sizeof(bool)];
+
+			Hazard() : Snapshot(NULL), InUse(true) {}
+		};
+
+		//Callers hold the mutex.
+		void publish(const PipelineSettings &values);
+		void reclaim();
+
+		SettingsStore(const SettingsStore &);
+		SettingsStore &operator=(const SettingsStore &);
+
+		std::atomic<const SettingsSnapshot *> current;
+		mutable std::mutex mutex;
+		std::vector<const SettingsSnapshot *> retired;
+		std::vector<std::unique_ptr<Hazard> > hazards;
+		std::vector<Subscription> subscriptions;
+	};
+
+	//Pinned access to the snapshots of a store, for one thread at a time.
+	class SettingsReader
+	{
+	public:
+		explicit SettingsReader(SettingsStore &store);
+		~SettingsReader();
+
+		//The current snapshot, valid until the next acquire() or release().
+		const SettingsSnapshot &acquire()
+		{
+			const SettingsSnapshot *snapshot = store.current.load(std::memory_order_acquire);
+			//Still pinned from the last call, nothing to publish.
+			if (hazard->Snapshot.load(std::memory_order_relaxed) == snapshot)
+				return *snapshot;
+			for (;;)
+			{
+				hazard->Snapshot.store(snapshot, std::memory_order_seq_cst);
+				//Pinned in time if it is still current after the pin is visible.
+				const SettingsSnapshot *again = store.current.load(std::memory_order_seq_cst);
+				if (again == snapshot)
+					return *snapshot;
+				snapshot = again;
+			}
+		}
+
+		void release() { hazard->Snapshot.store(NULL, std::memory_order_release); }
+
+	private:
+		SettingsReader(const SettingsReader &);
+		SettingsReader &operator=(const SettingsReader &);
+
+		SettingsStore &store;
+		SettingsStore::Hazard *hazard;
+	};
+
+}
@@ -0,0 +1,225 @@
+// TimerWheel.cpp
+
+#include "TimerWheel.h"
+
+#include <algorithm>
+
+namespace TouchmoteCore {
+
+	TimerWheel::TimerWheel(uint64_t resolution, int slots, uint64_t now)
+		: resolution(resolution > 0 ? resolution : 1), bits(1), live(0), nextSequence(0), freeList(-1)
+	{
+		//Up to 2^15 slots, so the levels stay within 60 bits of ticks.
+		while (bits < 15 && (1 << bits) < slots)
+			bits++;
+		mask = ((uint64_t)1 << bits) - 1;
+		heads.assign((size_t)TIMER_WHEEL_LEVELS << bits, -1);
+		std::fill(levelCounts, levelCounts + TIMER_WHEEL_LEVELS, 0);
+		currentTick = now / this->resolution;
+	}
+
+	int TimerWheel::findTimer(Handle handle) const
+	{
+		int index = (int)(handle & 0xffffffffu) - 1;
+		if (index < 0 || index >= (int)timers.size() || timers[index].Generation != (uint32_t)(handle >> 32))
+			return -1;
+		return index;
+	}
+
+	uint64_t TimerWheel::getTick(uint64_t deadline) const
+	{
+		return std::max(deadline / resolution + (deadline % resolution != 0 ? 1 : 0), currentTick);
+	}
+
+	void TimerWheel::link(int index)
+	{
+		Timer &timer = timers[index];
+		uint64_t tick = std::max(timer.Tick, currentTick);
+		uint64_t delta = tick - currentTick;
+
+		//The lowest level whose turn covers the distance; further out than the top
+		//level goes to the last slot ahead of it.
+		int level = 0;
+		while (level < TIMER_WHEEL_LEVELS - 1 && (delta >> (bits * (level + 1))) != 0)
+			level++;
+		if ((delta >> (bits * TIMER_WHEEL_LEVELS)) != 0)
+			tick = currentTick + ((uint64_t)1 << (bits * TIMER_WHEEL_LEVELS)) - 1;
+
+		timer.Bucket = (level << bits) + (int)((tick >> (bits * level)) & mask);
+		int &head = heads[timer.Bucket];
+		timer.State = TimerState::Linked;
+		timer.Prev = -1;
+		timer.Next = head;
+		if (head != -1)
+			timers[head].Prev = index;
+		head = index;
+		levelCounts[level]++;
+	}
+
+	void TimerWheel::unlink(int index)
+	{
+		Timer &timer = timers[index];
+		if (timer.Prev != -1)
+			timers[timer.Prev].Next = timer.Next;
+		else
+			heads[timer.Bucket] = timer.Next;
+		if (timer.Next != -1)
+			timers[timer.Next].Prev = timer.Prev;
+		levelCounts[timer.Bucket >> bits]--;
+	}
+
+	void TimerWheel::release(int index)
+	{
+		Timer &timer = timers[index];
+		timer.State = TimerState::Free;
+		timer.Generation++;
+		timer.Next = freeList;
+		freeList = index;
+		live--;
+	}
+
+	TimerWheel::Handle TimerWheel::schedule(uint64_t deadline, Callback callback, void *context, uint64_t data)
+	{
+		int index;
+		if (freeList != -1)
+		{
+			index = freeList;
+			freeList = timers[index].Next;
+		}
+		else
+		{
+			index = (int)timers.size();
+			Timer timer = Timer();
+			timer.Generation = 1;
+			timers.push_back(timer);
+		}
+
+		Timer &timer = timers[index];
+		timer.Deadline = deadline;
+		timer.Tick = getTick(deadline);
+		timer.Function = callback;
+		timer.Context = context;
+		timer.Data = data;
+		timer.Sequence = nextSequence++;
+		link(index);
+		live++;
+		return ((uint64_t)timer.Generation << 32) | (uint64_t)(index + 1);
+	}
+
+	bool TimerWheel::reschedule(Handle handle, uint64_t deadline)
+	{
+		int index = findTimer(handle);
+		if (index == -1 || timers[index].State != TimerState::Linked)
+			return false;
+
+		Timer &timer = timers[index];
+		unlink(index);
+		timer.Deadline = deadline;
+		timer.Tick = getTick(deadline);
+		timer.Sequence = nextSequence++;
+		link(index);
+		return true;
+	}
+
+	bool TimerWheel::cancel(Handle handle)
+	{
+		int index = findTimer(handle);
+		if (index == -1)
+			return false;
+
+		Timer &timer = timers[index];
+		if (timer.State == TimerState::Linked)
+		{
+			unlink(index);
+			release(index);
+			return true;
+		}
+		if (timer.State == TimerState::Due)
+		{
+			timer.State = TimerState::Cancelled;
+			timer.Generation++;
+			return true;
+		}
+		return false;
+	}
+
+	//Files the timers of the current slot of the level again, one level down or more.
+	void TimerWheel::cascade(int level)
+	{
+		int &head = heads[(level << bits) + (int)((currentTick >> (bits * level)) & mask)];
+		int index = head;
+		head = -1;
+		while (index != -1)
+		{
+			int next = timers[index].Next;
+			levelCounts[level]--;
+			link(index);
+			index = next;
+		}
+	}
+
+	void TimerWheel::advance(uint64_t now)
+	{
+		uint64_t lastTick = now / resolution;
+		if (lastTick < currentTick)
+			return;
+
+		due.clear();
+		while (currentTick <= lastTick)
+		{
+			//Cascade the levels that completed a turn, the highest first so its
+			//timers can go on down in the same tick.
+			int top = 0;
+			while (top < TIMER_WHEEL_LEVELS - 1 && (currentTick & (((uint64_t)1 << (bits * (top + 1))) - 1)) == 0)
+				top++;
+			for (int level = top; level > 0; level--)
+			{
+				if (levelCounts[level] > 0)
+					cascade(level);
+			}
+
+			int index = heads[currentTick & mask];
+			heads[currentTick & mask] = -1;
+			while (index != -1)
+			{
+				timers[index].State = TimerState::Due;
+				due.push_back(index);
+				levelCounts[0]--;
+				index = timers[index].Next;
+			}
+
+			//Nothing can fire before the lowest level that has timers cascades.
+			int lowest = 0;
+			while (lowest < TIMER_WHEEL_LEVELS && levelCounts[lowest] == 0)
+				lowest++;
+			if (lowest == TIMER_WHEEL_LEVELS)
+				currentTick = lastTick + 1;
+			else if (lowest == 0)
+				currentTick++;
+			else
+				currentTick = std::min(lastTick + 1, ((currentTick >> (bits * lowest)) + 1) << (bits * lowest));
+		}
+
+		//Timers scheduled by these callbacks go to a later tick, so they are not in this batch.
+		//No two timers have the same sequence, so std::sort gives one order without
+		//the buffer std::stable_sort allocates.
+		std::sort(due.begin(), due.end(), [this](int a, int b) {
+			const Timer &x = timers[a];
+			const Timer &y = timers[b];
+			return x.Deadline != y.Deadline ? x.Deadline < y.Deadline : x.Sequence < y.Sequence;
+		});
+		for (size_t i = 0; i < due.size(); i++)
+		{
+			int index = due[i];
+			Timer &timer = timers[index];
+			bool cancelled = timer.State == TimerState::Cancelled;
+			Callback function = timer.Function;
+			void *context = timer.Context;
+			uint64_t data = timer.Data;
+			release(index);
+			if (!cancelled)
+				function(context, data);
+		}
+	}
+
+}
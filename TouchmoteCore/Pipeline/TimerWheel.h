@@ -0,0 +1,107 @@
+// TimerWheel.h
+//
+// Hierarchical timer wheel: TIMER_WHEEL_LEVELS wheels of the same number of
+// slots, each slot of a level covering a whole turn of the level below. A
+// timer is filed in the level its distance fits in and moves down a level when
+// the clock reaches its slot, so advancing the clock only visits the slots of
+// the ticks that passed and the slots that cascade on the way. Scheduling,
+// rescheduling and cancelling are O(1) and nothing is allocated once the pool
+// has grown to the number of live timers. Timers beyond the top level wait in
+// its last slot and are filed again each time it cascades.
+//
+// Time has no fixed unit, it only has to match the resolution. A timer is
+// rounded up to the next tick, so it fires late by less than one resolution and
+// never early. Timers due in the same advance() fire in deadline order, those
+// with the same deadline in the order they were scheduled or rescheduled.
+//
+// Not thread safe; callbacks run inside advance() and may schedule, reschedule
+// and cancel timers, including ones due in the same advance().
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace TouchmoteCore {
+
+	static const int TIMER_WHEEL_LEVELS = 4;
+
+	class TimerWheel
+	{
+	public:
+		typedef void (*Callback)(void *context, uint64_t data);
+
+		//Timers can be cancelled by handle; a handle is never 0 and not reused
+		//until its slot has been recycled four billion times.
+		typedef uint64_t Handle;
+
+		//resolution is the length of a tick, slots is the number of slots of each
+		//level, rounded up to a power of two. The levels together cover slots^4 ticks.
+		TimerWheel(uint64_t resolution, int slots, uint64_t now);
+
+		//A deadline that already passed fires in the next advance().
+		Handle schedule(uint64_t deadline, Callback callback, void *context, uint64_t data);
+		//Moves a pending timer to another deadline, the handle stays valid. Returns
+		//false if the timer already fired or was cancelled.
+		bool reschedule(Handle handle, uint64_t deadline);
+		//Returns false if the timer already fired or was cancelled.
+		bool cancel(Handle handle);
+
+		//Fires every timer whose deadline is at or before now.
+		void advance(uint64_t now);
+
+		size_t size() const { return live; }
+
+	private:
+		enum class TimerState : uint8_t
+		{
+			Free,
+			Linked,
+			//Taken out of its slot by advance() and waiting to be called.
+			Due,
+			//Cancelled while Due, released by advance().
+			Cancelled
+		};
+
+		struct Timer
+		{
+			uint64_t Deadline;
+			uint64_t Tick;
+			Callback Function;
+			void *Context;
+			uint64_t Data;
+			//From nextSequence when scheduled, orders timers of the same deadline.
+			uint64_t Sequence;
+			uint32_t Generation;
+			TimerState State;
+			//Index in heads, level * slots + slot.
+			int Bucket;
+			int Prev;
+			int Next;
+		};
+
+		int findTimer(Handle handle) const;
+		uint64_t getTick(uint64_t deadline) const;
+		void link(int index);
+		void unlink(int index);
+		void release(int index);
+		void cascade(int level);
+
+		uint64_t resolution;
+		int bits;
+		uint64_t mask;
+		//Next tick to be processed; everything before it has fired.
+		uint64_t currentTick;
+		size_t live;
+		uint64_t nextSequence;
+		//Linked timers per level.
+		size_t levelCounts[TIMER_WHEEL_LEVELS];
+		std::vector<int> heads;
+		std::vector<Timer> timers;
+		int freeList;
+		//Scratch for advance().
+		std::vector<int> due;
+	};
+
+}
@@ -0,0 +1,40 @@
+// CaptureFormat.h
+//
+// Binary layout of Touchmote input captures (*.tmcap). A capture is a header
+// followed by a stream of self-delimiting records, so it can be written while
+// the app runs and read back without loading the whole file.
+//
+//   header:  "TMCP" u16 version u16 reserved
+//   record:  u8 type, varint timestamp delta (us), u8 slot, varint payload size, payload
+//
+// All multi-byte integers are little endian; varints are unsigned LEB128.
+// Readers skip record types they do not know. The writer in
+// WiiTUIO/Input/WiiProvider/ReportRecorder.cs must stay in sync with this file.
+
+#pragma once
+
+#include <stdint.h>
+
+namespace TouchmoteCore {
+
+	static const char CAPTURE_MAGIC[4] = { 'T', 'M', 'C', 'P' };
+	static const uint16_t CAPTURE_VERSION = 1;
+	//Largest payload a reader accepts. A Settings record of every setting is a
+	//few KB; a larger size is a corrupt file, not something to allocate for.
+	static const uint32_t CAPTURE_MAX_PAYLOAD = 1 << 20;
+
+	enum class CaptureRecordType : uint8_t
+	{
+		//Payload: repeated { u8 key length, key, u8 SettingValue::Type, value }.
+		//Bool is one byte, Int a zigzag varint, Double 8 bytes IEEE 754, String u8 length + bytes.
+		Settings = 1,
+		//Empty payload, slot is the WiimoteStatus.ID given to the controller.
+		Connect = 2,
+		Disconnect = 3,
+		//Payload: varint buttons, u8 accel x, y, z, u8 battery, u8 IR found mask,
+		//per found sensor { u16 raw x, u16 raw y, u8 size }, u8 extension type,
+		//and if an extension is present u8 length + extension bytes.
+		Report = 4
+	};
+
+}
@@ -0,0 +1,225 @@
+// CaptureReader.cpp
+
+#include "CaptureReader.h"
+
+#include <string.h>
+
+namespace TouchmoteCore {
+
+	CaptureReader::CaptureReader(std::istream &in)
+		: in(in), valid(false), timestamp(0), cursor(0)
+	{
+		char header[8];
+		if (!in.read(header, sizeof(header)))
+		{
+			fail("Capture header is truncated");
+			return;
+		}
+		if (memcmp(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0)
+		{
+			fail("Not a Touchmote capture");
+			return;
+		}
+		uint16_t version = (uint16_t)((uint8_t)header[4] | ((uint8_t)header[5] << 8));
+		if (version > CAPTURE_VERSION)
+		{
+			fail("Capture was written by a newer version");
+			return;
+		}
+		valid = true;
+	}
+
+	bool CaptureReader::fail(const char *message)
+	{
+		errorMessage = message;
+		return false;
+	}
+
+	bool CaptureReader::readVarint(uint64_t &value)
+	{
+		value = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			int c = in.get();
+			if (c == EOF)
+				return false;
+			value |= (uint64_t)(c & 0x7f) << shift;
+			if ((c & 0x80) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	bool CaptureReader::next(CaptureRecord &record)
+	{
+		if (!valid)
+			return false;
+
+		while (true)
+		{
+			int type = in.get();
+			if (type == EOF)
+				return false;
+
+			uint64_t delta, size;
+			if (!readVarint(delta))
+				return fail("Truncated record header");
+			int slot = in.get();
+			if (slot == EOF || !readVarint(size))
+				return fail("Truncated record header");
+
+			if (size > CAPTURE_MAX_PAYLOAD)
+				return fail("Malformed record");
+			payload.resize((size_t)size);
+			if (size > 0 && !in.read(&payload[0], (std::streamsize)size))
+				return fail("Truncated record payload");
+			cursor = 0;
+
+			timestamp += delta;
+
+			record.Type = (CaptureRecordType)type;
+			record.Timestamp = timestamp;
+			record.Slot = slot;
+
+			switch (record.Type)
+			{
+			case CaptureRecordType::Settings:
+				return parseSettings(record);
+			case CaptureRecordType::Connect:
+			case CaptureRecordType::Disconnect:
+				return true;
+			case CaptureRecordType::Report:
+				return parseReport(record);
+			default:
+				//Unknown record from a newer writer, skip it.
+				break;
+			}
+		}
+	}
+
+	//Payload accessors. They return false instead of reading past the end.
+	#define PAYLOAD_U8(dest) \
+		do { if (cursor + 1 > payload.size()) return fail("Malformed record payload"); \
+			dest = (uint8_t)payload[cursor++]; } while (0)
+
+	#define PAYLOAD_U16(dest) \
+		do { if (cursor + 2 > payload.size()) return fail("Malformed record payload"); \
+			dest = (uint16_t)((uint8_t)payload[cursor] | ((uint8_t)payload[cursor + 1] << 8)); cursor += 2; } while (0)
+
+	#define PAYLOAD_VARINT(dest) \
+		do { uint64_t v_ = 0; int shift_ = 0; uint8_t b_; \
+			do { PAYLOAD_U8(b_); v_ |= (uint64_t)(b_ & 0x7f) << shift_; shift_ += 7; } while ((b_ & 0x80) && shift_ < 64); \
+			dest = v_; } while (0)
+
+	bool CaptureReader::parseSettings(CaptureRecord &record)
+	{
+		record.Settings.clear();
+		while (cursor < payload.size())
+		{
+			SettingEntry entry;
+			uint8_t keyLength, type;
+			PAYLOAD_U8(keyLength);
+			if (cursor + keyLength > payload.size())
+				return fail("Malformed record payload");
+			entry.key.assign(payload, cursor, keyLength);
+			cursor += keyLength;
+
+			PAYLOAD_U8(type);
+			entry.value.type = (SettingValue::Type)type;
+			switch (entry.value.type)
+			{
+			case SettingValue::Type::Bool:
+			{
+				uint8_t b;
+				PAYLOAD_U8(b);
+				entry.value.b = b != 0;
+				break;
+			}
+			case SettingValue::Type::Int:
+			{
+				uint64_t zigzag;
+				PAYLOAD_VARINT(zigzag);
+				uint32_t u = (uint32_t)zigzag;
+				entry.value.i = (int)((u >> 1) ^ (~(u & 1) + 1));
+				break;
+			}
+			case SettingValue::Type::Double:
+			{
+				if (cursor + 8 > payload.size())
+					return fail("Malformed record payload");
+				uint64_t bits = 0;
+				for (int i = 0; i < 8; i++)
+					bits |= (uint64_t)(uint8_t)payload[cursor + i] << (8 * i);
+				cursor += 8;
+				memcpy(&entry.value.d, &bits, sizeof(bits));
+				break;
+			}
+			case SettingValue::Type::String:
+			{
+				uint8_t length;
+				PAYLOAD_U8(length);
+				if (cursor + length > payload.size())
+					return fail("Malformed record payload");
+				entry.value.s.assign(payload, cursor, length);
+				cursor += length;
+				break;
+			}
+			default:
+				return fail("Unknown setting type");
+			}
+			record.Settings.push_back(entry);
+		}
+		return true;
+	}
+
+	bool CaptureReader::parseReport(CaptureRecord &record)
+	{
+		WiimoteReport &report = record.Report;
+		memset(&report, 0, sizeof(report));
+		report.Timestamp = record.Timestamp;
+		report.Slot = record.Slot;
+
+		uint64_t buttons;
+		PAYLOAD_VARINT(buttons);
+		report.Buttons = (uint32_t)buttons;
+		PAYLOAD_U8(report.AccelRaw[0]);
+		PAYLOAD_U8(report.AccelRaw[1]);
+		PAYLOAD_U8(report.AccelRaw[2]);
+		PAYLOAD_U8(report.BatteryRaw);
+
+		uint8_t mask;
+		PAYLOAD_U8(mask);
+		for (int i = 0; i < IR_SENSOR_COUNT; i++)
+		{
+			if ((mask & (1 << i)) == 0)
+				continue;
+			uint16_t x, y;
+			uint8_t size;
+			PAYLOAD_U16(x);
+			PAYLOAD_U16(y);
+			PAYLOAD_U8(size);
+			report.IR[i].Found = true;
+			report.IR[i].setRawPosition(x, y);
+			report.IR[i].Size = size;
+		}
+
+		uint8_t extension;
+		PAYLOAD_U8(extension);
+		report.Extension = (ExtensionType)extension;
+		if (report.Extension != ExtensionType::None)
+		{
+			uint8_t length;
+			PAYLOAD_U8(length);
+			if (cursor + length > payload.size())
+				return fail("Malformed record payload");
+			memcpy(report.ExtensionData, payload.data() + cursor, length < MAX_EXTENSION_BYTES ? length : MAX_EXTENSION_BYTES);
+			cursor += length;
+		}
+		return true;
+	}
+
+	#undef PAYLOAD_U8
+	#undef PAYLOAD_U16
+	#undef PAYLOAD_VARINT
+
+}
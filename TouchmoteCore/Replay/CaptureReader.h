@@ -0,0 +1,58 @@
+// CaptureReader.h
+
+#pragma once
+
+#include <stdint.h>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "CaptureFormat.h"
+#include "../Input/WiimoteReport.h"
+#include "../Pipeline/PipelineSettings.h"
+
+namespace TouchmoteCore {
+
+	struct CaptureRecord
+	{
+		CaptureRecordType Type;
+		//Absolute microseconds since the start of the capture.
+		uint64_t Timestamp;
+		int Slot;
+		//Valid for Report records.
+		WiimoteReport Report;
+		//Valid for Settings records.
+		std::vector<SettingEntry> Settings;
+	};
+
+	class CaptureReader
+	{
+	public:
+		//The stream must be opened in binary mode.
+		explicit CaptureReader(std::istream &in);
+
+		//False if the header is missing or from a newer version.
+		bool isValid() const { return valid; }
+
+		//Reads the next known record. Returns false at the end of the stream or on a
+		//truncated or malformed record, in which case error() says which.
+		bool next(CaptureRecord &record);
+
+		const std::string &error() const { return errorMessage; }
+
+	private:
+		bool readVarint(uint64_t &value);
+		bool parseSettings(CaptureRecord &record);
+		bool parseReport(CaptureRecord &record);
+		bool fail(const char *message);
+
+		std::istream &in;
+		bool valid;
+		uint64_t timestamp;
+		std::string errorMessage;
+
+		std::string payload;
+		size_t cursor;
+	};
+
+}
@@ -0,0 +1,145 @@
+// CaptureWriter.cpp
+
+#include "CaptureWriter.h"
+
+#include <string.h>
+
+namespace TouchmoteCore {
+
+	static void putU8(std::string &buffer, uint8_t value)
+	{
+		buffer.push_back((char)value);
+	}
+
+	static void putU16(std::string &buffer, uint16_t value)
+	{
+		buffer.push_back((char)(value & 0xff));
+		buffer.push_back((char)(value >> 8));
+	}
+
+	static void putVarint(std::string &buffer, uint64_t value)
+	{
+		while (value >= 0x80)
+		{
+			buffer.push_back((char)((value & 0x7f) | 0x80));
+			value >>= 7;
+		}
+		buffer.push_back((char)value);
+	}
+
+	static void putDouble(std::string &buffer, double value)
+	{
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		for (int i = 0; i < 8; i++)
+			buffer.push_back((char)((bits >> (8 * i)) & 0xff));
+	}
+
+	CaptureWriter::CaptureWriter(std::ostream &out)
+		: out(out), lastTimestamp(0)
+	{
+		std::string header(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+		putU16(header, CAPTURE_VERSION);
+		putU16(header, 0);
+		out.write(header.data(), header.size());
+	}
+
+	void CaptureWriter::writeRecord(CaptureRecordType type, uint64_t timestamp, int slot)
+	{
+		//Timestamps are stored as deltas, a clock going backwards is clamped to zero.
+		uint64_t delta = timestamp > lastTimestamp ? timestamp - lastTimestamp : 0;
+		if (timestamp > lastTimestamp)
+			lastTimestamp = timestamp;
+
+		std::string head;
+		putU8(head, (uint8_t)type);
+		putVarint(head, delta);
+		putU8(head, (uint8_t)slot);
+		putVarint(head, payload.size());
+
+		out.write(head.data(), head.size());
+		out.write(payload.data(), payload.size());
+		payload.clear();
+	}
+
+	void CaptureWriter::writeSettings(uint64_t timestamp, const std::vector<SettingEntry> &entries)
+	{
+		payload.clear();
+		for (size_t i = 0; i < entries.size(); i++)
+		{
+			const SettingEntry &entry = entries[i];
+			size_t keyLength = entry.key.size() < 255 ? entry.key.size() : 255;
+			putU8(payload, (uint8_t)keyLength);
+			payload.append(entry.key, 0, keyLength);
+			putU8(payload, (uint8_t)entry.value.type);
+			switch (entry.value.type)
+			{
+			case SettingValue::Type::Bool:
+				putU8(payload, entry.value.b ? 1 : 0);
+				break;
+			case SettingValue::Type::Int:
+				putVarint(payload, ((uint32_t)entry.value.i << 1) ^ (uint32_t)(entry.value.i >> 31));
+				break;
+			case SettingValue::Type::Double:
+				putDouble(payload, entry.value.d);
+				break;
+			case SettingValue::Type::String:
+			{
+				size_t length = entry.value.s.size() < 255 ? entry.value.s.size() : 255;
+				putU8(payload, (uint8_t)length);
+				payload.append(entry.value.s, 0, length);
+				break;
+			}
+			}
+		}
+		writeRecord(CaptureRecordType::Settings, timestamp, 0);
+	}
+
+	void CaptureWriter::writeConnect(uint64_t timestamp, int slot)
+	{
+		payload.clear();
+		writeRecord(CaptureRecordType::Connect, timestamp, slot);
+	}
+
+	void CaptureWriter::writeDisconnect(uint64_t timestamp, int slot)
+	{
+		payload.clear();
+		writeRecord(CaptureRecordType::Disconnect, timestamp, slot);
+	}
+
+	void CaptureWriter::writeReport(const WiimoteReport &report)
+	{
+		payload.clear();
+		putVarint(payload, report.Buttons);
+		putU8(payload, report.AccelRaw[0]);
+		putU8(payload, report.AccelRaw[1]);
+		putU8(payload, report.AccelRaw[2]);
+		putU8(payload, report.BatteryRaw);
+
+		uint8_t mask = 0;
+		for (int i = 0; i < IR_SENSOR_COUNT; i++)
+		{
+			if (report.IR[i].Found)
+				mask |= (uint8_t)(1 << i);
+		}
+		putU8(payload, mask);
+		for (int i = 0; i < IR_SENSOR_COUNT; i++)
+		{
+			if (!report.IR[i].Found)
+				continue;
+			putU16(payload, (uint16_t)report.IR[i].RawX);
+			putU16(payload, (uint16_t)report.IR[i].RawY);
+			putU8(payload, (uint8_t)report.IR[i].Size);
+		}
+
+		putU8(payload, (uint8_t)report.Extension);
+		if (report.Extension != ExtensionType::None)
+		{
+			putU8(payload, MAX_EXTENSION_BYTES);
+			payload.append((const char *)report.ExtensionData, MAX_EXTENSION_BYTES);
+		}
+
+		writeRecord(CaptureRecordType::Report, report.Timestamp, report.Slot);
+	}
+
+}
@@ -0,0 +1,37 @@
+// CaptureWriter.h
+
+#pragma once
+
+#include <stdint.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "CaptureFormat.h"
+#include "../Input/WiimoteReport.h"
+#include "../Pipeline/PipelineSettings.h"
+
+namespace TouchmoteCore {
+
+	class CaptureWriter
+	{
+	public:
+		//The stream must be opened in binary mode. The header is written immediately.
+		explicit CaptureWriter(std::ostream &out);
+
+		void writeSettings(uint64_t timestamp, const std::vector<SettingEntry> &entries);
+		void writeConnect(uint64_t timestamp, int slot);
+		void writeDisconnect(uint64_t timestamp, int slot);
+		void writeReport(const WiimoteReport &report);
+
+		bool good() const { return out.good(); }
+
+	private:
+		void writeRecord(CaptureRecordType type, uint64_t timestamp, int slot);
+
+		std::ostream &out;
+		uint64_t lastTimestamp;
+		std::string payload;
+	};
+
+}
@@ -0,0 +1,451 @@
+// FilterEvaluation.cpp
+
+#include "FilterEvaluation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+
+#include "SyntheticTrace.h"
+#include "../Input/ScreenPositionCalculator.h"
+
+namespace TouchmoteCore {
+
+	static const double PI = 3.14159265358979323846;
+	static const double IR_SCALE_X = 1023.5;
+	static const double IR_SCALE_Y = 767.5;
+	//Half the distance between the two sensor bar dots, in camera pixels.
+	static const int DOT_HALF_SPAN = 100;
+
+	//Truth closer than this over a window counts as not moving, in pixels.
+	static const double STILL_THRESHOLD = 1.0;
+	static const uint64_t STILL_WINDOW = 200000;
+	static const uint64_t OVERSHOOT_WINDOW = 300000;
+	static const int LAG_SEARCH_MIN_MS = -50;
+	static const int LAG_SEARCH_MAX_MS = 150;
+
+	//Relative sensor bar midpoint to screen pixels, the same bounds ScreenPositionCalculator uses.
+	struct ScreenMapping
+	{
+		int minXPos;
+		int maxWidth;
+		int minYPos;
+		int maxHeight;
+		int offsetY;
+
+		explicit ScreenMapping(const PipelineSettings &settings)
+		{
+			minXPos = -(int)(settings.screenWidth * settings.pointer_marginsLeftRight);
+			int maxXPos = settings.screenWidth + (int)(settings.screenWidth * settings.pointer_marginsLeftRight);
+			maxWidth = maxXPos - minXPos;
+			minYPos = -(int)(settings.screenHeight * settings.pointer_marginsTopBottom);
+			int maxYPos = settings.screenHeight + (int)(settings.screenHeight * settings.pointer_marginsTopBottom);
+			maxHeight = maxYPos - minYPos;
+			int compensation = (int)(settings.screenHeight * settings.pointer_sensorBarPosCompensation);
+			offsetY = settings.pointer_sensorBarPos == SensorBarPos::Top ? -compensation
+				: settings.pointer_sensorBarPos == SensorBarPos::Bottom ? compensation : 0;
+		}
+
+		void toScreen(double midX, double midY, double &x, double &y) const
+		{
+			x = maxWidth * (1 - midX) + minXPos;
+			y = maxHeight * midY + minYPos + offsetY;
+		}
+
+		void toMidpoint(double x, double y, double &midX, double &midY) const
+		{
+			midX = 1 - (x - minXPos) / maxWidth;
+			midY = (y - offsetY - minYPos) / maxHeight;
+		}
+	};
+
+	bool FilterEvalTrace::getTruth(uint64_t timestamp, double &x, double &y) const
+	{
+		if (Truth.empty() || timestamp < Truth.front().Timestamp || timestamp > Truth.back().Timestamp)
+			return false;
+
+		size_t low = 0, high = Truth.size() - 1;
+		while (high - low > 1)
+		{
+			size_t mid = (low + high) / 2;
+			if (Truth[mid].Timestamp <= timestamp)
+				low = mid;
+			else
+				high = mid;
+		}
+
+		const TruthSample &a = Truth[low];
+		const TruthSample &b = Truth[high];
+		double f = b.Timestamp > a.Timestamp ? (double)(timestamp - a.Timestamp) / (b.Timestamp - a.Timestamp) : 0;
+		if (f > 1)
+			f = 1;
+		x = a.X + (b.X - a.X) * f;
+		y = a.Y + (b.Y - a.Y) * f;
+		return true;
+	}
+
+	struct MotionSegment
+	{
+		enum Type { Hold, Flick, Sweep };
+
+		Type SegmentType;
+		uint64_t Start;
+		uint64_t End;
+		double FromX, FromY;
+		double ToX, ToY;
+		double Amplitude;
+		double Frequency;
+
+		void getPosition(uint64_t timestamp, double &x, double &y) const
+		{
+			double t = (double)(timestamp - Start) / (End - Start);
+			switch (SegmentType)
+			{
+			case Flick:
+			{
+				//Minimum jerk profile, which is close to how a wrist flick accelerates and stops.
+				double s = t * t * t * (10 - 15 * t + 6 * t * t);
+				x = FromX + (ToX - FromX) * s;
+				y = FromY + (ToY - FromY) * s;
+				break;
+			}
+			case Sweep:
+			{
+				double seconds = (timestamp - Start) / 1000000.0;
+				x = FromX + Amplitude * std::sin(2 * PI * Frequency * seconds);
+				y = FromY + Amplitude * 0.5 * std::sin(4 * PI * Frequency * seconds);
+				break;
+			}
+			default:
+				x = FromX;
+				y = FromY;
+				break;
+			}
+		}
+	};
+
+	static double nextUniform(XorShift32 &random)
+	{
+		return (random.next() + 0.5) / 4294967296.0;
+	}
+
+	static double nextGaussian(XorShift32 &random)
+	{
+		double u = nextUniform(random), v = nextUniform(random);
+		return std::sqrt(-2 * std::log(u)) * std::cos(2 * PI * v);
+	}
+
+	void makeMotionTrace(const MotionTraceConfig &config, const PipelineSettings &settings, FilterEvalTrace &trace)
+	{
+		trace.Reports.clear();
+		trace.Truth.clear();
+
+		XorShift32 random(config.Seed);
+		ScreenMapping mapping(settings);
+		double minX = settings.screenWidth * 0.15, rangeX = settings.screenWidth * 0.7;
+		double minY = settings.screenHeight * 0.15, rangeY = settings.screenHeight * 0.7;
+		uint64_t duration = (uint64_t)config.DurationMs * 1000;
+
+		//Script the motion.
+		std::vector<MotionSegment> segments;
+		double x = settings.screenWidth / 2.0, y = settings.screenHeight / 2.0;
+		uint64_t t = 0;
+		for (int n = 0; t < duration; n++)
+		{
+			MotionSegment segment;
+			memset(&segment, 0, sizeof(segment));
+			segment.Start = t;
+			segment.FromX = segment.ToX = x;
+			segment.FromY = segment.ToY = y;
+			switch (n % 6)
+			{
+			case 0:
+			case 2:
+			case 4:
+				segment.SegmentType = MotionSegment::Hold;
+				segment.End = t + 400000 + random.next() % 600000;
+				break;
+			case 1:
+			case 5:
+				segment.SegmentType = MotionSegment::Flick;
+				segment.End = t + 150000 + random.next() % 250000;
+				segment.ToX = minX + nextUniform(random) * rangeX;
+				segment.ToY = minY + nextUniform(random) * rangeY;
+				break;
+			case 3:
+				//Whole periods, so the sweep ends where it started.
+				segment.SegmentType = MotionSegment::Sweep;
+				segment.Frequency = (n / 6) % 2 == 0 ? 0.5 : 2;
+				segment.End = t + (uint64_t)(2000000 / segment.Frequency);
+				segment.Amplitude = std::min(150.0, std::min(x - minX, minX + rangeX - x));
+				break;
+			}
+			segments.push_back(segment);
+			x = segment.ToX;
+			y = segment.ToY;
+			t = segment.End;
+		}
+
+		size_t current = 0;
+		for (uint64_t ms = 0; ms * 1000 <= duration; ms++)
+		{
+			uint64_t timestamp = ms * 1000;
+			while (current + 1 < segments.size() && segments[current].End <= timestamp)
+				current++;
+			TruthSample sample;
+			sample.Timestamp = timestamp;
+			segments[current].getPosition(timestamp, sample.X, sample.Y);
+			trace.Truth.push_back(sample);
+		}
+
+		uint64_t period = 1000000 / (uint64_t)(config.ReportRate > 0 ? config.ReportRate : 1);
+		for (uint64_t timestamp = period; timestamp <= duration; timestamp += period)
+		{
+			double truthX = 0, truthY = 0;
+			trace.getTruth(timestamp, truthX, truthY);
+			double midX, midY;
+			mapping.toMidpoint(truthX, truthY, midX, midY);
+
+			WiimoteReport report;
+			memset(&report, 0, sizeof(report));
+			report.Timestamp = timestamp;
+			report.Slot = 1;
+			report.BatteryRaw = 0xc0;
+			report.AccelRaw[0] = 128;
+			report.AccelRaw[1] = 128;
+			report.AccelRaw[2] = 154;
+			for (int d = 0; d < 2; d++)
+			{
+				double rawX = midX * IR_SCALE_X + (d == 0 ? -DOT_HALF_SPAN : DOT_HALF_SPAN) + nextGaussian(random) * config.SensorNoise;
+				double rawY = midY * IR_SCALE_Y + nextGaussian(random) * config.SensorNoise;
+				report.IR[d].Found = true;
+				report.IR[d].setRawPosition((int)std::floor(rawX + 0.5), (int)std::floor(rawY + 0.5));
+				report.IR[d].Size = 3;
+			}
+			trace.Reports.push_back(report);
+		}
+	}
+
+	bool loadCaptureTrace(CaptureReader &reader, int slot, PipelineSettings &settings, FilterEvalTrace &trace, std::string &error)
+	{
+		trace.Reports.clear();
+		trace.Truth.clear();
+		if (!reader.isValid())
+		{
+			error = reader.error();
+			return false;
+		}
+
+		CaptureRecord record;
+		while (reader.next(record))
+		{
+			switch (record.Type)
+			{
+			case CaptureRecordType::Settings:
+				//Later settings changes would move the truth mapping, only the first set counts.
+				if (trace.Reports.empty())
+				{
+					for (size_t i = 0; i < record.Settings.size(); i++)
+						settings.setValue(record.Settings[i].key, record.Settings[i].value);
+				}
+				break;
+			case CaptureRecordType::Connect:
+				if (slot == 0)
+					slot = record.Slot;
+				break;
+			case CaptureRecordType::Report:
+				if (record.Slot == slot)
+					trace.Reports.push_back(record.Report);
+				break;
+			default:
+				break;
+			}
+		}
+		if (!reader.error().empty())
+		{
+			error = reader.error();
+			return false;
+		}
+
+		ScreenMapping mapping(settings);
+		for (size_t r = 0; r < trace.Reports.size(); r++)
+		{
+			const WiimoteReport &report = trace.Reports[r];
+			//Same pair as CalculateCursorPos: the first two sensors that are found.
+			int first = -1, second = -1;
+			for (int i = 0; i < IR_SENSOR_COUNT && second < 0; i++)
+			{
+				if (!report.IR[i].Found)
+					continue;
+				if (first < 0)
+					first = i;
+				else
+					second = i;
+			}
+			if (second < 0)
+				continue;
+
+			TruthSample sample;
+			sample.Timestamp = report.Timestamp;
+			mapping.toScreen((report.IR[first].X + report.IR[second].X) / 2.0, (report.IR[first].Y + report.IR[second].Y) / 2.0, sample.X, sample.Y);
+			trace.Truth.push_back(sample);
+		}
+
+		if (trace.Reports.empty())
+		{
+			error = "no reports for this controller";
+			return false;
+		}
+		return true;
+	}
+
+	struct EvalFrame
+	{
+		uint64_t DisplayTime;
+		double X;
+		double Y;
+	};
+
+	//Whether the truth stays within STILL_THRESHOLD over [from, to].
+	static bool isTruthStill(const FilterEvalTrace &trace, uint64_t from, uint64_t to)
+	{
+		double x0, y0;
+		if (!trace.getTruth(from, x0, y0))
+			return false;
+		for (uint64_t t = from; t <= to; t += 5000)
+		{
+			double x, y;
+			if (!trace.getTruth(t, x, y))
+				return false;
+			if (std::fabs(x - x0) > STILL_THRESHOLD || std::fabs(y - y0) > STILL_THRESHOLD)
+				return false;
+		}
+		return true;
+	}
+
+	FilterEvalResult evaluateFilter(const FilterEvalTrace &trace, const PipelineSettings &settings, uint64_t displayLatency)
+	{
+		FilterEvalResult result;
+		memset(&result, 0, sizeof(result));
+		if (trace.Reports.empty())
+			return result;
+
+		PipelineSettings evalSettings = settings;
+		evalSettings.pointer_considerRotation = false;
+		ScreenPositionCalculator calculator(evalSettings);
+
+		int fps = evalSettings.pointer_FPS > 0 ? evalSettings.pointer_FPS : 1;
+		uint64_t period = (uint64_t)(1000 / fps) * 1000;
+		uint64_t end = trace.Reports.back().Timestamp;
+
+		//Run the frame loop like InputPipeline: every frame processes the latest report.
+		std::vector<EvalFrame> frames;
+		size_t next = 0;
+		for (uint64_t t = trace.Reports.front().Timestamp; t <= end; t += period)
+		{
+			while (next < trace.Reports.size() && trace.Reports[next].Timestamp <= t)
+				next++;
+			CursorPos pos = calculator.CalculateCursorPos(trace.Reports[next - 1], t);
+			if (pos.OutOfReach)
+				continue;
+			EvalFrame frame = { t + displayLatency, (double)pos.X, (double)pos.Y };
+			frames.push_back(frame);
+		}
+
+		std::vector<double> errors;
+		double errorSum = 0, movingSum = 0;
+		uint64_t moving = 0;
+		double jitterSum = 0;
+		uint64_t jitterCount = 0;
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			double x, y;
+			if (!trace.getTruth(frames[i].DisplayTime, x, y))
+				continue;
+			double error = std::sqrt((frames[i].X - x) * (frames[i].X - x) + (frames[i].Y - y) * (frames[i].Y - y));
+			errors.push_back(error);
+			errorSum += error;
+
+			bool still = frames[i].DisplayTime >= STILL_WINDOW && isTruthStill(trace, frames[i].DisplayTime - STILL_WINDOW, frames[i].DisplayTime);
+			if (!still)
+			{
+				movingSum += error;
+				moving++;
+			}
+			else if (i > 0)
+			{
+				double dx = frames[i].X - frames[i - 1].X, dy = frames[i].Y - frames[i - 1].Y;
+				jitterSum += dx * dx + dy * dy;
+				jitterCount++;
+			}
+		}
+
+		result.Frames = errors.size();
+		if (errors.empty())
+			return result;
+		result.MeanError = errorSum / errors.size();
+		result.MovingMeanError = moving > 0 ? movingSum / moving : 0;
+		result.JitterPx = jitterCount > 0 ? std::sqrt(jitterSum / jitterCount) : 0;
+		std::sort(errors.begin(), errors.end());
+		result.P95Error = errors[std::min(errors.size() - 1, (size_t)(errors.size() * 0.95))];
+
+		//Lag: the shift of the truth that matches the output best.
+		double bestError = -1;
+		for (int lag = LAG_SEARCH_MIN_MS; lag <= LAG_SEARCH_MAX_MS; lag++)
+		{
+			double sum = 0;
+			uint64_t count = 0;
+			for (size_t i = 0; i < frames.size(); i++)
+			{
+				int64_t shifted = (int64_t)frames[i].DisplayTime - (int64_t)lag * 1000;
+				double x, y;
+				if (shifted < 0 || !trace.getTruth((uint64_t)shifted, x, y))
+					continue;
+				sum += (frames[i].X - x) * (frames[i].X - x) + (frames[i].Y - y) * (frames[i].Y - y);
+				count++;
+			}
+			if (count == 0)
+				continue;
+			double error = sum / count;
+			if (bestError < 0 || error < bestError)
+			{
+				bestError = error;
+				result.LagMs = lag;
+			}
+		}
+
+		//Overshoot: find where the truth comes to rest and look at the output right after.
+		uint64_t truthStart = trace.Truth.front().Timestamp, truthEnd = trace.Truth.back().Timestamp;
+		bool wasMoving = false;
+		size_t frame = 0;
+		for (uint64_t t = truthStart + 50000; t + OVERSHOOT_WINDOW <= truthEnd; t += 5000)
+		{
+			bool still = isTruthStill(trace, t - 20000, t);
+			if (still && wasMoving && isTruthStill(trace, t, t + OVERSHOOT_WINDOW))
+			{
+				double restX, restY, beforeX, beforeY;
+				trace.getTruth(t, restX, restY);
+				trace.getTruth(t - 50000, beforeX, beforeY);
+				double dirX = restX - beforeX, dirY = restY - beforeY;
+				double length = std::sqrt(dirX * dirX + dirY * dirY);
+				if (length > 0)
+				{
+					dirX /= length;
+					dirY /= length;
+					while (frame < frames.size() && frames[frame].DisplayTime < t)
+						frame++;
+					for (size_t i = frame; i < frames.size() && frames[i].DisplayTime <= t + OVERSHOOT_WINDOW; i++)
+					{
+						double past = (frames[i].X - restX) * dirX + (frames[i].Y - restY) * dirY;
+						if (past > result.OvershootPx)
+							result.OvershootPx = past;
+					}
+				}
+			}
+			wasMoving = !still;
+		}
+
+		return result;
+	}
+
+}
@@ -0,0 +1,84 @@
+// FilterEvaluation.h
+//
+// Measures how well the pointer filter chain follows the hand. A trace is a
+// list of reports from one controller together with the true cursor position
+// over time. The reports run through ScreenPositionCalculator on the frame clock
+// of InputPipeline and every frame output is compared with where the cursor
+// should be once the frame is on screen.
+//
+// Synthetic traces know the exact motion. For recorded captures the truth is
+// the unfiltered sensor bar midpoint, so there the error includes sensor noise.
+// Rotation compensation is switched off in both, it does not affect latency and
+// would make the truth depend on the accelerometer.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "CaptureReader.h"
+#include "../Input/WiimoteReport.h"
+#include "../Pipeline/PipelineSettings.h"
+
+namespace TouchmoteCore {
+
+	struct TruthSample
+	{
+		//Microseconds.
+		uint64_t Timestamp;
+		//Screen pixels.
+		double X;
+		double Y;
+	};
+
+	struct FilterEvalTrace
+	{
+		std::vector<WiimoteReport> Reports;
+		//Ordered by time, linearly interpolated in between.
+		std::vector<TruthSample> Truth;
+
+		bool getTruth(uint64_t timestamp, double &x, double &y) const;
+	};
+
+	struct MotionTraceConfig
+	{
+		int ReportRate;
+		int DurationMs;
+		//Standard deviation of the IR dot position, in camera pixels.
+		double SensorNoise;
+		uint32_t Seed;
+
+		MotionTraceConfig() : ReportRate(100), DurationMs(30000), SensorNoise(0.5), Seed(1) {}
+	};
+
+	//Alternates between holding still, quick minimum-jerk flicks between targets
+	//and slow and fast sweeps.
+	void makeMotionTrace(const MotionTraceConfig &config, const PipelineSettings &settings, FilterEvalTrace &trace);
+
+	//Reports of one slot from a capture, with the raw midpoint as truth. Slot 0
+	//takes the first controller that connects. Settings records in the capture
+	//are applied to settings.
+	bool loadCaptureTrace(CaptureReader &reader, int slot, PipelineSettings &settings, FilterEvalTrace &trace, std::string &error);
+
+	struct FilterEvalResult
+	{
+		uint64_t Frames;
+		//Distance to the truth at display time, over all frames and over moving frames, in pixels.
+		double MeanError;
+		double P95Error;
+		double MovingMeanError;
+		//Time shift that best aligns the output with the truth at display time, in
+		//milliseconds. Positive means the cursor trails behind.
+		double LagMs;
+		//RMS frame to frame movement while the truth is still, in pixels.
+		double JitterPx;
+		//Largest distance past the truth along the direction of travel in the
+		//300ms after a movement stops, in pixels.
+		double OvershootPx;
+	};
+
+	//displayLatency is the time from the frame tick until the frame is on screen, in microseconds.
+	FilterEvalResult evaluateFilter(const FilterEvalTrace &trace, const PipelineSettings &settings, uint64_t displayLatency);
+
+}
@@ -0,0 +1,114 @@
+// Replayer.cpp
+
+#include "Replayer.h"
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "../Diagnostics/Instrumentation.h"
+
+namespace TouchmoteCore {
+
+	Replayer::Replayer(EventSink &sink)
+		: sink(sink)
+	{
+	}
+
+	ReplayResult Replayer::run(CaptureReader &reader, const ReplayOptions &options)
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		ReplayResult result;
+		result.Ok = reader.isValid();
+		result.Error = reader.error();
+		result.Records = 0;
+		result.Reports = 0;
+		result.Frames = 0;
+		result.CaptureDuration = 0;
+		result.WallSeconds = 0;
+		if (!result.Ok)
+			return result;
+
+		PipelineSettings settings;
+		InputPipeline pipeline(settings, sink);
+		std::unique_ptr<JobSystem> jobs;
+		if (options.Workers > 0)
+		{
+			jobs.reset(new JobSystem(options.Workers));
+			pipeline.setJobSystem(jobs.get());
+		}
+
+		Clock::time_point wallStart = Clock::now();
+		bool started = false;
+		uint64_t firstTimestamp = 0;
+		uint64_t nextFrame = 0;
+
+		CaptureRecord record;
+		while (true)
+		{
+			uint64_t decodeStart = Instrumentation::now();
+			if (!reader.next(record))
+				break;
+			if (record.Type == CaptureRecordType::Report)
+				Instrumentation::record(PipelineStage::Decode, record.Slot, Instrumentation::now() - decodeStart);
+
+			result.Records++;
+
+			if (!started)
+			{
+				started = true;
+				firstTimestamp = record.Timestamp;
+				nextFrame = record.Timestamp;
+			}
+
+			//Run every frame that was due before this record arrived.
+			while (nextFrame <= record.Timestamp)
+			{
+				if (!options.MaxSpeed)
+					std::this_thread::sleep_until(wallStart + std::chrono::microseconds(nextFrame - firstTimestamp));
+				pipeline.processFrame(nextFrame);
+				result.Frames++;
+				nextFrame += pipeline.getFramePeriod();
+			}
+
+			switch (record.Type)
+			{
+			case CaptureRecordType::Settings:
+				for (size_t i = 0; i < record.Settings.size(); i++)
+					settings.setValue(record.Settings[i].key, record.Settings[i].value);
+				pipeline.applySettings(settings);
+				break;
+			case CaptureRecordType::Connect:
+				pipeline.connect(record.Slot, record.Timestamp);
+				break;
+			case CaptureRecordType::Disconnect:
+				pipeline.disconnect(record.Slot, record.Timestamp);
+				break;
+			case CaptureRecordType::Report:
+				pipeline.pushReport(record.Report);
+				result.Reports++;
+				break;
+			}
+
+			result.CaptureDuration = record.Timestamp - firstTimestamp;
+		}
+
+		if (!reader.error().empty())
+		{
+			result.Ok = false;
+			result.Error = reader.error();
+		}
+
+		//One last frame for the reports after the final tick.
+		if (started)
+		{
+			pipeline.processFrame(nextFrame);
+			result.Frames++;
+		}
+
+		result.WallSeconds = std::chrono::duration<double>(Clock::now() - wallStart).count();
+		return result;
+	}
+
+}
@@ -0,0 +1,50 @@
+// Replayer.h
+//
+// Feeds a capture through InputPipeline, either paced like the recording or as
+// fast as possible. Frames are ticked on the capture clock in both modes, so the
+// emitted events do not depend on the replay speed. Stage latencies end up in
+// Instrumentation, with report decoding recorded as the Decode stage.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#include "CaptureReader.h"
+#include "../Pipeline/InputPipeline.h"
+
+namespace TouchmoteCore {
+
+	struct ReplayOptions
+	{
+		bool MaxSpeed;
+		//Worker threads for the per controller part of a frame, 0 runs it on the replay thread.
+		int Workers;
+
+		ReplayOptions() : MaxSpeed(false), Workers(0) {}
+	};
+
+	struct ReplayResult
+	{
+		bool Ok;
+		std::string Error;
+		uint64_t Records;
+		uint64_t Reports;
+		uint64_t Frames;
+		//Length of the capture in microseconds.
+		uint64_t CaptureDuration;
+		double WallSeconds;
+	};
+
+	class Replayer
+	{
+	public:
+		explicit Replayer(EventSink &sink);
+
+		ReplayResult run(CaptureReader &reader, const ReplayOptions &options);
+
+	private:
+		EventSink &sink;
+	};
+
+}
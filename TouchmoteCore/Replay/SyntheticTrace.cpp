@@ -0,0 +1,70 @@
+// SyntheticTrace.cpp
+
+#include "SyntheticTrace.h"
+
+#include <cmath>
+#include <string.h>
+
+namespace TouchmoteCore {
+
+	static const double PI = 3.14159265358979323846;
+
+	void makeSyntheticReport(XorShift32 &random, uint64_t timestamp, int controller, WiimoteReport &report)
+	{
+		double seconds = timestamp / 1000000.0;
+
+		memset(&report, 0, sizeof(report));
+		report.Timestamp = timestamp;
+		report.Slot = controller;
+		report.BatteryRaw = 0xc0;
+
+		//Held upright and pointed at the screen, with a little hand tremor on the accelerometer.
+		report.AccelRaw[0] = (uint8_t)(128 + random.nextInt(2));
+		report.AccelRaw[1] = (uint8_t)(128 + random.nextInt(2));
+		report.AccelRaw[2] = (uint8_t)(154 + random.nextInt(2));
+
+		//Press A for 200ms every second.
+		if (((timestamp / 1000) + 150 * controller) % 1000 < 200)
+			report.Buttons |= Button_A;
+
+		//Drop out of reach for 50ms every 3 seconds.
+		bool outOfReach = ((timestamp / 1000) + 500 * controller) % 3000 < 50;
+		if (!outOfReach)
+		{
+			double phase = controller * 0.7;
+			double cx = 512 + 300 * std::sin(2 * PI * 0.25 * seconds + phase);
+			double cy = 384 + 200 * std::sin(2 * PI * 0.4 * seconds + phase);
+			double halfSpan = 100;
+
+			report.IR[0].Found = true;
+			report.IR[0].setRawPosition((int)(cx - halfSpan) + random.nextInt(1), (int)cy + random.nextInt(1));
+			report.IR[0].Size = 3;
+			report.IR[1].Found = true;
+			report.IR[1].setRawPosition((int)(cx + halfSpan) + random.nextInt(1), (int)cy + random.nextInt(1));
+			report.IR[1].Size = 3;
+		}
+	}
+
+	void writeSyntheticCapture(CaptureWriter &writer, const SyntheticTraceConfig &config)
+	{
+		XorShift32 random(config.Seed);
+
+		writer.writeSettings(0, PipelineSettings().toEntries());
+		for (int c = 1; c <= config.Controllers; c++)
+			writer.writeConnect(0, c);
+
+		uint64_t period = 1000000 / (uint64_t)(config.ReportRate > 0 ? config.ReportRate : 1);
+		uint64_t duration = (uint64_t)config.DurationMs * 1000;
+
+		for (uint64_t t = period; t <= duration; t += period)
+		{
+			for (int c = 1; c <= config.Controllers; c++)
+			{
+				WiimoteReport report;
+				makeSyntheticReport(random, t, c, report);
+				writer.writeReport(report);
+			}
+		}
+	}
+
+}
@@ -0,0 +1,55 @@
+// SyntheticTrace.h
+//
+// Generates captures with a plausible sensor bar trace, for replaying and
+// benchmarking without hardware. The output only depends on the config.
+
+#pragma once
+
+#include <stdint.h>
+
+#include "CaptureWriter.h"
+
+namespace TouchmoteCore {
+
+	struct SyntheticTraceConfig
+	{
+		int Controllers;
+		//Reports per second per controller, a Wiimote in IR mode sends about 100.
+		int ReportRate;
+		int DurationMs;
+		uint32_t Seed;
+
+		SyntheticTraceConfig() : Controllers(1), ReportRate(100), DurationMs(10000), Seed(1) {}
+	};
+
+	//Small deterministic generator, used instead of <random> so traces are identical on every platform.
+	class XorShift32
+	{
+	public:
+		explicit XorShift32(uint32_t seed) : state(seed != 0 ? seed : 0x9e3779b9u) {}
+
+		uint32_t next()
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+
+		//Uniform in [-range, range].
+		int nextInt(int range)
+		{
+			return (int)(next() % (uint32_t)(2 * range + 1)) - range;
+		}
+
+	private:
+		uint32_t state;
+	};
+
+	//One report of controller (1-based) at the given time in microseconds. Calls
+	//with the same generator state, time and controller give the same report.
+	void makeSyntheticReport(XorShift32 &random, uint64_t timestamp, int controller, WiimoteReport &report);
+
+	void writeSyntheticCapture(CaptureWriter &writer, const SyntheticTraceConfig &config);
+
+}
@@ -0,0 +1,118 @@
+// TouchmoteFilterEval.cpp
+//
+// Compares the current pointer filter chain with the predictive filter at a few
+// prediction horizons: error against the true position at display time, lag,
+// jitter while holding still and overshoot after a movement stops.
+//
+//   TouchmoteFilterEval [--seconds S] [--rate HZ] [--noise PX] [--seed N] [--latency MS] [--set KEY=VALUE]...
+//   TouchmoteFilterEval --capture FILE [--slot N] [--latency MS] [--set KEY=VALUE]...
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../Replay/CaptureReader.h"
+#include "../Replay/FilterEvaluation.h"
+
+using namespace TouchmoteCore;
+
+static int usage()
+{
+	fprintf(stderr,
+		"usage: TouchmoteFilterEval [--seconds S] [--rate HZ] [--noise PX] [--seed N] [--latency MS] [--set KEY=VALUE]...\n"
+		"       TouchmoteFilterEval --capture FILE [--slot N] [--latency MS] [--set KEY=VALUE]...\n");
+	return 2;
+}
+
+static void printResult(const char *name, const FilterEvalResult &result)
+{
+	printf("%-16s %8llu %10.2f %10.2f %10.2f %8.0f %10.3f %10.2f\n",
+		name,
+		(unsigned long long)result.Frames,
+		result.MeanError,
+		result.P95Error,
+		result.MovingMeanError,
+		result.LagMs,
+		result.JitterPx,
+		result.OvershootPx);
+}
+
+int main(int argc, char **argv)
+{
+	MotionTraceConfig motion;
+	const char *capturePath = NULL;
+	int slot = 0;
+	int latencyMs = 16;
+	std::vector<std::string> overrides;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--capture") && hasValue) capturePath = argv[++i];
+		else if (!strcmp(argv[i], "--slot") && hasValue) slot = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--seconds") && hasValue) motion.DurationMs = (int)(atof(argv[++i]) * 1000);
+		else if (!strcmp(argv[i], "--rate") && hasValue) motion.ReportRate = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--noise") && hasValue) motion.SensorNoise = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--seed") && hasValue) motion.Seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else if (!strcmp(argv[i], "--latency") && hasValue) latencyMs = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--set") && hasValue) overrides.push_back(argv[++i]);
+		else return usage();
+	}
+
+	PipelineSettings settings;
+	FilterEvalTrace trace;
+	if (capturePath != NULL)
+	{
+		std::ifstream in(capturePath, std::ios::binary);
+		if (!in)
+		{
+			fprintf(stderr, "Could not open %s\n", capturePath);
+			return 1;
+		}
+		CaptureReader reader(in);
+		std::string error;
+		if (!loadCaptureTrace(reader, slot, settings, trace, error))
+		{
+			fprintf(stderr, "%s: %s\n", capturePath, error.c_str());
+			return 1;
+		}
+	}
+
+	//Overrides come after the capture's own settings.
+	for (size_t i = 0; i < overrides.size(); i++)
+	{
+		size_t equals = overrides[i].find('=');
+		if (equals == std::string::npos
+			|| !settings.setValue(overrides[i].substr(0, equals), SettingValue::fromString(overrides[i].substr(equals + 1))))
+		{
+			fprintf(stderr, "Unknown setting %s\n", overrides[i].c_str());
+			return 1;
+		}
+	}
+
+	if (capturePath == NULL)
+		makeMotionTrace(motion, settings, trace);
+
+	uint64_t latency = (uint64_t)(latencyMs > 0 ? latencyMs : 0) * 1000;
+	printf("%-16s %8s %10s %10s %10s %8s %10s %10s\n", "filter", "frames", "mean px", "p95 px", "moving px", "lag ms", "jitter px", "overshoot");
+
+	PipelineSettings current = settings;
+	current.pointer_prediction = false;
+	printResult("coordfilter", evaluateFilter(trace, current, latency));
+
+	int horizons[] = { 0, latencyMs / 2, latencyMs, latencyMs * 3 / 2 };
+	for (size_t h = 0; h < sizeof(horizons) / sizeof(horizons[0]); h++)
+	{
+		PipelineSettings predictive = settings;
+		predictive.pointer_prediction = true;
+		predictive.pointer_predictionHorizon = horizons[h];
+		char name[32];
+		sprintf(name, "predict/%dms", horizons[h]);
+		printResult(name, evaluateFilter(trace, predictive, latency));
+	}
+	return 0;
+}
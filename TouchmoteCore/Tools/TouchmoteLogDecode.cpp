@@ -0,0 +1,96 @@
+// TouchmoteLogDecode.cpp
+//
+// Prints a binary log written by BinaryLogSink the way TextLogSink would have,
+// one line per record, optionally only from a level up.
+//
+//   TouchmoteLogDecode [--level trace|debug|info|warning|error] FILE
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../Diagnostics/BinaryLog.h"
+
+using namespace TouchmoteCore;
+
+static int usage()
+{
+	fprintf(stderr, "usage: TouchmoteLogDecode [--level trace|debug|info|warning|error] FILE\n");
+	return 2;
+}
+
+static bool parseLevel(const char *name, LogLevel &level)
+{
+	for (int l = (int)LogLevel::Trace; l < (int)LogLevel::Off; l++)
+	{
+		if (strcmp(name, getLogLevelName((LogLevel)l)) == 0)
+		{
+			level = (LogLevel)l;
+			return true;
+		}
+	}
+	return false;
+}
+
+static const char *getFileName(const char *path)
+{
+	const char *slash = strrchr(path, '/');
+	const char *backslash = strrchr(path, '\\');
+	if (backslash > slash)
+		slash = backslash;
+	return slash != NULL ? slash + 1 : path;
+}
+
+int main(int argc, char **argv)
+{
+	LogLevel level = LogLevel::Trace;
+	const char *path = NULL;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--level") && i + 1 < argc)
+		{
+			if (!parseLevel(argv[++i], level))
+				return usage();
+		}
+		else if (path == NULL && argv[i][0] != '-')
+		{
+			path = argv[i];
+		}
+		else
+		{
+			return usage();
+		}
+	}
+	if (path == NULL)
+		return usage();
+
+	FILE *file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		fprintf(stderr, "Could not open %s\n", path);
+		return 1;
+	}
+	BinaryLogReader reader(file);
+	if (!reader.isValid())
+	{
+		fprintf(stderr, "%s: not a binary log\n", path);
+		fclose(file);
+		return 1;
+	}
+
+	DecodedLogRecord record;
+	while (reader.next(record))
+	{
+		if (record.Level < level)
+			continue;
+		printf("%12.6f %-7s %s:%d %s\n", record.Timestamp / 1e9, getLogLevelName(record.Level),
+			getFileName(record.File), record.Line, record.Message.c_str());
+	}
+	bool complete = feof(file) != 0;
+	fclose(file);
+	if (!complete)
+	{
+		fprintf(stderr, "%s: damaged record, stopped\n", path);
+		return 1;
+	}
+	return 0;
+}
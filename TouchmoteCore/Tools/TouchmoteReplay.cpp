@@ -0,0 +1,179 @@
+// TouchmoteReplay.cpp
+//
+// Replays an input capture through the native pipeline and prints the output
+// events followed by per-stage latency percentiles and counters.
+//
+//   TouchmoteReplay [--max-speed] [--quiet] [--workers N] [--events FILE] CAPTURE
+//   TouchmoteReplay --synthesize FILE [--controllers N] [--rate HZ] [--seconds S] [--seed N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fstream>
+#include <string>
+
+#include "../Diagnostics/Instrumentation.h"
+#include "../Replay/CaptureReader.h"
+#include "../Replay/CaptureWriter.h"
+#include "../Replay/Replayer.h"
+#include "../Replay/SyntheticTrace.h"
+
+using namespace TouchmoteCore;
+
+class PrintingSink : public EventSink
+{
+public:
+	explicit PrintingSink(FILE *out) : out(out) {}
+
+	virtual void onEvent(const OutputEvent &event)
+	{
+		if (out == NULL)
+			return;
+		fprintf(out, "%llu %llu %s slot=%d id=%llu x=%.3f y=%.3f%s buttons=%x\n",
+			(unsigned long long)event.Frame,
+			(unsigned long long)event.Timestamp,
+			getEventTypeName(event.EventType),
+			event.Slot,
+			(unsigned long long)event.ID,
+			event.X,
+			event.Y,
+			event.OutOfReach ? " out" : "",
+			event.Buttons);
+	}
+
+private:
+	FILE *out;
+};
+
+static int usage()
+{
+	fprintf(stderr,
+		"usage: TouchmoteReplay [--max-speed] [--quiet] [--workers N] [--events FILE] CAPTURE\n"
+		"       TouchmoteReplay --synthesize FILE [--controllers N] [--rate HZ] [--seconds S] [--seed N]\n");
+	return 2;
+}
+
+static int synthesize(const char *path, const SyntheticTraceConfig &config)
+{
+	std::ofstream out(path, std::ios::binary);
+	if (!out)
+	{
+		fprintf(stderr, "Could not open %s for writing\n", path);
+		return 1;
+	}
+	CaptureWriter writer(out);
+	writeSyntheticCapture(writer, config);
+	if (!writer.good())
+	{
+		fprintf(stderr, "Error writing %s\n", path);
+		return 1;
+	}
+	return 0;
+}
+
+static void printInstrumentation(FILE *out)
+{
+	InstrumentationSnapshot snapshot;
+	Instrumentation::snapshot(snapshot);
+
+	fprintf(out, "%-10s %5s %10s %10s %10s %10s %10s %10s\n", "stage", "slot", "count", "mean ns", "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+	for (size_t i = 0; i < snapshot.Stages.size(); i++)
+	{
+		const StageSummary &stage = snapshot.Stages[i];
+		char slot[16];
+		if (stage.Controller < 0)
+			strcpy(slot, "all");
+		else
+			sprintf(slot, "%d", stage.Controller);
+		fprintf(out, "%-10s %5s %10llu %10.0f %10llu %10llu %10llu %10llu\n",
+			getStageName(stage.Stage),
+			slot,
+			(unsigned long long)stage.Count,
+			stage.MeanNs,
+			(unsigned long long)stage.P50Ns,
+			(unsigned long long)stage.P99Ns,
+			(unsigned long long)stage.P999Ns,
+			(unsigned long long)stage.MaxNs);
+	}
+
+	for (int n = 0; n < (int)InstrumentationCounter::Count; n++)
+	{
+		uint64_t value = snapshot.getCounter((InstrumentationCounter)n, -1);
+		fprintf(out, "%s=%llu%s", getCounterName((InstrumentationCounter)n), (unsigned long long)value, n + 1 < (int)InstrumentationCounter::Count ? " " : "\n");
+	}
+}
+
+int main(int argc, char **argv)
+{
+	ReplayOptions options;
+	SyntheticTraceConfig traceConfig;
+	const char *capturePath = NULL;
+	const char *synthesizePath = NULL;
+	const char *eventsPath = NULL;
+	bool quiet = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "--max-speed")) options.MaxSpeed = true;
+		else if (!strcmp(argv[i], "--quiet")) quiet = true;
+		else if (!strcmp(argv[i], "--workers") && hasValue) options.Workers = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--events") && hasValue) eventsPath = argv[++i];
+		else if (!strcmp(argv[i], "--synthesize") && hasValue) synthesizePath = argv[++i];
+		else if (!strcmp(argv[i], "--controllers") && hasValue) traceConfig.Controllers = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--rate") && hasValue) traceConfig.ReportRate = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--seconds") && hasValue) traceConfig.DurationMs = (int)(atof(argv[++i]) * 1000);
+		else if (!strcmp(argv[i], "--seed") && hasValue) traceConfig.Seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else if (argv[i][0] != '-' && capturePath == NULL) capturePath = argv[i];
+		else return usage();
+	}
+
+	if (synthesizePath != NULL)
+		return synthesize(synthesizePath, traceConfig);
+
+	if (capturePath == NULL)
+		return usage();
+
+	std::ifstream in(capturePath, std::ios::binary);
+	if (!in)
+	{
+		fprintf(stderr, "Could not open %s\n", capturePath);
+		return 1;
+	}
+
+	FILE *events = quiet ? NULL : stdout;
+	if (eventsPath != NULL)
+	{
+		events = fopen(eventsPath, "w");
+		if (events == NULL)
+		{
+			fprintf(stderr, "Could not open %s for writing\n", eventsPath);
+			return 1;
+		}
+	}
+
+	PrintingSink sink(events);
+	CaptureReader reader(in);
+	Replayer replayer(sink);
+	Instrumentation::reset();
+	ReplayResult result = replayer.run(reader, options);
+
+	if (events != NULL && events != stdout)
+		fclose(events);
+
+	if (!result.Ok)
+	{
+		fprintf(stderr, "%s: %s\n", capturePath, result.Error.c_str());
+		return 1;
+	}
+
+	fprintf(stderr, "%llu records, %llu reports, %llu frames, %.3fs of capture replayed in %.3fs\n",
+		(unsigned long long)result.Records,
+		(unsigned long long)result.Reports,
+		(unsigned long long)result.Frames,
+		result.CaptureDuration / 1000000.0,
+		result.WallSeconds);
+	printInstrumentation(stderr);
+	return 0;
+}
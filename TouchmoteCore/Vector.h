@@ -0,0 +1,52 @@
+// Vector.h
+//
+// Minimal 2D vector matching the semantics of System.Windows.Vector/Point
+// as used by the managed pipeline.
+
+#pragma once
+
+#include <cmath>
+
+namespace TouchmoteCore {
+
+	struct Vector
+	{
+		double X;
+		double Y;
+
+		Vector() : X(0), Y(0) {}
+		Vector(double x, double y) : X(x), Y(y) {}
+
+		double Length() const
+		{
+			return std::sqrt(X * X + Y * Y);
+		}
+
+		double LengthSquared() const
+		{
+			return X * X + Y * Y;
+		}
+
+		//Unlike System.Windows.Vector, a zero vector stays zero instead of turning into NaN.
+		void Normalize()
+		{
+			double length = Length();
+			if (length > 0)
+			{
+				X /= length;
+				Y /= length;
+			}
+		}
+
+		Vector operator+(const Vector &other) const { return Vector(X + other.X, Y + other.Y); }
+		Vector operator-(const Vector &other) const { return Vector(X - other.X, Y - other.Y); }
+		Vector operator*(double scalar) const { return Vector(X * scalar, Y * scalar); }
+		Vector operator/(double scalar) const { return Vector(X / scalar, Y / scalar); }
+		Vector &operator+=(const Vector &other) { X += other.X; Y += other.Y; return *this; }
+		Vector &operator-=(const Vector &other) { X -= other.X; Y -= other.Y; return *this; }
+		Vector &operator/=(double scalar) { X /= scalar; Y /= scalar; return *this; }
+		bool operator==(const Vector &other) const { return X == other.X && Y == other.Y; }
+		bool operator!=(const Vector &other) const { return !(*this == other); }
+	};
+
+}
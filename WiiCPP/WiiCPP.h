@@ -12,6 +12,11 @@
 #include <strsafe.h>
 #include <vcclr.h>
 #include <map>
+#include <vector>
+
+#include "Devices/BluetoothAddress.h"
+#include "Devices/MonitorTable.h"
+#include "Devices/Win32DisplayConfig.h"
 
 #pragma comment(lib, "Bthprops.lib")
 
@@ -66,6 +71,10 @@ namespace WiiCPP {
 
 		DWORD ShowErrorCode(LPTSTR msg, DWORD dw) 
 		{ 
+			// Nothing to show when the call succeeded
+			if (dw == ERROR_SUCCESS)
+				return dw;
+
 			// Retrieve the system error message for the last-error code
 
 			LPVOID lpMsgBuf;
@@ -96,14 +105,12 @@ namespace WiiCPP {
 		_TCHAR * FormatBTAddress(BLUETOOTH_ADDRESS address)
 		{
 			static _TCHAR ret[20];
-			_stprintf(ret, _T("%02x:%02x:%02x:%02x:%02x:%02x"),
-				address.rgBytes[5],
-				address.rgBytes[4],
-				address.rgBytes[3],
-				address.rgBytes[2],
-				address.rgBytes[1],
-				address.rgBytes[0]
-			);
+			char text[TouchmoteCore::BT_ADDRESS_STRING_LENGTH];
+			TouchmoteCore::formatBTAddress(address.rgBytes, text);
+			for (int i = 0; i < TouchmoteCore::BT_ADDRESS_STRING_LENGTH; i++)
+			{
+				ret[i] = text[i];
+			}
 			return ret;
 		}
 
@@ -477,56 +484,24 @@ namespace WiiCPP {
 
 		static array<MonitorInfo^>^ enumerateMonitors(){
 
-			int numMonitors = 0;
-			int curMonitor = 0;
+			TouchmoteCore::Win32DisplayConfigProvider provider;
+			std::vector<TouchmoteCore::DisplayPath> paths;
+			std::vector<TouchmoteCore::MonitorEntry> entries;
 
-			UINT32 num_of_paths = 0;
-			UINT32 num_of_modes = 0;
-			DISPLAYCONFIG_PATH_INFO* displayPaths = NULL;
-			DISPLAYCONFIG_MODE_INFO* displayModes = NULL;
+			//One entry per physical monitor, see TouchmoteCore::enumerateMonitors
+			TouchmoteCore::enumerateMonitors(provider, paths, entries);
 
-			GetDisplayConfigBufferSizes(QDC_ALL_PATHS, &num_of_paths, &num_of_modes);
-			
-			// Allocate paths and modes dynamically
-			displayPaths = (DISPLAYCONFIG_PATH_INFO*)calloc((int)num_of_paths, sizeof(DISPLAYCONFIG_PATH_INFO));
-			displayModes = (DISPLAYCONFIG_MODE_INFO*)calloc((int)num_of_modes, sizeof(DISPLAYCONFIG_MODE_INFO));
-
-			// Query for the information 
-			LONG result = QueryDisplayConfig(QDC_ALL_PATHS, &num_of_paths, displayPaths, &num_of_modes, displayModes, NULL);
-			
-			std::map<int, gcroot<MonitorInfo^>> monitormap;
+			array<MonitorInfo^>^ monitors = gcnew array<MonitorInfo^>((int)entries.size());
 
-			//display paths lists relationships between virtual desktop (source) -> physical monitors (target)
-			//we will base the list on physical monitor ids
-			//since there can only be either several monitors to one virtual desktop but never 
-			//several virtual desktops to one monitor (as far as I can tell...)
-			for (int i = 0; i < num_of_paths; i++)
+			for (size_t i = 0; i < entries.size(); i++)
 			{
-				if (displayPaths[i].flags & DISPLAYCONFIG_PATH_ACTIVE) //If the monitor is active
-				{
-					monitormap[displayPaths[i].targetInfo.id] = gcnew MonitorInfo();
-					monitormap[displayPaths[i].targetInfo.id]->DeviceName = getGDIDeviceNameFromSource(displayPaths[i].sourceInfo.adapterId, displayPaths[i].sourceInfo.id);
-					monitormap[displayPaths[i].targetInfo.id]->DevicePath = getMonitorDevicePathFromTarget(displayPaths[i].targetInfo.adapterId, displayPaths[i].targetInfo.id);
-					monitormap[displayPaths[i].targetInfo.id]->FriendlyName = getFriendlyNameFromTarget(displayPaths[i].targetInfo.adapterId, displayPaths[i].targetInfo.id);
-				}
+				MonitorInfo^ info = gcnew MonitorInfo();
+				info->DeviceName = gcnew System::String(entries[i].DeviceName.c_str());
+				info->DevicePath = gcnew System::String(entries[i].DevicePath.c_str());
+				info->FriendlyName = gcnew System::String(entries[i].FriendlyName.c_str());
+				monitors[(int)i] = info;
 			}
 
-			array<MonitorInfo^>^ monitors = gcnew array<MonitorInfo^>(monitormap.size());
-			
-			for (std::map<int, gcroot<MonitorInfo^>>::iterator iter = monitormap.begin();
-				iter != monitormap.end();
-				++iter)
-			{
-				/*
-				printf("\n id: %d", iter->first);
-				printf("\n Devname: %s", iter->second->DeviceName);
-				printf("\n friendly: %s", iter->second->FriendlyName);
-				*/
-				monitors[curMonitor++] = iter->second;
-			}
-			
-			free(displayPaths);
-			free(displayModes);
 			return monitors;
 		}
 	};
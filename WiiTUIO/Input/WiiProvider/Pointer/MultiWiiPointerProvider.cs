@@ -54,6 +54,11 @@ public class MultiWiiPointerProvider : IProvider
         private EventHandler<WiimoteChangedEventArgs> wiimoteChangedEventHandler;
         private EventHandler<WiimoteExtensionChangedEventArgs> wiimoteExtensionChangedEventHandler;
 
+        /// <summary>
+        /// Writes every report to Settings.capture_file while running, if set.
+        /// </summary>
+        private ReportRecorder reportRecorder;
+
         #region Properties and Constructor
         /// <summary>
         /// Boolean which indicates if we are generating input or not.
@@ -116,6 +121,10 @@ public MultiWiiPointerProvider()
         public void start()
         {
             Console.WriteLine("Start");
+            if (!String.IsNullOrEmpty(Settings.Default.capture_file))
+            {
+                this.reportRecorder = new ReportRecorder(Settings.Default.capture_file);
+            }
             TouchOutputFactory.getCurrentProviderHandler().connect();
             this.bRunning = true;
             wiimoteConnectorTimer.Change(0, Timeout.Infinite);
@@ -159,6 +168,12 @@ public void stop()
 
             TouchOutputFactory.getCurrentProviderHandler().disconnect();
 
+            if (this.reportRecorder != null)
+            {
+                this.reportRecorder.Dispose();
+                this.reportRecorder = null;
+            }
+
         }
         #endregion
 
@@ -315,6 +330,12 @@ private void connectWiimote(Wiimote wiimote)
             pWiimoteMap[wiimote.HIDDevicePath] = control;
             pDeviceMutex.ReleaseMutex();
 
+            ReportRecorder recorder = this.reportRecorder;
+            if (recorder != null)
+            {
+                recorder.writeConnect(id);
+            }
+
             // Hook up device event handlers.
             wiimote.WiimoteChanged += this.wiimoteChangedEventHandler;
             wiimote.WiimoteExtensionChanged += this.wiimoteExtensionChangedEventHandler;
@@ -432,6 +453,12 @@ private void teardownWiimoteConnection(Wiimote pDevice)
                 }
                 pDeviceMutex.ReleaseMutex();
 
+                ReportRecorder recorder = this.reportRecorder;
+                if (recorder != null)
+                {
+                    recorder.writeDisconnect(wiimoteid);
+                }
+
                 pDevice.SetReportType(InputReport.Status, false);
 
                 pDevice.SetRumble(false);
@@ -565,7 +592,14 @@ private void handleWiimoteChanged(object sender, WiimoteChangedEventArgs e)
 
             eventBuffer[((Wiimote)sender).HIDDevicePath] = e;
 
-            pWiimoteMap[((Wiimote)sender).HIDDevicePath].LastWiimoteEventTime = DateTime.Now;
+            WiimoteControl control = pWiimoteMap[((Wiimote)sender).HIDDevicePath];
+            control.LastWiimoteEventTime = DateTime.Now;
+
+            ReportRecorder recorder = this.reportRecorder;
+            if (recorder != null)
+            {
+                recorder.writeReport(control.Status.ID, e.WiimoteState);
+            }
 
         }
         #endregion
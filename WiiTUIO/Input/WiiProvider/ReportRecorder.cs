@@ -0,0 +1,320 @@
+﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.Linq;
+using System.Text;
+using WiimoteLib;
+using WiiTUIO.Properties;
+
+namespace WiiTUIO.Provider
+{
+    /// <summary>
+    /// Records raw Wiimote reports and the pointer settings to a capture file, so a session can be replayed
+    /// through the native pipeline with TouchmoteCore's TouchmoteReplay tool.
+    /// The layout is documented in TouchmoteCore/Replay/CaptureFormat.h and must be kept in sync with it.
+    /// </summary>
+    public class ReportRecorder : IDisposable
+    {
+        private const ushort CAPTURE_VERSION = 1;
+
+        private const byte RECORD_SETTINGS = 1;
+        private const byte RECORD_CONNECT = 2;
+        private const byte RECORD_DISCONNECT = 3;
+        private const byte RECORD_REPORT = 4;
+
+        private const byte VALUE_BOOL = 0;
+        private const byte VALUE_INT = 1;
+        private const byte VALUE_DOUBLE = 2;
+        private const byte VALUE_STRING = 3;
+
+        private const byte EXTENSION_NONE = 0;
+        private const byte EXTENSION_NUNCHUK = 1;
+        private const byte EXTENSION_CLASSIC = 2;
+
+        private BinaryWriter writer;
+        private Stopwatch clock;
+        private long lastTimestamp = 0;
+        private object writeLock = new object();
+
+        /// <summary>
+        /// Payload buffer, reused for every record.
+        /// </summary>
+        private MemoryStream payload = new MemoryStream(64);
+
+        public ReportRecorder(string filename)
+        {
+            this.writer = new BinaryWriter(new FileStream(filename, FileMode.Create, FileAccess.Write, FileShare.Read));
+            this.writer.Write(Encoding.ASCII.GetBytes("TMCP"));
+            this.writer.Write(CAPTURE_VERSION);
+            this.writer.Write((ushort)0);
+
+            this.clock = Stopwatch.StartNew();
+
+            this.writeSettings();
+            Settings.Default.PropertyChanged += SettingsChanged;
+        }
+
+        private void SettingsChanged(object sender, System.ComponentModel.PropertyChangedEventArgs e)
+        {
+            this.writeSettings();
+        }
+
+        private long now()
+        {
+            return this.clock.ElapsedTicks * 1000000 / Stopwatch.Frequency;
+        }
+
+        public void writeSettings()
+        {
+            System.Drawing.Rectangle bounds = DeviceUtils.DeviceUtil.GetScreen(Settings.Default.primaryMonitor).Bounds;
+
+            lock (writeLock)
+            {
+                payload.SetLength(0);
+                putSetting("screenWidth", bounds.Width);
+                putSetting("screenHeight", bounds.Height);
+                putSetting("pointer_marginsLeftRight", Settings.Default.pointer_marginsLeftRight);
+                putSetting("pointer_marginsTopBottom", Settings.Default.pointer_marginsTopBottom);
+                putSetting("pointer_sensorBarPosCompensation", Settings.Default.pointer_sensorBarPosCompensation);
+                putSetting("pointer_sensorBarPos", Settings.Default.pointer_sensorBarPos);
+                putSetting("pointer_considerRotation", Settings.Default.pointer_considerRotation);
+                putSetting("pointer_customCursor", Settings.Default.pointer_customCursor);
+                putSetting("pointer_FPS", Settings.Default.pointer_FPS);
+                putSetting("pointer_positionSmoothing", Settings.Default.pointer_positionSmoothing);
+                putSetting("pointer_positionRadius", Settings.Default.pointer_positionRadius);
+                putSetting("pointer_cursorStillHideTimeout", Settings.Default.pointer_cursorStillHideTimeout);
+                putSetting("pointer_cursorStillThreshold", Settings.Default.pointer_cursorStillThreshold);
+                putSetting("touch_touchTapThreshold", Settings.Default.touch_touchTapThreshold);
+                putSetting("touch_edgeGestureHelperMargins", Settings.Default.touch_edgeGestureHelperMargins);
+                putSetting("touch_edgeGestureHelperRelease", Settings.Default.touch_edgeGestureHelperRelease);
+                writeRecord(RECORD_SETTINGS, 0);
+            }
+        }
+
+        public void writeConnect(int id)
+        {
+            lock (writeLock)
+            {
+                payload.SetLength(0);
+                writeRecord(RECORD_CONNECT, id);
+            }
+        }
+
+        public void writeDisconnect(int id)
+        {
+            lock (writeLock)
+            {
+                payload.SetLength(0);
+                writeRecord(RECORD_DISCONNECT, id);
+            }
+        }
+
+        public void writeReport(int id, WiimoteState ws)
+        {
+            lock (writeLock)
+            {
+                payload.SetLength(0);
+
+                putVarint(getButtons(ws));
+                payload.WriteByte(clampByte(ws.AccelState.RawValues.X));
+                payload.WriteByte(clampByte(ws.AccelState.RawValues.Y));
+                payload.WriteByte(clampByte(ws.AccelState.RawValues.Z));
+                payload.WriteByte(ws.BatteryRaw);
+
+                IRSensor[] sensors = ws.IRState.IRSensors;
+                byte mask = 0;
+                for (int i = 0; i < sensors.Length && i < 4; i++)
+                {
+                    if (sensors[i].Found)
+                    {
+                        mask |= (byte)(1 << i);
+                    }
+                }
+                payload.WriteByte(mask);
+                for (int i = 0; i < sensors.Length && i < 4; i++)
+                {
+                    if (sensors[i].Found)
+                    {
+                        putU16(sensors[i].RawPosition.X);
+                        putU16(sensors[i].RawPosition.Y);
+                        payload.WriteByte(clampByte(sensors[i].Size));
+                    }
+                }
+
+                if (ws.Extension && ws.ExtensionType == ExtensionType.Nunchuk)
+                {
+                    payload.WriteByte(EXTENSION_NUNCHUK);
+                    payload.WriteByte(6);
+                    payload.WriteByte(clampByte(ws.NunchukState.RawJoystick.X));
+                    payload.WriteByte(clampByte(ws.NunchukState.RawJoystick.Y));
+                    payload.WriteByte(clampByte(ws.NunchukState.AccelState.RawValues.X));
+                    payload.WriteByte(clampByte(ws.NunchukState.AccelState.RawValues.Y));
+                    payload.WriteByte(clampByte(ws.NunchukState.AccelState.RawValues.Z));
+                    payload.WriteByte(0);
+                }
+                else if (ws.Extension && ws.ExtensionType == ExtensionType.ClassicController)
+                {
+                    payload.WriteByte(EXTENSION_CLASSIC);
+                    payload.WriteByte(6);
+                    payload.WriteByte(clampByte(ws.ClassicControllerState.RawJoystickL.X));
+                    payload.WriteByte(clampByte(ws.ClassicControllerState.RawJoystickL.Y));
+                    payload.WriteByte(clampByte(ws.ClassicControllerState.RawJoystickR.X));
+                    payload.WriteByte(clampByte(ws.ClassicControllerState.RawJoystickR.Y));
+                    payload.WriteByte(ws.ClassicControllerState.RawTriggerL);
+                    payload.WriteByte(ws.ClassicControllerState.RawTriggerR);
+                }
+                else
+                {
+                    payload.WriteByte(EXTENSION_NONE);
+                }
+
+                writeRecord(RECORD_REPORT, id);
+            }
+        }
+
+        /// <summary>
+        /// Same layout as WiiKeyMapper.ButtonFlag.
+        /// </summary>
+        private static uint getButtons(WiimoteState ws)
+        {
+            ButtonState b = ws.ButtonState;
+            uint buttons = 0;
+            if (b.A) buttons |= 1 << 0;
+            if (b.B) buttons |= 1 << 1;
+            if (b.Up) buttons |= 1 << 2;
+            if (b.Down) buttons |= 1 << 3;
+            if (b.Left) buttons |= 1 << 4;
+            if (b.Right) buttons |= 1 << 5;
+            if (b.Minus) buttons |= 1 << 6;
+            if (b.Plus) buttons |= 1 << 7;
+            if (b.Home) buttons |= 1 << 8;
+            if (b.One) buttons |= 1 << 9;
+            if (b.Two) buttons |= 1 << 10;
+
+            if (ws.Extension && ws.ExtensionType == ExtensionType.Nunchuk)
+            {
+                if (ws.NunchukState.C) buttons |= 1 << 11;
+                if (ws.NunchukState.Z) buttons |= 1 << 12;
+            }
+
+            if (ws.Extension && ws.ExtensionType == ExtensionType.ClassicController)
+            {
+                ClassicControllerButtonState c = ws.ClassicControllerState.ButtonState;
+                if (c.A) buttons |= 1 << 13;
+                if (c.B) buttons |= 1 << 14;
+                if (c.X) buttons |= 1 << 15;
+                if (c.Y) buttons |= 1 << 16;
+                if (c.Up) buttons |= 1 << 17;
+                if (c.Down) buttons |= 1 << 18;
+                if (c.Left) buttons |= 1 << 19;
+                if (c.Right) buttons |= 1 << 20;
+                if (c.Home) buttons |= 1 << 21;
+                if (c.Plus) buttons |= 1 << 22;
+                if (c.Minus) buttons |= 1 << 23;
+                if (c.TriggerL) buttons |= 1 << 24;
+                if (c.TriggerR) buttons |= 1 << 25;
+                if (c.ZL) buttons |= 1 << 26;
+                if (c.ZR) buttons |= 1 << 27;
+            }
+            return buttons;
+        }
+
+        private void writeRecord(byte type, int slot)
+        {
+            if (writer == null)
+            {
+                return;
+            }
+
+            long timestamp = now();
+            ulong delta = timestamp > lastTimestamp ? (ulong)(timestamp - lastTimestamp) : 0;
+            if (timestamp > lastTimestamp)
+            {
+                lastTimestamp = timestamp;
+            }
+
+            writer.Write(type);
+            writeVarint(writer, delta);
+            writer.Write((byte)slot);
+            writeVarint(writer, (ulong)payload.Length);
+            writer.Write(payload.GetBuffer(), 0, (int)payload.Length);
+        }
+
+        private void putSetting(string key, object value)
+        {
+            byte[] keyBytes = Encoding.ASCII.GetBytes(key);
+            payload.WriteByte((byte)keyBytes.Length);
+            payload.Write(keyBytes, 0, keyBytes.Length);
+
+            if (value is bool)
+            {
+                payload.WriteByte(VALUE_BOOL);
+                payload.WriteByte((bool)value ? (byte)1 : (byte)0);
+            }
+            else if (value is int)
+            {
+                int i = (int)value;
+                payload.WriteByte(VALUE_INT);
+                putVarint((uint)((i << 1) ^ (i >> 31)));
+            }
+            else if (value is double)
+            {
+                payload.WriteByte(VALUE_DOUBLE);
+                byte[] bytes = BitConverter.GetBytes((double)value);
+                payload.Write(bytes, 0, bytes.Length);
+            }
+            else
+            {
+                byte[] bytes = Encoding.UTF8.GetBytes(value.ToString());
+                payload.WriteByte(VALUE_STRING);
+                payload.WriteByte((byte)Math.Min(bytes.Length, 255));
+                payload.Write(bytes, 0, Math.Min(bytes.Length, 255));
+            }
+        }
+
+        private void putU16(int value)
+        {
+            payload.WriteByte((byte)(value & 0xff));
+            payload.WriteByte((byte)((value >> 8) & 0xff));
+        }
+
+        private void putVarint(ulong value)
+        {
+            while (value >= 0x80)
+            {
+                payload.WriteByte((byte)((value & 0x7f) | 0x80));
+                value >>= 7;
+            }
+            payload.WriteByte((byte)value);
+        }
+
+        private static void writeVarint(BinaryWriter writer, ulong value)
+        {
+            while (value >= 0x80)
+            {
+                writer.Write((byte)((value & 0x7f) | 0x80));
+                value >>= 7;
+            }
+            writer.Write((byte)value);
+        }
+
+        private static byte clampByte(int value)
+        {
+            return (byte)(value < 0 ? 0 : (value > 255 ? 255 : value));
+        }
+
+        public void Dispose()
+        {
+            Settings.Default.PropertyChanged -= SettingsChanged;
+            lock (writeLock)
+            {
+                if (this.writer != null)
+                {
+                    this.writer.Close();
+                    this.writer = null;
+                }
+            }
+        }
+    }
+}
@@ -442,6 +442,17 @@ public int xinput_rumbleThreshold_small
             }
         }
       
+        private string _capture_file = "";
+        public string capture_file
+        {
+            get { return _capture_file; }
+            set
+            {
+                _capture_file = value;
+                OnPropertyChanged("capture_file");
+            }
+        }
+
         private static string SETTINGS_FILENAME = System.AppDomain.CurrentDomain.BaseDirectory+"settings.json";
 
         private static Settings defaultInstance;